@@ -0,0 +1,650 @@
+#include "ArchiveCreate.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef USE_LIBARCHIVE
+#include <archive.h>
+#include <archive_entry.h>
+#endif
+
+#include "Checksum.h"
+#include "WorkerPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr std::size_t kReadChunk = 1024 * 1024;
+// Compressed data a worker keeps in memory before moving the entry to a spill file.
+constexpr std::size_t kSpillThreshold = 8 * 1024 * 1024;
+constexpr unsigned kMaxWorkers = 8;
+constexpr std::uint64_t kZip32Limit = 0xFFFFFFFFu;
+constexpr std::uint16_t kVersionDeflate = 20;
+constexpr std::uint16_t kVersionZip64 = 45;
+// General purpose flag bit 11: names are UTF-8.
+constexpr std::uint16_t kFlagUtf8 = 0x0800;
+
+std::int64_t unixFromFileTime(fs::file_time_type time) {
+    auto system = std::chrono::system_clock::now() + (time - fs::file_time_type::clock::now());
+    return std::chrono::duration_cast<std::chrono::seconds>(system.time_since_epoch()).count();
+}
+
+// MS-DOS date (high 16 bits) and time (low 16 bits) in local time, as unzip expects.
+std::uint32_t dosDateTime(std::int64_t seconds) {
+    std::time_t value = static_cast<std::time_t>(seconds);
+    std::tm local {};
+#ifdef _WIN32
+    localtime_s(&local, &value);
+#else
+    localtime_r(&value, &local);
+#endif
+    if (local.tm_year < 80) {
+        return ((1u << 5) | 1u) << 16;
+    }
+    std::uint32_t year = static_cast<std::uint32_t>(std::min(local.tm_year - 80, 127));
+    std::uint32_t date = (year << 9) | (static_cast<std::uint32_t>(local.tm_mon + 1) << 5) |
+                         static_cast<std::uint32_t>(local.tm_mday);
+    std::uint32_t time = (static_cast<std::uint32_t>(local.tm_hour) << 11) |
+                         (static_cast<std::uint32_t>(local.tm_min) << 5) |
+                         static_cast<std::uint32_t>(local.tm_sec / 2);
+    return (date << 16) | time;
+}
+
+void put16(std::string& out, std::uint64_t value) {
+    for (int i = 0; i < 2; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFFu));
+    }
+}
+
+void put32(std::string& out, std::uint64_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFFu));
+    }
+}
+
+void put64(std::string& out, std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFFu));
+    }
+}
+
+void setActivity(ExtractProgress& progress, std::size_t slot, const ArchiveSource* source, std::uint64_t done) {
+    std::lock_guard<std::mutex> lock(progress.mutex);
+    ExtractActivity& activity = progress.active[slot];
+    if (!source) {
+        activity = {};
+        return;
+    }
+    activity.name = source->name;
+    activity.size = source->size;
+    activity.done = done;
+}
+
+bool addSource(const fs::path& path, const fs::path& base, std::vector<ArchiveSource>& sources,
+               std::uint64_t& totalBytes) {
+    std::error_code ec;
+    fs::file_status status = fs::symlink_status(path, ec);
+    if (ec) {
+        return false;
+    }
+    ArchiveSource source;
+    source.path = path;
+    source.name = path.lexically_relative(base).generic_u8string();
+    source.mode = static_cast<std::uint32_t>(status.permissions() & fs::perms::mask);
+    source.modified = unixFromFileTime(fs::last_write_time(path, ec));
+    if (ec) {
+        source.modified = unixFromFileTime(fs::file_time_type::clock::now());
+    }
+    if (fs::is_symlink(status)) {
+        source.isLink = true;
+        source.linkTarget = fs::read_symlink(path, ec).generic_u8string();
+    } else if (fs::is_directory(status)) {
+        source.isDir = true;
+        source.name += "/";
+    } else if (fs::is_regular_file(status)) {
+        source.size = fs::file_size(path, ec);
+        totalBytes += source.size;
+    } else {
+        // Sockets, pipes and devices have no content to archive.
+        return true;
+    }
+    sources.push_back(source);
+    return true;
+}
+
+struct ZipRecord {
+    const ArchiveSource* source = nullptr;
+    std::uint64_t offset = 0;
+    std::uint64_t compressedSize = 0;
+    std::uint64_t uncompressedSize = 0;
+    std::uint32_t crc = 0;
+    std::uint16_t method = 0;
+    std::uint32_t dosTime = 0;
+};
+
+// Compressed bytes of one entry. They stay in memory until they outgrow
+// kSpillThreshold and then move to a temporary file.
+class EntryData {
+public:
+    explicit EntryData(fs::path spillPath) : spillPath_(std::move(spillPath)) {}
+    ~EntryData() {
+        clear();
+    }
+
+    bool append(const char* data, std::size_t size, std::string& error) {
+        size_ += size;
+        if (!spill_.is_open() && memory_.size() + size <= kSpillThreshold) {
+            memory_.append(data, size);
+            return true;
+        }
+        if (!spill_.is_open()) {
+            spill_.open(spillPath_, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+            spill_.write(memory_.data(), static_cast<std::streamsize>(memory_.size()));
+            memory_.clear();
+        }
+        spill_.write(data, static_cast<std::streamsize>(size));
+        if (!spill_) {
+            error = "Failed to write temporary file";
+            return false;
+        }
+        return true;
+    }
+
+    std::uint64_t size() const {
+        return size_;
+    }
+
+    bool copyTo(OutputFile& output, std::uint64_t offset, std::vector<char>& buffer, std::string& error) {
+        if (!spill_.is_open()) {
+            return output.write(memory_.data(), memory_.size(), offset, error);
+        }
+        spill_.flush();
+        spill_.seekg(0);
+        std::uint64_t left = size_;
+        while (left > 0) {
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(left, buffer.size()));
+            if (!spill_.read(buffer.data(), static_cast<std::streamsize>(chunk))) {
+                error = "Failed to read temporary file";
+                return false;
+            }
+            if (!output.write(buffer.data(), chunk, offset, error)) {
+                return false;
+            }
+            offset += chunk;
+            left -= chunk;
+        }
+        return true;
+    }
+
+    void clear() {
+        memory_.clear();
+        size_ = 0;
+        if (spill_.is_open()) {
+            spill_.close();
+            std::error_code ec;
+            fs::remove(spillPath_, ec);
+        }
+        spill_.clear();
+    }
+
+private:
+    fs::path spillPath_;
+    std::string memory_;
+    std::fstream spill_;
+    std::uint64_t size_ = 0;
+};
+
+#ifdef USE_ZLIB
+// Copies the file as it is, for entries deflate would have made larger.
+bool storeFile(const ArchiveSource& source, std::uint64_t size, EntryData& data, std::vector<char>& input,
+               std::string& error) {
+    std::ifstream in(source.path, std::ios::binary);
+    std::uint64_t left = size;
+    while (left > 0) {
+        std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(left, input.size()));
+        if (!in.read(input.data(), static_cast<std::streamsize>(chunk))) {
+            error = source.path.filename().string() + " changed while compressing";
+            return false;
+        }
+        if (!data.append(input.data(), chunk, error)) {
+            return false;
+        }
+        left -= chunk;
+    }
+    return true;
+}
+#endif
+
+// Reads the file once, feeding the CRC and the deflater from the same buffer.
+bool compressFile(const ArchiveSource& source, ZipRecord& record, EntryData& data, std::vector<char>& input,
+                  std::vector<char>& output, ExtractProgress& progress, std::size_t slot, std::string& error) {
+    std::ifstream in(source.path, std::ios::binary);
+    if (!in) {
+        error = "Failed to read " + source.path.filename().string();
+        return false;
+    }
+    setActivity(progress, slot, &source, 0);
+#ifdef USE_ZLIB
+    z_stream stream {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        error = "Failed to start compression";
+        return false;
+    }
+#endif
+    Crc32 crc;
+    std::uint64_t total = 0;
+    bool end = false;
+    bool ok = true;
+    while (ok && !end) {
+        if (progress.cancel) {
+            error = "Cancelled";
+            ok = false;
+            break;
+        }
+        in.read(input.data(), static_cast<std::streamsize>(input.size()));
+        std::size_t got = static_cast<std::size_t>(in.gcount());
+        if (in.bad()) {
+            error = "Failed to read " + source.path.filename().string();
+            ok = false;
+            break;
+        }
+        end = got < input.size();
+        crc.update(input.data(), got);
+        total += got;
+        progress.bytesDone += got;
+        setActivity(progress, slot, &source, total);
+#ifdef USE_ZLIB
+        stream.next_in = reinterpret_cast<Bytef*>(input.data());
+        stream.avail_in = static_cast<uInt>(got);
+        do {
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            if (deflate(&stream, end ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) {
+                error = "Failed to compress " + source.path.filename().string();
+                ok = false;
+                break;
+            }
+            std::size_t produced = output.size() - stream.avail_out;
+            ok = data.append(output.data(), produced, error);
+        } while (ok && stream.avail_out == 0);
+#else
+        (void)output;
+        ok = data.append(input.data(), got, error);
+#endif
+    }
+#ifdef USE_ZLIB
+    deflateEnd(&stream);
+#endif
+    setActivity(progress, slot, nullptr, 0);
+    if (!ok) {
+        return false;
+    }
+    record.crc = crc.value();
+    record.uncompressedSize = total;
+    record.compressedSize = data.size();
+#ifdef USE_ZLIB
+    record.method = 8;
+    if (data.size() >= total) {
+        data.clear();
+        if (!storeFile(source, total, data, input, error)) {
+            return false;
+        }
+        record.method = 0;
+        record.compressedSize = total;
+    }
+#else
+    record.method = 0;
+#endif
+    return true;
+}
+
+std::string localHeader(const ZipRecord& record) {
+    bool zip64 = record.uncompressedSize >= kZip32Limit || record.compressedSize >= kZip32Limit;
+    const std::string& name = record.source->name;
+    std::string header;
+    put32(header, 0x04034b50u);
+    put16(header, zip64 ? kVersionZip64 : kVersionDeflate);
+    put16(header, kFlagUtf8);
+    put16(header, record.method);
+    put32(header, record.dosTime);
+    put32(header, record.crc);
+    put32(header, zip64 ? kZip32Limit : record.compressedSize);
+    put32(header, zip64 ? kZip32Limit : record.uncompressedSize);
+    put16(header, name.size());
+    put16(header, zip64 ? 20 : 0);
+    header += name;
+    if (zip64) {
+        put16(header, 0x0001);
+        put16(header, 16);
+        put64(header, record.uncompressedSize);
+        put64(header, record.compressedSize);
+    }
+    return header;
+}
+
+void appendCentralHeader(std::string& out, const ZipRecord& record) {
+    const ArchiveSource& source = *record.source;
+    bool bigSize = record.uncompressedSize >= kZip32Limit;
+    bool bigCompressed = record.compressedSize >= kZip32Limit;
+    bool bigOffset = record.offset >= kZip32Limit;
+    std::string extra;
+    if (bigSize || bigCompressed || bigOffset) {
+        put16(extra, 0x0001);
+        put16(extra, 8 * ((bigSize ? 1 : 0) + (bigCompressed ? 1 : 0) + (bigOffset ? 1 : 0)));
+        if (bigSize) {
+            put64(extra, record.uncompressedSize);
+        }
+        if (bigCompressed) {
+            put64(extra, record.compressedSize);
+        }
+        if (bigOffset) {
+            put64(extra, record.offset);
+        }
+    }
+#ifdef _WIN32
+    std::uint16_t madeBy = kVersionZip64;
+    std::uint32_t attributes = source.isDir ? 0x10u : 0x20u;
+#else
+    std::uint16_t madeBy = (3u << 8) | kVersionZip64;
+    std::uint32_t type = source.isDir ? 0040000u : (source.isLink ? 0120000u : 0100000u);
+    std::uint32_t attributes = ((type | source.mode) << 16) | (source.isDir ? 0x10u : 0u);
+#endif
+    put32(out, 0x02014b50u);
+    put16(out, madeBy);
+    put16(out, extra.empty() ? kVersionDeflate : kVersionZip64);
+    put16(out, kFlagUtf8);
+    put16(out, record.method);
+    put32(out, record.dosTime);
+    put32(out, record.crc);
+    put32(out, bigCompressed ? kZip32Limit : record.compressedSize);
+    put32(out, bigSize ? kZip32Limit : record.uncompressedSize);
+    put16(out, source.name.size());
+    put16(out, extra.size());
+    put16(out, 0);
+    put16(out, 0);
+    put16(out, 0);
+    put32(out, attributes);
+    put32(out, bigOffset ? kZip32Limit : record.offset);
+    out += source.name;
+    out += extra;
+}
+
+// Central directory plus the end records, switching to ZIP64 ones when the classic
+// fields overflow.
+std::string centralDirectory(const std::vector<ZipRecord>& records, std::uint64_t offset) {
+    std::string out;
+    for (const ZipRecord& record : records) {
+        appendCentralHeader(out, record);
+    }
+    std::uint64_t size = out.size();
+    std::uint64_t count = records.size();
+    if (count >= 0xFFFFu || size >= kZip32Limit || offset >= kZip32Limit) {
+        std::uint64_t endOffset = offset + size;
+        put32(out, 0x06064b50u);
+        put64(out, 44);
+        put16(out, kVersionZip64);
+        put16(out, kVersionZip64);
+        put32(out, 0);
+        put32(out, 0);
+        put64(out, count);
+        put64(out, count);
+        put64(out, size);
+        put64(out, offset);
+        put32(out, 0x07064b50u);
+        put32(out, 0);
+        put64(out, endOffset);
+        put32(out, 1);
+    }
+    put32(out, 0x06054b50u);
+    put16(out, 0);
+    put16(out, 0);
+    put16(out, std::min<std::uint64_t>(count, 0xFFFFu));
+    put16(out, std::min<std::uint64_t>(count, 0xFFFFu));
+    put32(out, std::min<std::uint64_t>(size, kZip32Limit));
+    put32(out, std::min<std::uint64_t>(offset, kZip32Limit));
+    put16(out, 0);
+    return out;
+}
+} // namespace
+
+bool collectArchiveSources(const fs::path& root, std::vector<ArchiveSource>& sources, std::uint64_t& totalBytes,
+                           std::string& error) {
+    sources.clear();
+    totalBytes = 0;
+    fs::path base = root.parent_path();
+    if (!addSource(root, base, sources, totalBytes)) {
+        error = "Source not found";
+        return false;
+    }
+    if (sources.empty() || !sources.front().isDir) {
+        return true;
+    }
+    std::error_code ec;
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+    fs::recursive_directory_iterator end;
+    for (; !ec && it != end; it.increment(ec)) {
+        addSource(it->path(), base, sources, totalBytes);
+    }
+    if (ec) {
+        error = "Failed to read " + root.filename().string();
+        return false;
+    }
+    return true;
+}
+
+bool createZipArchive(const std::vector<ArchiveSource>& sources, const fs::path& zipPath, unsigned threads,
+                      ExtractProgress& progress, std::string& error) {
+    OutputFile output;
+    if (!output.open(zipPath, 0, error)) {
+        return false;
+    }
+    std::vector<ZipRecord> records;
+    std::vector<const ArchiveSource*> queue;
+    std::uint64_t nextOffset = 0;
+    // Folders carry no data, so they go in first, in walk order.
+    for (const ArchiveSource& source : sources) {
+        if (!source.isDir) {
+            queue.push_back(&source);
+            continue;
+        }
+        ZipRecord record;
+        record.source = &source;
+        record.offset = nextOffset;
+        record.dosTime = dosDateTime(source.modified);
+        std::string header = localHeader(record);
+        if (!output.write(header.data(), header.size(), nextOffset, error)) {
+            return false;
+        }
+        nextOffset += header.size();
+        records.push_back(record);
+    }
+    std::stable_sort(queue.begin(), queue.end(),
+                     [](const ArchiveSource* a, const ArchiveSource* b) { return a->size > b->size; });
+
+    threads = workerCount(threads, kMaxWorkers, queue.size());
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        progress.active.assign(threads, {});
+    }
+
+    // Scratch space of each worker, reused from one entry to the next.
+    struct WorkerBuffers {
+        std::vector<char> input = std::vector<char>(kReadChunk);
+        std::vector<char> compressed = std::vector<char>(kReadChunk);
+        std::unique_ptr<EntryData> data;
+    };
+    std::vector<WorkerBuffers> buffers(threads);
+    for (std::size_t slot = 0; slot < threads; ++slot) {
+        fs::path spillPath = fs::path(zipPath).concat(".part" + std::to_string(slot));
+        buffers[slot].data = std::make_unique<EntryData>(spillPath);
+    }
+    std::atomic<bool> failed {false};
+    std::mutex outputMutex;
+    runParallel(queue.size(), threads, [&](std::size_t slot, std::size_t index) {
+        if (progress.cancel) {
+            return false;
+        }
+        std::vector<char>& input = buffers[slot].input;
+        EntryData& data = *buffers[slot].data;
+        const ArchiveSource& source = *queue[index];
+        ZipRecord record;
+        record.source = &source;
+        record.dosTime = dosDateTime(source.modified);
+        std::string itemError;
+        bool ok = true;
+        data.clear();
+        if (source.isLink) {
+            Crc32 crc;
+            crc.update(source.linkTarget.data(), source.linkTarget.size());
+            record.crc = crc.value();
+            record.compressedSize = record.uncompressedSize = source.linkTarget.size();
+            ok = data.append(source.linkTarget.data(), source.linkTarget.size(), itemError);
+        } else {
+            ok = compressFile(source, record, data, input, buffers[slot].compressed, progress, slot, itemError);
+        }
+        if (ok) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            record.offset = nextOffset;
+            std::string header = localHeader(record);
+            ok = output.write(header.data(), header.size(), nextOffset, itemError) &&
+                 data.copyTo(output, nextOffset + header.size(), input, itemError);
+            nextOffset += header.size() + data.size();
+            records.push_back(record);
+        }
+        if (!ok) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (!failed.exchange(true)) {
+                error = itemError;
+            }
+            return false;
+        }
+        ++progress.filesDone;
+        return true;
+    });
+    // Removes the spill files.
+    buffers.clear();
+    if (failed) {
+        return false;
+    }
+    if (progress.cancel) {
+        error = "Cancelled";
+        return false;
+    }
+    std::string directory = centralDirectory(records, nextOffset);
+    return output.write(directory.data(), directory.size(), nextOffset, error) && output.close(error);
+}
+
+#ifdef USE_LIBARCHIVE
+bool createTarZstArchive(const std::vector<ArchiveSource>& sources, const fs::path& tarPath, unsigned threads,
+                         ExtractProgress& progress, std::string& error) {
+    archive* writer = archive_write_new();
+    if (!writer) {
+        error = "Out of memory";
+        return false;
+    }
+    bool opened = false;
+    auto fail = [&](const std::string& message) {
+        error = message;
+        archive_write_free(writer);
+        if (opened) {
+            std::error_code ec;
+            fs::remove(tarPath, ec);
+        }
+        return false;
+    };
+    archive_write_set_format_pax_restricted(writer);
+    if (archive_write_add_filter_zstd(writer) != ARCHIVE_OK) {
+        return fail(archive_error_string(writer) ? archive_error_string(writer) : "zstd is not available");
+    }
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // libarchive before 3.6 does not know the option and compresses on one thread.
+    archive_write_set_filter_option(writer, "zstd", "threads", std::to_string(threads).c_str());
+#ifdef _WIN32
+    int result = archive_write_open_filename_w(writer, tarPath.c_str());
+#else
+    int result = archive_write_open_filename(writer, tarPath.c_str());
+#endif
+    if (result != ARCHIVE_OK) {
+        return fail("Failed to create " + tarPath.filename().string());
+    }
+    opened = true;
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        progress.active.assign(1, {});
+    }
+
+    std::vector<char> buffer(kReadChunk);
+    for (const ArchiveSource& source : sources) {
+        if (progress.cancel) {
+            return fail("Cancelled");
+        }
+        archive_entry* entry = archive_entry_new();
+        archive_entry_set_pathname_utf8(entry, source.name.c_str());
+        archive_entry_set_perm(entry, source.mode);
+        archive_entry_set_mtime(entry, static_cast<time_t>(source.modified), 0);
+        if (source.isDir) {
+            archive_entry_set_filetype(entry, AE_IFDIR);
+        } else if (source.isLink) {
+            archive_entry_set_filetype(entry, AE_IFLNK);
+            archive_entry_set_symlink_utf8(entry, source.linkTarget.c_str());
+        } else {
+            archive_entry_set_filetype(entry, AE_IFREG);
+            archive_entry_set_size(entry, static_cast<la_int64_t>(source.size));
+        }
+        result = archive_write_header(writer, entry);
+        archive_entry_free(entry);
+        if (result != ARCHIVE_OK && result != ARCHIVE_WARN) {
+            return fail(archive_error_string(writer) ? archive_error_string(writer) : "Failed to write archive");
+        }
+        if (source.isDir) {
+            continue;
+        }
+        if (source.isLink) {
+            ++progress.filesDone;
+            continue;
+        }
+        std::ifstream in(source.path, std::ios::binary);
+        if (!in) {
+            return fail("Failed to read " + source.path.filename().string());
+        }
+        setActivity(progress, 0, &source, 0);
+        // The header already promised source.size bytes; libarchive pads a file that shrank.
+        std::uint64_t done = 0;
+        while (done < source.size) {
+            if (progress.cancel) {
+                return fail("Cancelled");
+            }
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(source.size - done, buffer.size()));
+            in.read(buffer.data(), static_cast<std::streamsize>(chunk));
+            std::size_t got = static_cast<std::size_t>(in.gcount());
+            if (got == 0) {
+                break;
+            }
+            if (archive_write_data(writer, buffer.data(), got) < 0) {
+                return fail(archive_error_string(writer) ? archive_error_string(writer) : "Failed to write archive");
+            }
+            done += got;
+            progress.bytesDone += got;
+            setActivity(progress, 0, &source, done);
+        }
+        setActivity(progress, 0, nullptr, 0);
+        ++progress.filesDone;
+    }
+    if (archive_write_close(writer) != ARCHIVE_OK) {
+        return fail(archive_error_string(writer) ? archive_error_string(writer) : "Failed to write archive");
+    }
+    archive_write_free(writer);
+    return true;
+}
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ExtractOutput.h"
+
+// One file, folder or link going into a new archive.
+struct ArchiveSource {
+    std::filesystem::path path;
+    // Name inside the archive with '/' separators; folders end in '/'.
+    std::string name;
+    std::uint64_t size = 0;
+    // Permission bits only.
+    std::uint32_t mode = 0;
+    std::int64_t modified = 0;
+    bool isDir = false;
+    bool isLink = false;
+    std::string linkTarget;
+};
+
+// Walks root (a file or a folder) without following links. Every name starts with
+// root's own name, so the archive unpacks into a single file or folder.
+bool collectArchiveSources(const std::filesystem::path& root, std::vector<ArchiveSource>& sources,
+                           std::uint64_t& totalBytes, std::string& error);
+
+// Writes a ZIP archive (ZIP64 once sizes, offsets or the entry count need it). Files
+// are deflated concurrently on up to `threads` workers (0 picks one per core), largest
+// first; each worker compresses a whole entry, spilling to a temporary file next to
+// the output once it outgrows memory, and appends it when done. Entries that would
+// grow are stored instead, and without zlib everything is stored. progress.bytesDone
+// counts source bytes read. A failed or cancelled run leaves no output behind.
+bool createZipArchive(const std::vector<ArchiveSource>& sources, const std::filesystem::path& zipPath,
+                      unsigned threads, ExtractProgress& progress, std::string& error);
+
+#ifdef USE_LIBARCHIVE
+// Writes a pax tar compressed with zstd. The files are read in order on the calling
+// thread while zstd compresses on up to `threads` workers of its own.
+bool createTarZstArchive(const std::vector<ArchiveSource>& sources, const std::filesystem::path& tarPath,
+                         unsigned threads, ExtractProgress& progress, std::string& error);
+#endif
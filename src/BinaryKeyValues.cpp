@@ -0,0 +1,186 @@
+#include "BinaryKeyValues.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace {
+constexpr std::uint8_t kEnd = 0x08;
+// Real files nest a few levels; the limit keeps a corrupt one from exhausting the stack.
+constexpr int kMaxDepth = 64;
+
+bool sameKey(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class Parser {
+public:
+    Parser(const std::uint8_t* data, std::size_t size) : data_(data), size_(size) {}
+
+    // Reads keys into object until its end marker.
+    bool readObject(KeyValue& object, int depth, std::string& error) {
+        if (depth > kMaxDepth) {
+            error = "KeyValues nested too deeply";
+            return false;
+        }
+        while (true) {
+            if (pos_ >= size_) {
+                error = "Unexpected end of KeyValues data";
+                return false;
+            }
+            std::uint8_t type = data_[pos_++];
+            if (type == kEnd) {
+                return true;
+            }
+            KeyValue child;
+            child.type = static_cast<KeyValue::Type>(type);
+            if (!readString(child.key, error)) {
+                return false;
+            }
+            switch (child.type) {
+            case KeyValue::Type::Object:
+                if (!readObject(child, depth + 1, error)) {
+                    return false;
+                }
+                break;
+            case KeyValue::Type::String:
+                if (!readString(child.text, error)) {
+                    return false;
+                }
+                break;
+            case KeyValue::Type::Int32:
+            case KeyValue::Type::Float:
+            case KeyValue::Type::Pointer:
+            case KeyValue::Type::Color:
+                if (!readBits(child.bits, 4, error)) {
+                    return false;
+                }
+                break;
+            case KeyValue::Type::UInt64:
+            case KeyValue::Type::Int64:
+                if (!readBits(child.bits, 8, error)) {
+                    return false;
+                }
+                break;
+            default:
+                error = "Unsupported KeyValues type " + std::to_string(type) + " at \"" + child.key + "\"";
+                return false;
+            }
+            object.children.push_back(std::move(child));
+        }
+    }
+
+private:
+    bool readString(std::string& out, std::string& error) {
+        const void* end = pos_ < size_ ? std::memchr(data_ + pos_, 0, size_ - pos_) : nullptr;
+        if (!end) {
+            error = "Unterminated KeyValues string";
+            return false;
+        }
+        std::size_t length = static_cast<std::size_t>(static_cast<const std::uint8_t*>(end) - (data_ + pos_));
+        out.assign(reinterpret_cast<const char*>(data_ + pos_), length);
+        pos_ += length + 1;
+        return true;
+    }
+
+    bool readBits(std::uint64_t& out, std::size_t width, std::string& error) {
+        if (size_ - pos_ < width) {
+            error = "Unexpected end of KeyValues data";
+            return false;
+        }
+        out = 0;
+        for (std::size_t i = 0; i < width; ++i) {
+            out |= static_cast<std::uint64_t>(data_[pos_ + i]) << (8 * i);
+        }
+        pos_ += width;
+        return true;
+    }
+
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::size_t pos_ = 0;
+};
+
+void writeObject(const KeyValue& object, std::vector<std::uint8_t>& out) {
+    for (const KeyValue& child : object.children) {
+        out.push_back(static_cast<std::uint8_t>(child.type));
+        out.insert(out.end(), child.key.begin(), child.key.end());
+        out.push_back(0);
+        switch (child.type) {
+        case KeyValue::Type::Object:
+            writeObject(child, out);
+            out.push_back(kEnd);
+            break;
+        case KeyValue::Type::String:
+            out.insert(out.end(), child.text.begin(), child.text.end());
+            out.push_back(0);
+            break;
+        case KeyValue::Type::UInt64:
+        case KeyValue::Type::Int64:
+            for (int i = 0; i < 8; ++i) {
+                out.push_back(static_cast<std::uint8_t>(child.bits >> (8 * i)));
+            }
+            break;
+        default:
+            for (int i = 0; i < 4; ++i) {
+                out.push_back(static_cast<std::uint8_t>(child.bits >> (8 * i)));
+            }
+            break;
+        }
+    }
+}
+} // namespace
+
+KeyValue KeyValue::object(const std::string& key) {
+    KeyValue value;
+    value.type = Type::Object;
+    value.key = key;
+    return value;
+}
+
+KeyValue KeyValue::string(const std::string& key, const std::string& text) {
+    KeyValue value;
+    value.type = Type::String;
+    value.key = key;
+    value.text = text;
+    return value;
+}
+
+KeyValue KeyValue::int32(const std::string& key, std::uint32_t number) {
+    KeyValue value;
+    value.type = Type::Int32;
+    value.key = key;
+    value.bits = number;
+    return value;
+}
+
+const KeyValue* KeyValue::find(const std::string& name) const {
+    for (const KeyValue& child : children) {
+        if (sameKey(child.key, name)) {
+            return &child;
+        }
+    }
+    return nullptr;
+}
+
+KeyValue* KeyValue::find(const std::string& name) {
+    return const_cast<KeyValue*>(static_cast<const KeyValue*>(this)->find(name));
+}
+
+bool parseBinaryKeyValues(const std::uint8_t* data, std::size_t size, KeyValue& root, std::string& error) {
+    root = KeyValue::object("");
+    Parser parser(data, size);
+    return parser.readObject(root, 0, error);
+}
+
+void writeBinaryKeyValues(const KeyValue& root, std::vector<std::uint8_t>& out) {
+    writeObject(root, out);
+    out.push_back(kEnd);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One key of Valve's binary KeyValues format, as used by shortcuts.vdf. Objects hold
+// their children in file order; every other type keeps its value as read, so a parsed
+// tree is written back byte for byte.
+struct KeyValue {
+    enum class Type : std::uint8_t {
+        Object = 0x00,
+        String = 0x01,
+        Int32 = 0x02,
+        Float = 0x03,
+        Pointer = 0x04,
+        Color = 0x06,
+        UInt64 = 0x07,
+        Int64 = 0x0A,
+    };
+
+    Type type = Type::Object;
+    std::string key;
+    // String values.
+    std::string text;
+    // Numeric values as their raw little-endian bits (4 or 8 bytes wide by type).
+    std::uint64_t bits = 0;
+    std::vector<KeyValue> children;
+
+    static KeyValue object(const std::string& key);
+    static KeyValue string(const std::string& key, const std::string& value);
+    static KeyValue int32(const std::string& key, std::uint32_t value);
+
+    // First child whose key matches, ignoring ASCII case as Steam does; nullptr if none.
+    const KeyValue* find(const std::string& name) const;
+    KeyValue* find(const std::string& name);
+};
+
+// Parses a whole file: the top-level keys up to the final end marker go into
+// root.children; anything after that marker is ignored. Wide strings (type 0x05) are
+// rejected.
+bool parseBinaryKeyValues(const std::uint8_t* data, std::size_t size, KeyValue& root, std::string& error);
+
+// Inverse of parseBinaryKeyValues.
+void writeBinaryKeyValues(const KeyValue& root, std::vector<std::uint8_t>& out);
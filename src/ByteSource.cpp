@@ -0,0 +1,89 @@
+#include "ByteSource.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr std::size_t kFetchChunk = 256 * 1024;
+} // namespace
+
+PrefetchSource::PrefetchSource(ByteSource& inner, std::size_t limit) : inner_(inner), limit_(limit) {}
+
+PrefetchSource::~PrefetchSource() {
+    stop();
+}
+
+bool PrefetchSource::open(std::uint64_t offset, std::string& error) {
+    stop();
+    chunks_.clear();
+    consumed_ = 0;
+    buffered_ = 0;
+    finished_ = false;
+    stopping_ = false;
+    error_.clear();
+    if (!inner_.open(offset, error)) {
+        return false;
+    }
+    thread_ = std::thread(&PrefetchSource::fill, this);
+    return true;
+}
+
+long long PrefetchSource::read(char* buffer, std::size_t size, std::string& error) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [&]() { return finished_ || !chunks_.empty(); });
+    if (chunks_.empty()) {
+        if (!error_.empty()) {
+            error = error_;
+            return -1;
+        }
+        return 0;
+    }
+    std::vector<char>& front = chunks_.front();
+    std::size_t count = std::min(size, front.size() - consumed_);
+    std::memcpy(buffer, front.data() + consumed_, count);
+    consumed_ += count;
+    if (consumed_ == front.size()) {
+        buffered_ -= front.size();
+        chunks_.pop_front();
+        consumed_ = 0;
+        changed_.notify_all();
+    }
+    return static_cast<long long>(count);
+}
+
+void PrefetchSource::fill() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [&]() { return stopping_ || buffered_ < limit_; });
+            if (stopping_) {
+                return;
+            }
+        }
+        std::vector<char> chunk(kFetchChunk);
+        std::string error;
+        long long bytes = inner_.read(chunk.data(), chunk.size(), error);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bytes <= 0) {
+            error_ = bytes < 0 ? (error.empty() ? "Read failed" : error) : "";
+            finished_ = true;
+            changed_.notify_all();
+            return;
+        }
+        chunk.resize(static_cast<std::size_t>(bytes));
+        buffered_ += chunk.size();
+        chunks_.push_back(std::move(chunk));
+        changed_.notify_all();
+    }
+}
+
+void PrefetchSource::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        changed_.notify_all();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A file read front to back that can be restarted at any offset, such as a download
+// resumed with FTP REST. Lets the extractors read archives that are not on local disk.
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+    // Starts reading at offset, dropping any read in progress.
+    virtual bool open(std::uint64_t offset, std::string& error) = 0;
+    // Returns the number of bytes read, 0 at end of file or -1 on error.
+    virtual long long read(char* buffer, std::size_t size, std::string& error) = 0;
+};
+
+// Keeps reading the wrapped source on its own thread, up to limit bytes ahead of the
+// caller, so the transfer and whatever consumes it run at the same time.
+class PrefetchSource : public ByteSource {
+public:
+    PrefetchSource(ByteSource& inner, std::size_t limit);
+    ~PrefetchSource() override;
+    PrefetchSource(const PrefetchSource&) = delete;
+    PrefetchSource& operator=(const PrefetchSource&) = delete;
+
+    bool open(std::uint64_t offset, std::string& error) override;
+    long long read(char* buffer, std::size_t size, std::string& error) override;
+
+private:
+    void fill();
+    void stop();
+
+    ByteSource& inner_;
+    std::size_t limit_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<std::vector<char>> chunks_;
+    // Bytes of chunks_.front() already handed out.
+    std::size_t consumed_ = 0;
+    std::size_t buffered_ = 0;
+    bool finished_ = false;
+    bool stopping_ = false;
+    std::string error_;
+};
@@ -0,0 +1,269 @@
+#include "Checksum.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHECKSUM_CLMUL 1
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CLMUL_TARGET
+#else
+#define CLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
+
+namespace {
+using Crc32Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+constexpr Crc32Tables makeCrc32Tables() {
+    Crc32Tables tables {};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1u) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        tables[0][i] = crc;
+    }
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        for (std::size_t t = 1; t < 8; ++t) {
+            std::uint32_t prev = tables[t - 1][i];
+            tables[t][i] = (prev >> 8) ^ tables[0][prev & 0xFFu];
+        }
+    }
+    return tables;
+}
+
+// Slice-by-8 tables: eight input bytes are folded per step instead of one.
+constexpr Crc32Tables kCrc32Tables = makeCrc32Tables();
+
+std::uint32_t crc32Tables(std::uint32_t crc, const std::uint8_t* bytes, std::size_t size) {
+    while (size >= 8) {
+        std::uint32_t low = crc ^ (static_cast<std::uint32_t>(bytes[0]) | static_cast<std::uint32_t>(bytes[1]) << 8 |
+                                   static_cast<std::uint32_t>(bytes[2]) << 16 | static_cast<std::uint32_t>(bytes[3]) << 24);
+        crc = kCrc32Tables[7][low & 0xFFu] ^ kCrc32Tables[6][(low >> 8) & 0xFFu] ^
+              kCrc32Tables[5][(low >> 16) & 0xFFu] ^ kCrc32Tables[4][low >> 24] ^
+              kCrc32Tables[3][bytes[4]] ^ kCrc32Tables[2][bytes[5]] ^
+              kCrc32Tables[1][bytes[6]] ^ kCrc32Tables[0][bytes[7]];
+        bytes += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ kCrc32Tables[0][(crc ^ *bytes++) & 0xFFu];
+    }
+    return crc;
+}
+
+#ifdef CHECKSUM_CLMUL
+bool cpuHasClmul() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 1)) != 0 && (info[2] & (1 << 19)) != 0;
+#else
+    // Runs from a static initializer, possibly before libgcc has filled in its CPU data.
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+const bool kHasClmul = cpuHasClmul();
+
+CLMUL_TARGET inline __m128i load128(const std::uint8_t* p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+// Multiplies both halves of x by their constants in k and adds in the next block.
+CLMUL_TARGET inline __m128i fold128(__m128i x, __m128i k, __m128i next) {
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00)), next);
+}
+
+// Carry-less multiply folding (Intel, "Fast CRC Computation for Generic Polynomials
+// Using PCLMULQDQ Instruction"): four 128-bit lanes fold 64 bytes per step, then get
+// folded down to one and Barrett-reduced to the 32-bit remainder. size must be at
+// least 64 and a multiple of 16. The constants are for the reflected IEEE polynomial.
+CLMUL_TARGET std::uint32_t crc32Clmul(std::uint32_t crc, const std::uint8_t* bytes, std::size_t size) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_xor_si128(load128(bytes), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x2 = load128(bytes + 16);
+    __m128i x3 = load128(bytes + 32);
+    __m128i x4 = load128(bytes + 48);
+    bytes += 64;
+    size -= 64;
+    while (size >= 64) {
+        x1 = fold128(x1, k1k2, load128(bytes));
+        x2 = fold128(x2, k1k2, load128(bytes + 16));
+        x3 = fold128(x3, k1k2, load128(bytes + 32));
+        x4 = fold128(x4, k1k2, load128(bytes + 48));
+        bytes += 64;
+        size -= 64;
+    }
+    x1 = fold128(x1, k3k4, x2);
+    x1 = fold128(x1, k3k4, x3);
+    x1 = fold128(x1, k3k4, x4);
+    while (size >= 16) {
+        x1 = fold128(x1, k3k4, load128(bytes));
+        bytes += 16;
+        size -= 16;
+    }
+
+    // 128 bits down to 64.
+    __m128i folded = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), folded);
+    __m128i upper = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5k0, 0x00), upper);
+
+    // Barrett reduction to 32 bits.
+    __m128i t = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10);
+    t = _mm_clmulepi64_si128(_mm_and_si128(t, low32), poly, 0x00);
+    x1 = _mm_xor_si128(x1, t);
+    return static_cast<std::uint32_t>(_mm_extract_epi32(x1, 1));
+}
+#endif
+
+std::string toHex(const std::uint8_t* bytes, std::size_t size, bool upper) {
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    std::string out;
+    out.reserve(size * 2);
+    for (std::size_t i = 0; i < size; ++i) {
+        out.push_back(digits[bytes[i] >> 4]);
+        out.push_back(digits[bytes[i] & 0x0F]);
+    }
+    return out;
+}
+
+std::uint32_t rotateLeft(std::uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+constexpr std::uint32_t kMd5Sines[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+constexpr int kMd5Shifts[64] = {7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+                                5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20, 5, 9,  14, 20,
+                                4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+                                6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21};
+} // namespace
+
+void Crc32::update(const void* data, std::size_t size) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+#ifdef CHECKSUM_CLMUL
+    if (kHasClmul && size >= 64) {
+        std::size_t bulk = size & ~static_cast<std::size_t>(15);
+        state_ = crc32Clmul(state_, bytes, bulk);
+        bytes += bulk;
+        size -= bulk;
+    }
+#endif
+    state_ = crc32Tables(state_, bytes, size);
+}
+
+std::uint32_t Crc32::value() const {
+    return ~state_;
+}
+
+std::string Crc32::hex() const {
+    std::uint32_t crc = value();
+    std::uint8_t bytes[4] = {static_cast<std::uint8_t>(crc >> 24), static_cast<std::uint8_t>(crc >> 16),
+                             static_cast<std::uint8_t>(crc >> 8), static_cast<std::uint8_t>(crc)};
+    return toHex(bytes, sizeof(bytes), true);
+}
+
+Md5::Md5() : state_ {0x67452301u, 0xefcdab89u, 0x98badcfeu, 0x10325476u}, buffer_ {} {}
+
+void Md5::update(const void* data, std::size_t size) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    length_ += size;
+    if (buffered_ > 0) {
+        std::size_t take = std::min(size, sizeof(buffer_) - buffered_);
+        std::memcpy(buffer_ + buffered_, bytes, take);
+        buffered_ += take;
+        bytes += take;
+        size -= take;
+        if (buffered_ < sizeof(buffer_)) {
+            return;
+        }
+        transform(buffer_);
+        buffered_ = 0;
+    }
+    while (size >= 64) {
+        transform(bytes);
+        bytes += 64;
+        size -= 64;
+    }
+    std::memcpy(buffer_, bytes, size);
+    buffered_ = size;
+}
+
+std::string Md5::hex() {
+    std::uint64_t bits = length_ * 8;
+    std::uint8_t padding[72] = {0x80};
+    std::size_t padLength = (buffered_ < 56) ? 56 - buffered_ : 120 - buffered_;
+    update(padding, padLength);
+    std::uint8_t lengthBytes[8];
+    for (int i = 0; i < 8; ++i) {
+        lengthBytes[i] = static_cast<std::uint8_t>(bits >> (8 * i));
+    }
+    update(lengthBytes, sizeof(lengthBytes));
+    std::uint8_t digest[16];
+    for (int i = 0; i < 4; ++i) {
+        for (int b = 0; b < 4; ++b) {
+            digest[i * 4 + b] = static_cast<std::uint8_t>(state_[i] >> (8 * b));
+        }
+    }
+    return toHex(digest, sizeof(digest), false);
+}
+
+void Md5::transform(const std::uint8_t* block) {
+    std::uint32_t words[16];
+    for (int i = 0; i < 16; ++i) {
+        words[i] = static_cast<std::uint32_t>(block[i * 4]) | static_cast<std::uint32_t>(block[i * 4 + 1]) << 8 |
+                   static_cast<std::uint32_t>(block[i * 4 + 2]) << 16 | static_cast<std::uint32_t>(block[i * 4 + 3]) << 24;
+    }
+    std::uint32_t a = state_[0];
+    std::uint32_t b = state_[1];
+    std::uint32_t c = state_[2];
+    std::uint32_t d = state_[3];
+    for (int i = 0; i < 64; ++i) {
+        std::uint32_t f = 0;
+        int g = 0;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+        std::uint32_t next = d;
+        d = c;
+        c = b;
+        b = b + rotateLeft(a + f + kMd5Sines[i] + words[g], kMd5Shifts[i]);
+        a = next;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Incremental CRC-32 (IEEE polynomial, as used by zip, gzip and the FTP XCRC command).
+class Crc32 {
+public:
+    void update(const void* data, std::size_t size);
+    std::uint32_t value() const;
+    // Eight upper-case hex digits.
+    std::string hex() const;
+
+private:
+    std::uint32_t state_ = 0xFFFFFFFFu;
+};
+
+// Incremental MD5. hex() finalizes the digest; update() must not be called afterwards.
+class Md5 {
+public:
+    Md5();
+    void update(const void* data, std::size_t size);
+    // Thirty-two lower-case hex digits.
+    std::string hex();
+
+private:
+    void transform(const std::uint8_t* block);
+
+    std::uint32_t state_[4];
+    std::uint64_t length_ = 0;
+    std::uint8_t buffer_[64];
+    std::size_t buffered_ = 0;
+};
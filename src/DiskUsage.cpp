@@ -0,0 +1,88 @@
+#include "DiskUsage.h"
+
+#include "WorkerPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr unsigned kMaxWorkers = 8;
+} // namespace
+
+std::uint64_t DiskUsageCache::measure(const fs::path& path, const std::atomic<bool>* cancel) {
+    std::uint64_t total = 0;
+    std::vector<fs::path> stack {path};
+    while (!stack.empty()) {
+        if (cancel && *cancel) {
+            return total;
+        }
+        fs::path dir = std::move(stack.back());
+        stack.pop_back();
+        std::error_code ec;
+        if (!fs::is_directory(fs::symlink_status(dir, ec))) {
+            continue;
+        }
+        std::int64_t modified = fs::last_write_time(dir, ec).time_since_epoch().count();
+        if (ec) {
+            continue;
+        }
+        std::string key = dir.string();
+        Dir entry;
+        bool cached = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto found = dirs_.find(key);
+            if (found != dirs_.end() && found->second.modified == modified) {
+                entry = found->second;
+                cached = true;
+            }
+        }
+        if (cached) {
+            std::uint64_t fileBytes = 0;
+            for (const std::string& name : entry.files) {
+                std::uintmax_t size = fs::file_size(dir / name, ec);
+                fileBytes += ec ? 0 : size;
+            }
+            if (fileBytes != entry.fileBytes) {
+                entry.fileBytes = fileBytes;
+                std::lock_guard<std::mutex> lock(mutex_);
+                dirs_[key].fileBytes = fileBytes;
+            }
+        } else {
+            entry.modified = modified;
+            for (fs::directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+                 !ec && it != fs::directory_iterator(); it.increment(ec)) {
+                std::error_code statError;
+                fs::file_status status = it->symlink_status(statError);
+                if (fs::is_directory(status)) {
+                    entry.subdirs.push_back(it->path().filename().string());
+                } else if (fs::is_regular_file(status)) {
+                    entry.files.push_back(it->path().filename().string());
+                    std::uintmax_t size = it->file_size(statError);
+                    entry.fileBytes += statError ? 0 : size;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            dirs_[key] = entry;
+        }
+        total += entry.fileBytes;
+        for (const std::string& name : entry.subdirs) {
+            stack.push_back(dir / name);
+        }
+    }
+    return total;
+}
+
+bool measureDiskUsage(DiskUsageCache& cache, const std::vector<fs::path>& paths, unsigned threads,
+                      std::vector<std::uint64_t>& bytes, std::atomic<int>& done, const std::atomic<bool>& cancel) {
+    bytes.assign(paths.size(), 0);
+    threads = workerCount(threads, kMaxWorkers, paths.size());
+    runParallel(paths.size(), threads, [&](std::size_t, std::size_t index) {
+        if (cancel) {
+            return false;
+        }
+        bytes[index] = cache.measure(paths[index], &cancel);
+        ++done;
+        return true;
+    });
+    return !cancel;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Sizes of folder trees, remembered per directory. A directory whose modification time
+// is unchanged is not listed again: its files and subfolders are taken from the cache,
+// and only the files' sizes are read afresh, since a file rewritten in place does not
+// change its directory's time. Adding, removing or renaming an entry does.
+class DiskUsageCache {
+public:
+    // Total bytes of the regular files below path; 0 when it does not exist. Symlinks
+    // are counted as links, never followed. Safe to call from several threads.
+    std::uint64_t measure(const std::filesystem::path& path, const std::atomic<bool>* cancel = nullptr);
+
+private:
+    struct Dir {
+        std::int64_t modified = 0;
+        std::uint64_t fileBytes = 0;
+        std::vector<std::string> files;
+        std::vector<std::string> subdirs;
+    };
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Dir> dirs_;
+};
+
+// Measures each of paths on up to `threads` workers (0 picks one per core), filling
+// bytes in the same order. done counts finished paths; false when cancelled.
+bool measureDiskUsage(DiskUsageCache& cache, const std::vector<std::filesystem::path>& paths, unsigned threads,
+                      std::vector<std::uint64_t>& bytes, std::atomic<int>& done, const std::atomic<bool>& cancel);
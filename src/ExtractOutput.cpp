@@ -0,0 +1,303 @@
+#include "ExtractOutput.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+fs::file_time_type fileTimeFromUnix(std::int64_t seconds) {
+    std::chrono::system_clock::time_point system {std::chrono::seconds(seconds)};
+    return std::chrono::time_point_cast<fs::file_time_type::duration>(
+        system - std::chrono::system_clock::now() + fs::file_time_type::clock::now());
+}
+} // namespace
+
+void CreatedPaths::add(const fs::path& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    paths_.push_back(path);
+}
+
+void CreatedPaths::undo() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto path = paths_.rbegin(); path != paths_.rend(); ++path) {
+        std::error_code ec;
+        fs::remove(*path, ec);
+    }
+    paths_.clear();
+}
+
+bool ExtractProgress::current(ExtractActivity& activity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool found = false;
+    for (const ExtractActivity& slot : active) {
+        if (!slot.name.empty() && (!found || slot.size - slot.done > activity.size - activity.done)) {
+            activity = slot;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool safeRelativePath(const std::string& name, std::string& relPath) {
+    relPath.clear();
+    std::string part;
+    for (std::size_t i = 0; i <= name.size(); ++i) {
+        char ch = i < name.size() ? name[i] : '/';
+        if (ch != '/' && ch != '\\') {
+            part.push_back(ch);
+            continue;
+        }
+        if (part == "..") {
+            return false;
+        }
+#ifdef _WIN32
+        if (part.find(':') != std::string::npos) {
+            return false;
+        }
+#endif
+        if (!part.empty() && part != ".") {
+            relPath += relPath.empty() ? part : "/" + part;
+        }
+        part.clear();
+    }
+    return true;
+}
+
+void applyFileMetadata(const fs::path& target, std::uint32_t mode, std::int64_t modified) {
+    std::error_code ec;
+    mode &= 07777u;
+    if (mode != 0) {
+        fs::permissions(target, static_cast<fs::perms>(mode), fs::perm_options::replace, ec);
+    }
+    fs::last_write_time(target, fileTimeFromUnix(modified), ec);
+}
+
+bool makeExtractDirs(const fs::path& root, const std::string& relPath, std::string& error,
+                     CreatedPaths* created) {
+    // The destination itself is the caller's choice, links included, and is only made
+    // when missing.
+    std::error_code rootError;
+    if (!relPath.empty() && !fs::exists(root, rootError)) {
+        fs::create_directories(root, rootError);
+    }
+    fs::path dir = root;
+    for (std::size_t start = 0; start < relPath.size();) {
+        std::size_t slash = relPath.find('/', start);
+        std::size_t end = slash == std::string::npos ? relPath.size() : slash;
+        dir /= fs::u8path(relPath.substr(start, end - start));
+        start = end + 1;
+        std::error_code ec;
+        fs::file_status status = fs::symlink_status(dir, ec);
+        if (fs::is_directory(status)) {
+            continue;
+        }
+        if (!fs::exists(status) && fs::create_directory(dir, ec)) {
+            if (created) {
+                created->add(dir);
+            }
+            continue;
+        }
+        // Another worker may have made the same folder in the meantime.
+        if (!fs::exists(status) && fs::is_directory(fs::symlink_status(dir, ec))) {
+            continue;
+        }
+        error = (fs::is_symlink(status) ? "Not extracting through the link " : "Failed to create ") +
+                relPath.substr(0, end);
+        return false;
+    }
+    return true;
+}
+
+bool resolvesInside(const fs::path& root, const fs::path& path) {
+    std::error_code ec;
+    fs::path base = fs::weakly_canonical(root, ec);
+    if (ec) {
+        return false;
+    }
+    fs::path resolved = fs::weakly_canonical(path, ec);
+    if (ec) {
+        return false;
+    }
+    fs::path relative = resolved.lexically_relative(base);
+    return !relative.empty() && *relative.begin() != "..";
+}
+
+bool writeSymlink(const fs::path& root, const std::string& relPath, const std::string& link, std::string& error,
+                  CreatedPaths* created) {
+    std::size_t slash = relPath.rfind('/');
+    if (slash != std::string::npos && !makeExtractDirs(root, relPath.substr(0, slash), error, created)) {
+        return false;
+    }
+    fs::path target = root / fs::u8path(relPath);
+    std::error_code ec;
+    fs::file_status status = fs::symlink_status(target, ec);
+    if (fs::is_directory(status)) {
+        error = "A folder is in the way of " + relPath;
+        return false;
+    }
+
+    int depth = static_cast<int>(std::count(relPath.begin(), relPath.end(), '/'));
+    int ups = 0;
+    std::vector<std::string> names;
+    std::string part;
+    for (std::size_t i = 0; i <= link.size(); ++i) {
+        char ch = i < link.size() ? link[i] : '/';
+        if (ch != '/' && ch != '\\') {
+            part.push_back(ch);
+            continue;
+        }
+        if (part == "..") {
+            if (names.empty()) {
+                ++ups;
+            } else {
+                names.pop_back();
+            }
+        } else if (!part.empty() && part != ".") {
+            names.push_back(part);
+        }
+        part.clear();
+    }
+    std::string folded;
+    for (int i = 0; i < ups; ++i) {
+        folded += "../";
+    }
+    for (const std::string& name : names) {
+        folded += name + "/";
+    }
+    folded = folded.empty() ? "." : folded.substr(0, folded.size() - 1);
+
+    bool inside = !link.empty() && link[0] != '/' && link[0] != '\\' && ups <= depth;
+#ifdef _WIN32
+    inside = inside && link.find(':') == std::string::npos;
+#endif
+    inside = inside && resolvesInside(root, target.parent_path() / fs::u8path(folded));
+    fs::remove(target, ec);
+    if (inside) {
+        fs::create_symlink(fs::u8path(folded), target, ec);
+        if (!ec) {
+            if (created && !fs::exists(status)) {
+                created->add(target);
+            }
+            return true;
+        }
+    }
+    OutputFile output;
+    return output.open(target, link.size(), error, fs::exists(status) ? nullptr : created) &&
+           output.write(link.data(), link.size(), 0, error) && output.close(error);
+}
+
+OutputFile::~OutputFile() {
+    if (!isOpen()) {
+        return;
+    }
+#ifdef _WIN32
+    CloseHandle(handle_);
+#else
+    ::close(fd_);
+#endif
+    std::error_code ec;
+    fs::remove(path_, ec);
+}
+
+bool OutputFile::open(const fs::path& path, std::uint64_t size, std::string& error, CreatedPaths* created) {
+    path_ = path;
+    std::error_code ec;
+    fs::file_status status = fs::symlink_status(path, ec);
+    // Never write through a link that was already sitting at the target path.
+    if (fs::is_symlink(status)) {
+        fs::remove(path, ec);
+    }
+#ifdef _WIN32
+    handle_ = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle_ == INVALID_HANDLE_VALUE) {
+        handle_ = nullptr;
+        error = "Failed to create " + path.filename().string();
+        return false;
+    }
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(size);
+    if (size > 0 && (!SetFilePointerEx(handle_, end, nullptr, FILE_BEGIN) || !SetEndOfFile(handle_))) {
+        error = "Not enough space for " + path.filename().string();
+        return false;
+    }
+#else
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        error = "Failed to create " + path.filename().string();
+        return false;
+    }
+#ifdef __linux__
+    if (size > 0 && posix_fallocate(fd_, 0, static_cast<off_t>(size)) == ENOSPC) {
+        error = "Not enough space for " + path.filename().string();
+        return false;
+    }
+#endif
+#endif
+    if (created && !fs::exists(status)) {
+        created->add(path);
+    }
+    return true;
+}
+
+bool OutputFile::write(const char* data, std::size_t size, std::uint64_t offset, std::string& error) {
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written = 0;
+        DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(size, 1u << 30));
+        if (!WriteFile(handle_, data, chunk, &written, &overlapped) || written == 0) {
+            error = "Failed to write " + path_.filename().string();
+            return false;
+        }
+#else
+        ssize_t written = pwrite(fd_, data, size, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            error = "Failed to write " + path_.filename().string();
+            return false;
+        }
+#endif
+        data += written;
+        size -= static_cast<std::size_t>(written);
+        offset += static_cast<std::uint64_t>(written);
+    }
+    return true;
+}
+
+bool OutputFile::close(std::string& error) {
+#ifdef _WIN32
+    bool ok = CloseHandle(handle_) != 0;
+    handle_ = nullptr;
+#else
+    bool ok = ::close(fd_) == 0;
+    fd_ = -1;
+#endif
+    if (!ok) {
+        error = "Failed to write " + path_.filename().string();
+        std::error_code ec;
+        fs::remove(path_, ec);
+    }
+    return ok;
+}
+
+bool OutputFile::isOpen() const {
+#ifdef _WIN32
+    return handle_ != nullptr;
+#else
+    return fd_ >= 0;
+#endif
+}
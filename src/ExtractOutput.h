@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The entry one worker is writing.
+struct ExtractActivity {
+    std::string name;
+    std::uint64_t size = 0;
+    std::uint64_t done = 0;
+};
+
+// What an extraction added to the destination, so a cancelled run can take back
+// exactly that and nothing else. Workers add to it concurrently.
+class CreatedPaths {
+public:
+    void add(const std::filesystem::path& path);
+    // Removes the paths newest first; a folder that something else has since written
+    // into is left behind.
+    void undo();
+
+private:
+    std::mutex mutex_;
+    std::vector<std::filesystem::path> paths_;
+};
+
+// Counters shared between a running extraction and the thread that shows its progress.
+struct ExtractProgress {
+    std::atomic<std::uint64_t> bytesDone {0};
+    std::atomic<int> filesDone {0};
+    // Archive bytes consumed so far; only kept by extractors that read the archive front to back.
+    std::atomic<std::uint64_t> sourceDone {0};
+    // Files left alone because an identical copy was already on disk; they count towards
+    // bytesDone and filesDone as well.
+    std::atomic<int> filesSkipped {0};
+    std::atomic<std::uint64_t> bytesSkipped {0};
+    // Set by the caller to stop early; files that were being written are removed.
+    std::atomic<bool> cancel {false};
+    // Set by the caller to learn every file, folder and link the run creates.
+    CreatedPaths* created = nullptr;
+
+    // The in-flight entry with the most bytes left, i.e. the one the run is waiting on.
+    bool current(ExtractActivity& activity);
+
+    std::mutex mutex;
+    // One slot per worker; an empty name means the worker is between entries.
+    std::vector<ExtractActivity> active;
+};
+
+// Splits an entry name into a relative path, refusing anything that could climb out
+// of the destination (.., absolute names, drive letters).
+bool safeRelativePath(const std::string& name, std::string& relPath);
+
+// Restores permission bits (when non-zero) and the modification time of an extracted file.
+void applyFileMetadata(const std::filesystem::path& target, std::uint32_t mode, std::int64_t modified);
+
+// Makes the folder root/relPath and any missing folders on the way. Fails when a part
+// of the path is a link or a file, so nothing is ever extracted through a link.
+bool makeExtractDirs(const std::filesystem::path& root, const std::string& relPath, std::string& error,
+                     CreatedPaths* created = nullptr);
+
+// True when path, with every link along it followed, stays below root.
+bool resolvesInside(const std::filesystem::path& root, const std::filesystem::path& path);
+
+// Makes the link at root/relPath. The target is stored with its ".." parts folded in,
+// so it only climbs through real folders and no later link can redirect it; targets
+// that lead outside root are stored as plain files holding the link text.
+bool writeSymlink(const std::filesystem::path& root, const std::string& relPath, const std::string& link,
+                  std::string& error, CreatedPaths* created = nullptr);
+
+// Takes extracted files in place of a local folder, e.g. to upload them as they are
+// decompressed. Calls come from one thread in archive order: a file's data arrives in
+// sequence between openFile and closeFile. Paths are relative, with '/' separators.
+class ExtractSink {
+public:
+    virtual ~ExtractSink() = default;
+    virtual bool makeDir(const std::string& relPath, std::string& error) = 0;
+    virtual bool openFile(const std::string& relPath, std::uint64_t size, std::string& error) = 0;
+    virtual bool write(const char* data, std::size_t size, std::string& error) = 0;
+    virtual bool closeFile(std::string& error) = 0;
+};
+
+// Output file written at explicit offsets. The full size is reserved up front so the
+// filesystem can lay the file out in one piece; an unfinished file is deleted.
+class OutputFile {
+public:
+    OutputFile() = default;
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+    ~OutputFile();
+
+    // A file that was not there before is added to created.
+    bool open(const std::filesystem::path& path, std::uint64_t size, std::string& error,
+              CreatedPaths* created = nullptr);
+    bool write(const char* data, std::size_t size, std::uint64_t offset, std::string& error);
+    bool close(std::string& error);
+    bool isOpen() const;
+
+private:
+    std::filesystem::path path_;
+#ifdef _WIN32
+    // A HANDLE; kept as void* so this header does not pull in windows.h.
+    void* handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
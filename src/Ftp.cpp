@@ -0,0 +1,1264 @@
+#include "Ftp.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace {
+struct FtpOperationStats {
+    std::deque<FtpTimingSample> samples;
+    int count = 0;
+    int failures = 0;
+};
+
+struct FtpStatsStore {
+    std::mutex mutex;
+    // Server key -> operation name -> rolling samples.
+    std::map<std::string, std::map<std::string, FtpOperationStats>> servers;
+};
+
+FtpStatsStore& ftpStatsStore() {
+    static FtpStatsStore store;
+    return store;
+}
+
+double percentileOf(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    // Nearest-rank percentile.
+    size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(values.size())));
+    size_t index = std::min(values.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+    return values[index];
+}
+
+FtpTimingSample percentileSample(const std::deque<FtpTimingSample>& samples, double fraction) {
+    std::vector<double> connect;
+    std::vector<double> ready;
+    std::vector<double> firstByte;
+    std::vector<double> total;
+    std::vector<double> speed;
+    for (const auto& sample : samples) {
+        connect.push_back(sample.connectMs);
+        ready.push_back(sample.readyMs);
+        firstByte.push_back(sample.firstByteMs);
+        total.push_back(sample.totalMs);
+        speed.push_back(sample.bytesPerSecond);
+    }
+    FtpTimingSample result;
+    result.connectMs = percentileOf(connect, fraction);
+    result.readyMs = percentileOf(ready, fraction);
+    result.firstByteMs = percentileOf(firstByte, fraction);
+    result.totalMs = percentileOf(total, fraction);
+    result.bytesPerSecond = percentileOf(speed, fraction);
+    return result;
+}
+
+} // namespace
+
+std::string normalizeFtpPath(const std::string& path) {
+    if (path.empty()) {
+        return "/";
+    }
+    std::string normalized = path;
+    if (normalized[0] != '/') {
+        normalized = "/" + normalized;
+    }
+    while (normalized.size() > 1 && normalized.back() == '/') {
+        normalized.pop_back();
+    }
+    return normalized;
+}
+
+std::string ftpJoinPath(const std::string& base, const std::string& name) {
+    std::string cleanBase = normalizeFtpPath(base);
+    if (cleanBase == "/") {
+        return cleanBase + name;
+    }
+    return cleanBase + "/" + name;
+}
+
+std::string ftpServerKey(const Settings& settings) {
+    return settings.ftpUser + "@" + settings.ftpHost + ":" + std::to_string(settings.ftpPort);
+}
+
+void clearFtpStats(const std::string& serverKey) {
+    FtpStatsStore& store = ftpStatsStore();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    store.servers.erase(serverKey);
+}
+
+std::vector<FtpOperationSummary> summarizeFtpStats(const std::string& serverKey) {
+    std::vector<FtpOperationSummary> summaries;
+    FtpStatsStore& store = ftpStatsStore();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    auto server = store.servers.find(serverKey);
+    if (server == store.servers.end()) {
+        return summaries;
+    }
+    for (const auto& [operation, stats] : server->second) {
+        FtpOperationSummary summary;
+        summary.operation = operation;
+        summary.count = stats.count;
+        summary.failures = stats.failures;
+        summary.median = percentileSample(stats.samples, 0.5);
+        summary.p90 = percentileSample(stats.samples, 0.9);
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+#ifdef USE_CURL
+namespace {
+std::string toLower(const std::string& text) {
+    std::string out = text;
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return out;
+}
+
+bool parseUnsignedValue(const std::string& token, std::uintmax_t& value) {
+    if (token.empty()) {
+        return false;
+    }
+    std::uintmax_t parsed = 0;
+    for (char ch : token) {
+        if (!std::isdigit(static_cast<unsigned char>(ch))) {
+            return false;
+        }
+        parsed = parsed * 10 + static_cast<std::uintmax_t>(ch - '0');
+    }
+    value = parsed;
+    return true;
+}
+
+std::int64_t daysFromCivil(std::int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2 ? 1 : 0;
+    const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+// MLSD times are UTC in the form YYYYMMDDHHMMSS[.sss].
+bool parseMlsdTime(const std::string& token, std::int64_t& seconds) {
+    if (token.size() < 14) {
+        return false;
+    }
+    for (size_t i = 0; i < 14; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(token[i]))) {
+            return false;
+        }
+    }
+    auto field = [&](size_t pos, size_t len) {
+        return std::stoi(token.substr(pos, len));
+    };
+    int year = field(0, 4);
+    int month = field(4, 2);
+    int day = field(6, 2);
+    int hour = field(8, 2);
+    int minute = field(10, 2);
+    int second = field(12, 2);
+    if (month < 1 || month > 12 || day < 1 || day > 31) {
+        return false;
+    }
+    std::int64_t days = daysFromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day));
+    seconds = days * 86400 + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+bool findMlsdFact(const std::string& line, const std::string& fact, std::string& value) {
+    size_t factsEnd = line.find(' ');
+    std::string facts = line.substr(0, factsEnd);
+    size_t pos = 0;
+    while (pos < facts.size()) {
+        size_t end = facts.find(';', pos);
+        if (end == std::string::npos) {
+            end = facts.size();
+        }
+        std::string item = facts.substr(pos, end - pos);
+        size_t eq = item.find('=');
+        if (eq != std::string::npos && toLower(item.substr(0, eq)) == fact) {
+            value = item.substr(eq + 1);
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+bool parseFtpListLine(const std::string& line, Entry& entry) {
+    if (line.empty()) {
+        return false;
+    }
+    if (line.rfind("total ", 0) == 0) {
+        return false;
+    }
+    if (line.find("type=") != std::string::npos) {
+        bool isDir = (line.find("type=dir") != std::string::npos || line.find("type=cdir") != std::string::npos ||
+                      line.find("type=pdir") != std::string::npos);
+        if (!isDir) {
+            size_t sizePos = line.find("size=");
+            if (sizePos != std::string::npos) {
+                sizePos += std::string("size=").size();
+                size_t endPos = line.find(';', sizePos);
+                std::string sizeToken = line.substr(sizePos, endPos == std::string::npos ? std::string::npos : endPos - sizePos);
+                std::uintmax_t sizeValue = 0;
+                if (parseUnsignedValue(sizeToken, sizeValue)) {
+                    entry.sizeBytes = sizeValue;
+                    entry.hasSize = true;
+                }
+            }
+        }
+        size_t nameStart = line.find(' ');
+        if (nameStart == std::string::npos) {
+            return false;
+        }
+        while (nameStart < line.size() && line[nameStart] == ' ') {
+            ++nameStart;
+        }
+        if (nameStart >= line.size()) {
+            return false;
+        }
+        std::string name = line.substr(nameStart);
+        if (name == "." || name == "..") {
+            return false;
+        }
+        std::string modifyToken;
+        if (findMlsdFact(line, "modify", modifyToken)) {
+            entry.hasModified = parseMlsdTime(modifyToken, entry.modifiedTime);
+        }
+        entry.name = name;
+        entry.isDir = isDir;
+        entry.isParent = false;
+        entry.path.clear();
+        return !entry.name.empty();
+    }
+    bool isDir = (line[0] == 'd');
+    int tokens = 0;
+    bool inToken = false;
+    size_t nameStart = std::string::npos;
+    size_t tokenStart = std::string::npos;
+    std::string sizeToken;
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (!std::isspace(static_cast<unsigned char>(line[i]))) {
+            if (!inToken) {
+                inToken = true;
+                ++tokens;
+                tokenStart = i;
+                if (tokens == 9) {
+                    nameStart = i;
+                    break;
+                }
+            }
+        } else {
+            if (inToken && tokens == 5 && sizeToken.empty()) {
+                sizeToken = line.substr(tokenStart, i - tokenStart);
+            }
+            inToken = false;
+        }
+    }
+    if (nameStart == std::string::npos) {
+        entry.name = line;
+        entry.isDir = false;
+        entry.isParent = false;
+        entry.path.clear();
+        return !entry.name.empty();
+    }
+    std::string name = line.substr(nameStart);
+    size_t arrow = name.find(" -> ");
+    if (arrow != std::string::npos) {
+        name = name.substr(0, arrow);
+    }
+    if (!name.empty() && name.back() == '/') {
+        name.pop_back();
+        isDir = true;
+    }
+    if (name == "." || name == "..") {
+        return false;
+    }
+    entry.name = name;
+    entry.isDir = isDir;
+    entry.isParent = false;
+    entry.path.clear();
+    if (!entry.isDir && !sizeToken.empty()) {
+        std::uintmax_t sizeValue = 0;
+        if (parseUnsignedValue(sizeToken, sizeValue)) {
+            entry.sizeBytes = sizeValue;
+            entry.hasSize = true;
+        }
+    }
+    return !entry.name.empty();
+}
+
+
+struct CurlBuffer {
+    std::string data;
+};
+
+size_t curlWriteCallback(void* ptr, size_t size, size_t nmemb, void* userdata) {
+    size_t total = size * nmemb;
+    CurlBuffer* buffer = static_cast<CurlBuffer*>(userdata);
+    buffer->data.append(static_cast<char*>(ptr), total);
+    return total;
+}
+
+std::string urlEncodePath(const std::string& path) {
+    std::ostringstream out;
+    for (unsigned char c : path) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/') {
+            out << static_cast<char>(c);
+        } else {
+            out << '%' << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
+                << static_cast<int>(c) << std::nouppercase << std::dec;
+        }
+    }
+    return out.str();
+}
+
+std::string ftpParentPath(const std::string& path) {
+    std::string clean = normalizeFtpPath(path);
+    if (clean == "/") {
+        return "/";
+    }
+    size_t pos = clean.find_last_of('/');
+    if (pos == std::string::npos || pos == 0) {
+        return "/";
+    }
+    return clean.substr(0, pos);
+}
+
+struct CurlShareState {
+    CURLSH* share = nullptr;
+    std::mutex locks[CURL_LOCK_DATA_LAST];
+};
+
+CurlShareState& curlShareState() {
+    static CurlShareState state;
+    return state;
+}
+
+void curlShareLock(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<CurlShareState*>(userptr)->locks[data].lock();
+}
+
+void curlShareUnlock(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<CurlShareState*>(userptr)->locks[data].unlock();
+}
+
+// Every FTP operation runs on its own easy handle, so without a share each one would
+// start with a cold DNS lookup and a full TLS handshake. The share hands cached TLS
+// sessions (IDs and tickets) to new control and data connections across all handles.
+CURLSH* curlSharedHandle() {
+    static std::once_flag once;
+    CurlShareState& state = curlShareState();
+    std::call_once(once, [&state]() {
+        state.share = curl_share_init();
+        if (!state.share) {
+            return;
+        }
+        curl_share_setopt(state.share, CURLSHOPT_LOCKFUNC, curlShareLock);
+        curl_share_setopt(state.share, CURLSHOPT_UNLOCKFUNC, curlShareUnlock);
+        curl_share_setopt(state.share, CURLSHOPT_USERDATA, &state);
+        curl_share_setopt(state.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_share_setopt(state.share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    });
+    return state.share;
+}
+
+constexpr long kFtpConnectTimeoutSeconds = 15;
+constexpr long kFtpStallSeconds = 30;
+
+// Handles of finished FTP stream transfers, each with its multi handle still holding
+// the logged-in control connection, so the next transfer to the same server skips the
+// connect, TLS handshake and login. Keyed by server and TLS mode.
+struct FtpHandlePool {
+    struct Idle {
+        std::string key;
+        CURL* easy = nullptr;
+        CURLM* multi = nullptr;
+        std::chrono::steady_clock::time_point since;
+    };
+    std::mutex mutex;
+    std::vector<Idle> idle;
+};
+
+const size_t kFtpPoolSize = 8;
+// Servers drop idle control connections; handles left longer than this are closed.
+const std::chrono::seconds kFtpPoolIdle(30);
+
+FtpHandlePool& ftpHandlePool() {
+    static FtpHandlePool pool;
+    return pool;
+}
+
+std::string ftpPoolKey(const Settings& settings) {
+    return ftpServerKey(settings) + "|" + std::to_string(static_cast<int>(settings.ftpTls));
+}
+
+void closeFtpHandles(CURL* easy, CURLM* multi) {
+    if (easy) {
+        curl_easy_cleanup(easy);
+    }
+    if (multi) {
+        curl_multi_cleanup(multi);
+    }
+}
+
+// Hands out a pooled pair for key, or leaves both null.
+void acquireFtpHandles(const std::string& key, CURL*& easy, CURLM*& multi) {
+    FtpHandlePool& pool = ftpHandlePool();
+    std::vector<FtpHandlePool::Idle> stale;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = pool.idle.begin(); it != pool.idle.end();) {
+            if (now - it->since > kFtpPoolIdle) {
+                stale.push_back(*it);
+                it = pool.idle.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = pool.idle.rbegin(); it != pool.idle.rend(); ++it) {
+            if (it->key == key) {
+                easy = it->easy;
+                multi = it->multi;
+                pool.idle.erase(std::next(it).base());
+                break;
+            }
+        }
+    }
+    for (const auto& idle : stale) {
+        closeFtpHandles(idle.easy, idle.multi);
+    }
+}
+
+// Takes a pair whose transfer finished cleanly; false when the pool is full.
+bool releaseFtpHandles(const std::string& key, CURL* easy, CURLM* multi) {
+    FtpHandlePool& pool = ftpHandlePool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.idle.size() >= kFtpPoolSize) {
+        return false;
+    }
+    curl_easy_reset(easy);
+    pool.idle.push_back({key, easy, multi, std::chrono::steady_clock::now()});
+    return true;
+}
+
+int curlCancelCallback(void* clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    const std::atomic<bool>* cancel = static_cast<const std::atomic<bool>*>(clientp);
+    return (cancel && cancel->load()) ? 1 : 0;
+}
+
+void recordFtpSample(const std::string& serverKey, const std::string& operation, const FtpTimingSample& sample, bool ok) {
+    FtpStatsStore& store = ftpStatsStore();
+    std::lock_guard<std::mutex> lock(store.mutex);
+    FtpOperationStats& stats = store.servers[serverKey][operation];
+    ++stats.count;
+    if (!ok) {
+        ++stats.failures;
+        return;
+    }
+    stats.samples.push_back(sample);
+    if (stats.samples.size() > kFtpStatsWindow) {
+        stats.samples.pop_front();
+    }
+}
+
+FtpTimingSample readFtpTiming(CURL* curl) {
+    curl_off_t connect = 0;
+    curl_off_t pretransfer = 0;
+    curl_off_t starttransfer = 0;
+    curl_off_t total = 0;
+    curl_off_t download = 0;
+    curl_off_t upload = 0;
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    curl_easy_getinfo(curl, CURLINFO_SPEED_DOWNLOAD_T, &download);
+    curl_easy_getinfo(curl, CURLINFO_SPEED_UPLOAD_T, &upload);
+    FtpTimingSample sample;
+    sample.connectMs = static_cast<double>(connect) / 1000.0;
+    sample.readyMs = static_cast<double>(pretransfer) / 1000.0;
+    sample.firstByteMs = static_cast<double>(starttransfer) / 1000.0;
+    sample.totalMs = static_cast<double>(total) / 1000.0;
+    sample.bytesPerSecond = static_cast<double>(std::max(download, upload));
+    return sample;
+}
+
+bool fetchFtpList(const Settings& settings, const std::string& path, std::string& output, std::string& error) {
+    CURL* curl = curl_easy_init();
+    if (!curl) {
+        error = "Failed to initialize CURL";
+        return false;
+    }
+    bool ok = fetchFtpListOn(curl, settings, path, output, error);
+    curl_easy_cleanup(curl);
+    return ok;
+}
+
+bool ftpRenamePath(const Settings& settings, const std::string& fromPath, const std::string& toPath, std::string& error) {
+    CURL* curl = curl_easy_init();
+    if (!configureFtpHandle(curl, settings, error)) {
+        if (curl) {
+            curl_easy_cleanup(curl);
+        }
+        return false;
+    }
+
+    std::string url = buildFtpUrl(settings, "/", true);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+
+    std::string rnfr = "RNFR " + normalizeFtpPath(fromPath);
+    std::string rnto = "RNTO " + normalizeFtpPath(toPath);
+    struct curl_slist* quote = nullptr;
+    quote = curl_slist_append(quote, rnfr.c_str());
+    quote = curl_slist_append(quote, rnto.c_str());
+    curl_easy_setopt(curl, CURLOPT_QUOTE, quote);
+
+    CURLcode res = curl_easy_perform(curl);
+    recordFtpTiming(settings, "Rename", curl, res);
+    curl_slist_free_all(quote);
+    if (res != CURLE_OK) {
+        error = curl_easy_strerror(res);
+        curl_easy_cleanup(curl);
+        return false;
+    }
+    curl_easy_cleanup(curl);
+    return true;
+}
+
+struct FtpHashSupport {
+    ChecksumKind kind = ChecksumKind::None;
+    // Set when the digest comes from RFC draft HASH rather than XCRC/XMD5.
+    bool useHash = false;
+};
+
+// Picks the cheapest digest the server advertises in FEAT. Probed once per server.
+FtpHashSupport ftpHashSupport(const Settings& settings) {
+    static std::mutex mutex;
+    static std::map<std::string, FtpHashSupport> probed;
+    std::string key = ftpServerKey(settings);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = probed.find(key);
+        if (it != probed.end()) {
+            return it->second;
+        }
+    }
+
+    std::vector<std::string> replies;
+    std::string error;
+    FtpHashSupport support;
+    if (!ftpQuoteCommands(settings, {"FEAT"}, replies, error)) {
+        // Leave unprobed so a later transfer can try again.
+        return support;
+    }
+    bool hashCrc = false;
+    bool hashMd5 = false;
+    bool xcrc = false;
+    bool xmd5 = false;
+    for (const auto& reply : replies) {
+        if (reply.empty() || reply[0] != ' ') {
+            continue;
+        }
+        std::string feature = toLower(reply.substr(1));
+        if (feature.rfind("hash ", 0) == 0) {
+            std::istringstream algorithms(feature.substr(5));
+            std::string algorithm;
+            while (std::getline(algorithms, algorithm, ';')) {
+                if (!algorithm.empty() && algorithm.back() == '*') {
+                    algorithm.pop_back();
+                }
+                hashCrc = hashCrc || algorithm == "crc32";
+                hashMd5 = hashMd5 || algorithm == "md5";
+            }
+        } else if (feature == "xcrc") {
+            xcrc = true;
+        } else if (feature == "xmd5") {
+            xmd5 = true;
+        }
+    }
+    if (hashCrc || xcrc) {
+        support.kind = ChecksumKind::Crc32;
+        support.useHash = hashCrc;
+    } else if (hashMd5 || xmd5) {
+        support.kind = ChecksumKind::Md5;
+        support.useHash = hashMd5;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    probed[key] = support;
+    return support;
+}
+
+bool isHexDigest(const std::string& text, size_t length) {
+    return text.size() == length && std::all_of(text.begin(), text.end(), [](unsigned char c) {
+        return std::isxdigit(c) != 0;
+    });
+}
+
+// Asks the server for the digest of a whole file.
+bool ftpFileChecksum(const Settings& settings, const std::string& remotePath, std::string& hex, std::string& error) {
+    FtpHashSupport support = ftpHashSupport(settings);
+    if (support.kind == ChecksumKind::None) {
+        error = "Server has no checksum command";
+        return false;
+    }
+    bool crc = support.kind == ChecksumKind::Crc32;
+    std::string path = normalizeFtpPath(remotePath);
+    std::vector<std::string> commands;
+    if (support.useHash) {
+        commands.push_back(crc ? "OPTS HASH CRC32" : "OPTS HASH MD5");
+        commands.push_back("HASH " + path);
+    } else {
+        commands.push_back((crc ? "XCRC " : "XMD5 ") + path);
+    }
+    std::vector<std::string> replies;
+    if (!ftpQuoteCommands(settings, commands, replies, error)) {
+        return false;
+    }
+    // HASH answers "213 <alg> <range> <hex> <name>"; XCRC/XMD5 answer "250 <hex>".
+    size_t length = crc ? 8 : 32;
+    for (auto it = replies.rbegin(); it != replies.rend(); ++it) {
+        std::istringstream words(*it);
+        std::string code;
+        std::string word;
+        words >> code;
+        if (code != (support.useHash ? "213" : "250")) {
+            continue;
+        }
+        while (words >> word) {
+            if (isHexDigest(word, length)) {
+                hex = toLower(word);
+                return true;
+            }
+        }
+    }
+    error = "Unexpected checksum reply";
+    return false;
+}
+
+bool ftpCreateDir(const Settings& settings, const std::string& remotePath, std::string& error) {
+    CURL* curl = curl_easy_init();
+    if (!configureFtpHandle(curl, settings, error)) {
+        if (curl) {
+            curl_easy_cleanup(curl);
+        }
+        return false;
+    }
+
+    std::string url = buildFtpUrl(settings, "/", true);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+
+    std::string command = "MKD " + normalizeFtpPath(remotePath);
+    struct curl_slist* quote = nullptr;
+    quote = curl_slist_append(quote, command.c_str());
+    curl_easy_setopt(curl, CURLOPT_QUOTE, quote);
+
+    CURLcode res = curl_easy_perform(curl);
+    recordFtpTiming(settings, "Make folder", curl, res);
+    curl_slist_free_all(quote);
+    if (res != CURLE_OK) {
+        error = curl_easy_strerror(res);
+        curl_easy_cleanup(curl);
+        return false;
+    }
+    curl_easy_cleanup(curl);
+    return true;
+}
+
+// FTP transfers run on a curl multi handle that is only driven from inside read() and
+// write(), so the copy engine can pull and push data without a helper thread. The
+// handles go back to the pool after a clean finish, keeping the connection open.
+class FtpStreamBase {
+public:
+    virtual ~FtpStreamBase() {
+        if (multi_ && easy_) {
+            curl_multi_remove_handle(multi_, easy_);
+            if (finished_ && result_ == CURLE_OK && releaseFtpHandles(poolKey_, easy_, multi_)) {
+                return;
+            }
+        }
+        closeFtpHandles(easy_, multi_);
+    }
+
+protected:
+    bool begin(const Settings& settings, const std::string& path, const char* operation, std::string& error) {
+        serverKey_ = ftpServerKey(settings);
+        poolKey_ = ftpPoolKey(settings);
+        operation_ = operation;
+        acquireFtpHandles(poolKey_, easy_, multi_);
+        if (!easy_) {
+            easy_ = curl_easy_init();
+        }
+        if (!configureFtpHandle(easy_, settings, error)) {
+            return false;
+        }
+        if (!multi_) {
+            multi_ = curl_multi_init();
+        }
+        if (!multi_) {
+            error = "Failed to initialize CURL";
+            return false;
+        }
+        url_ = buildFtpUrl(settings, path, false);
+        curl_easy_setopt(easy_, CURLOPT_URL, url_.c_str());
+        curl_easy_setopt(easy_, CURLOPT_NOPROGRESS, 1L);
+        return true;
+    }
+    bool start(std::string& error) {
+        if (curl_multi_add_handle(multi_, easy_) != CURLM_OK) {
+            error = "Failed to start transfer";
+            return false;
+        }
+        return true;
+    }
+    void pump() {
+        if (cancel_ && *cancel_) {
+            finished_ = true;
+            result_ = CURLE_ABORTED_BY_CALLBACK;
+            return;
+        }
+        int running = 0;
+        if (curl_multi_perform(multi_, &running) != CURLM_OK) {
+            finished_ = true;
+            result_ = CURLE_FAILED_INIT;
+            return;
+        }
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(multi_, &queued)) {
+            if (message->msg == CURLMSG_DONE) {
+                finished_ = true;
+                result_ = message->data.result;
+                recordFtpSample(serverKey_, operation_, readFtpTiming(easy_), result_ == CURLE_OK);
+            }
+        }
+        if (!finished_ && running > 0) {
+            curl_multi_wait(multi_, nullptr, 0, 100, nullptr);
+        }
+    }
+    std::string failure() const {
+        return result_ == CURLE_ABORTED_BY_CALLBACK ? "Cancelled" : curl_easy_strerror(result_);
+    }
+
+    CURL* easy_ = nullptr;
+    CURLM* multi_ = nullptr;
+    std::string url_;
+    std::string serverKey_;
+    std::string poolKey_;
+    const char* operation_ = "";
+    const std::atomic<bool>* cancel_ = nullptr;
+    bool finished_ = false;
+    CURLcode result_ = CURLE_OK;
+};
+
+class FtpReadStream : public VfsReadStream, private FtpStreamBase {
+public:
+    bool open(const Settings& settings, const std::string& path, std::uint64_t offset, std::string& error) {
+        if (!begin(settings, path, "Download", error)) {
+            return false;
+        }
+        curl_easy_setopt(easy_, CURLOPT_WRITEFUNCTION, onData);
+        curl_easy_setopt(easy_, CURLOPT_WRITEDATA, this);
+        if (offset > 0) {
+            curl_easy_setopt(easy_, CURLOPT_RESUME_FROM_LARGE, static_cast<curl_off_t>(offset));
+        }
+        return start(error);
+    }
+    long long read(char* buffer, size_t size, std::string& error) override {
+        while (offset_ == buffer_.size() && !finished_) {
+            buffer_.clear();
+            offset_ = 0;
+            pump();
+        }
+        if (offset_ < buffer_.size()) {
+            size_t count = std::min(size, buffer_.size() - offset_);
+            std::memcpy(buffer, buffer_.data() + offset_, count);
+            offset_ += count;
+            return static_cast<long long>(count);
+        }
+        if (result_ != CURLE_OK) {
+            error = failure();
+            return -1;
+        }
+        return 0;
+    }
+    void setCancel(const std::atomic<bool>* cancel) override {
+        cancel_ = cancel;
+    }
+
+private:
+    static size_t onData(char* ptr, size_t size, size_t nmemb, void* userdata) {
+        FtpReadStream* self = static_cast<FtpReadStream*>(userdata);
+        self->buffer_.append(ptr, size * nmemb);
+        return size * nmemb;
+    }
+
+    std::string buffer_;
+    size_t offset_ = 0;
+};
+
+class FtpWriteStream : public VfsWriteStream, private FtpStreamBase {
+public:
+    ~FtpWriteStream() override {
+        if (!committed_ && started_) {
+            // Drop the connection first so the server releases the partial file.
+            if (multi_ && easy_) {
+                curl_multi_remove_handle(multi_, easy_);
+                curl_easy_cleanup(easy_);
+                easy_ = nullptr;
+            }
+            std::string ignored;
+            ftpDeletePath(settings_, path_, false, ignored);
+        }
+    }
+    bool open(const Settings& settings, const std::string& path, std::uint64_t sizeHint, std::string& error) {
+        settings_ = settings;
+        path_ = path;
+        if (!begin(settings, path, "Upload", error)) {
+            return false;
+        }
+        curl_easy_setopt(easy_, CURLOPT_UPLOAD, 1L);
+        // Missing parent folders are made on the way, over the same connection.
+        curl_easy_setopt(easy_, CURLOPT_FTP_CREATE_MISSING_DIRS, static_cast<long>(CURLFTP_CREATE_DIR_RETRY));
+        curl_easy_setopt(easy_, CURLOPT_READFUNCTION, onRead);
+        curl_easy_setopt(easy_, CURLOPT_READDATA, this);
+        if (sizeHint > 0) {
+            curl_easy_setopt(easy_, CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(sizeHint));
+        }
+        started_ = start(error);
+        return started_;
+    }
+    bool write(const char* data, size_t size, std::string& error) override {
+        pending_ = data;
+        pendingSize_ = size;
+        resume();
+        while (pendingSize_ > 0 && !finished_) {
+            pump();
+        }
+        pending_ = nullptr;
+        if (pendingSize_ > 0) {
+            error = (result_ != CURLE_OK) ? failure() : "Upload ended early";
+            return false;
+        }
+        return true;
+    }
+    bool close(std::string& error) override {
+        closing_ = true;
+        resume();
+        while (!finished_) {
+            pump();
+        }
+        if (result_ != CURLE_OK) {
+            error = failure();
+            return false;
+        }
+        committed_ = true;
+        return true;
+    }
+    void setCancel(const std::atomic<bool>* cancel) override {
+        cancel_ = cancel;
+    }
+
+private:
+    static size_t onRead(char* buffer, size_t size, size_t nmemb, void* userdata) {
+        FtpWriteStream* self = static_cast<FtpWriteStream*>(userdata);
+        if (self->pendingSize_ == 0) {
+            if (self->closing_) {
+                return 0;
+            }
+            self->paused_ = true;
+            return CURL_READFUNC_PAUSE;
+        }
+        size_t count = std::min(size * nmemb, self->pendingSize_);
+        std::memcpy(buffer, self->pending_, count);
+        self->pending_ += count;
+        self->pendingSize_ -= count;
+        return count;
+    }
+    void resume() {
+        if (paused_) {
+            paused_ = false;
+            curl_easy_pause(easy_, CURLPAUSE_CONT);
+        }
+    }
+
+    Settings settings_;
+    std::string path_;
+    const char* pending_ = nullptr;
+    size_t pendingSize_ = 0;
+    bool paused_ = false;
+    bool closing_ = false;
+    bool started_ = false;
+    bool committed_ = false;
+};
+
+class FtpVfs : public VfsBackend {
+public:
+    explicit FtpVfs(const Settings& settings) : settings_(settings) {}
+
+    VfsCapabilities capabilities() const override {
+        VfsCapabilities caps;
+        caps.serverSideRename = true;
+        caps.rangeReads = true;
+        caps.cacheListings = true;
+        return caps;
+    }
+    std::string key() const override {
+        return ftpServerKey(settings_);
+    }
+    std::string join(const std::string& dir, const std::string& name) const override {
+        return ftpJoinPath(dir, name);
+    }
+    std::string parent(const std::string& path) const override {
+        return ftpParentPath(path);
+    }
+    std::string baseName(const std::string& path) const override {
+        std::string clean = normalizeFtpPath(path);
+        return clean.substr(clean.find_last_of('/') + 1);
+    }
+    std::unique_ptr<VfsReadStream> openRead(const std::string& path, std::uint64_t offset, std::string& error) override {
+        auto stream = std::make_unique<FtpReadStream>();
+        if (!stream->open(settings_, path, offset, error)) {
+            return nullptr;
+        }
+        return stream;
+    }
+    ChecksumKind checksumKind() override {
+        return ftpHashSupport(settings_).kind;
+    }
+    bool checksum(const std::string& path, ChecksumKind kind, std::string& hex, std::string& error) override {
+        if (kind != checksumKind()) {
+            error = "Checksum kind not supported";
+            return false;
+        }
+        return ftpFileChecksum(settings_, path, hex, error);
+    }
+
+protected:
+    bool doList(const std::string& path, std::vector<Entry>& entries, std::string& error) override {
+        std::string listing;
+        if (!fetchFtpList(settings_, path, listing, error)) {
+            return false;
+        }
+        auto parseStart = std::chrono::steady_clock::now();
+        parseFtpListing(listing, entries);
+        FtpTimingSample parse;
+        parse.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - parseStart).count();
+        recordFtpSample(key(), kFtpParseOperation, parse, true);
+        return true;
+    }
+    std::unique_ptr<VfsWriteStream> doOpenWrite(const std::string& path, std::uint64_t sizeHint, std::string& error) override {
+        auto stream = std::make_unique<FtpWriteStream>();
+        if (!stream->open(settings_, path, sizeHint, error)) {
+            return nullptr;
+        }
+        return stream;
+    }
+    bool doRename(const std::string& fromPath, const std::string& toPath, std::string& error) override {
+        return ftpRenamePath(settings_, fromPath, toPath, error);
+    }
+    bool doRemove(const std::string& path, bool isDir, std::string& error) override {
+        return isDir ? ftpDeleteRecursive(settings_, path, error) : ftpDeletePath(settings_, path, false, error);
+    }
+    bool doMkdir(const std::string& path, std::string& error) override {
+        return ftpCreateDir(settings_, path, error);
+    }
+
+private:
+    Settings settings_;
+};
+
+} // namespace
+
+std::string buildFtpUrl(const Settings& settings, const std::string& path, bool isDir) {
+    std::string url = "ftp://" + settings.ftpHost;
+    if (settings.ftpPort > 0 && settings.ftpPort != 21) {
+        url += ":" + std::to_string(settings.ftpPort);
+    }
+    std::string remotePath = normalizeFtpPath(path);
+    if (isDir && remotePath.back() != '/') {
+        remotePath.push_back('/');
+    }
+    url += urlEncodePath(remotePath);
+    return url;
+}
+
+void releaseCurlShare() {
+    CurlShareState& state = curlShareState();
+    if (state.share) {
+        curl_share_cleanup(state.share);
+        state.share = nullptr;
+    }
+}
+
+bool configureFtpHandle(CURL* curl, const Settings& settings, std::string& error) {
+    if (!curl) {
+        error = "Failed to initialize CURL";
+        return false;
+    }
+    if (settings.ftpHost.empty()) {
+        error = "FTP host not set";
+        return false;
+    }
+    curl_easy_setopt(curl, CURLOPT_USERNAME, settings.ftpUser.empty() ? "anonymous" : settings.ftpUser.c_str());
+    curl_easy_setopt(curl, CURLOPT_PASSWORD, settings.ftpPass.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_SHARE, curlSharedHandle());
+    // A server that drops off the network mid-transfer (Wi-Fi gone, console suspended)
+    // never closes the connection; give up on it instead of waiting forever.
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, kFtpConnectTimeoutSeconds);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, kFtpStallSeconds);
+    if (settings.ftpTls != FtpTlsMode::Off) {
+        // Explicit FTPS: the control and data channels both have to be encrypted.
+        curl_easy_setopt(curl, CURLOPT_USE_SSL, static_cast<long>(CURLUSESSL_ALL));
+        curl_easy_setopt(curl, CURLOPT_FTPSSLAUTH, static_cast<long>(CURLFTPAUTH_TLS));
+        curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 1L);
+        if (settings.ftpTls == FtpTlsMode::TlsTrustAny) {
+            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        }
+    }
+    return true;
+}
+
+void drainFtpHandlePool() {
+    FtpHandlePool& pool = ftpHandlePool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (const auto& idle : pool.idle) {
+        closeFtpHandles(idle.easy, idle.multi);
+    }
+    pool.idle.clear();
+}
+
+void recordFtpTiming(const Settings& settings, const char* operation, CURL* curl, CURLcode result) {
+    recordFtpSample(ftpServerKey(settings), operation, readFtpTiming(curl), result == CURLE_OK);
+}
+
+bool fetchFtpListOn(CURL* curl, const Settings& settings, const std::string& path, std::string& output,
+                    std::string& error, const std::atomic<bool>* cancel) {
+    std::string url = buildFtpUrl(settings, path, true);
+    CurlBuffer buffer;
+    CURLcode res = CURLE_OK;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        curl_easy_reset(curl);
+        if (!configureFtpHandle(curl, settings, error)) {
+            return false;
+        }
+        buffer.data.clear();
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
+        curl_easy_setopt(curl, CURLOPT_DIRLISTONLY, 0L);
+        if (attempt == 0) {
+            curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "MLSD");
+        }
+        if (cancel) {
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, curlCancelCallback);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, cancel);
+        } else {
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+        }
+        res = curl_easy_perform(curl);
+        recordFtpTiming(settings, "List", curl, res);
+        if (res == CURLE_OK) {
+            output = buffer.data;
+            return true;
+        }
+        if (cancel && cancel->load()) {
+            break;
+        }
+    }
+    error = curl_easy_strerror(res);
+    return false;
+}
+
+bool ftpDeletePath(const Settings& settings, const std::string& remotePath, bool isDir, std::string& error) {
+    CURL* curl = curl_easy_init();
+    if (!configureFtpHandle(curl, settings, error)) {
+        if (curl) {
+            curl_easy_cleanup(curl);
+        }
+        return false;
+    }
+
+    std::string url = buildFtpUrl(settings, "/", true);
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+
+    std::string command = std::string(isDir ? "RMD " : "DELE ") + normalizeFtpPath(remotePath);
+    struct curl_slist* quote = nullptr;
+    quote = curl_slist_append(quote, command.c_str());
+    curl_easy_setopt(curl, CURLOPT_QUOTE, quote);
+
+    CURLcode res = curl_easy_perform(curl);
+    recordFtpTiming(settings, "Delete", curl, res);
+    curl_slist_free_all(quote);
+    if (res != CURLE_OK) {
+        error = curl_easy_strerror(res);
+        curl_easy_cleanup(curl);
+        return false;
+    }
+    curl_easy_cleanup(curl);
+    return true;
+}
+
+bool ftpQuoteCommands(const Settings& settings, const std::vector<std::string>& commands,
+                      std::vector<std::string>& replies, std::string& error,
+                      FtpTimingSample* timing) {
+    CURL* curl = curl_easy_init();
+    if (!configureFtpHandle(curl, settings, error)) {
+        if (curl) {
+            curl_easy_cleanup(curl);
+        }
+        return false;
+    }
+
+    std::string url = buildFtpUrl(settings, "/", true);
+    CurlBuffer headers;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlWriteCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headers);
+
+    struct curl_slist* quote = nullptr;
+    for (const auto& command : commands) {
+        quote = curl_slist_append(quote, command.c_str());
+    }
+    curl_easy_setopt(curl, CURLOPT_QUOTE, quote);
+
+    CURLcode res = curl_easy_perform(curl);
+    recordFtpTiming(settings, "Command", curl, res);
+    if (timing) {
+        *timing = readFtpTiming(curl);
+    }
+    curl_slist_free_all(quote);
+    curl_easy_cleanup(curl);
+    if (res != CURLE_OK) {
+        error = curl_easy_strerror(res);
+        return false;
+    }
+    std::istringstream lines(headers.data);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        replies.push_back(line);
+    }
+    return true;
+}
+
+void storeFtpListing(const Settings& settings, const std::string& path, const std::vector<Entry>& entries,
+                     bool seeded) {
+    storeListing(ftpServerKey(settings), normalizeFtpPath(path), entries, seeded);
+}
+
+void invalidateFtpListings(const Settings& settings, const std::string& path) {
+    invalidateListings(ftpServerKey(settings), normalizeFtpPath(path));
+}
+
+void parseFtpListing(const std::string& listing, std::vector<Entry>& entries) {
+    std::istringstream lines(listing);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        Entry entry;
+        if (parseFtpListLine(line, entry)) {
+            entries.push_back(entry);
+        }
+    }
+    sortEntries(entries);
+}
+
+bool listFtpEntries(const Settings& settings, const std::string& path, std::vector<Entry>& entries,
+                    std::string& error, bool includeHidden) {
+    std::string listing;
+    if (!fetchFtpList(settings, path, listing, error)) {
+        return false;
+    }
+    std::vector<Entry> parsed;
+    parseFtpListing(listing, parsed);
+    storeFtpListing(settings, path, parsed);
+    if (!includeHidden) {
+        filterHiddenEntries(parsed);
+    }
+    entries.insert(entries.end(), parsed.begin(), parsed.end());
+    return true;
+}
+
+bool ftpEnsureDir(const Settings& settings, const std::string& remotePath, std::string& error) {
+    std::string clean = normalizeFtpPath(remotePath);
+    if (clean == "/") {
+        return true;
+    }
+    size_t pos = 1;
+    bool made = false;
+    std::string cmdError;
+    while (true) {
+        pos = clean.find('/', pos);
+        std::string segment = (pos == std::string::npos) ? clean : clean.substr(0, pos);
+        cmdError.clear();
+        made = ftpCreateDir(settings, segment, cmdError);
+        if (pos == std::string::npos) {
+            break;
+        }
+        ++pos;
+    }
+    // MKD fails as well for a folder that is already there, so only one that cannot be
+    // entered afterwards is an error.
+    std::vector<std::string> replies;
+    std::string cwdError;
+    if (!made && !ftpQuoteCommands(settings, {"CWD " + clean}, replies, cwdError)) {
+        error = "Failed to create " + clean + (cmdError.empty() ? "" : ": " + cmdError);
+        return false;
+    }
+    return true;
+}
+
+bool ftpDeleteRecursive(const Settings& settings, const std::string& remotePath, std::string& error) {
+    std::vector<Entry> entries;
+    if (!listFtpEntries(settings, remotePath, entries, error, true)) {
+        return false;
+    }
+    for (const auto& entry : entries) {
+        std::string childRemote = ftpJoinPath(remotePath, entry.name);
+        if (entry.isDir) {
+            if (!ftpDeleteRecursive(settings, childRemote, error)) {
+                return false;
+            }
+        } else {
+            if (!ftpDeletePath(settings, childRemote, false, error)) {
+                return false;
+            }
+        }
+    }
+    return ftpDeletePath(settings, remotePath, true, error);
+}
+
+std::shared_ptr<VfsBackend> ftpBackend(const Settings& settings) {
+    return std::make_shared<FtpVfs>(settings);
+}
+#endif
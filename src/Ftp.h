@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef USE_CURL
+#include <curl/curl.h>
+#endif
+
+#include "Settings.h"
+#include "Vfs.h"
+
+// "/"-rooted, without a trailing slash except for the root itself.
+std::string normalizeFtpPath(const std::string& path);
+std::string ftpJoinPath(const std::string& base, const std::string& name);
+// Identifies a server and login; FTP listings and timings are kept under this key.
+std::string ftpServerKey(const Settings& settings);
+
+// One FTP request as libcurl saw it. The phase times are measured from the start of
+// the request, so a reused connection reports a zero connect time.
+struct FtpTimingSample {
+    double connectMs = 0.0;
+    // Logged in and about to send the transfer command.
+    double readyMs = 0.0;
+    double firstByteMs = 0.0;
+    double totalMs = 0.0;
+    double bytesPerSecond = 0.0;
+};
+
+struct FtpOperationSummary {
+    std::string operation;
+    int count = 0;
+    int failures = 0;
+    FtpTimingSample median;
+    FtpTimingSample p90;
+};
+
+// Samples kept per operation and server.
+constexpr std::size_t kFtpStatsWindow = 200;
+// Local work recorded next to the network operations; only its total time is set.
+constexpr char kFtpParseOperation[] = "Parse listing";
+
+void clearFtpStats(const std::string& serverKey);
+// Median and 90th percentile of the recent samples of each operation on a server.
+std::vector<FtpOperationSummary> summarizeFtpStats(const std::string& serverKey);
+
+#ifdef USE_CURL
+std::string buildFtpUrl(const Settings& settings, const std::string& path, bool isDir);
+// Logs in with the settings' credentials and TLS mode, sharing TLS sessions and DNS
+// with every other FTP handle, and gives up on stalled connections.
+bool configureFtpHandle(CURL* curl, const Settings& settings, std::string& error);
+// Files the timings of a finished request under the server's diagnostics.
+void recordFtpTiming(const Settings& settings, const char* operation, CURL* curl, CURLcode result);
+// Must run before releaseCurlShare, as pooled handles still use the share.
+void drainFtpHandlePool();
+// Must run after every FTP handle is gone and before curl_global_cleanup.
+void releaseCurlShare();
+
+// Runs the listing on a caller-owned handle so that a worker can keep its control
+// connection (and login) alive across many directories.
+bool fetchFtpListOn(CURL* curl, const Settings& settings, const std::string& path, std::string& output,
+                    std::string& error, const std::atomic<bool>* cancel = nullptr);
+// Parses MLSD or LIST output, sorted.
+void parseFtpListing(const std::string& listing, std::vector<Entry>& entries);
+void storeFtpListing(const Settings& settings, const std::string& path, const std::vector<Entry>& entries,
+                     bool seeded = false);
+void invalidateFtpListings(const Settings& settings, const std::string& path);
+bool listFtpEntries(const Settings& settings, const std::string& path, std::vector<Entry>& entries,
+                    std::string& error, bool includeHidden);
+
+// Runs raw commands on a fresh control connection and returns every reply line the
+// server sent, login included.
+bool ftpQuoteCommands(const Settings& settings, const std::vector<std::string>& commands,
+                      std::vector<std::string>& replies, std::string& error,
+                      FtpTimingSample* timing = nullptr);
+bool ftpDeletePath(const Settings& settings, const std::string& remotePath, bool isDir, std::string& error);
+bool ftpDeleteRecursive(const Settings& settings, const std::string& remotePath, std::string& error);
+// Makes every missing folder on the way to remotePath; fails when remotePath is still
+// not a folder afterwards.
+bool ftpEnsureDir(const Settings& settings, const std::string& remotePath, std::string& error);
+
+// The FTP server in settings as a VfsBackend. Reads and writes stream over pooled
+// connections; listings are cached and checksums use HASH, XCRC or XMD5 when offered.
+std::shared_ptr<VfsBackend> ftpBackend(const Settings& settings);
+#endif
@@ -0,0 +1,190 @@
+#include "GameScan.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <tuple>
+
+#include "WorkerPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr unsigned kMaxWorkers = 8;
+// Deepest level searched below a game folder; Unreal keeps its binary in <Game>/Binaries/Win64/.
+constexpr int kMaxDepth = 3;
+constexpr std::uint16_t kFileDll = 0x2000;
+constexpr std::uint16_t kMagicPe32 = 0x10b;
+constexpr std::uint16_t kMagicPe32Plus = 0x20b;
+constexpr std::uint16_t kSubsystemGui = 2;
+constexpr std::uint16_t kSubsystemConsole = 3;
+
+// Name fragments of executables that come with a game but do not start it.
+const char* const kSkipNames[] = {
+    "unins", "setup", "install", "redist", "dxwebsetup", "directx", "dotnet", "ndp4", "prereq",
+    "crashhandler", "crashreport", "crashpad", "errorreport", "bugreport", "uploader", "cefprocess",
+};
+// Folders holding only installers and runtimes.
+const char* const kSkipDirs[] = {
+    "_commonredist", "commonredist", "redist", "_redist", "redistributables", "directx", "vcredist", "dotnet",
+    "__installer", "installer", "installers", "prerequisites", "easyanticheat", "battleye",
+};
+
+std::uint16_t read16(const unsigned char* p) {
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+std::uint32_t read32(const unsigned char* p) {
+    return static_cast<std::uint32_t>(read16(p)) | (static_cast<std::uint32_t>(read16(p + 2)) << 16);
+}
+
+std::string lowerName(const fs::path& path) {
+    std::string name = path.filename().string();
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    return name;
+}
+
+// Letters and digits only, lower-cased, so "My Game" matches "MyGame-Win64".
+std::string nameKey(const std::string& name) {
+    std::string key;
+    for (unsigned char ch : name) {
+        if (std::isalnum(ch)) {
+            key += static_cast<char>(std::tolower(ch));
+        }
+    }
+    return key;
+}
+
+bool containsAny(const std::string& name, const char* const* begin, const char* const* end) {
+    return std::any_of(begin, end, [&](const char* part) { return name.find(part) != std::string::npos; });
+}
+
+bool matchesSkipDir(const std::string& name) {
+    return std::find_if(std::begin(kSkipDirs), std::end(kSkipDirs),
+                        [&](const char* dir) { return name == dir; }) != std::end(kSkipDirs);
+}
+
+struct Choice {
+    fs::path exe;
+    int depth = 0;
+    bool named = false;
+    bool gui = false;
+    std::uintmax_t size = 0;
+
+    bool betterThan(const Choice& other) const {
+        return std::make_tuple(named, gui, -depth, size) > std::make_tuple(other.named, other.gui, -other.depth, other.size);
+    }
+};
+} // namespace
+
+bool readPeInfo(const fs::path& path, PeInfo& info) {
+    std::ifstream file(path, std::ios::binary);
+    unsigned char dos[64];
+    if (!file.read(reinterpret_cast<char*>(dos), sizeof(dos)) || dos[0] != 'M' || dos[1] != 'Z') {
+        return false;
+    }
+    // Signature, COFF header, then the optional header up to and including Subsystem.
+    unsigned char headers[4 + 20 + 70];
+    if (!file.seekg(read32(dos + 0x3C)) || !file.read(reinterpret_cast<char*>(headers), sizeof(headers))) {
+        return false;
+    }
+    if (headers[0] != 'P' || headers[1] != 'E' || headers[2] != 0 || headers[3] != 0) {
+        return false;
+    }
+    const unsigned char* coff = headers + 4;
+    const unsigned char* optional = coff + 20;
+    std::uint16_t magic = read16(optional);
+    if (read16(coff + 16) < 70 || (magic != kMagicPe32 && magic != kMagicPe32Plus)) {
+        return false;
+    }
+    info.dll = (read16(coff + 18) & kFileDll) != 0;
+    info.is64 = magic == kMagicPe32Plus;
+    info.subsystem = read16(optional + 68);
+    return true;
+}
+
+fs::path findMainExecutable(const fs::path& folder) {
+    std::string folderKey = nameKey(folder.filename().string());
+    Choice best;
+    std::error_code ec;
+    fs::recursive_directory_iterator it(folder, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        const fs::directory_entry& entry = *it;
+        std::string name = lowerName(entry.path());
+        std::error_code typeError;
+        if (entry.is_directory(typeError)) {
+            if (it.depth() >= kMaxDepth || matchesSkipDir(name)) {
+                it.disable_recursion_pending();
+            }
+            continue;
+        }
+        if (name.size() < 5 || name.compare(name.size() - 4, 4, ".exe") != 0 ||
+            containsAny(name, std::begin(kSkipNames), std::end(kSkipNames))) {
+            continue;
+        }
+        PeInfo pe;
+        if (!readPeInfo(entry.path(), pe) || pe.dll ||
+            (pe.subsystem != kSubsystemGui && pe.subsystem != kSubsystemConsole)) {
+            continue;
+        }
+        Choice choice;
+        choice.exe = entry.path();
+        choice.depth = it.depth();
+        std::string exeKey = nameKey(entry.path().stem().string());
+        choice.named = !folderKey.empty() && exeKey.size() >= 3 &&
+                       (folderKey.find(exeKey) != std::string::npos || exeKey.find(folderKey) != std::string::npos);
+        choice.gui = pe.subsystem == kSubsystemGui;
+        choice.size = entry.file_size(typeError);
+        if (best.exe.empty() || choice.betterThan(best)) {
+            best = choice;
+        }
+    }
+    return best.exe;
+}
+
+bool scanGameFolders(const fs::path& root, unsigned threads, std::vector<GameCandidate>& games,
+                     GameScanProgress& progress, std::string& error) {
+    games.clear();
+    std::vector<fs::path> folders;
+    std::error_code ec;
+    for (fs::directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+         !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        std::error_code typeError;
+        if (it->is_directory(typeError)) {
+            folders.push_back(it->path());
+        }
+    }
+    if (ec) {
+        error = "Failed to list " + root.string();
+        return false;
+    }
+    progress.folders = static_cast<int>(folders.size());
+
+    // Each folder is walked on one worker; card readers and USB disks cope with a few
+    // parallel readers much better than with one thread stalling on every seek.
+    std::vector<fs::path> exes(folders.size());
+    threads = workerCount(threads, kMaxWorkers, folders.size());
+    runParallel(folders.size(), threads, [&](std::size_t, std::size_t index) {
+        if (progress.cancel) {
+            return false;
+        }
+        exes[index] = findMainExecutable(folders[index]);
+        ++progress.foldersDone;
+        return true;
+    });
+    if (progress.cancel) {
+        error = "Cancelled";
+        return false;
+    }
+
+    for (std::size_t i = 0; i < folders.size(); ++i) {
+        if (!exes[i].empty()) {
+            games.push_back({folders[i], exes[i]});
+        }
+    }
+    std::sort(games.begin(), games.end(), [](const GameCandidate& a, const GameCandidate& b) {
+        return lowerName(a.folder) < lowerName(b.folder);
+    });
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// What the PE headers of a Windows executable say about it.
+struct PeInfo {
+    // 2 for GUI programs, 3 for console ones (IMAGE_SUBSYSTEM_WINDOWS_*).
+    std::uint16_t subsystem = 0;
+    bool dll = false;
+    bool is64 = false;
+};
+
+// Reads the DOS, COFF and optional headers; false when the file is not a PE image.
+bool readPeInfo(const std::filesystem::path& path, PeInfo& info);
+
+// The executable chosen to launch the game in folder.
+struct GameCandidate {
+    std::filesystem::path folder;
+    std::filesystem::path exe;
+};
+
+struct GameScanProgress {
+    // Set once the subfolders have been listed.
+    std::atomic<int> folders {0};
+    std::atomic<int> foldersDone {0};
+    std::atomic<bool> cancel {false};
+};
+
+// Picks the main executable of a game folder, looking a few levels deep. Installers,
+// uninstallers, redistributables, crash reporters and DLLs are passed over; of the
+// rest one named like the folder wins, then GUI over console, then the shallowest,
+// then the largest. Returns an empty path when nothing qualifies.
+std::filesystem::path findMainExecutable(const std::filesystem::path& folder);
+
+// Treats every subfolder of root as one game and runs findMainExecutable on each, on
+// up to `threads` workers (0 picks one per core). Folders without a candidate are left
+// out; games are sorted by folder name.
+bool scanGameFolders(const std::filesystem::path& root, unsigned threads, std::vector<GameCandidate>& games,
+                     GameScanProgress& progress, std::string& error);
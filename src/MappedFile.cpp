@@ -0,0 +1,104 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::filesystem::path& path, std::string& error) {
+    close();
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Failed to open file";
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        error = "Failed to read file size";
+        return false;
+    }
+    file_ = file;
+    size_ = static_cast<std::uint64_t>(size.QuadPart);
+    if (size_ == 0) {
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        error = "Failed to map file";
+        return false;
+    }
+    mapping_ = mapping;
+    data_ = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        close();
+        error = "Failed to map file";
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+        CloseHandle(static_cast<HANDLE>(mapping_));
+    }
+    if (file_) {
+        CloseHandle(static_cast<HANDLE>(file_));
+    }
+    data_ = nullptr;
+    mapping_ = nullptr;
+    file_ = nullptr;
+    size_ = 0;
+}
+#else
+bool MappedFile::open(const std::filesystem::path& path, std::string& error) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "Failed to open file";
+        return false;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        error = "Failed to read file size";
+        return false;
+    }
+    size_ = static_cast<std::uint64_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapped = mmap(nullptr, static_cast<size_t>(size_), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            size_ = 0;
+            error = "Failed to map file";
+            return false;
+        }
+        data_ = static_cast<const std::uint8_t*>(mapped);
+    }
+    // The mapping keeps the file referenced on its own.
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) {
+        munmap(const_cast<std::uint8_t*>(data_), static_cast<size_t>(size_));
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+#endif
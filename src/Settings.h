@@ -0,0 +1,29 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+enum class FtpTlsMode {
+    Off,
+    // Explicit FTPS (AUTH TLS) with certificate checks.
+    Tls,
+    // Explicit FTPS that accepts self-signed certificates, as most NAS boxes ship with.
+    TlsTrustAny,
+};
+
+struct Settings {
+    std::string ftpHost;
+    int ftpPort = 21;
+    std::string ftpUser;
+    std::string ftpPass;
+    FtpTlsMode ftpTls = FtpTlsMode::Off;
+    std::string steamLaunchOptions;
+    std::string steamCompatibilityToolVersion;
+    float uiScale = 1.0f;
+    bool showHidden = false;
+    int ftpCacheLimitMb = 1024;
+    int ftpSearchDepth = 8;
+    bool ftpVerify = false;
+    std::filesystem::path panePath[2];
+    std::filesystem::path ftpCacheDir;
+};
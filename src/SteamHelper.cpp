@@ -14,13 +14,16 @@
 #include <unordered_set>
 #include <vector>
 
+#include "MappedFile.h"
+#include "TreeCopy.h"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
 namespace fs = std::filesystem;
 
 namespace {
-constexpr uint8_t kNul = 0;
-constexpr uint8_t kSoh = 1;
-constexpr uint8_t kStx = 2;
-constexpr uint8_t kBs = 8;
 
 fs::path getHomePath() {
 #ifdef _WIN32
@@ -47,218 +50,44 @@ bool isDigits(const std::string& text) {
            std::all_of(text.begin(), text.end(), [](unsigned char ch) { return std::isdigit(ch) != 0; });
 }
 
-void appendByte(std::vector<uint8_t>& out, uint8_t value) {
-    out.push_back(value);
-}
-
-void appendString(std::vector<uint8_t>& out, const std::string& value) {
-    out.insert(out.end(), value.begin(), value.end());
-}
-
-void appendUInt32LE(std::vector<uint8_t>& out, uint32_t value) {
-    out.push_back(static_cast<uint8_t>(value & 0xFF));
-    out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
-    out.push_back(static_cast<uint8_t>((value >> 16) & 0xFF));
-    out.push_back(static_cast<uint8_t>((value >> 24) & 0xFF));
-}
-
-void appendNumberField(std::vector<uint8_t>& out, const std::string& key, uint32_t value) {
-    appendByte(out, kStx);
-    appendString(out, key);
-    appendByte(out, kNul);
-    appendUInt32LE(out, value);
-}
-
-void appendStringField(std::vector<uint8_t>& out, const std::string& key, const std::string& value) {
-    appendByte(out, kSoh);
-    appendString(out, key);
-    appendByte(out, kNul);
-    appendString(out, value);
-    appendByte(out, kNul);
-}
-
-void appendStringArrayField(std::vector<uint8_t>& out, const std::string& key, const std::vector<std::string>& values) {
-    appendByte(out, kNul);
-    appendString(out, key);
-    appendByte(out, kNul);
-    for (size_t i = 0; i < values.size(); ++i) {
-        appendByte(out, kSoh);
-        appendString(out, std::to_string(i));
-        appendByte(out, kNul);
-        appendString(out, values[i]);
-        appendByte(out, kNul);
+std::string quoteIfNeeded(const std::string& value) {
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        return value;
     }
+    return "\"" + value + "\"";
 }
 
-std::vector<uint8_t> buildEntryBuffer(uint32_t appId,
-                                      const std::string& appName,
-                                      const std::string& exe,
-                                      const std::string& startDir,
-                                      const std::string& launchOptions) {
-    auto quoteIfNeeded = [](const std::string& value) -> std::string {
-        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-            return value;
-        }
-        return "\"" + value + "\"";
+KeyValue buildShortcutEntry(uint32_t appId,
+                            const std::string& appName,
+                            const std::string& exe,
+                            const std::string& startDir,
+                            const std::string& launchOptions) {
+    KeyValue entry = KeyValue::object("");
+    entry.children = {
+        KeyValue::int32("appid", appId),
+        KeyValue::string("AppName", appName),
+        KeyValue::string("Exe", quoteIfNeeded(exe)),
+        KeyValue::string("StartDir", quoteIfNeeded(startDir)),
+        KeyValue::string("icon", ""),
+        KeyValue::string("ShortcutPath", ""),
+        KeyValue::string("LaunchOptions", launchOptions),
+        KeyValue::int32("IsHidden", 0),
+        KeyValue::int32("AllowDesktopConfig", 0),
+        KeyValue::int32("AllowOverlay", 0),
+        KeyValue::int32("OpenVR", 0),
+        KeyValue::int32("Devkit", 0),
+        KeyValue::string("DevkitGameID", ""),
+        KeyValue::int32("DevkitOverrideAppID", 0),
+        KeyValue::int32("LastPlayTime", 0),
+        KeyValue::string("FlatpakAppID", ""),
+        KeyValue::object("tags"),
     };
-    std::vector<uint8_t> out;
-    appendNumberField(out, "appid", appId);
-    appendStringField(out, "AppName", appName);
-    appendStringField(out, "Exe", quoteIfNeeded(exe));
-    appendStringField(out, "StartDir", quoteIfNeeded(startDir));
-    appendStringField(out, "icon", "");
-    appendStringField(out, "ShortcutPath", "");
-    appendStringField(out, "LaunchOptions", launchOptions);
-    appendNumberField(out, "IsHidden", 0);
-    appendNumberField(out, "AllowDesktopConfig", 0);
-    appendNumberField(out, "AllowOverlay", 0);
-    appendNumberField(out, "OpenVR", 0);
-    appendNumberField(out, "Devkit", 0);
-    appendStringField(out, "DevkitGameID", "");
-    appendNumberField(out, "DevkitOverrideAppID", 0);
-    appendNumberField(out, "LastPlayTime", 0);
-    appendStringField(out, "FlatpakAppID", "");
-    appendStringArrayField(out, "tags", {});
-    return out;
-}
-
-std::optional<uint32_t> extractAppId(const std::vector<uint8_t>& entry) {
-    const std::array<uint8_t, 7> pattern = {kStx, 'a', 'p', 'p', 'i', 'd', kNul};
-    auto it = std::search(entry.begin(), entry.end(), pattern.begin(), pattern.end());
-    if (it == entry.end()) {
-        return std::nullopt;
-    }
-    size_t offset = static_cast<size_t>(it - entry.begin()) + pattern.size();
-    if (offset + 4 > entry.size()) {
-        return std::nullopt;
-    }
-    uint32_t value = static_cast<uint32_t>(entry[offset]) |
-                     (static_cast<uint32_t>(entry[offset + 1]) << 8) |
-                     (static_cast<uint32_t>(entry[offset + 2]) << 16) |
-                     (static_cast<uint32_t>(entry[offset + 3]) << 24);
-    return value;
+    return entry;
 }
 
-size_t findSequence(const std::vector<uint8_t>& data, size_t start, uint8_t first, uint8_t second) {
-    for (size_t i = start; i + 1 < data.size(); ++i) {
-        if (data[i] == first && data[i + 1] == second) {
-            return i;
-        }
-    }
-    return std::string::npos;
-}
-
-bool parseShortcuts(const std::vector<uint8_t>& data,
-                    std::vector<std::vector<uint8_t>>& entries,
-                    std::string& error) {
-    entries.clear();
-    if (data.empty()) {
-        return true;
-    }
-    const std::string header = "shortcuts";
-    if (data.size() < header.size() + 2 || data[0] != kNul) {
-        error = "Invalid shortcuts.vdf header";
-        return false;
-    }
-    if (std::string(data.begin() + 1, data.begin() + 1 + header.size()) != header ||
-        data[1 + header.size()] != kNul) {
-        error = "Invalid shortcuts.vdf header";
-        return false;
-    }
-
-    size_t pos = 1 + header.size() + 1;
-    while (pos < data.size()) {
-        if (data[pos] == kBs && pos + 1 < data.size() && data[pos + 1] == kBs) {
-            return true;
-        }
-        if (data[pos] != kNul) {
-            error = "Malformed shortcuts.vdf entry";
-            return false;
-        }
-        size_t indexStart = pos + 1;
-        size_t indexEnd = indexStart;
-        while (indexEnd < data.size() && data[indexEnd] != kNul) {
-            ++indexEnd;
-        }
-        if (indexEnd >= data.size()) {
-            error = "Malformed shortcuts.vdf entry";
-            return false;
-        }
-        pos = indexEnd + 1;
-        size_t entryEnd = findSequence(data, pos, kBs, kBs);
-        if (entryEnd == std::string::npos) {
-            error = "Malformed shortcuts.vdf entry";
-            return false;
-        }
-        entries.emplace_back(data.begin() + static_cast<std::vector<uint8_t>::difference_type>(pos),
-                             data.begin() + static_cast<std::vector<uint8_t>::difference_type>(entryEnd));
-        pos = entryEnd + 2;
-    }
-    return true;
-}
-
-std::vector<uint8_t> buildShortcutsBuffer(const std::vector<std::vector<uint8_t>>& entries) {
-    std::vector<uint8_t> out;
-    appendByte(out, kNul);
-    appendString(out, "shortcuts");
-    appendByte(out, kNul);
-    for (size_t i = 0; i < entries.size(); ++i) {
-        appendByte(out, kNul);
-        appendString(out, std::to_string(i));
-        appendByte(out, kNul);
-        out.insert(out.end(), entries[i].begin(), entries[i].end());
-        appendByte(out, kBs);
-        appendByte(out, kBs);
-    }
-    appendByte(out, kBs);
-    appendByte(out, kBs);
-    return out;
-}
-
-bool readFile(const fs::path& path, std::vector<uint8_t>& data, std::string& error) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file) {
-        error = "Failed to open shortcuts.vdf";
-        return false;
-    }
-    file.seekg(0, std::ios::end);
-    std::streamoff size = file.tellg();
-    if (size < 0) {
-        error = "Failed to read shortcuts.vdf";
-        return false;
-    }
-    data.resize(static_cast<size_t>(size));
-    file.seekg(0, std::ios::beg);
-    if (size > 0) {
-        file.read(reinterpret_cast<char*>(data.data()), size);
-        if (!file) {
-            error = "Failed to read shortcuts.vdf";
-            return false;
-        }
-    }
-    return true;
-}
-
-bool writeFile(const fs::path& path, const std::vector<uint8_t>& data, std::string& error) {
-    std::error_code ec;
-    fs::create_directories(path.parent_path(), ec);
-    if (ec) {
-        error = "Failed to create Steam config directory";
-        return false;
-    }
-    std::ofstream file(path, std::ios::binary | std::ios::trunc);
-    if (!file) {
-        error = "Failed to write shortcuts.vdf";
-        return false;
-    }
-    if (!data.empty()) {
-        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
-        if (!file) {
-            error = "Failed to write shortcuts.vdf";
-            return false;
-        }
-    }
-    return true;
+std::string stringField(const KeyValue& entry, const std::string& key) {
+    const KeyValue* field = entry.find(key);
+    return field && field->type == KeyValue::Type::String ? field->text : std::string();
 }
 
 std::vector<fs::path> steamSearchRoots() {
@@ -565,6 +394,32 @@ VdfEntry* findEntry(VdfObject& obj, const std::string& key, bool caseSensitive =
     return nullptr;
 }
 
+// Parses a whole text VDF file (libraryfolders.vdf, appmanifest_*.acf).
+bool readVdfFile(const fs::path& path, VdfObject& root, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "Failed to open " + path.filename().string();
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<VdfToken> tokens;
+    if (!tokenizeVdf(text, tokens, error) || !parseRootTokens(tokens, root, error)) {
+        error = "Malformed " + path.filename().string();
+        return false;
+    }
+    return true;
+}
+
+std::string vdfString(VdfObject& obj, const std::string& key) {
+    VdfEntry* entry = findEntry(obj, key, false);
+    return entry && !entry->objectValue ? entry->stringValue : std::string();
+}
+
+std::uint64_t vdfNumber(VdfObject& obj, const std::string& key) {
+    std::string text = vdfString(obj, key);
+    return isDigits(text) ? std::strtoull(text.c_str(), nullptr, 10) : 0;
+}
+
 std::string detectNewline(const std::string& text) {
     if (text.find("\r\n") != std::string::npos) {
         return "\r\n";
@@ -658,79 +513,10 @@ bool insertBefore(std::string& text, size_t pos, const std::string& insertion) {
     text.insert(pos, insertion);
     return true;
 }
-} // namespace
-
-bool addShortcutToSteam(const fs::path& exePath,
-                        const fs::path& startDir,
-                        const std::string& appName,
-                        const std::string& launchOptions,
-                        std::uint32_t& appId,
-                        std::string& error) {
-    if (appName.empty()) {
-        error = "App name is required";
-        return false;
-    }
-
-    fs::path shortcutsPath = findShortcutsPath(error);
-    if (shortcutsPath.empty()) {
-        return false;
-    }
-
-    std::vector<std::vector<uint8_t>> entries;
-    if (fs::exists(shortcutsPath)) {
-        std::vector<uint8_t> data;
-        if (!readFile(shortcutsPath, data, error)) {
-            return false;
-        }
-        if (!parseShortcuts(data, entries, error)) {
-            return false;
-        }
-    }
-
-    std::unordered_set<uint32_t> existingIds;
-    for (const auto& entry : entries) {
-        if (auto appId = extractAppId(entry)) {
-            existingIds.insert(*appId);
-        }
-    }
-
-    auto newAppId = generateUniqueAppId(existingIds);
-    if (!newAppId) {
-        error = "Failed to generate unique app ID";
-        return false;
-    }
-    appId = *newAppId;
-
-    fs::path absExe = fs::absolute(exePath);
-    fs::path absStart = startDir.empty() ? absExe.parent_path() : fs::absolute(startDir);
-    std::string exeValue = absExe.string();
-    std::string dirValue = absStart.string();
-    entries.push_back(buildEntryBuffer(*newAppId, appName, exeValue, dirValue, launchOptions));
-
-    std::vector<uint8_t> output = buildShortcutsBuffer(entries);
-    if (!writeFile(shortcutsPath, output, error)) {
-        return false;
-    }
-
-    return true;
-}
-
-bool setSteamCompatToolMapping(std::uint32_t appId, const std::string& toolName, std::string& error) {
-    if (toolName.empty()) {
-        return true;
-    }
-    fs::path configPath = findConfigVdfPath(error);
-    if (configPath.empty()) {
-        return false;
-    }
-
-    std::ifstream file(configPath);
-    if (!file) {
-        error = "Failed to open config.vdf";
-        return false;
-    }
-    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
+// Adds or updates the CompatToolMapping entry of one app in the text of config.vdf,
+// keeping the file's own indentation and newlines.
+bool applyCompatToolMapping(std::string& text, std::uint32_t appId, const std::string& toolName, std::string& error) {
     std::vector<VdfToken> tokens;
     if (!tokenizeVdf(text, tokens, error)) {
         return false;
@@ -855,6 +641,541 @@ bool setSteamCompatToolMapping(std::uint32_t appId, const std::string& toolName,
         }
     }
 
+    return true;
+}
+
+// Replaces path with data in one step: written next to it first, then renamed over it.
+bool writeFileReplacing(const fs::path& path, const void* data, size_t size, std::string& error) {
+    fs::path temp = path;
+    temp += ".tmp";
+    std::error_code ec;
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        file.close();
+        if (!file) {
+            fs::remove(temp, ec);
+            error = "Failed to write " + path.filename().string();
+            return false;
+        }
+    }
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        error = "Failed to replace " + path.filename().string();
+        return false;
+    }
+    return true;
+}
+
+// The numbered entry of libraryfolders.vdf whose path is library.
+VdfEntry* findLibraryEntry(VdfObject& root, const fs::path& library) {
+    VdfEntry* folders = findEntry(root, "libraryfolders", false);
+    if (!folders || !folders->objectValue) {
+        return nullptr;
+    }
+    for (auto& entry : folders->objectValue->entries) {
+        std::error_code ec;
+        if (entry.objectValue && isDigits(entry.key) &&
+            fs::equivalent(fs::u8path(vdfString(*entry.objectValue, "path")), library, ec)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+// Moves appId from the "apps" list of one library to the other's in the text of
+// libraryfolders.vdf. Offsets shift with the first edit, so each one parses afresh.
+bool moveLibraryFoldersApp(std::string& text, std::uint32_t appId, const fs::path& from, const fs::path& to,
+                           std::uint64_t size, std::string& error) {
+    std::string appIdText = std::to_string(appId);
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<VdfToken> tokens;
+        VdfObject root;
+        if (!tokenizeVdf(text, tokens, error) || !parseRootTokens(tokens, root, error)) {
+            error = "Malformed libraryfolders.vdf";
+            return false;
+        }
+        VdfEntry* library = findLibraryEntry(root, pass == 0 ? from : to);
+        VdfEntry* apps = library ? findEntry(*library->objectValue, "apps", false) : nullptr;
+        if (!apps || !apps->objectValue) {
+            continue;
+        }
+        VdfEntry* app = findEntry(*apps->objectValue, appIdText);
+        if (pass == 0 && app) {
+            size_t start = text.rfind('\n', app->keyStart);
+            start = start == std::string::npos ? 0 : start + 1;
+            size_t end = text.find('\n', app->valueEnd);
+            end = end == std::string::npos ? text.size() : end + 1;
+            text.erase(start, end - start);
+        } else if (pass == 1 && !app) {
+            size_t braceEnd = apps->objectValue->braceEnd;
+            std::string closingIndent = getLineIndent(text, braceEnd);
+            std::string indent = apps->objectValue->entries.empty()
+                                     ? closingIndent + detectIndentUnit(closingIndent)
+                                     : getLineIndent(text, apps->objectValue->entries.front().keyStart);
+            std::string newline = detectNewline(text);
+            std::string line = indent + "\"" + appIdText + "\"\t\t\"" + std::to_string(size) + "\"" + newline;
+            size_t lineStart = text.rfind('\n', braceEnd);
+            lineStart = lineStart == std::string::npos ? 0 : lineStart + 1;
+            // A closing brace on its own line gets the new entry above it.
+            if (text.find_first_not_of(" \t\r", lineStart) == braceEnd) {
+                text.insert(lineStart, line);
+            } else {
+                text.insert(braceEnd, newline + line);
+            }
+        }
+    }
+    return true;
+}
+
+// Steam rebuilds these lists itself, but shows stale sizes per library until it does.
+bool updateLibraryFolders(std::uint32_t appId, const fs::path& from, const fs::path& to, std::uint64_t size,
+                          std::string& error) {
+    std::vector<fs::path> done;
+    for (const auto& root : steamSearchRoots()) {
+        fs::path path = root / "steamapps" / "libraryfolders.vdf";
+        std::error_code ec;
+        fs::path real = fs::weakly_canonical(path, ec);
+        if (!fs::exists(path, ec) || std::find(done.begin(), done.end(), real) != done.end()) {
+            continue;
+        }
+        done.push_back(real);
+        std::ifstream file(path, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (!file.good() && !file.eof()) {
+            error = "Failed to read libraryfolders.vdf";
+            return false;
+        }
+        if (!moveLibraryFoldersApp(text, appId, from, to, size, error) ||
+            !writeFileReplacing(path, text.data(), text.size(), error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Written into the target library when a move starts and removed once it is complete,
+// holding the source library; lets a cut-off move be resumed or finished.
+fs::path moveJournalPath(const fs::path& library, std::uint32_t appId) {
+    return library / "steamapps" / ("gamepadcommander-move-" + std::to_string(appId));
+}
+
+// Whether a folder at from can be renamed into library rather than copied.
+bool sameFilesystem(const fs::path& from, const fs::path& library) {
+#ifdef _WIN32
+    std::error_code ec;
+    fs::path left = fs::absolute(from, ec);
+    fs::path right = fs::absolute(library, ec);
+    return !ec && left.root_name() == right.root_name();
+#else
+    struct stat left {};
+    struct stat right {};
+    return ::stat(from.c_str(), &left) == 0 && ::stat(library.c_str(), &right) == 0 &&
+           left.st_dev == right.st_dev;
+#endif
+}
+
+// installdir names a folder below steamapps/common; anything else is never deleted.
+bool plainFolderName(const std::string& name) {
+    return !name.empty() && name != "." && name != ".." && name.find('/') == std::string::npos &&
+           name.find('\\') == std::string::npos;
+}
+
+// The last steps of a move, once the target library holds every file and the manifest:
+// the old copy goes, and libraryfolders.vdf learns where the app now is.
+void completeSteamAppMove(const SteamApp& source, const fs::path& toLibrary, std::string& warning) {
+    SteamApp target = source;
+    target.library = toLibrary;
+    // The new manifest and copy must be on disk before the old ones go; the journal
+    // stays, so the next start finishes the move.
+    if (!flushFilesystem(toLibrary / "steamapps")) {
+        warning = "Could not flush " + toLibrary.string() + "; the old copy was kept";
+        return;
+    }
+    std::error_code ec;
+    fs::remove(source.manifest, ec);
+    const std::pair<fs::path, fs::path> parts[] = {
+        {source.installPath(), target.installPath()},
+        {source.shaderCachePath(), target.shaderCachePath()},
+        {source.compatDataPath(), target.compatDataPath()},
+    };
+    for (const auto& part : parts) {
+        if (fs::exists(part.first, ec) && !fs::equivalent(part.first, part.second, ec)) {
+            fs::remove_all(part.first, ec);
+        }
+    }
+    if (!updateLibraryFolders(source.appId, source.library, toLibrary, source.sizeOnDisk, warning)) {
+        warning = "libraryfolders.vdf not updated: " + warning;
+    }
+    fs::remove(moveJournalPath(toLibrary, source.appId), ec);
+}
+} // namespace
+
+fs::path SteamApp::installPath() const {
+    return library / "steamapps" / "common" / fs::u8path(installDir);
+}
+
+fs::path SteamApp::shaderCachePath() const {
+    return library / "steamapps" / "shadercache" / std::to_string(appId);
+}
+
+fs::path SteamApp::compatDataPath() const {
+    return library / "steamapps" / "compatdata" / std::to_string(appId);
+}
+
+std::vector<fs::path> findSteamLibraries() {
+    std::vector<fs::path> libraries;
+    std::vector<fs::path> seen;
+    auto addLibrary = [&](const fs::path& library) {
+        std::error_code ec;
+        if (!fs::is_directory(library / "steamapps", ec)) {
+            return;
+        }
+        fs::path real = fs::weakly_canonical(library, ec);
+        fs::path key = ec ? library : real;
+        if (std::find(seen.begin(), seen.end(), key) == seen.end()) {
+            seen.push_back(key);
+            libraries.push_back(library);
+        }
+    };
+    for (const auto& root : steamSearchRoots()) {
+        // The install itself is always library 0, even when the list is missing.
+        addLibrary(root);
+        VdfObject vdf;
+        std::string error;
+        if (!readVdfFile(root / "steamapps" / "libraryfolders.vdf", vdf, error)) {
+            continue;
+        }
+        VdfEntry* folders = findEntry(vdf, "libraryfolders", false);
+        if (!folders || !folders->objectValue) {
+            continue;
+        }
+        for (auto& entry : folders->objectValue->entries) {
+            if (!isDigits(entry.key)) {
+                continue;
+            }
+            // Older files map the number straight to the path.
+            std::string path = entry.objectValue ? vdfString(*entry.objectValue, "path") : entry.stringValue;
+            if (!path.empty()) {
+                addLibrary(fs::u8path(path));
+            }
+        }
+    }
+    return libraries;
+}
+
+bool listSteamApps(const std::vector<fs::path>& libraries, std::vector<SteamApp>& apps, std::string& error) {
+    apps.clear();
+    if (libraries.empty()) {
+        error = "No Steam library found";
+        return false;
+    }
+    for (const auto& library : libraries) {
+        std::error_code ec;
+        for (fs::directory_iterator it(library / "steamapps", ec); !ec && it != fs::directory_iterator(); it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (name.rfind("appmanifest_", 0) != 0 || it->path().extension() != ".acf") {
+                continue;
+            }
+            VdfObject manifest;
+            std::string manifestError;
+            if (!readVdfFile(it->path(), manifest, manifestError)) {
+                continue;
+            }
+            VdfEntry* state = findEntry(manifest, "AppState", false);
+            if (!state || !state->objectValue) {
+                continue;
+            }
+            SteamApp app;
+            app.appId = static_cast<std::uint32_t>(vdfNumber(*state->objectValue, "appid"));
+            app.name = vdfString(*state->objectValue, "name");
+            app.installDir = vdfString(*state->objectValue, "installdir");
+            app.sizeOnDisk = vdfNumber(*state->objectValue, "SizeOnDisk");
+            app.library = library;
+            app.manifest = it->path();
+            if (app.appId == 0 || app.installDir.empty()) {
+                continue;
+            }
+            if (app.name.empty()) {
+                app.name = app.installDir;
+            }
+            apps.push_back(app);
+        }
+    }
+    return true;
+}
+
+bool moveSteamApp(const SteamApp& app, const fs::path& toLibrary, ExtractProgress& progress, std::string& error) {
+    std::error_code ec;
+    if (fs::equivalent(app.library, toLibrary, ec)) {
+        error = "Already in that library";
+        return false;
+    }
+    if (!plainFolderName(app.installDir)) {
+        error = "Unexpected installdir in manifest";
+        return false;
+    }
+    SteamApp target = app;
+    target.library = toLibrary;
+    target.manifest = toLibrary / "steamapps" / app.manifest.filename();
+    if (fs::exists(target.manifest, ec)) {
+        error = "Already installed in that library";
+        return false;
+    }
+    fs::path journal = moveJournalPath(toLibrary, app.appId);
+    if (!fs::exists(journal, ec) && fs::exists(target.installPath(), ec)) {
+        error = "Target library already has a folder named " + app.installDir;
+        return false;
+    }
+    std::string source = app.library.u8string();
+    if (!writeFileReplacing(journal, source.data(), source.size(), error)) {
+        return false;
+    }
+
+    // Parts on another filesystem are copied first; only once all of them are complete
+    // are the others renamed, so a failure never leaves the app split between libraries.
+    // Sources stay until completeSteamAppMove, and renames are put back on a failure.
+    const std::pair<fs::path, fs::path> parts[] = {
+        {app.installPath(), target.installPath()},
+        {app.shaderCachePath(), target.shaderCachePath()},
+        {app.compatDataPath(), target.compatDataPath()},
+    };
+    std::vector<const std::pair<fs::path, fs::path>*> renames;
+    for (const auto& part : parts) {
+        if (!fs::exists(part.first, ec)) {
+            continue;
+        }
+        if (!fs::exists(part.second, ec) && sameFilesystem(part.first, toLibrary)) {
+            renames.push_back(&part);
+        } else if (!copyTree(part.first, part.second, 0, progress, error)) {
+            return false;
+        }
+    }
+    std::vector<const std::pair<fs::path, fs::path>*> renamed;
+    auto rollBack = [&renamed]() {
+        std::error_code ignored;
+        for (auto it = renamed.rbegin(); it != renamed.rend(); ++it) {
+            fs::rename((*it)->second, (*it)->first, ignored);
+        }
+    };
+    for (const auto* part : renames) {
+        fs::create_directories(part->second.parent_path(), ec);
+        fs::rename(part->first, part->second, ec);
+        if (!ec) {
+            renamed.push_back(part);
+        } else if (!copyTree(part->first, part->second, 0, progress, error)) {
+            rollBack();
+            return false;
+        }
+    }
+
+    std::ifstream file(app.manifest, std::ios::binary);
+    std::string manifest((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (manifest.empty() || !writeFileReplacing(target.manifest, manifest.data(), manifest.size(), error)) {
+        if (manifest.empty()) {
+            error = "Failed to read " + app.manifest.filename().string();
+        }
+        rollBack();
+        return false;
+    }
+    error.clear();
+    completeSteamAppMove(app, toLibrary, error);
+    return true;
+}
+
+void finishSteamAppMoves(const std::vector<fs::path>& libraries) {
+    const std::string prefix = "gamepadcommander-move-";
+    for (const auto& library : libraries) {
+        std::error_code ec;
+        std::vector<std::uint32_t> pending;
+        for (fs::directory_iterator it(library / "steamapps", ec); !ec && it != fs::directory_iterator();
+             it.increment(ec)) {
+            std::string name = it->path().filename().string();
+            if (name.rfind(prefix, 0) == 0 && isDigits(name.substr(prefix.size()))) {
+                pending.push_back(static_cast<std::uint32_t>(std::strtoul(name.c_str() + prefix.size(), nullptr, 10)));
+            }
+        }
+        for (std::uint32_t appId : pending) {
+            // Without the manifest in place the copy itself was cut off; that is resumed
+            // by moving the app again.
+            fs::path manifestName = "appmanifest_" + std::to_string(appId) + ".acf";
+            VdfObject manifest;
+            std::string error;
+            if (!readVdfFile(library / "steamapps" / manifestName, manifest, error)) {
+                continue;
+            }
+            VdfEntry* state = findEntry(manifest, "AppState", false);
+            std::ifstream journal(moveJournalPath(library, appId), std::ios::binary);
+            std::string sourceLibrary((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+            if (!state || !state->objectValue || sourceLibrary.empty()) {
+                continue;
+            }
+            SteamApp source;
+            source.appId = appId;
+            source.installDir = vdfString(*state->objectValue, "installdir");
+            source.sizeOnDisk = vdfNumber(*state->objectValue, "SizeOnDisk");
+            source.library = fs::u8path(sourceLibrary);
+            source.manifest = source.library / "steamapps" / manifestName;
+            if (plainFolderName(source.installDir)) {
+                completeSteamAppMove(source, library, error);
+            }
+        }
+    }
+}
+
+bool SteamShortcuts::load(std::string& error) {
+    path_ = findShortcutsPath(error);
+    if (path_.empty()) {
+        return false;
+    }
+    root_ = KeyValue::object("");
+    appIds_.clear();
+    std::error_code ec;
+    if (fs::exists(path_, ec)) {
+        MappedFile file;
+        if (!file.open(path_, error)) {
+            error = "Failed to open shortcuts.vdf";
+            return false;
+        }
+        if (file.size() > 0 && !parseBinaryKeyValues(file.data(), static_cast<size_t>(file.size()), root_, error)) {
+            error = "Invalid shortcuts.vdf: " + error;
+            return false;
+        }
+    }
+    KeyValue* shortcuts = root_.find("shortcuts");
+    if (!shortcuts) {
+        root_.children.push_back(KeyValue::object("shortcuts"));
+        shortcuts = &root_.children.back();
+    }
+    if (shortcuts->type != KeyValue::Type::Object) {
+        error = "Invalid shortcuts.vdf header";
+        return false;
+    }
+    for (const KeyValue& entry : shortcuts->children) {
+        const KeyValue* id = entry.find("appid");
+        if (id && id->type == KeyValue::Type::Int32) {
+            appIds_.insert(static_cast<uint32_t>(id->bits));
+        }
+    }
+    return true;
+}
+
+std::vector<SteamShortcut> SteamShortcuts::list() const {
+    std::vector<SteamShortcut> shortcuts;
+    const KeyValue* root = root_.find("shortcuts");
+    if (!root) {
+        return shortcuts;
+    }
+    for (const KeyValue& entry : root->children) {
+        if (entry.type != KeyValue::Type::Object) {
+            continue;
+        }
+        SteamShortcut shortcut;
+        const KeyValue* id = entry.find("appid");
+        shortcut.appId = id && id->type == KeyValue::Type::Int32 ? static_cast<uint32_t>(id->bits) : 0;
+        shortcut.appName = stringField(entry, "AppName");
+        shortcut.exe = stringField(entry, "Exe");
+        shortcut.startDir = stringField(entry, "StartDir");
+        shortcut.launchOptions = stringField(entry, "LaunchOptions");
+        shortcuts.push_back(shortcut);
+    }
+    return shortcuts;
+}
+
+bool SteamShortcuts::add(const fs::path& exePath,
+                         const fs::path& startDir,
+                         const std::string& appName,
+                         const std::string& launchOptions,
+                         std::uint32_t& appId,
+                         std::string& error) {
+    if (appName.empty()) {
+        error = "App name is required";
+        return false;
+    }
+    KeyValue* shortcuts = root_.find("shortcuts");
+    if (!shortcuts) {
+        error = "shortcuts.vdf not loaded";
+        return false;
+    }
+    auto newAppId = generateUniqueAppId(appIds_);
+    if (!newAppId) {
+        error = "Failed to generate unique app ID";
+        return false;
+    }
+    appId = *newAppId;
+    appIds_.insert(appId);
+
+    fs::path absExe = fs::absolute(exePath);
+    fs::path absStart = startDir.empty() ? absExe.parent_path() : fs::absolute(startDir);
+    shortcuts->children.push_back(
+        buildShortcutEntry(appId, appName, absExe.string(), absStart.string(), launchOptions));
+    return true;
+}
+
+// Steam numbers the entries from zero, so keys are reassigned before writing. The new
+// file is written next to the old one and renamed over it, so Steam never sees a
+// partial file.
+bool SteamShortcuts::commit(std::string& error) {
+    KeyValue* shortcuts = root_.find("shortcuts");
+    if (!shortcuts) {
+        error = "shortcuts.vdf not loaded";
+        return false;
+    }
+    for (size_t i = 0; i < shortcuts->children.size(); ++i) {
+        shortcuts->children[i].key = std::to_string(i);
+    }
+    std::vector<uint8_t> data;
+    writeBinaryKeyValues(root_, data);
+
+    std::error_code ec;
+    fs::create_directories(path_.parent_path(), ec);
+    if (ec) {
+        error = "Failed to create Steam config directory";
+        return false;
+    }
+    return writeFileReplacing(path_, data.data(), data.size(), error);
+}
+
+bool addShortcutToSteam(const fs::path& exePath,
+                        const fs::path& startDir,
+                        const std::string& appName,
+                        const std::string& launchOptions,
+                        std::uint32_t& appId,
+                        std::string& error) {
+    if (appName.empty()) {
+        error = "App name is required";
+        return false;
+    }
+    SteamShortcuts shortcuts;
+    return shortcuts.load(error) && shortcuts.add(exePath, startDir, appName, launchOptions, appId, error) &&
+           shortcuts.commit(error);
+}
+
+bool setSteamCompatToolMappings(const std::vector<std::uint32_t>& appIds,
+                                const std::string& toolName,
+                                std::string& error) {
+    if (toolName.empty() || appIds.empty()) {
+        return true;
+    }
+    fs::path configPath = findConfigVdfPath(error);
+    if (configPath.empty()) {
+        return false;
+    }
+
+    std::ifstream file(configPath);
+    if (!file) {
+        error = "Failed to open config.vdf";
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    for (std::uint32_t appId : appIds) {
+        if (!applyCompatToolMapping(text, appId, toolName, error)) {
+            return false;
+        }
+    }
+
     std::ofstream out(configPath, std::ios::trunc);
     if (!out) {
         error = "Failed to write config.vdf";
@@ -863,3 +1184,7 @@ bool setSteamCompatToolMapping(std::uint32_t appId, const std::string& toolName,
     out << text;
     return true;
 }
+
+bool setSteamCompatToolMapping(std::uint32_t appId, const std::string& toolName, std::string& error) {
+    return setSteamCompatToolMappings({appId}, toolName, error);
+}
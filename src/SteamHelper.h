@@ -3,7 +3,88 @@
 #include <cstdint>
 #include <filesystem>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
+#include "BinaryKeyValues.h"
+#include "ExtractOutput.h"
+
+// A non-Steam game as listed in shortcuts.vdf.
+struct SteamShortcut {
+    std::uint32_t appId = 0;
+    std::string appName;
+    std::string exe;
+    std::string startDir;
+    std::string launchOptions;
+};
+
+// An installed game as recorded by steamapps/appmanifest_<id>.acf.
+struct SteamApp {
+    std::uint32_t appId = 0;
+    std::string name;
+    std::string installDir;
+    // SizeOnDisk from the manifest, as Steam last counted it.
+    std::uint64_t sizeOnDisk = 0;
+    // Root of the library (the folder holding steamapps).
+    std::filesystem::path library;
+    std::filesystem::path manifest;
+
+    std::filesystem::path installPath() const;
+    std::filesystem::path shaderCachePath() const;
+    // The Proton prefix, only present for games run through Proton.
+    std::filesystem::path compatDataPath() const;
+};
+
+// Library roots listed in libraryfolders.vdf of every Steam install found, each once,
+// in the order Steam numbers them.
+std::vector<std::filesystem::path> findSteamLibraries();
+
+// Reads every appmanifest_*.acf of the given libraries. Manifests that do not parse are
+// skipped; false only when no library exists at all.
+bool listSteamApps(const std::vector<std::filesystem::path>& libraries,
+                   std::vector<SteamApp>& apps,
+                   std::string& error);
+
+// Moves an installed app, with its shader cache and Proton prefix, into another library
+// (a folder holding steamapps). Folders on another filesystem are copied with copyTree,
+// progress going to progress, and only then are the rest renamed; a failure puts the
+// renamed folders back, so the app is never left split between libraries. The manifest
+// follows once every file is in place, then the old copy is deleted and
+// libraryfolders.vdf updated. A move that is cancelled or cut off keeps the source
+// intact and picks up where it stopped when started again. Steam should not be running.
+// As with addExeToSteam, true with error set means the move itself succeeded.
+bool moveSteamApp(const SteamApp& app,
+                  const std::filesystem::path& toLibrary,
+                  ExtractProgress& progress,
+                  std::string& error);
+
+// Finishes moves that were cut off after the target library already had everything,
+// by removing the old copy.
+void finishSteamAppMoves(const std::vector<std::filesystem::path>& libraries);
+
+// The current user's shortcuts.vdf, read once from a mapping into a KeyValues tree.
+// Additions stay in memory until commit() writes the whole file in one atomic step;
+// keys this model does not know about are written back unchanged.
+class SteamShortcuts {
+public:
+    bool load(std::string& error);
+    std::vector<SteamShortcut> list() const;
+    // Queues a new shortcut with a fresh app ID, unique among the loaded ones.
+    bool add(const std::filesystem::path& exePath,
+             const std::filesystem::path& startDir,
+             const std::string& appName,
+             const std::string& launchOptions,
+             std::uint32_t& appId,
+             std::string& error);
+    bool commit(std::string& error);
+
+private:
+    std::filesystem::path path_;
+    KeyValue root_;
+    std::unordered_set<std::uint32_t> appIds_;
+};
+
+// Adds a single shortcut; SteamShortcuts does the same for several in one write.
 bool addShortcutToSteam(const std::filesystem::path& exePath,
                         const std::filesystem::path& startDir,
                         const std::string& appName,
@@ -14,3 +95,8 @@ bool addShortcutToSteam(const std::filesystem::path& exePath,
 bool setSteamCompatToolMapping(std::uint32_t appId,
                                const std::string& toolName,
                                std::string& error);
+
+// Same for several apps, with config.vdf read and written once.
+bool setSteamCompatToolMappings(const std::vector<std::uint32_t>& appIds,
+                                const std::string& toolName,
+                                std::string& error);
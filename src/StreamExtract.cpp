@@ -0,0 +1,713 @@
+#include "StreamExtract.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <archive.h>
+#include <archive_entry.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr std::size_t kOpenBlock = 1024 * 1024;
+// Decompressed data allowed to wait for the writer before the reader pauses.
+constexpr std::size_t kQueueBytes = 16 * 1024 * 1024;
+// Compressed data fetched ahead of the decompressor when the archive is remote.
+constexpr std::size_t kPrefetchBytes = 16 * 1024 * 1024;
+constexpr std::size_t kZeroBlock = 1024 * 1024;
+
+// One step of the extraction, handed from the decompressing thread to the writer in
+// archive order. A File is followed by its Data blocks and an End.
+struct Block {
+    enum class Kind { Dir, File, Data, End, Symlink, HardLink };
+    Kind kind = Kind::Data;
+    std::string relPath;
+    // Symlink text, or the relative path of the earlier entry a hard link points to.
+    std::string link;
+    std::uint64_t size = 0;
+    std::uint64_t offset = 0;
+    std::uint32_t mode = 0;
+    std::int64_t modified = 0;
+    std::vector<char> data;
+};
+
+class BlockQueue {
+public:
+    // Waits while the queue is over its byte budget. False once the writer has stopped.
+    bool push(Block block) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&]() { return stopped_ || bytes_ < kQueueBytes; });
+        if (stopped_) {
+            return false;
+        }
+        bytes_ += block.data.size();
+        blocks_.push_back(std::move(block));
+        changed_.notify_all();
+        return true;
+    }
+
+    // Waits for the next block. False when the reader has finished and nothing is left.
+    bool pop(Block& block) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&]() { return finished_ || !blocks_.empty(); });
+        if (blocks_.empty()) {
+            return false;
+        }
+        block = std::move(blocks_.front());
+        blocks_.pop_front();
+        bytes_ -= block.data.size();
+        changed_.notify_all();
+        return true;
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        changed_.notify_all();
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopped_ = true;
+        changed_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Block> blocks_;
+    std::size_t bytes_ = 0;
+    bool finished_ = false;
+    bool stopped_ = false;
+};
+
+class ArchiveReader {
+public:
+    ~ArchiveReader() {
+        if (handle_) {
+            archive_read_free(handle_);
+        }
+    }
+
+    bool open(const fs::path& path, std::string& error) {
+        handle_ = archive_read_new();
+        if (!handle_) {
+            error = "Out of memory";
+            return false;
+        }
+        archive_read_support_filter_all(handle_);
+        archive_read_support_format_tar(handle_);
+        archive_read_support_format_7zip(handle_);
+        archive_read_support_format_rar(handle_);
+        archive_read_support_format_rar5(handle_);
+        // libarchive moves on to the next volume by itself when given the whole set.
+        std::vector<fs::path> volumes = archiveVolumes(path);
+#ifdef _WIN32
+        std::vector<const wchar_t*> names;
+#else
+        std::vector<const char*> names;
+#endif
+        for (const fs::path& volume : volumes) {
+            names.push_back(volume.c_str());
+        }
+        names.push_back(nullptr);
+#ifdef _WIN32
+        int result = archive_read_open_filenames_w(handle_, names.data(), kOpenBlock);
+#else
+        int result = archive_read_open_filenames(handle_, names.data(), kOpenBlock);
+#endif
+        if (result != ARCHIVE_OK) {
+            error = lastError();
+            return false;
+        }
+        return true;
+    }
+
+    bool open(ByteSource& source, std::uint64_t size, std::string& error) {
+        handle_ = archive_read_new();
+        if (!handle_) {
+            error = "Out of memory";
+            return false;
+        }
+        archive_read_support_filter_all(handle_);
+        archive_read_support_format_tar(handle_);
+        archive_read_support_format_7zip(handle_);
+        archive_read_support_format_rar(handle_);
+        archive_read_support_format_rar5(handle_);
+        source_ = &source;
+        size_ = size;
+        buffer_.resize(kOpenBlock);
+        archive_read_set_callback_data(handle_, this);
+        archive_read_set_open_callback(handle_, openSource);
+        archive_read_set_read_callback(handle_, readSource);
+        archive_read_set_seek_callback(handle_, seekSource);
+        if (archive_read_open1(handle_) != ARCHIVE_OK) {
+            error = lastError();
+            return false;
+        }
+        return true;
+    }
+
+    // ARCHIVE_OK with entry set, ARCHIVE_EOF at the end, anything else is a failure.
+    int next(archive_entry*& entry) {
+        int result = archive_read_next_header(handle_, &entry);
+        return result == ARCHIVE_WARN ? ARCHIVE_OK : result;
+    }
+
+    std::uint64_t bytesRead() const {
+        return static_cast<std::uint64_t>(archive_filter_bytes(handle_, -1));
+    }
+
+    std::string lastError() const {
+        const char* message = archive_error_string(handle_);
+        return message ? message : "Unreadable archive";
+    }
+
+    archive* handle() const {
+        return handle_;
+    }
+
+private:
+    static int openSource(archive* handle, void* data) {
+        ArchiveReader* self = static_cast<ArchiveReader*>(data);
+        std::string error;
+        if (!self->source_->open(0, error)) {
+            archive_set_error(handle, EIO, "%s", error.c_str());
+            return ARCHIVE_FATAL;
+        }
+        self->position_ = 0;
+        return ARCHIVE_OK;
+    }
+    static la_ssize_t readSource(archive* handle, void* data, const void** buffer) {
+        ArchiveReader* self = static_cast<ArchiveReader*>(data);
+        std::string error;
+        long long bytes = self->source_->read(self->buffer_.data(), self->buffer_.size(), error);
+        if (bytes < 0) {
+            archive_set_error(handle, EIO, "%s", error.c_str());
+            return -1;
+        }
+        self->position_ += static_cast<std::uint64_t>(bytes);
+        *buffer = self->buffer_.data();
+        return static_cast<la_ssize_t>(bytes);
+    }
+    static la_int64_t seekSource(archive* handle, void* data, la_int64_t offset, int whence) {
+        ArchiveReader* self = static_cast<ArchiveReader*>(data);
+        la_int64_t base = whence == SEEK_END ? static_cast<la_int64_t>(self->size_)
+                          : whence == SEEK_CUR ? static_cast<la_int64_t>(self->position_)
+                                               : 0;
+        la_int64_t target = std::min(std::max<la_int64_t>(base + offset, 0), static_cast<la_int64_t>(self->size_));
+        if (static_cast<std::uint64_t>(target) == self->position_) {
+            return target;
+        }
+        std::string error;
+        if (!self->source_->open(static_cast<std::uint64_t>(target), error)) {
+            archive_set_error(handle, EIO, "%s", error.c_str());
+            return ARCHIVE_FATAL;
+        }
+        self->position_ = static_cast<std::uint64_t>(target);
+        return target;
+    }
+
+    archive* handle_ = nullptr;
+    ByteSource* source_ = nullptr;
+    std::uint64_t size_ = 0;
+    std::uint64_t position_ = 0;
+    std::vector<char> buffer_;
+};
+
+std::string entryName(archive_entry* entry) {
+    const char* name = archive_entry_pathname_utf8(entry);
+    if (!name) {
+        name = archive_entry_pathname(entry);
+    }
+    return name ? name : "";
+}
+
+std::string entryLink(const char* utf8, const char* native) {
+    return utf8 ? utf8 : (native ? native : "");
+}
+
+// Runs on its own thread: walks the archive and queues everything the writer needs.
+void readBlocks(ArchiveReader& reader, const std::unordered_set<std::string>* names, BlockQueue& queue,
+                ExtractProgress& progress, std::string& error) {
+    archive_entry* entry = nullptr;
+    while (!progress.cancel) {
+        int result = reader.next(entry);
+        progress.sourceDone = reader.bytesRead();
+        if (result == ARCHIVE_EOF) {
+            break;
+        }
+        if (result != ARCHIVE_OK) {
+            error = reader.lastError();
+            break;
+        }
+        std::string name = entryName(entry);
+        Block block;
+        // Unselected and unsafe entries are skipped; libarchive drops their data on the next header.
+        if ((names && names->count(name) == 0) || !safeRelativePath(name, block.relPath) || block.relPath.empty()) {
+            continue;
+        }
+        block.mode = static_cast<std::uint32_t>(archive_entry_perm(entry));
+        block.modified = static_cast<std::int64_t>(archive_entry_mtime(entry));
+        const char* hardLink = archive_entry_hardlink(entry);
+        unsigned type = static_cast<unsigned>(archive_entry_filetype(entry));
+        if (hardLink) {
+            block.kind = Block::Kind::HardLink;
+            if (!safeRelativePath(entryLink(archive_entry_hardlink_utf8(entry), hardLink), block.link) ||
+                block.link.empty()) {
+                continue;
+            }
+        } else if (type == AE_IFDIR) {
+            block.kind = Block::Kind::Dir;
+        } else if (type == AE_IFLNK) {
+            block.kind = Block::Kind::Symlink;
+            block.link = entryLink(archive_entry_symlink_utf8(entry), archive_entry_symlink(entry));
+        } else if (type == AE_IFREG) {
+            block.kind = Block::Kind::File;
+            block.size = archive_entry_size_is_set(entry) ? static_cast<std::uint64_t>(archive_entry_size(entry)) : 0;
+        } else {
+            continue;
+        }
+        bool isFile = block.kind == Block::Kind::File;
+        if (!queue.push(std::move(block))) {
+            break;
+        }
+        if (!isFile) {
+            continue;
+        }
+        bool failed = false;
+        while (!progress.cancel) {
+            const void* data = nullptr;
+            size_t size = 0;
+            la_int64_t offset = 0;
+            result = archive_read_data_block(reader.handle(), &data, &size, &offset);
+            if (result == ARCHIVE_EOF) {
+                break;
+            }
+            if (result != ARCHIVE_OK && result != ARCHIVE_WARN) {
+                error = reader.lastError();
+                failed = true;
+                break;
+            }
+            progress.sourceDone = reader.bytesRead();
+            Block chunk;
+            chunk.offset = static_cast<std::uint64_t>(offset);
+            chunk.data.assign(static_cast<const char*>(data), static_cast<const char*>(data) + size);
+            if (!queue.push(std::move(chunk))) {
+                failed = true;
+                break;
+            }
+        }
+        if (failed || progress.cancel) {
+            break;
+        }
+        Block end;
+        end.kind = Block::Kind::End;
+        if (!queue.push(std::move(end))) {
+            break;
+        }
+    }
+    queue.finish();
+}
+
+void setActivity(ExtractProgress& progress, const Block* file, std::uint64_t done) {
+    std::lock_guard<std::mutex> lock(progress.mutex);
+    ExtractActivity& activity = progress.active[0];
+    if (!file) {
+        activity = {};
+        return;
+    }
+    activity.name = file->relPath;
+    activity.size = file->size;
+    activity.done = done;
+}
+
+bool ensureParent(const fs::path& destDir, const std::string& relPath, std::string& lastParent, std::string& error,
+                  CreatedPaths* created) {
+    std::size_t slash = relPath.rfind('/');
+    std::string parent = slash == std::string::npos ? std::string() : relPath.substr(0, slash);
+    if (parent == lastParent) {
+        return true;
+    }
+    if (!makeExtractDirs(destDir, parent, error, created)) {
+        return false;
+    }
+    lastParent = parent;
+    return true;
+}
+
+bool writeLink(const fs::path& destDir, const Block& link, std::string& error, CreatedPaths* created) {
+    fs::path target = destDir / fs::u8path(link.relPath);
+    std::string lastParent;
+    if (!ensureParent(destDir, link.relPath, lastParent, error, created)) {
+        return false;
+    }
+    if (link.kind == Block::Kind::Symlink) {
+        return writeSymlink(destDir, link.relPath, link.link, error, created);
+    }
+    // The earlier entry may be, or sit behind, a symlink. That is followed, and only a
+    // regular file still inside destDir is taken; linking the symlink itself would carry
+    // its relative target to another folder.
+    std::error_code ec;
+    fs::path source = fs::canonical(destDir / fs::u8path(link.link), ec);
+    if (ec || !resolvesInside(destDir, source) || !fs::is_regular_file(fs::symlink_status(source, ec))) {
+        error = "Failed to link " + target.filename().string() + ": " + link.link + " is not an extracted file";
+        return false;
+    }
+    bool existed = fs::exists(fs::symlink_status(target, ec));
+    fs::remove(target, ec);
+    fs::create_hard_link(source, target, ec);
+    if (ec) {
+        ec.clear();
+        fs::copy_file(source, target, fs::copy_options::overwrite_existing, ec);
+    }
+    if (ec) {
+        error = "Failed to link " + target.filename().string();
+        return false;
+    }
+    if (created && !existed) {
+        created->add(target);
+    }
+    return true;
+}
+
+// Decompresses on one thread and writes on the calling one; see extractStreamArchive.
+bool extractFrom(ArchiveReader& reader, const fs::path& destDir, const std::unordered_set<std::string>* names,
+                 ExtractProgress& progress, std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        progress.active.assign(1, {});
+    }
+
+    BlockQueue queue;
+    std::string readError;
+    std::thread decompressor(readBlocks, std::ref(reader), names, std::ref(queue), std::ref(progress),
+                             std::ref(readError));
+
+    std::string writeError;
+    std::vector<Block> links;
+    std::vector<Block> dirs;
+    OutputFile output;
+    Block file;
+    fs::path target;
+    std::string lastParent;
+    Block block;
+    bool failed = false;
+    while (!failed && queue.pop(block)) {
+        if (progress.cancel) {
+            break;
+        }
+        switch (block.kind) {
+        case Block::Kind::Dir: {
+            failed = !makeExtractDirs(destDir, block.relPath, writeError, progress.created);
+            dirs.push_back(std::move(block));
+            break;
+        }
+        case Block::Kind::File:
+            file = std::move(block);
+            target = destDir / fs::u8path(file.relPath);
+            failed = !ensureParent(destDir, file.relPath, lastParent, writeError, progress.created) ||
+                     !output.open(target, file.size, writeError, progress.created);
+            setActivity(progress, &file, 0);
+            break;
+        case Block::Kind::Data:
+            if (!output.write(block.data.data(), block.data.size(), block.offset, writeError)) {
+                failed = true;
+                break;
+            }
+            progress.bytesDone += block.data.size();
+            setActivity(progress, &file, block.offset + block.data.size());
+            break;
+        case Block::Kind::End:
+            setActivity(progress, nullptr, 0);
+            if (!output.close(writeError)) {
+                failed = true;
+                break;
+            }
+            applyFileMetadata(target, file.mode, file.modified);
+            ++progress.filesDone;
+            break;
+        case Block::Kind::Symlink:
+        case Block::Kind::HardLink:
+            links.push_back(std::move(block));
+            break;
+        }
+    }
+    queue.stop();
+    decompressor.join();
+    setActivity(progress, nullptr, 0);
+
+    if (failed) {
+        error = writeError;
+        return false;
+    }
+    if (progress.cancel) {
+        error = "Cancelled";
+        return false;
+    }
+    if (!readError.empty()) {
+        error = readError;
+        return false;
+    }
+    for (const Block& link : links) {
+        if (!writeLink(destDir, link, error, progress.created)) {
+            return false;
+        }
+        ++progress.filesDone;
+    }
+    // Writing into a folder changes its time, so folders are stamped last.
+    for (const Block& dir : dirs) {
+        applyFileMetadata(destDir / fs::u8path(dir.relPath), dir.mode, dir.modified);
+    }
+    return true;
+}
+
+// Holes in sparse files come as gaps between data blocks; a sink only takes a plain
+// stream, so they are sent as zeros.
+bool sendZeros(ExtractSink& sink, std::uint64_t count, std::string& error) {
+    static const std::vector<char> zeros(kZeroBlock);
+    while (count > 0) {
+        std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(count, zeros.size()));
+        if (!sink.write(zeros.data(), chunk, error)) {
+            return false;
+        }
+        count -= chunk;
+    }
+    return true;
+}
+
+// extractFrom for a sink: same decompressor thread, but links are dropped and nothing
+// is stamped, since the sink has no use for either.
+bool sendTo(ArchiveReader& reader, ExtractSink& sink, ExtractProgress& progress, std::string& error) {
+    BlockQueue queue;
+    std::string readError;
+    std::thread decompressor(readBlocks, std::ref(reader), nullptr, std::ref(queue), std::ref(progress),
+                             std::ref(readError));
+
+    std::string writeError;
+    std::uint64_t size = 0;
+    std::uint64_t written = 0;
+    Block block;
+    bool failed = false;
+    while (!failed && queue.pop(block)) {
+        if (progress.cancel) {
+            break;
+        }
+        switch (block.kind) {
+        case Block::Kind::Dir:
+            failed = !sink.makeDir(block.relPath, writeError);
+            break;
+        case Block::Kind::File:
+            size = block.size;
+            written = 0;
+            failed = !sink.openFile(block.relPath, block.size, writeError);
+            break;
+        case Block::Kind::Data:
+            failed = (block.offset > written && !sendZeros(sink, block.offset - written, writeError)) ||
+                     !sink.write(block.data.data(), block.data.size(), writeError);
+            written = std::max(written, block.offset + block.data.size());
+            break;
+        case Block::Kind::End:
+            failed = (size > written && !sendZeros(sink, size - written, writeError)) || !sink.closeFile(writeError);
+            break;
+        case Block::Kind::Symlink:
+        case Block::Kind::HardLink:
+            break;
+        }
+    }
+    queue.stop();
+    decompressor.join();
+
+    if (failed) {
+        error = writeError;
+        return false;
+    }
+    if (progress.cancel) {
+        error = "Cancelled";
+        return false;
+    }
+    if (!readError.empty()) {
+        error = readError;
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+bool isStreamArchiveName(const std::string& fileName) {
+    static const char* const kSuffixes[] = {".tar",  ".tar.gz", ".tgz",     ".tar.bz2", ".tbz2", ".tbz",
+                                            ".tar.xz", ".txz",  ".tar.zst", ".tzst",    ".7z"};
+    std::string lower = fileName;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    for (const char* suffix : kSuffixes) {
+        std::string tail = suffix;
+        if (lower.size() > tail.size() && lower.compare(lower.size() - tail.size(), tail.size(), tail) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<fs::path> archiveVolumes(const fs::path& path) {
+    std::string name = path.filename().u8string();
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    fs::path dir = path.parent_path();
+    std::vector<fs::path> volumes;
+    if (lower.size() <= 4 || lower.compare(lower.size() - 4, 4, ".rar") != 0) {
+        volumes.push_back(path);
+        return volumes;
+    }
+    std::error_code ec;
+    // name.part01.rar, name.part02.rar, ...; the number keeps its zero padding.
+    std::size_t part = lower.rfind(".part");
+    if (part != std::string::npos) {
+        std::string digits = name.substr(part + 5, name.size() - 4 - (part + 5));
+        if (!digits.empty() && std::all_of(digits.begin(), digits.end(),
+                                           [](unsigned char ch) { return std::isdigit(ch) != 0; })) {
+            for (int number = 1;; ++number) {
+                std::string text = std::to_string(number);
+                if (text.size() < digits.size()) {
+                    text.insert(0, digits.size() - text.size(), '0');
+                }
+                fs::path volume = dir / fs::u8path(name.substr(0, part + 5) + text + name.substr(name.size() - 4));
+                if (!fs::is_regular_file(volume, ec)) {
+                    break;
+                }
+                volumes.push_back(volume);
+            }
+            if (!volumes.empty()) {
+                return volumes;
+            }
+        }
+    }
+    volumes.push_back(path);
+    std::string stem = name.substr(0, name.size() - 4);
+    for (int number = 0; number < 100; ++number) {
+        std::string suffix = std::to_string(number);
+        fs::path volume = dir / fs::u8path(stem + (number < 10 ? ".r0" : ".r") + suffix);
+        if (!fs::is_regular_file(volume, ec)) {
+            break;
+        }
+        volumes.push_back(volume);
+    }
+    return volumes;
+}
+
+bool listStreamArchive(const fs::path& path, std::vector<StreamArchiveEntry>& entries, std::string& error,
+                       const std::atomic<bool>* cancel) {
+    entries.clear();
+    ArchiveReader reader;
+    if (!reader.open(path, error)) {
+        return false;
+    }
+    archive_entry* entry = nullptr;
+    while (true) {
+        if (cancel && *cancel) {
+            error = "Cancelled";
+            return false;
+        }
+        int result = reader.next(entry);
+        if (result == ARCHIVE_EOF) {
+            return true;
+        }
+        if (result != ARCHIVE_OK) {
+            error = reader.lastError();
+            return false;
+        }
+        StreamArchiveEntry item;
+        item.name = entryName(entry);
+        item.isDir = archive_entry_filetype(entry) == AE_IFDIR;
+        if (!item.isDir && archive_entry_size_is_set(entry)) {
+            item.size = static_cast<std::uint64_t>(archive_entry_size(entry));
+        }
+        entries.push_back(item);
+    }
+}
+
+bool extractStreamArchive(const fs::path& path, const fs::path& destDir, const std::unordered_set<std::string>* names,
+                          ExtractProgress& progress, std::string& error) {
+    ArchiveReader reader;
+    return reader.open(path, error) && extractFrom(reader, destDir, names, progress, error);
+}
+
+bool extractStreamArchive(ByteSource& source, std::uint64_t size, const fs::path& destDir, ExtractProgress& progress,
+                          std::string& error) {
+    PrefetchSource prefetch(source, kPrefetchBytes);
+    ArchiveReader reader;
+    return reader.open(prefetch, size, error) && extractFrom(reader, destDir, nullptr, progress, error);
+}
+
+bool extractStreamArchive(const fs::path& path, ExtractSink& sink, ExtractProgress& progress, std::string& error) {
+    ArchiveReader reader;
+    return reader.open(path, error) && sendTo(reader, sink, progress, error);
+}
+
+bool testStreamArchive(const fs::path& path, ExtractProgress& progress, std::vector<std::string>& corrupt,
+                       std::string& error) {
+    ArchiveReader reader;
+    if (!reader.open(path, error)) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        progress.active.assign(1, {});
+    }
+    Block file;
+    archive_entry* entry = nullptr;
+    while (!progress.cancel) {
+        int result = reader.next(entry);
+        progress.sourceDone = reader.bytesRead();
+        if (result == ARCHIVE_EOF) {
+            return true;
+        }
+        if (result != ARCHIVE_OK) {
+            error = reader.lastError();
+            return false;
+        }
+        if (archive_entry_filetype(entry) != AE_IFREG || archive_entry_hardlink(entry)) {
+            continue;
+        }
+        file.relPath = entryName(entry);
+        file.size = archive_entry_size_is_set(entry) ? static_cast<std::uint64_t>(archive_entry_size(entry)) : 0;
+        setActivity(progress, &file, 0);
+        // The format's own checks (7z and RAR CRCs, the compressor's frame checksums)
+        // run as the data is read; a bad one ends the entry with a warning or an error.
+        std::uint64_t done = 0;
+        while (!progress.cancel) {
+            const void* data = nullptr;
+            size_t size = 0;
+            la_int64_t offset = 0;
+            result = archive_read_data_block(reader.handle(), &data, &size, &offset);
+            if (result == ARCHIVE_EOF) {
+                break;
+            }
+            if (result != ARCHIVE_OK) {
+                corrupt.push_back(file.relPath);
+                // Warnings leave the archive readable; anything worse ends the test here.
+                if (result != ARCHIVE_WARN) {
+                    error = reader.lastError();
+                    setActivity(progress, nullptr, 0);
+                    return false;
+                }
+                break;
+            }
+            done += size;
+            progress.bytesDone += size;
+            progress.sourceDone = reader.bytesRead();
+            setActivity(progress, &file, done);
+        }
+        setActivity(progress, nullptr, 0);
+        ++progress.filesDone;
+    }
+    error = "Cancelled";
+    return false;
+}
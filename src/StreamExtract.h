@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "ByteSource.h"
+#include "ExtractOutput.h"
+
+struct StreamArchiveEntry {
+    // Path inside the archive exactly as stored.
+    std::string name;
+    std::uint64_t size = 0;
+    bool isDir = false;
+};
+
+// True for the tar (plain, gzip, bzip2, xz, zstd) and 7z names read through
+// libarchive. RAR is read the same way but keeps its own kind in the UI.
+bool isStreamArchiveName(const std::string& fileName);
+
+// The files of a multi-volume RAR set in order, starting from the first volume, for
+// either name.partN.rar or name.rar + name.r00, name.r01, ... naming. Any other path
+// comes back alone.
+std::vector<std::filesystem::path> archiveVolumes(const std::filesystem::path& path);
+
+// Lists the entries in archive order, reading every volume of a RAR set. Compressed
+// tarballs carry no index, so this decompresses the whole stream. Setting cancel stops
+// it at the next entry.
+bool listStreamArchive(const std::filesystem::path& path, std::vector<StreamArchiveEntry>& entries,
+                       std::string& error, const std::atomic<bool>* cancel = nullptr);
+
+// Extracts the archive below destDir, overwriting existing files. When names is given,
+// only entries listed there (by their stored names) are written. One thread
+// decompresses while the calling thread writes, with a bounded amount of data queued
+// between them; cancelling stops both within one block. The archive can only be read
+// front to back, so progress.sourceDone (archive bytes read, across all volumes) is
+// the measure to show against the archive's size.
+bool extractStreamArchive(const std::filesystem::path& path, const std::filesystem::path& destDir,
+                          const std::unordered_set<std::string>* names, ExtractProgress& progress,
+                          std::string& error);
+
+// Same, reading an archive of size bytes that is not on local disk. The transfer runs
+// ahead of the decompressor on a thread of its own; formats that need to jump around
+// (7z keeps its index at the end) reopen the source at the offset they ask for.
+bool extractStreamArchive(ByteSource& source, std::uint64_t size, const std::filesystem::path& destDir,
+                          ExtractProgress& progress, std::string& error);
+
+// Same, handing every file to sink in archive order instead of writing below a folder.
+// Links are left out. progress.bytesDone and filesDone are left to the sink.
+bool extractStreamArchive(const std::filesystem::path& path, ExtractSink& sink, ExtractProgress& progress,
+                          std::string& error);
+
+// Reads every file in the archive without writing anything, so the format's checksums
+// are verified. Entries that fail are listed in corrupt. Damage that leaves the rest of
+// the archive unreadable also makes this return false, with error set.
+bool testStreamArchive(const std::filesystem::path& path, ExtractProgress& progress,
+                       std::vector<std::string>& corrupt, std::string& error);
@@ -0,0 +1,325 @@
+#include "TreeCopy.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include "Checksum.h"
+#include "MappedFile.h"
+#include "WorkerPool.h"
+
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr unsigned kMaxWorkers = 4;
+constexpr std::size_t kCopyChunk = 8 * 1024 * 1024;
+constexpr std::size_t kHashChunk = 64 * 1024 * 1024;
+
+struct CopyItem {
+    fs::path from;
+    fs::path to;
+    std::string relPath;
+    std::uint64_t size = 0;
+};
+
+bool sameFileTime(const fs::path& a, const fs::path& b) {
+    std::error_code ec;
+    fs::file_time_type left = fs::last_write_time(a, ec);
+    if (ec) {
+        return false;
+    }
+    fs::file_time_type right = fs::last_write_time(b, ec);
+    return !ec && left == right;
+}
+
+// Copied by an earlier run: only verified files carry the source's time.
+bool alreadyCopied(const CopyItem& item) {
+    std::error_code ec;
+    if (!fs::is_regular_file(fs::symlink_status(item.to, ec))) {
+        return false;
+    }
+    std::uintmax_t size = fs::file_size(item.to, ec);
+    return !ec && size == item.size && sameFileTime(item.from, item.to);
+}
+
+class Copier {
+public:
+    Copier(ExtractProgress& progress, std::size_t slot) : progress_(progress), slot_(slot) {}
+
+    bool copy(const CopyItem& item, std::string& error) {
+        setActivity(&item, 0);
+        std::uint32_t crc = 0;
+        bool ok = copyData(item, crc, error) && verify(item, crc, error);
+        setActivity(nullptr, 0);
+        std::error_code ec;
+        if (!ok) {
+            fs::remove(item.to, ec);
+            return false;
+        }
+        fs::permissions(item.to, fs::status(item.from, ec).permissions(), fs::perm_options::replace, ec);
+        fs::last_write_time(item.to, fs::last_write_time(item.from, ec), ec);
+        return true;
+    }
+
+private:
+    // The data passes through a buffer so its CRC is taken on the way; the source is
+    // read once.
+    bool copyData(const CopyItem& item, std::uint32_t& crc, std::string& error) {
+        Crc32 digest;
+        std::vector<char> buffer(kCopyChunk);
+        std::uint64_t done = 0;
+        auto advance = [&](std::size_t bytes) {
+            digest.update(buffer.data(), bytes);
+            done += bytes;
+            progress_.bytesDone += bytes;
+            setActivity(&item, done);
+        };
+#ifdef __linux__
+        int source = ::open(item.from.c_str(), O_RDONLY | O_CLOEXEC);
+        if (source < 0) {
+            error = "Failed to open " + item.relPath;
+            return false;
+        }
+        int target = ::open(item.to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (target < 0) {
+            ::close(source);
+            error = "Failed to create " + item.relPath;
+            return false;
+        }
+        bool ok = true;
+        if (item.size > 0 && posix_fallocate(target, 0, static_cast<off_t>(item.size)) == ENOSPC) {
+            error = "Not enough space for " + item.relPath;
+            ok = false;
+        }
+        while (ok && done < item.size) {
+            if (progress_.cancel) {
+                error = "Cancelled";
+                ok = false;
+                break;
+            }
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(item.size - done, kCopyChunk));
+            ssize_t moved = ::read(source, buffer.data(), chunk);
+            for (ssize_t written = 0; moved > 0 && written < moved;) {
+                ssize_t bytes = ::write(target, buffer.data() + written, static_cast<std::size_t>(moved - written));
+                if (bytes < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (bytes <= 0) {
+                    moved = -1;
+                    break;
+                }
+                written += bytes;
+            }
+            if (moved < 0 && errno == EINTR) {
+                continue;
+            }
+            if (moved <= 0) {
+                // Zero means the source shrank while it was being copied.
+                error = "Failed to copy " + item.relPath;
+                ok = false;
+                break;
+            }
+            advance(static_cast<std::size_t>(moved));
+        }
+        ::close(source);
+        // On disk before the source can go, and out of the page cache so that verify()
+        // reads back what the disk holds rather than what was just written.
+        if (ok && ::fdatasync(target) != 0) {
+            error = "Failed to write " + item.relPath;
+            ok = false;
+        }
+        if (ok) {
+            posix_fadvise(target, 0, 0, POSIX_FADV_DONTNEED);
+        }
+        if (::close(target) != 0 && ok) {
+            error = "Failed to write " + item.relPath;
+            ok = false;
+        }
+        crc = digest.value();
+        return ok;
+#else
+        std::ifstream source(item.from, std::ios::binary);
+        std::ofstream target(item.to, std::ios::binary | std::ios::trunc);
+        if (!source || !target) {
+            error = "Failed to copy " + item.relPath;
+            return false;
+        }
+        while (done < item.size) {
+            if (progress_.cancel) {
+                error = "Cancelled";
+                return false;
+            }
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(item.size - done, kCopyChunk));
+            if (!source.read(buffer.data(), static_cast<std::streamsize>(chunk)) ||
+                !target.write(buffer.data(), static_cast<std::streamsize>(chunk))) {
+                error = "Failed to copy " + item.relPath;
+                return false;
+            }
+            advance(chunk);
+        }
+        target.close();
+        if (!target) {
+            error = "Failed to write " + item.relPath;
+            return false;
+        }
+        crc = digest.value();
+        return true;
+#endif
+    }
+
+    bool verify(const CopyItem& item, std::uint32_t expected, std::string& error) {
+        Crc32 digest;
+        if (item.size > 0) {
+            MappedFile file;
+            if (!file.open(item.to, error) || file.size() != item.size) {
+                error = "Failed to read back " + item.relPath;
+                return false;
+            }
+            for (std::uint64_t offset = 0; offset < item.size; offset += kHashChunk) {
+                if (progress_.cancel) {
+                    error = "Cancelled";
+                    return false;
+                }
+                std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(item.size - offset, kHashChunk));
+                digest.update(file.data() + offset, chunk);
+            }
+        }
+        if (digest.value() != expected) {
+            error = "Copy does not match: " + item.relPath;
+            return false;
+        }
+        return true;
+    }
+
+    void setActivity(const CopyItem* item, std::uint64_t done) {
+        std::lock_guard<std::mutex> lock(progress_.mutex);
+        progress_.active[slot_] = item ? ExtractActivity {item->relPath, item->size, done} : ExtractActivity {};
+    }
+
+    ExtractProgress& progress_;
+    std::size_t slot_;
+};
+} // namespace
+
+bool copyTree(const fs::path& from, const fs::path& to, unsigned threads, ExtractProgress& progress,
+              std::string& error) {
+    std::error_code ec;
+    if (!fs::is_directory(fs::symlink_status(from, ec))) {
+        error = "Not a folder: " + from.string();
+        return false;
+    }
+    std::vector<CopyItem> files;
+    std::vector<CopyItem> links;
+    std::vector<fs::path> dirs {to};
+    for (fs::recursive_directory_iterator it(from, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        CopyItem item;
+        item.from = it->path();
+        item.relPath = it->path().lexically_relative(from).generic_string();
+        item.to = to / it->path().lexically_relative(from);
+        std::error_code statError;
+        fs::file_status status = it->symlink_status(statError);
+        if (fs::is_symlink(status)) {
+            links.push_back(item);
+        } else if (fs::is_directory(status)) {
+            dirs.push_back(item.to);
+        } else if (fs::is_regular_file(status)) {
+            item.size = it->file_size(statError);
+            files.push_back(item);
+        }
+    }
+    if (ec) {
+        error = "Failed to list " + from.string();
+        return false;
+    }
+    for (const fs::path& dir : dirs) {
+        if (!fs::create_directories(dir, ec) && !fs::is_directory(dir, ec)) {
+            error = "Failed to create " + dir.string();
+            return false;
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const CopyItem& a, const CopyItem& b) { return a.size > b.size; });
+
+    threads = workerCount(threads, kMaxWorkers, files.size());
+    std::atomic<bool> failed {false};
+    std::mutex errorMutex;
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        progress.active.assign(threads, {});
+    }
+    std::vector<Copier> copiers;
+    for (std::size_t slot = 0; slot < threads; ++slot) {
+        copiers.emplace_back(progress, slot);
+    }
+    runParallel(files.size(), threads, [&](std::size_t slot, std::size_t index) {
+        if (progress.cancel) {
+            return false;
+        }
+        const CopyItem& item = files[index];
+        if (alreadyCopied(item)) {
+            progress.bytesDone += item.size;
+            progress.bytesSkipped += item.size;
+            ++progress.filesSkipped;
+            ++progress.filesDone;
+            return true;
+        }
+        std::string itemError;
+        if (!copiers[slot].copy(item, itemError)) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!failed.exchange(true)) {
+                error = itemError;
+            }
+            return false;
+        }
+        ++progress.filesDone;
+        return true;
+    });
+    if (!failed && progress.cancel) {
+        error = "Cancelled";
+        return false;
+    }
+    if (failed) {
+        return false;
+    }
+
+    for (const CopyItem& link : links) {
+        fs::path value = fs::read_symlink(link.from, ec);
+        if (ec) {
+            error = "Failed to read link " + link.relPath;
+            return false;
+        }
+        fs::remove(link.to, ec);
+        fs::create_symlink(value, link.to, ec);
+        if (ec) {
+            error = "Failed to create link " + link.relPath;
+            return false;
+        }
+        ++progress.filesDone;
+    }
+    if (!flushFilesystem(to)) {
+        error = "Failed to flush " + to.string();
+        return false;
+    }
+    return true;
+}
+
+bool flushFilesystem(const fs::path& path) {
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::syncfs(fd) == 0;
+    ::close(fd);
+    return ok;
+#else
+    (void)path;
+    return true;
+#endif
+}
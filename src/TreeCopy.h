@@ -0,0 +1,22 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include "ExtractOutput.h"
+
+// Copies the folder tree at from into to (created as needed) on up to `threads` workers
+// (0 picks one per core), largest files first. The source's CRC-32 is taken as its data
+// is copied; on Linux each target is then flushed to disk and dropped from the page
+// cache, so reading it back for the comparison reads the disk (elsewhere the read-back
+// may come from the cache). Only then does the target get the source's permissions and
+// modification time, so a file at the target with the source's size and time is known
+// to be complete: those are skipped, which lets a run that was cancelled or cut off pick
+// up where it stopped (counted in filesSkipped and bytesSkipped). Symlinks are
+// recreated, never followed. A successful copy ends with flushFilesystem(to), so the
+// source may be removed afterwards. progress.bytesDone counts bytes copied or skipped.
+bool copyTree(const std::filesystem::path& from, const std::filesystem::path& to, unsigned threads,
+              ExtractProgress& progress, std::string& error);
+// Writes everything pending on the filesystem holding path to disk (syncfs on Linux;
+// elsewhere a no-op that succeeds).
+bool flushFilesystem(const std::filesystem::path& path);
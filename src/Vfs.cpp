@@ -0,0 +1,685 @@
+#include "Vfs.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "ZipArchive.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+std::string toLower(const std::string& text) {
+    std::string out = text;
+    std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return out;
+}
+
+// Listings are dropped after kListingTtl even when nothing invalidated them.
+struct ListingCache {
+    struct Listing {
+        std::vector<Entry> entries;
+        std::chrono::steady_clock::time_point fetched;
+        // Crawled by a search and not browsed into since.
+        bool seeded = false;
+    };
+    std::mutex mutex;
+    std::unordered_map<std::string, Listing> listings;
+};
+
+ListingCache& listingCache() {
+    static ListingCache cache;
+    return cache;
+}
+
+const std::chrono::seconds kListingTtl(300);
+
+class LocalReadStream : public VfsReadStream {
+public:
+    explicit LocalReadStream(const fs::path& path) : input_(path, std::ios::binary) {}
+    bool open(std::uint64_t offset, std::string& error) {
+        if (!input_.is_open()) {
+            error = "Failed to open source file";
+            return false;
+        }
+        if (offset > 0 && !input_.seekg(static_cast<std::streamoff>(offset))) {
+            error = "Failed to seek source file";
+            return false;
+        }
+        return true;
+    }
+    long long read(char* buffer, size_t size, std::string& error) override {
+        input_.read(buffer, static_cast<std::streamsize>(size));
+        std::streamsize bytes = input_.gcount();
+        if (bytes <= 0 && input_.bad()) {
+            error = "Failed to read source file";
+            return -1;
+        }
+        return static_cast<long long>(bytes);
+    }
+
+private:
+    std::ifstream input_;
+};
+
+class LocalWriteStream : public VfsWriteStream {
+public:
+    explicit LocalWriteStream(const fs::path& path) : path_(path), output_(path, std::ios::binary) {}
+    ~LocalWriteStream() override {
+        if (!committed_) {
+            output_.close();
+            std::error_code ec;
+            fs::remove(path_, ec);
+        }
+    }
+    bool isOpen() const {
+        return output_.is_open();
+    }
+    bool write(const char* data, size_t size, std::string& error) override {
+        output_.write(data, static_cast<std::streamsize>(size));
+        if (!output_) {
+            error = "Failed to write target file";
+            return false;
+        }
+        return true;
+    }
+    bool close(std::string& error) override {
+        output_.close();
+        if (output_.fail()) {
+            error = "Failed to write target file";
+            return false;
+        }
+        committed_ = true;
+        return true;
+    }
+
+private:
+    fs::path path_;
+    std::ofstream output_;
+    bool committed_ = false;
+};
+
+class LocalVfs : public VfsBackend {
+public:
+    VfsCapabilities capabilities() const override {
+        VfsCapabilities caps;
+        caps.serverSideRename = true;
+        caps.rangeReads = true;
+        caps.localFiles = true;
+#if defined(__linux__) && defined(FICLONE)
+        caps.reflink = true;
+#endif
+        return caps;
+    }
+    std::string key() const override {
+        return "local";
+    }
+    std::string join(const std::string& dir, const std::string& name) const override {
+        return (fs::path(dir) / name).string();
+    }
+    std::string parent(const std::string& path) const override {
+        fs::path current(path);
+        return current.has_relative_path() ? current.parent_path().string() : path;
+    }
+    std::string baseName(const std::string& path) const override {
+        return fs::path(path).filename().string();
+    }
+    bool stat(const std::string& path, Entry& entry, std::string& error) override {
+        error.clear();
+        std::error_code ec;
+        fs::file_status status = fs::status(path, ec);
+        if (!fs::exists(status)) {
+            return false;
+        }
+        entry = {baseName(path), fs::path(path), fs::is_directory(status), false};
+        if (!entry.isDir) {
+            std::uintmax_t size = fs::file_size(entry.path, ec);
+            if (!ec) {
+                entry.sizeBytes = size;
+                entry.hasSize = true;
+            }
+        }
+        return true;
+    }
+    std::unique_ptr<VfsReadStream> openRead(const std::string& path, std::uint64_t offset, std::string& error) override {
+        auto stream = std::make_unique<LocalReadStream>(fs::path(path));
+        if (!stream->open(offset, error)) {
+            return nullptr;
+        }
+        return stream;
+    }
+#if defined(__linux__) && defined(FICLONE)
+    // Shares the source's extents with the new file on filesystems that support it
+    // (btrfs, XFS). Fails across filesystems, in which case the caller copies.
+    bool reflink(const std::string& fromPath, const std::string& toPath, std::string& error) override {
+        int source = ::open(fromPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (source < 0) {
+            error = "Failed to open source file";
+            return false;
+        }
+        struct stat info {};
+        mode_t permissions = (::fstat(source, &info) == 0) ? (info.st_mode & 0777) : 0644;
+        int target = ::open(toPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, permissions);
+        if (target < 0) {
+            ::close(source);
+            error = "Failed to open target file";
+            return false;
+        }
+        bool ok = ::ioctl(target, FICLONE, source) == 0;
+        ::close(source);
+        ::close(target);
+        if (!ok) {
+            ::unlink(toPath.c_str());
+            error = "Reflink not supported";
+        }
+        return ok;
+    }
+#endif
+
+protected:
+    bool doList(const std::string& path, std::vector<Entry>& entries, std::string& error) override {
+        std::error_code ec;
+        fs::directory_iterator it(path, ec);
+        if (ec) {
+            error = ec.message();
+            return false;
+        }
+        for (const auto& item : it) {
+            Entry entry;
+            entry.path = item.path();
+            entry.name = item.path().filename().string();
+            entry.isDir = item.is_directory(ec);
+            entry.isParent = false;
+            if (!entry.isDir) {
+                std::uintmax_t size = item.file_size(ec);
+                if (!ec) {
+                    entry.sizeBytes = size;
+                    entry.hasSize = true;
+                }
+            }
+            entries.push_back(entry);
+        }
+        return true;
+    }
+    std::unique_ptr<VfsWriteStream> doOpenWrite(const std::string& path, std::uint64_t sizeHint, std::string& error) override {
+        (void)sizeHint;
+        auto stream = std::make_unique<LocalWriteStream>(fs::path(path));
+        if (!stream->isOpen()) {
+            error = "Failed to open target file";
+            return nullptr;
+        }
+        return stream;
+    }
+    bool doRename(const std::string& fromPath, const std::string& toPath, std::string& error) override {
+        std::error_code ec;
+        fs::rename(fromPath, toPath, ec);
+        if (ec) {
+            error = ec.message();
+            return false;
+        }
+        return true;
+    }
+    bool doRemove(const std::string& path, bool isDir, std::string& error) override {
+        std::error_code ec;
+        if (isDir) {
+            fs::remove_all(path, ec);
+        } else {
+            fs::remove(path, ec);
+        }
+        if (ec) {
+            error = ec.message();
+            return false;
+        }
+        return true;
+    }
+    bool doMkdir(const std::string& path, std::string& error) override {
+        std::error_code ec;
+        if (!fs::create_directory(path, ec) || ec) {
+            error = ec ? ec.message() : "Failed to create folder";
+            return false;
+        }
+        return true;
+    }
+};
+
+constexpr std::uint64_t kZipSkipChunk = 256 * 1024;
+
+class ZipReadStream : public VfsReadStream {
+public:
+    ZipReadStream(std::shared_ptr<const ZipArchive> archive, const ZipEntry& entry) : archive_(std::move(archive)), entry_(entry) {}
+    bool open(std::uint64_t offset, std::string& error) {
+        if (!reader_.open(*archive_, entry_, error)) {
+            return false;
+        }
+        // Deflate cannot seek, so an offset is reached by decompressing up to it.
+        std::vector<char> discard(std::min<std::uint64_t>(offset, kZipSkipChunk));
+        while (offset > 0) {
+            long long bytes = reader_.read(discard.data(), static_cast<size_t>(std::min<std::uint64_t>(offset, discard.size())), error);
+            if (bytes <= 0) {
+                if (bytes == 0) {
+                    error = "Offset past end of entry";
+                }
+                return false;
+            }
+            offset -= static_cast<std::uint64_t>(bytes);
+        }
+        return true;
+    }
+    long long read(char* buffer, size_t size, std::string& error) override {
+        return reader_.read(buffer, size, error);
+    }
+
+private:
+    std::shared_ptr<const ZipArchive> archive_;
+    const ZipEntry& entry_;
+    ZipEntryReader reader_;
+};
+
+// Folders that only appear as a prefix of a file name are synthesized.
+class ZipVfs : public VfsBackend {
+public:
+    bool open(const fs::path& archivePath, std::string& error) {
+        auto archive = std::make_shared<ZipArchive>();
+        if (!archive->open(archivePath, error)) {
+            return false;
+        }
+        archivePath_ = archivePath;
+        archive_ = archive;
+        dirs_["/"];
+        const std::vector<ZipEntry>& entries = archive_->entries();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            addEntry(entries[i], i);
+        }
+        return true;
+    }
+
+    VfsCapabilities capabilities() const override {
+        return {};
+    }
+    std::string key() const override {
+        return "zip:" + archivePath_.string();
+    }
+    std::string join(const std::string& dir, const std::string& name) const override {
+        return (dir == "/") ? "/" + name : dir + "/" + name;
+    }
+    std::string parent(const std::string& path) const override {
+        size_t slash = path.find_last_of('/');
+        return (slash == std::string::npos || slash == 0) ? "/" : path.substr(0, slash);
+    }
+    std::string baseName(const std::string& path) const override {
+        return path.substr(path.find_last_of('/') + 1);
+    }
+    std::unique_ptr<VfsReadStream> openRead(const std::string& path, std::uint64_t offset, std::string& error) override {
+        auto file = files_.find(path);
+        if (file == files_.end()) {
+            error = "Entry not found in archive";
+            return nullptr;
+        }
+        auto stream = std::make_unique<ZipReadStream>(archive_, archive_->entries()[file->second]);
+        if (!stream->open(offset, error)) {
+            return nullptr;
+        }
+        return stream;
+    }
+
+protected:
+    bool doList(const std::string& path, std::vector<Entry>& entries, std::string& error) override {
+        auto dir = dirs_.find(path);
+        if (dir == dirs_.end()) {
+            error = "Folder not found in archive";
+            return false;
+        }
+        entries = dir->second;
+        return true;
+    }
+    std::unique_ptr<VfsWriteStream> doOpenWrite(const std::string&, std::uint64_t, std::string& error) override {
+        error = "Archives are read-only";
+        return nullptr;
+    }
+    bool doRename(const std::string&, const std::string&, std::string& error) override {
+        error = "Archives are read-only";
+        return false;
+    }
+    bool doRemove(const std::string&, bool, std::string& error) override {
+        error = "Archives are read-only";
+        return false;
+    }
+    bool doMkdir(const std::string&, std::string& error) override {
+        error = "Archives are read-only";
+        return false;
+    }
+
+private:
+    // Makes sure every folder on the way to dir is listed in its parent.
+    void ensureDir(const std::string& dir) {
+        if (dirs_.count(dir) > 0) {
+            return;
+        }
+        std::string up = parent(dir);
+        ensureDir(up);
+        dirs_[dir];
+        dirs_[up].push_back({baseName(dir), {}, true, false});
+    }
+    void addEntry(const ZipEntry& zipEntry, size_t index) {
+        std::string path;
+        std::istringstream parts(zipEntry.name);
+        std::string part;
+        while (std::getline(parts, part, '/')) {
+            if (part.empty() || part == ".") {
+                continue;
+            }
+            if (part == "..") {
+                // Never let an entry name escape the archive root.
+                return;
+            }
+            path += "/" + part;
+        }
+        if (path.empty()) {
+            return;
+        }
+        std::int64_t modified = zipEntry.modifiedTime();
+        if (zipEntry.isDir) {
+            ensureDir(path);
+            for (auto& sibling : dirs_[parent(path)]) {
+                if (sibling.isDir && sibling.name == baseName(path)) {
+                    sibling.modifiedTime = modified;
+                    sibling.hasModified = true;
+                }
+            }
+            return;
+        }
+        if (files_.count(path) > 0 || dirs_.count(path) > 0) {
+            return;
+        }
+        ensureDir(parent(path));
+        Entry entry {baseName(path), {}, false, false};
+        entry.sizeBytes = zipEntry.uncompressedSize;
+        entry.hasSize = true;
+        entry.modifiedTime = modified;
+        entry.hasModified = true;
+        dirs_[parent(path)].push_back(entry);
+        files_[path] = index;
+    }
+
+    fs::path archivePath_;
+    std::shared_ptr<const ZipArchive> archive_;
+    std::map<std::string, std::vector<Entry>> dirs_;
+    std::map<std::string, size_t> files_;
+};
+} // namespace
+
+void sortEntries(std::vector<Entry>& entries) {
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        if (a.isDir != b.isDir) {
+            return a.isDir > b.isDir;
+        }
+        return toLower(a.name) < toLower(b.name);
+    });
+}
+
+void filterHiddenEntries(std::vector<Entry>& entries) {
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) {
+                      return !entry.name.empty() && entry.name[0] == '.';
+                  }),
+                  entries.end());
+}
+
+void storeListing(const std::string& backendKey, const std::string& path, const std::vector<Entry>& entries,
+                  bool seeded) {
+    ListingCache& cache = listingCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    ListingCache::Listing& listing = cache.listings[backendKey + path];
+    listing.entries = entries;
+    listing.fetched = std::chrono::steady_clock::now();
+    listing.seeded = seeded;
+}
+
+bool lookupListing(const std::string& backendKey, const std::string& path, std::vector<Entry>& entries,
+                   bool browsing) {
+    ListingCache& cache = listingCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.listings.find(backendKey + path);
+    if (it == cache.listings.end()) {
+        return false;
+    }
+    if (std::chrono::steady_clock::now() - it->second.fetched > kListingTtl) {
+        cache.listings.erase(it);
+        return false;
+    }
+    if (browsing) {
+        if (!it->second.seeded) {
+            return false;
+        }
+        it->second.seeded = false;
+    }
+    entries = it->second.entries;
+    return true;
+}
+
+void invalidateListings(const std::string& backendKey, const std::string& path) {
+    ListingCache& cache = listingCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    std::string prefix = backendKey + path;
+    std::string childPrefix = (prefix.back() == '/') ? prefix : prefix + "/";
+    for (auto it = cache.listings.begin(); it != cache.listings.end();) {
+        if (it->first == prefix || it->first.compare(0, childPrefix.size(), childPrefix) == 0) {
+            it = cache.listings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool VfsBackend::stat(const std::string& path, Entry& entry, std::string& error) {
+    error.clear();
+    std::string dir = parent(path);
+    if (dir == path) {
+        entry = {baseName(path), {}, true, false};
+        return true;
+    }
+    std::vector<Entry> entries;
+    if (!list(dir, true, entries, error)) {
+        return false;
+    }
+    std::string name = baseName(path);
+    for (const auto& candidate : entries) {
+        if (candidate.name == name) {
+            entry = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VfsBackend::reflink(const std::string& fromPath, const std::string& toPath, std::string& error) {
+    (void)fromPath;
+    (void)toPath;
+    error = "Reflink not supported";
+    return false;
+}
+
+ChecksumKind VfsBackend::checksumKind() {
+    return ChecksumKind::None;
+}
+
+bool VfsBackend::checksum(const std::string& path, ChecksumKind kind, std::string& hex, std::string& error) {
+    (void)path;
+    (void)kind;
+    (void)hex;
+    error = "Checksums not supported";
+    return false;
+}
+
+bool VfsBackend::list(const std::string& path, bool includeHidden, std::vector<Entry>& entries, std::string& error,
+                      bool browsing) {
+    bool cacheable = capabilities().cacheListings;
+    std::vector<Entry> listed;
+    if (!cacheable || !lookupListing(key(), path, listed, browsing)) {
+        if (!doList(path, listed, error)) {
+            return false;
+        }
+        sortEntries(listed);
+        if (cacheable) {
+            storeListing(key(), path, listed);
+        }
+    }
+    if (!includeHidden) {
+        filterHiddenEntries(listed);
+    }
+    entries.insert(entries.end(), listed.begin(), listed.end());
+    return true;
+}
+
+std::unique_ptr<VfsWriteStream> VfsBackend::openWrite(const std::string& path, std::uint64_t sizeHint, std::string& error) {
+    invalidate(parent(path));
+    return doOpenWrite(path, sizeHint, error);
+}
+
+bool VfsBackend::rename(const std::string& fromPath, const std::string& toPath, std::string& error) {
+    bool ok = doRename(fromPath, toPath, error);
+    invalidate(parent(fromPath));
+    invalidate(parent(toPath));
+    return ok;
+}
+
+bool VfsBackend::remove(const std::string& path, bool isDir, std::string& error) {
+    bool ok = doRemove(path, isDir, error);
+    invalidate(parent(path));
+    return ok;
+}
+
+bool VfsBackend::mkdir(const std::string& path, std::string& error) {
+    bool ok = doMkdir(path, error);
+    invalidate(parent(path));
+    return ok;
+}
+
+void VfsBackend::invalidate(const std::string& path) {
+    if (capabilities().cacheListings) {
+        invalidateListings(key(), path);
+    }
+}
+
+std::future<VfsResult<std::vector<Entry>>> VfsBackend::listAsync(const std::string& path, bool includeHidden,
+                                                                 bool browsing) {
+    return runAsync([path, includeHidden, browsing](VfsBackend& vfs) {
+        VfsResult<std::vector<Entry>> result;
+        result.ok = vfs.list(path, includeHidden, result.value, result.error, browsing);
+        return result;
+    });
+}
+
+std::future<VfsResult<Entry>> VfsBackend::statAsync(const std::string& path) {
+    return runAsync([path](VfsBackend& vfs) {
+        VfsResult<Entry> result;
+        result.ok = vfs.stat(path, result.value, result.error);
+        return result;
+    });
+}
+
+std::future<VfsResult<std::unique_ptr<VfsReadStream>>> VfsBackend::openReadAsync(const std::string& path,
+                                                                                 std::uint64_t offset) {
+    return runAsync([path, offset](VfsBackend& vfs) {
+        VfsResult<std::unique_ptr<VfsReadStream>> result;
+        result.value = vfs.openRead(path, offset, result.error);
+        result.ok = result.value != nullptr;
+        return result;
+    });
+}
+
+std::future<VfsResult<std::unique_ptr<VfsWriteStream>>> VfsBackend::openWriteAsync(const std::string& path,
+                                                                                   std::uint64_t sizeHint) {
+    return runAsync([path, sizeHint](VfsBackend& vfs) {
+        VfsResult<std::unique_ptr<VfsWriteStream>> result;
+        result.value = vfs.openWrite(path, sizeHint, result.error);
+        result.ok = result.value != nullptr;
+        return result;
+    });
+}
+
+std::future<VfsResult<bool>> VfsBackend::renameAsync(const std::string& fromPath, const std::string& toPath) {
+    return runAsync([fromPath, toPath](VfsBackend& vfs) {
+        VfsResult<bool> result;
+        result.ok = result.value = vfs.rename(fromPath, toPath, result.error);
+        return result;
+    });
+}
+
+std::future<VfsResult<bool>> VfsBackend::removeAsync(const std::string& path, bool isDir) {
+    return runAsync([path, isDir](VfsBackend& vfs) {
+        VfsResult<bool> result;
+        result.ok = result.value = vfs.remove(path, isDir, result.error);
+        return result;
+    });
+}
+
+std::future<VfsResult<bool>> VfsBackend::mkdirAsync(const std::string& path) {
+    return runAsync([path](VfsBackend& vfs) {
+        VfsResult<bool> result;
+        result.ok = result.value = vfs.mkdir(path, result.error);
+        return result;
+    });
+}
+
+std::shared_ptr<VfsBackend> localBackend() {
+    static std::shared_ptr<VfsBackend> backend = std::make_shared<LocalVfs>();
+    return backend;
+}
+
+std::shared_ptr<VfsBackend> archiveBackend(const fs::path& archivePath, std::string& error) {
+    struct OpenArchive {
+        std::shared_ptr<ZipVfs> vfs;
+        std::uintmax_t size = 0;
+        fs::file_time_type modified;
+    };
+    static std::mutex mutex;
+    static std::deque<std::pair<std::string, OpenArchive>> open;
+    const size_t kMaxOpen = 4;
+
+    std::error_code ec;
+    std::uintmax_t size = fs::file_size(archivePath, ec);
+    fs::file_time_type modified = fs::last_write_time(archivePath, ec);
+    if (ec) {
+        error = "Archive not found";
+        return nullptr;
+    }
+    std::string key = archivePath.string();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = open.begin(); it != open.end(); ++it) {
+        if (it->first == key) {
+            if (it->second.size == size && it->second.modified == modified) {
+                std::shared_ptr<ZipVfs> vfs = it->second.vfs;
+                open.erase(it);
+                open.push_front({key, {vfs, size, modified}});
+                return vfs;
+            }
+            open.erase(it);
+            break;
+        }
+    }
+    auto vfs = std::make_shared<ZipVfs>();
+    if (!vfs->open(archivePath, error)) {
+        return nullptr;
+    }
+    open.push_front({key, {vfs, size, modified}});
+    if (open.size() > kMaxOpen) {
+        open.pop_back();
+    }
+    return vfs;
+}
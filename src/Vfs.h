@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct Entry {
+    std::string name;
+    std::filesystem::path path;
+    bool isDir;
+    bool isParent;
+    std::uintmax_t sizeBytes = 0;
+    bool hasSize = false;
+    std::int64_t modifiedTime = 0;
+    bool hasModified = false;
+};
+
+enum class ChecksumKind {
+    None,
+    Crc32,
+    Md5,
+};
+
+// Folders first, then by name ignoring case.
+void sortEntries(std::vector<Entry>& entries);
+// Drops dot files.
+void filterHiddenEntries(std::vector<Entry>& entries);
+
+// Directory listings of remote backends are remembered for a short while, so the copy
+// engine can look files up without listing their folder each time and opening a folder
+// a search has just crawled does not hit the server again. Browsing into any other
+// folder always lists it afresh, since other clients may have changed it. Anything this
+// app changes invalidates the affected folders.
+void storeListing(const std::string& backendKey, const std::string& path, const std::vector<Entry>& entries,
+                  bool seeded = false);
+// With browsing set only a listing seeded by a search is used, and only the once.
+bool lookupListing(const std::string& backendKey, const std::string& path, std::vector<Entry>& entries,
+                   bool browsing = false);
+// Drops the listing of path and of every folder below it.
+void invalidateListings(const std::string& backendKey, const std::string& path);
+
+// Virtual filesystem layer. Panes reach their files through a VfsBackend instead of
+// branching on where they point; the copy engine streams between any pair of backends
+// and consults capability flags to take a shortcut when one exists.
+struct VfsCapabilities {
+    bool serverSideRename = false;
+    bool reflink = false;
+    bool rangeReads = false;
+    bool cacheListings = false;
+    bool localFiles = false;
+};
+
+class VfsReadStream {
+public:
+    virtual ~VfsReadStream() = default;
+    // Returns the number of bytes read, 0 at end of file or -1 on error.
+    virtual long long read(char* buffer, std::size_t size, std::string& error) = 0;
+    // Streams that wait on the network fail with "Cancelled" soon after cancel is set.
+    virtual void setCancel(const std::atomic<bool>* cancel) {
+        (void)cancel;
+    }
+};
+
+class VfsWriteStream {
+public:
+    virtual ~VfsWriteStream() = default;
+    virtual bool write(const char* data, std::size_t size, std::string& error) = 0;
+    // Completes the file. A stream destroyed without a successful close discards it.
+    virtual bool close(std::string& error) = 0;
+    virtual void setCancel(const std::atomic<bool>* cancel) {
+        (void)cancel;
+    }
+};
+
+template <typename T>
+struct VfsResult {
+    bool ok = false;
+    T value {};
+    std::string error;
+};
+
+class VfsBackend : public std::enable_shared_from_this<VfsBackend> {
+public:
+    virtual ~VfsBackend() = default;
+
+    virtual VfsCapabilities capabilities() const = 0;
+    // Identifies the filesystem instance; listings are cached under this key.
+    virtual std::string key() const = 0;
+    virtual std::string join(const std::string& dir, const std::string& name) const = 0;
+    // Returns the path itself for a root.
+    virtual std::string parent(const std::string& path) const = 0;
+    virtual std::string baseName(const std::string& path) const = 0;
+
+    // Looks up a single path. Returns false with an empty error when it does not exist.
+    virtual bool stat(const std::string& path, Entry& entry, std::string& error);
+    virtual std::unique_ptr<VfsReadStream> openRead(const std::string& path, std::uint64_t offset, std::string& error) = 0;
+    virtual bool reflink(const std::string& fromPath, const std::string& toPath, std::string& error);
+    // Digest the backend can report for a stored file without the caller reading it.
+    virtual ChecksumKind checksumKind();
+    // Lower-case hex digest of the given kind.
+    virtual bool checksum(const std::string& path, ChecksumKind kind, std::string& hex, std::string& error);
+
+    // browsing marks a folder the user opened: it is listed afresh unless a search has
+    // just crawled it (see storeListing).
+    bool list(const std::string& path, bool includeHidden, std::vector<Entry>& entries, std::string& error,
+              bool browsing = false);
+    std::unique_ptr<VfsWriteStream> openWrite(const std::string& path, std::uint64_t sizeHint, std::string& error);
+    bool rename(const std::string& fromPath, const std::string& toPath, std::string& error);
+    bool remove(const std::string& path, bool isDir, std::string& error);
+    bool mkdir(const std::string& path, std::string& error);
+    void invalidate(const std::string& path);
+
+    // Runs an operation on a worker thread. The backend stays alive until it finishes,
+    // and backends are safe to use from several threads at once.
+    template <typename Fn>
+    auto runAsync(Fn fn) -> std::future<decltype(fn(std::declval<VfsBackend&>()))> {
+        std::shared_ptr<VfsBackend> self = shared_from_this();
+        return std::async(std::launch::async, [self, fn]() mutable { return fn(*self); });
+    }
+    std::future<VfsResult<std::vector<Entry>>> listAsync(const std::string& path, bool includeHidden,
+                                                         bool browsing = false);
+    std::future<VfsResult<Entry>> statAsync(const std::string& path);
+    std::future<VfsResult<std::unique_ptr<VfsReadStream>>> openReadAsync(const std::string& path, std::uint64_t offset);
+    std::future<VfsResult<std::unique_ptr<VfsWriteStream>>> openWriteAsync(const std::string& path, std::uint64_t sizeHint);
+    std::future<VfsResult<bool>> renameAsync(const std::string& fromPath, const std::string& toPath);
+    std::future<VfsResult<bool>> removeAsync(const std::string& path, bool isDir);
+    std::future<VfsResult<bool>> mkdirAsync(const std::string& path);
+
+protected:
+    virtual bool doList(const std::string& path, std::vector<Entry>& entries, std::string& error) = 0;
+    virtual std::unique_ptr<VfsWriteStream> doOpenWrite(const std::string& path, std::uint64_t sizeHint, std::string& error) = 0;
+    virtual bool doRename(const std::string& fromPath, const std::string& toPath, std::string& error) = 0;
+    virtual bool doRemove(const std::string& path, bool isDir, std::string& error) = 0;
+    virtual bool doMkdir(const std::string& path, std::string& error) = 0;
+};
+
+// The local disk. Reflinks files on filesystems that share extents.
+std::shared_ptr<VfsBackend> localBackend();
+
+// Read-only view of a ZIP archive. Paths are "/"-rooted inside the archive. Recently
+// browsed archives stay mapped, so moving between their folders does not re-read the
+// central directory; one is reopened when the file on disk changes.
+std::shared_ptr<VfsBackend> archiveBackend(const std::filesystem::path& archivePath, std::string& error);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Workers to use for count items: threads (0 picks one per core), at most maxThreads
+// and never more than there are items.
+inline unsigned workerCount(unsigned threads, unsigned maxThreads, std::size_t count) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return std::min({threads, maxThreads, static_cast<unsigned>(std::max<std::size_t>(count, 1))});
+}
+
+// Calls fn(slot, index) for each index below count on `workers` threads, the calling
+// thread being slot 0. A free worker always takes the next index, so callers put their
+// largest items first: one big item then does not start last and leave the pool idle.
+// Once a call returns false (an error or a cancel), no worker takes another item.
+template <typename Fn>
+void runParallel(std::size_t count, unsigned workers, Fn fn) {
+    std::atomic<std::size_t> next {0};
+    std::atomic<bool> stopped {false};
+    auto work = [&](std::size_t slot) {
+        while (!stopped) {
+            std::size_t index = next++;
+            if (index >= count) {
+                return;
+            }
+            if (!fn(slot, index)) {
+                stopped = true;
+                return;
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned slot = 1; slot < workers; ++slot) {
+        threads.emplace_back(work, slot);
+    }
+    work(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,385 @@
+#include "ZipArchive.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+constexpr std::uint32_t kEndOfCentralDirSig = 0x06054b50u;
+constexpr std::uint32_t kZip64EndLocatorSig = 0x07064b50u;
+constexpr std::uint32_t kZip64EndOfCentralDirSig = 0x06064b50u;
+constexpr std::uint32_t kCentralHeaderSig = 0x02014b50u;
+constexpr std::uint32_t kLocalHeaderSig = 0x04034b50u;
+constexpr std::uint16_t kZip64ExtraId = 0x0001u;
+constexpr std::uint64_t kEndOfCentralDirSize = 22;
+constexpr std::uint64_t kZip64EndLocatorSize = 20;
+constexpr std::uint64_t kZip64EndOfCentralDirSize = 56;
+constexpr std::uint64_t kCentralHeaderSize = 46;
+constexpr std::uint64_t kLocalHeaderSize = 30;
+constexpr std::uint64_t kMaxCommentSize = 0xFFFF;
+constexpr std::uint16_t kMethodStored = 0;
+constexpr std::uint16_t kMethodDeflate = 8;
+
+std::uint16_t read16(const std::uint8_t* p) {
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+std::uint32_t read32(const std::uint8_t* p) {
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+           (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint64_t read64(const std::uint8_t* p) {
+    return static_cast<std::uint64_t>(read32(p)) | (static_cast<std::uint64_t>(read32(p + 4)) << 32);
+}
+
+// Fills in the 64-bit fields that the central header marked with 0xFFFFFFFF, in the
+// order the ZIP64 extra field stores them.
+bool applyZip64Extra(const std::uint8_t* extra, std::uint16_t extraLength, bool wantUncompressed,
+                     bool wantCompressed, bool wantOffset, ZipEntry& entry) {
+    std::uint16_t pos = 0;
+    while (pos + 4 <= extraLength) {
+        std::uint16_t id = read16(extra + pos);
+        std::uint16_t size = read16(extra + pos + 2);
+        if (pos + 4 + size > extraLength) {
+            return false;
+        }
+        if (id == kZip64ExtraId) {
+            const std::uint8_t* field = extra + pos + 4;
+            std::uint16_t used = 0;
+            auto take = [&](std::uint64_t& value) {
+                if (used + 8 > size) {
+                    return false;
+                }
+                value = read64(field + used);
+                used += 8;
+                return true;
+            };
+            if (wantUncompressed && !take(entry.uncompressedSize)) {
+                return false;
+            }
+            if (wantCompressed && !take(entry.compressedSize)) {
+                return false;
+            }
+            if (wantOffset && !take(entry.localHeaderOffset)) {
+                return false;
+            }
+            return true;
+        }
+        pos = static_cast<std::uint16_t>(pos + 4 + size);
+    }
+    return !(wantUncompressed || wantCompressed || wantOffset);
+}
+} // namespace
+
+bool ZipArchive::open(const std::filesystem::path& path, std::string& error) {
+    entries_.clear();
+    prefix_ = 0;
+    if (!file_.open(path, error)) {
+        return false;
+    }
+    std::uint64_t needed = 0;
+    return parseCentralDirectory(file_.data(), 0, file_.size(), needed, error);
+}
+
+bool ZipArchive::openTail(const std::vector<std::uint8_t>& tail, std::uint64_t fileSize, std::uint64_t& needed,
+                          std::string& error) {
+    entries_.clear();
+    prefix_ = 0;
+    file_.close();
+    if (tail.size() > fileSize) {
+        error = "Not a zip archive";
+        return false;
+    }
+    return parseCentralDirectory(tail.data(), fileSize - tail.size(), fileSize, needed, error);
+}
+
+bool ZipArchive::parseCentralDirectory(const std::uint8_t* data, std::uint64_t base, std::uint64_t size,
+                                       std::uint64_t& needed, std::string& error) {
+    needed = 0;
+    // Checks that the bytes from pos on are in hand, noting how much more is needed if not.
+    auto have = [&](std::uint64_t pos) {
+        if (pos >= base) {
+            return true;
+        }
+        needed = size - pos;
+        error = "Central directory not loaded";
+        return false;
+    };
+    auto at = [&](std::uint64_t pos) { return data + (pos - base); };
+    if (size < kEndOfCentralDirSize) {
+        error = "Not a zip archive";
+        return false;
+    }
+
+    // The end record sits before an optional comment of up to 64 KB.
+    std::uint64_t scanStart = size - kEndOfCentralDirSize;
+    std::uint64_t scanEnd = (scanStart > kMaxCommentSize) ? scanStart - kMaxCommentSize : 0;
+    std::uint64_t eocd = UINT64_MAX;
+    for (std::uint64_t pos = scanStart + 1; pos-- > scanEnd;) {
+        if (!have(pos)) {
+            needed = size - scanEnd;
+            return false;
+        }
+        if (read32(at(pos)) == kEndOfCentralDirSig && pos + kEndOfCentralDirSize + read16(at(pos + 20)) <= size) {
+            eocd = pos;
+            break;
+        }
+    }
+    if (eocd == UINT64_MAX) {
+        error = "Not a zip archive";
+        return false;
+    }
+
+    std::uint64_t entryCount = read16(at(eocd + 10));
+    std::uint64_t dirSize = read32(at(eocd + 12));
+    std::uint64_t dirOffset = read32(at(eocd + 16));
+    std::uint64_t dirEnd = eocd;
+    if (eocd >= kZip64EndLocatorSize && have(eocd - kZip64EndLocatorSize) &&
+        read32(at(eocd - kZip64EndLocatorSize)) == kZip64EndLocatorSig) {
+        std::uint64_t locator = eocd - kZip64EndLocatorSize;
+        std::uint64_t record = read64(at(locator + 8));
+        auto isRecord = [&](std::uint64_t pos) {
+            return pos >= base && pos <= size && size - pos >= kZip64EndOfCentralDirSize &&
+                   read32(at(pos)) == kZip64EndOfCentralDirSig;
+        };
+        // With a prefix the recorded offset is too small; the record sits right before the locator.
+        if (!isRecord(record) && locator >= kZip64EndOfCentralDirSize && record + kZip64EndOfCentralDirSize <= locator &&
+            isRecord(locator - kZip64EndOfCentralDirSize)) {
+            record = locator - kZip64EndOfCentralDirSize;
+        }
+        if (record <= size && size - record >= kZip64EndOfCentralDirSize && !have(record)) {
+            return false;
+        }
+        if (!isRecord(record)) {
+            error = "Corrupt zip64 end record";
+            return false;
+        }
+        entryCount = read64(at(record + 32));
+        dirSize = read64(at(record + 40));
+        dirOffset = read64(at(record + 48));
+        dirEnd = record;
+    } else if (needed > 0) {
+        return false;
+    }
+    if (dirSize > dirEnd || dirOffset > dirEnd - dirSize) {
+        error = "Corrupt central directory";
+        return false;
+    }
+    prefix_ = dirEnd - dirSize - dirOffset;
+    if (!have(dirOffset + prefix_)) {
+        return false;
+    }
+
+    // Every header is at least 46 bytes, which bounds a hostile entry count.
+    entries_.reserve(static_cast<size_t>(std::min<std::uint64_t>(entryCount, dirSize / kCentralHeaderSize)));
+    std::uint64_t pos = dirOffset + prefix_;
+    std::uint64_t end = pos + dirSize;
+    for (std::uint64_t i = 0; i < entryCount; ++i) {
+        if (pos + kCentralHeaderSize > end || read32(at(pos)) != kCentralHeaderSig) {
+            error = "Corrupt central directory";
+            return false;
+        }
+        const std::uint8_t* header = at(pos);
+        std::uint16_t nameLength = read16(header + 28);
+        std::uint16_t extraLength = read16(header + 30);
+        std::uint16_t commentLength = read16(header + 32);
+        std::uint64_t next = pos + kCentralHeaderSize + nameLength + extraLength + commentLength;
+        if (next > end) {
+            error = "Corrupt central directory";
+            return false;
+        }
+
+        ZipEntry entry;
+        entry.versionMadeBy = read16(header + 4);
+        entry.flags = read16(header + 8);
+        entry.method = read16(header + 10);
+        entry.dosDateTime = (static_cast<std::uint32_t>(read16(header + 14)) << 16) | read16(header + 12);
+        entry.crc32 = read32(header + 16);
+        entry.compressedSize = read32(header + 20);
+        entry.uncompressedSize = read32(header + 24);
+        entry.externalAttributes = read32(header + 38);
+        entry.localHeaderOffset = read32(header + 42);
+        entry.name.assign(reinterpret_cast<const char*>(header + kCentralHeaderSize), nameLength);
+        std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+        entry.isDir = !entry.name.empty() && entry.name.back() == '/';
+
+        bool wantUncompressed = entry.uncompressedSize == 0xFFFFFFFFu;
+        bool wantCompressed = entry.compressedSize == 0xFFFFFFFFu;
+        bool wantOffset = entry.localHeaderOffset == 0xFFFFFFFFu;
+        if ((wantUncompressed || wantCompressed || wantOffset) &&
+            !applyZip64Extra(header + kCentralHeaderSize + nameLength, extraLength, wantUncompressed, wantCompressed,
+                             wantOffset, entry)) {
+            error = "Corrupt zip64 entry: " + entry.name;
+            return false;
+        }
+        // Local headers come before the central directory; this also keeps
+        // localHeaderOffset + prefix_ from wrapping around later.
+        if (entry.localHeaderOffset >= dirOffset) {
+            error = "Corrupt local header offset: " + entry.name;
+            return false;
+        }
+        entries_.push_back(std::move(entry));
+        pos = next;
+    }
+    return true;
+}
+
+std::uint64_t ZipArchive::totalUncompressedSize() const {
+    std::uint64_t total = 0;
+    for (const auto& entry : entries_) {
+        total += entry.uncompressedSize;
+    }
+    return total;
+}
+
+bool ZipArchive::entryData(const ZipEntry& entry, const std::uint8_t*& data, std::string& error) const {
+    std::uint64_t size = file_.size();
+    if (entry.localHeaderOffset > size || prefix_ > size - entry.localHeaderOffset ||
+        size - (prefix_ + entry.localHeaderOffset) < kLocalHeaderSize) {
+        error = "Corrupt local header: " + entry.name;
+        return false;
+    }
+    std::uint64_t header = entry.localHeaderOffset + prefix_;
+    if (read32(file_.data() + header) != kLocalHeaderSig) {
+        error = "Corrupt local header: " + entry.name;
+        return false;
+    }
+    // The local name and extra lengths may differ from the central copy.
+    std::uint64_t start = header + kLocalHeaderSize + read16(file_.data() + header + 26) + read16(file_.data() + header + 28);
+    if (start > size || entry.compressedSize > size - start) {
+        error = "Truncated entry: " + entry.name;
+        return false;
+    }
+    data = file_.data() + start;
+    return true;
+}
+
+std::int64_t ZipEntry::modifiedTime() const {
+    std::tm time {};
+    time.tm_year = static_cast<int>((dosDateTime >> 25) & 0x7F) + 80;
+    time.tm_mon = static_cast<int>((dosDateTime >> 21) & 0x0F) - 1;
+    time.tm_mday = static_cast<int>((dosDateTime >> 16) & 0x1F);
+    time.tm_hour = static_cast<int>((dosDateTime >> 11) & 0x1F);
+    time.tm_min = static_cast<int>((dosDateTime >> 5) & 0x3F);
+    time.tm_sec = static_cast<int>((dosDateTime & 0x1F) * 2);
+    time.tm_isdst = -1;
+    return static_cast<std::int64_t>(std::mktime(&time));
+}
+
+ZipEntryReader::~ZipEntryReader() {
+#ifdef USE_ZLIB
+    if (inflater_) {
+        z_stream* stream = static_cast<z_stream*>(inflater_);
+        inflateEnd(stream);
+        delete stream;
+    }
+#endif
+}
+
+bool ZipEntryReader::supports(const ZipEntry& entry) {
+    if (entry.encrypted()) {
+        return false;
+    }
+#ifdef USE_ZLIB
+    return entry.method == kMethodStored || entry.method == kMethodDeflate;
+#else
+    return entry.method == kMethodStored;
+#endif
+}
+
+bool ZipEntryReader::open(const ZipArchive& archive, const ZipEntry& entry, std::string& error) {
+    if (entry.encrypted()) {
+        error = "Encrypted entries are not supported";
+        return false;
+    }
+    if (entry.method != kMethodStored && entry.method != kMethodDeflate) {
+        error = "Unsupported compression method " + std::to_string(entry.method);
+        return false;
+    }
+    if (!archive.entryData(entry, data_, error)) {
+        return false;
+    }
+    entry_ = &entry;
+    if (entry.method == kMethodDeflate) {
+#ifdef USE_ZLIB
+        z_stream* stream = new z_stream();
+        // Negative window bits: raw deflate data without a zlib header.
+        if (inflateInit2(stream, -MAX_WBITS) != Z_OK) {
+            delete stream;
+            error = "Failed to start decompression";
+            return false;
+        }
+        inflater_ = stream;
+#else
+        error = "Deflate support not built";
+        return false;
+#endif
+    }
+    return true;
+}
+
+long long ZipEntryReader::read(char* buffer, std::size_t size, std::string& error) {
+    if (done_ || size == 0) {
+        return 0;
+    }
+    std::size_t produced = 0;
+    if (entry_->method == kMethodStored) {
+        std::uint64_t remaining = entry_->compressedSize - consumed_;
+        produced = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, size));
+        std::memcpy(buffer, data_ + consumed_, produced);
+        consumed_ += produced;
+    } else {
+#ifdef USE_ZLIB
+        z_stream* stream = static_cast<z_stream*>(inflater_);
+        stream->next_out = reinterpret_cast<Bytef*>(buffer);
+        stream->avail_out = static_cast<uInt>(std::min<std::size_t>(size, 1u << 30));
+        while (stream->avail_out > 0) {
+            if (stream->avail_in == 0 && consumed_ < entry_->compressedSize) {
+                std::uint64_t chunk = std::min<std::uint64_t>(entry_->compressedSize - consumed_, 1u << 30);
+                stream->next_in = const_cast<Bytef*>(data_ + consumed_);
+                stream->avail_in = static_cast<uInt>(chunk);
+                consumed_ += chunk;
+            }
+            int result = inflate(stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                break;
+            }
+            if (result == Z_BUF_ERROR && stream->avail_in == 0 && consumed_ >= entry_->compressedSize) {
+                error = "Truncated entry: " + entry_->name;
+                return -1;
+            }
+            if (result != Z_OK && result != Z_BUF_ERROR) {
+                error = "Corrupt data in " + entry_->name;
+                return -1;
+            }
+        }
+        produced = reinterpret_cast<char*>(stream->next_out) - buffer;
+#endif
+    }
+    crc_.update(buffer, produced);
+    produced_ += produced;
+    if (produced == 0 || produced_ >= entry_->uncompressedSize) {
+        if (!finish(error)) {
+            return -1;
+        }
+    }
+    return static_cast<long long>(produced);
+}
+
+bool ZipEntryReader::finish(std::string& error) {
+    done_ = true;
+    if (produced_ != entry_->uncompressedSize) {
+        error = "Size mismatch in " + entry_->name;
+        return false;
+    }
+    if (crc_.value() != entry_->crc32) {
+        error = "CRC mismatch in " + entry_->name;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Checksum.h"
+#include "MappedFile.h"
+
+struct ZipEntry {
+    // Path inside the archive, always with '/' separators. Directories end in '/'.
+    std::string name;
+    std::uint64_t compressedSize = 0;
+    std::uint64_t uncompressedSize = 0;
+    // Offset of the local file header, relative to the start of the file.
+    std::uint64_t localHeaderOffset = 0;
+    std::uint32_t crc32 = 0;
+    // 0 = stored, 8 = deflate; anything else is left to the caller to reject.
+    std::uint16_t method = 0;
+    std::uint16_t flags = 0;
+    // MS-DOS date (high 16 bits) and time (low 16 bits).
+    std::uint32_t dosDateTime = 0;
+    std::uint32_t externalAttributes = 0;
+    std::uint16_t versionMadeBy = 0;
+    bool isDir = false;
+
+    bool encrypted() const {
+        return (flags & 0x0001u) != 0;
+    }
+    // DOS timestamps carry no zone; like unzip, they are read as local time.
+    std::int64_t modifiedTime() const;
+    // Unix permission bits when the archive was made on a Unix host, otherwise 0.
+    std::uint32_t unixMode() const {
+        return (versionMadeBy >> 8) == 3 ? externalAttributes >> 16 : 0;
+    }
+};
+
+// Reads the central directory of a ZIP or ZIP64 archive straight from a memory
+// mapping; no entry data is touched until it is asked for.
+class ZipArchive {
+public:
+    bool open(const std::filesystem::path& path, std::string& error);
+    // Reads the central directory of an archive that is not on local disk. tail holds
+    // the last tail.size() bytes of the fileSize-byte archive; when the directory starts
+    // before them, this fails with needed set to the tail length that would cover it.
+    // entryData is not available on an archive opened this way.
+    bool openTail(const std::vector<std::uint8_t>& tail, std::uint64_t fileSize, std::uint64_t& needed,
+                  std::string& error);
+
+    const std::vector<ZipEntry>& entries() const {
+        return entries_;
+    }
+    std::uint64_t totalUncompressedSize() const;
+    // Bytes in front of the archive proper; local header offsets do not include them.
+    std::uint64_t prefix() const {
+        return prefix_;
+    }
+
+    // Points at the compressed bytes of an entry inside the mapping.
+    bool entryData(const ZipEntry& entry, const std::uint8_t*& data, std::string& error) const;
+
+private:
+    // data holds the file from offset base to its end, size bytes in all.
+    bool parseCentralDirectory(const std::uint8_t* data, std::uint64_t base, std::uint64_t size,
+                               std::uint64_t& needed, std::string& error);
+
+    MappedFile file_;
+    std::vector<ZipEntry> entries_;
+    // Bytes prepended to the archive (self-extracting stubs); added to every offset.
+    std::uint64_t prefix_ = 0;
+};
+
+// Decompresses one entry straight out of the archive mapping and checks its CRC at
+// the end. Stored and deflated entries are supported; deflate needs a USE_ZLIB build.
+class ZipEntryReader {
+public:
+    ZipEntryReader() = default;
+    ~ZipEntryReader();
+    ZipEntryReader(const ZipEntryReader&) = delete;
+    ZipEntryReader& operator=(const ZipEntryReader&) = delete;
+
+    // Whether this build can decompress the entry at all.
+    static bool supports(const ZipEntry& entry);
+    bool open(const ZipArchive& archive, const ZipEntry& entry, std::string& error);
+    // Returns the number of bytes produced, 0 at the end of the entry and -1 on error.
+    long long read(char* buffer, std::size_t size, std::string& error);
+
+private:
+    bool finish(std::string& error);
+
+    const ZipEntry* entry_ = nullptr;
+    const std::uint8_t* data_ = nullptr;
+    std::uint64_t consumed_ = 0;
+    std::uint64_t produced_ = 0;
+    Crc32 crc_;
+    bool done_ = false;
+    // z_stream, kept opaque so callers do not need zlib headers.
+    void* inflater_ = nullptr;
+};
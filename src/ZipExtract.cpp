@@ -0,0 +1,347 @@
+#include "ZipExtract.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "WorkerPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr std::size_t kWriteChunk = 1024 * 1024;
+constexpr unsigned kMaxWorkers = 8;
+constexpr std::uint32_t kUnixTypeMask = 0170000u;
+constexpr std::uint32_t kUnixSymlink = 0120000u;
+
+struct ExtractItem {
+    const ZipEntry* entry = nullptr;
+    fs::path target;
+    std::string relPath;
+};
+
+void setActivity(ExtractProgress& progress, std::size_t slot, const ExtractItem* item, std::uint64_t done) {
+    std::lock_guard<std::mutex> lock(progress.mutex);
+    ExtractActivity& activity = progress.active[slot];
+    if (!item) {
+        activity = {};
+        return;
+    }
+    if (done == 0) {
+        activity.name = item->relPath;
+        activity.size = item->entry->uncompressedSize;
+    }
+    activity.done = done;
+}
+
+bool extractFile(const ZipArchive& archive, const ExtractItem& item, std::vector<char>& buffer,
+                 ExtractProgress& progress, std::size_t slot, std::string& error) {
+    setActivity(progress, slot, &item, 0);
+    ZipEntryReader reader;
+    if (!reader.open(archive, *item.entry, error)) {
+        return false;
+    }
+    OutputFile output;
+    if (!output.open(item.target, item.entry->uncompressedSize, error, progress.created)) {
+        return false;
+    }
+    std::uint64_t offset = 0;
+    while (true) {
+        if (progress.cancel) {
+            error = "Cancelled";
+            return false;
+        }
+        long long bytes = reader.read(buffer.data(), buffer.size(), error);
+        if (bytes < 0) {
+            return false;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        if (!output.write(buffer.data(), static_cast<std::size_t>(bytes), offset, error)) {
+            return false;
+        }
+        offset += static_cast<std::uint64_t>(bytes);
+        progress.bytesDone += static_cast<std::uint64_t>(bytes);
+        setActivity(progress, slot, &item, offset);
+    }
+    setActivity(progress, slot, nullptr, 0);
+    if (!output.close(error)) {
+        return false;
+    }
+    applyFileMetadata(item.target, item.entry->unixMode(), item.entry->modifiedTime());
+    return true;
+}
+
+// True when the file at the item's target has the entry's size and CRC. Large files are
+// hashed a chunk at a time so the activity slot moves and a cancel is noticed.
+bool matchesOnDisk(const ExtractItem& item, ExtractProgress& progress, std::size_t slot) {
+    std::error_code ec;
+    if (!fs::is_regular_file(fs::symlink_status(item.target, ec))) {
+        return false;
+    }
+    std::uintmax_t size = fs::file_size(item.target, ec);
+    if (ec || size != item.entry->uncompressedSize) {
+        return false;
+    }
+    MappedFile file;
+    std::string error;
+    if (!file.open(item.target, error) || file.size() != item.entry->uncompressedSize) {
+        return false;
+    }
+    setActivity(progress, slot, &item, 0);
+    Crc32 crc;
+    for (std::uint64_t offset = 0; offset < file.size() && !progress.cancel; offset += kWriteChunk) {
+        std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(kWriteChunk, file.size() - offset));
+        crc.update(file.data() + offset, chunk);
+        setActivity(progress, slot, &item, offset + chunk);
+    }
+    setActivity(progress, slot, nullptr, 0);
+    return !progress.cancel && crc.value() == item.entry->crc32;
+}
+
+// Targets that point outside the archive's own tree are stored as plain files.
+bool extractSymlink(const ZipArchive& archive, const fs::path& destDir, const ExtractItem& item,
+                    CreatedPaths* created, std::string& error) {
+    ZipEntryReader reader;
+    if (!reader.open(archive, *item.entry, error)) {
+        return false;
+    }
+    std::string link(static_cast<std::size_t>(std::min<std::uint64_t>(item.entry->uncompressedSize, 4096)), '\0');
+    long long bytes = link.empty() ? 0 : reader.read(&link[0], link.size(), error);
+    if (bytes < 0) {
+        return false;
+    }
+    link.resize(static_cast<std::size_t>(bytes));
+    return writeSymlink(destDir, item.relPath, link, error, created);
+}
+
+// Picks the entries to write, keyed by relative path, and every folder they need.
+// Later entries with the same name replace earlier ones, as with unzip -o.
+void collectItems(const ZipArchive& archive, const std::vector<bool>* include, const fs::path& destDir,
+                  std::map<std::string, ExtractItem>& files, std::set<std::string>& dirs) {
+    const std::vector<ZipEntry>& entries = archive.entries();
+    for (std::size_t index = 0; index < entries.size(); ++index) {
+        const ZipEntry& entry = entries[index];
+        if (include && (index >= include->size() || !(*include)[index])) {
+            continue;
+        }
+        ExtractItem item;
+        if (!safeRelativePath(entry.name, item.relPath) || item.relPath.empty()) {
+            continue;
+        }
+        std::string parent = entry.isDir ? item.relPath : item.relPath.substr(0, item.relPath.rfind('/') + 1);
+        while (!parent.empty()) {
+            if (parent.back() == '/') {
+                parent.pop_back();
+            }
+            if (!dirs.insert(parent).second) {
+                break;
+            }
+            std::size_t slash = parent.rfind('/');
+            parent = slash == std::string::npos ? std::string() : parent.substr(0, slash);
+        }
+        if (!entry.isDir) {
+            item.entry = &entry;
+            item.target = destDir / fs::u8path(item.relPath);
+            files[item.relPath] = item;
+        }
+    }
+}
+} // namespace
+
+bool zipExtractSupported(const ZipArchive& archive) {
+    for (const ZipEntry& entry : archive.entries()) {
+        if (!entry.isDir && !ZipEntryReader::supports(entry)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool extractZipArchive(const ZipArchive& archive, const fs::path& destDir, const std::vector<bool>* include,
+                       unsigned threads, ExtractProgress& progress, std::string& error, bool skipIdentical) {
+    std::map<std::string, ExtractItem> files;
+    std::set<std::string> dirs;
+    collectItems(archive, include, destDir, files, dirs);
+
+    for (const std::string& dir : dirs) {
+        if (!makeExtractDirs(destDir, dir, error, progress.created)) {
+            return false;
+        }
+    }
+
+    std::vector<ExtractItem> queue;
+    std::vector<ExtractItem> links;
+    for (auto& file : files) {
+        if ((file.second.entry->unixMode() & kUnixTypeMask) == kUnixSymlink) {
+            links.push_back(file.second);
+        } else if (dirs.count(file.first) == 0) {
+            queue.push_back(file.second);
+        }
+    }
+    std::sort(queue.begin(), queue.end(), [](const ExtractItem& a, const ExtractItem& b) {
+        return a.entry->uncompressedSize > b.entry->uncompressedSize;
+    });
+
+    threads = workerCount(threads, kMaxWorkers, queue.size());
+    std::atomic<bool> failed {false};
+    std::mutex errorMutex;
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        progress.active.assign(threads, {});
+    }
+    std::vector<std::vector<char>> buffers(threads, std::vector<char>(kWriteChunk));
+    runParallel(queue.size(), threads, [&](std::size_t slot, std::size_t index) {
+        if (progress.cancel) {
+            return false;
+        }
+        if (skipIdentical && matchesOnDisk(queue[index], progress, slot)) {
+            progress.bytesDone += queue[index].entry->uncompressedSize;
+            progress.bytesSkipped += queue[index].entry->uncompressedSize;
+            ++progress.filesSkipped;
+            ++progress.filesDone;
+            return true;
+        }
+        std::string itemError;
+        if (!extractFile(archive, queue[index], buffers[slot], progress, slot, itemError)) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!failed.exchange(true)) {
+                error = itemError;
+            }
+            return false;
+        }
+        ++progress.filesDone;
+        return true;
+    });
+    if (!failed && progress.cancel) {
+        error = "Cancelled";
+        return false;
+    }
+    if (failed) {
+        return false;
+    }
+
+    for (const ExtractItem& link : links) {
+        if (!extractSymlink(archive, destDir, link, progress.created, error)) {
+            return false;
+        }
+        ++progress.filesDone;
+    }
+    return true;
+}
+
+bool extractZipArchive(const ZipArchive& archive, ExtractSink& sink, ExtractProgress& progress, std::string& error) {
+    std::map<std::string, ExtractItem> files;
+    std::set<std::string> dirs;
+    collectItems(archive, nullptr, fs::path(), files, dirs);
+    for (const std::string& dir : dirs) {
+        if (!sink.makeDir(dir, error)) {
+            return false;
+        }
+    }
+    std::vector<ExtractItem> order;
+    for (auto& file : files) {
+        if ((file.second.entry->unixMode() & kUnixTypeMask) != kUnixSymlink && dirs.count(file.first) == 0) {
+            order.push_back(file.second);
+        }
+    }
+    // Stored order, so the mapping is read from front to back.
+    std::sort(order.begin(), order.end(), [](const ExtractItem& a, const ExtractItem& b) {
+        return a.entry->localHeaderOffset < b.entry->localHeaderOffset;
+    });
+    std::vector<char> buffer(kWriteChunk);
+    for (const ExtractItem& item : order) {
+        if (progress.cancel) {
+            error = "Cancelled";
+            return false;
+        }
+        ZipEntryReader reader;
+        if (!reader.open(archive, *item.entry, error) ||
+            !sink.openFile(item.relPath, item.entry->uncompressedSize, error)) {
+            return false;
+        }
+        while (true) {
+            if (progress.cancel) {
+                error = "Cancelled";
+                return false;
+            }
+            long long bytes = reader.read(buffer.data(), buffer.size(), error);
+            if (bytes < 0) {
+                return false;
+            }
+            if (bytes == 0) {
+                break;
+            }
+            if (!sink.write(buffer.data(), static_cast<std::size_t>(bytes), error)) {
+                return false;
+            }
+        }
+        if (!sink.closeFile(error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testZipArchive(const ZipArchive& archive, unsigned threads, ExtractProgress& progress,
+                    std::vector<std::string>& corrupt, std::string& error) {
+    std::vector<ExtractItem> queue;
+    for (const ZipEntry& entry : archive.entries()) {
+        if (!entry.isDir) {
+            ExtractItem item;
+            item.entry = &entry;
+            item.relPath = entry.name;
+            queue.push_back(item);
+        }
+    }
+    std::sort(queue.begin(), queue.end(), [](const ExtractItem& a, const ExtractItem& b) {
+        return a.entry->uncompressedSize > b.entry->uncompressedSize;
+    });
+    threads = workerCount(threads, kMaxWorkers, queue.size());
+    std::mutex corruptMutex;
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        progress.active.assign(threads, {});
+    }
+    // Every entry is inflated into a scratch buffer and dropped; the reader checks the
+    // size and CRC once it reaches the end.
+    std::vector<std::vector<char>> buffers(threads, std::vector<char>(kWriteChunk));
+    runParallel(queue.size(), threads, [&](std::size_t slot, std::size_t index) {
+        if (progress.cancel) {
+            return false;
+        }
+        std::vector<char>& buffer = buffers[slot];
+        const ExtractItem& item = queue[index];
+        setActivity(progress, slot, &item, 0);
+        ZipEntryReader reader;
+        std::string itemError;
+        bool ok = reader.open(archive, *item.entry, itemError);
+        std::uint64_t done = 0;
+        while (ok && !progress.cancel) {
+            long long bytes = reader.read(buffer.data(), buffer.size(), itemError);
+            if (bytes <= 0) {
+                ok = bytes == 0;
+                break;
+            }
+            done += static_cast<std::uint64_t>(bytes);
+            progress.bytesDone += static_cast<std::uint64_t>(bytes);
+            setActivity(progress, slot, &item, done);
+        }
+        setActivity(progress, slot, nullptr, 0);
+        if (!ok) {
+            std::lock_guard<std::mutex> lock(corruptMutex);
+            corrupt.push_back(item.relPath);
+        }
+        ++progress.filesDone;
+        return true;
+    });
+    if (progress.cancel) {
+        error = "Cancelled";
+        return false;
+    }
+    std::sort(corrupt.begin(), corrupt.end());
+    return true;
+}
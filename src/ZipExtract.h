@@ -0,0 +1,33 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "ExtractOutput.h"
+#include "ZipArchive.h"
+
+// True when every entry can be decompressed by this build (see ZipEntryReader::supports).
+bool zipExtractSupported(const ZipArchive& archive);
+
+// Extracts the archive below destDir, overwriting existing files. When include is
+// given, only entries whose index is set are written (with the folders they need).
+// Entries are inflated concurrently on up to `threads` workers (0 picks one per core),
+// largest first, each written into a file preallocated to its final size. Entries
+// whose names would land outside destDir are skipped. With skipIdentical, a file
+// already on disk with the entry's size is hashed, and left untouched (counted in
+// progress.filesSkipped) when its CRC matches too.
+bool extractZipArchive(const ZipArchive& archive, const std::filesystem::path& destDir,
+                       const std::vector<bool>* include, unsigned threads, ExtractProgress& progress,
+                       std::string& error, bool skipIdentical = false);
+
+// Same, handing every file to sink one at a time in stored order instead of writing
+// below a folder. Symlinks are left out. progress.bytesDone and filesDone are left to
+// the sink, which knows when the data has actually landed.
+bool extractZipArchive(const ZipArchive& archive, ExtractSink& sink, ExtractProgress& progress, std::string& error);
+
+// Decompresses every file entry on up to `threads` workers without writing anything,
+// checking each one's size and CRC. Entries that fail are listed in corrupt (sorted);
+// false is only returned when cancelled. Every entry must pass ZipEntryReader::supports.
+bool testZipArchive(const ZipArchive& archive, unsigned threads, ExtractProgress& progress,
+                    std::vector<std::string>& corrupt, std::string& error);
@@ -0,0 +1,337 @@
+#include "ZipStream.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+#include <vector>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+// Enough for the end records and a maximal comment; most central directories fit too.
+constexpr std::uint64_t kTailRead = 256 * 1024;
+constexpr std::size_t kPrefetchBytes = 16 * 1024 * 1024;
+// Unused stretches shorter than this are read through rather than reopened at.
+constexpr std::uint64_t kSeekGap = 4 * 1024 * 1024;
+constexpr std::size_t kChunk = 256 * 1024;
+constexpr std::size_t kLocalHeaderSize = 30;
+constexpr std::uint32_t kLocalHeaderSig = 0x04034b50u;
+constexpr std::uint16_t kMethodStored = 0;
+constexpr std::uint32_t kUnixTypeMask = 0170000u;
+constexpr std::uint32_t kUnixSymlink = 0120000u;
+
+std::uint16_t read16(const unsigned char* p) {
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+std::uint32_t read32(const unsigned char* p) {
+    return static_cast<std::uint32_t>(read16(p)) | (static_cast<std::uint32_t>(read16(p + 2)) << 16);
+}
+
+bool readExact(ByteSource& source, char* buffer, std::size_t size, std::string& error) {
+    while (size > 0) {
+        long long bytes = source.read(buffer, size, error);
+        if (bytes < 0) {
+            return false;
+        }
+        if (bytes == 0) {
+            error = "Unexpected end of archive";
+            return false;
+        }
+        buffer += bytes;
+        size -= static_cast<std::size_t>(bytes);
+    }
+    return true;
+}
+
+// Walks the archive forward, keeping track of the offset reached.
+class Cursor {
+public:
+    Cursor(ByteSource& source, ExtractProgress& progress) : source_(source), progress_(progress) {}
+
+    bool seek(std::uint64_t offset, std::string& error) {
+        if (started_ && offset >= position_ && offset - position_ < kSeekGap) {
+            return skip(offset - position_, error);
+        }
+        if (!source_.open(offset, error)) {
+            return false;
+        }
+        started_ = true;
+        position_ = offset;
+        progress_.sourceDone = position_;
+        return true;
+    }
+    bool read(char* buffer, std::size_t size, std::string& error) {
+        if (!readExact(source_, buffer, size, error)) {
+            return false;
+        }
+        position_ += size;
+        progress_.sourceDone = position_;
+        return true;
+    }
+    bool skip(std::uint64_t size, std::string& error) {
+        while (size > 0) {
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(size, sizeof(discard_)));
+            if (!read(discard_, chunk, error)) {
+                return false;
+            }
+            size -= chunk;
+        }
+        return true;
+    }
+
+private:
+    ByteSource& source_;
+    ExtractProgress& progress_;
+    std::uint64_t position_ = 0;
+    bool started_ = false;
+    char discard_[64 * 1024];
+};
+
+struct StreamItem {
+    const ZipEntry* entry = nullptr;
+    std::string relPath;
+    bool link = false;
+};
+
+using Sink = std::function<bool(const char*, std::size_t, std::string&)>;
+
+// Feeds the entry's data, decompressed, to sink in order and checks size and CRC.
+bool decodeEntry(Cursor& cursor, const ZipEntry& entry, std::vector<char>& input, std::vector<char>& output,
+                 const Sink& sink, ExtractProgress& progress, std::string& error) {
+    Crc32 crc;
+    std::uint64_t produced = 0;
+    std::uint64_t remaining = entry.compressedSize;
+    auto emit = [&](const char* data, std::size_t size) {
+        crc.update(data, size);
+        produced += size;
+        return sink(data, size, error);
+    };
+    if (entry.method == kMethodStored) {
+        while (remaining > 0) {
+            if (progress.cancel) {
+                error = "Cancelled";
+                return false;
+            }
+            std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, input.size()));
+            if (!cursor.read(input.data(), chunk, error) || !emit(input.data(), chunk)) {
+                return false;
+            }
+            remaining -= chunk;
+        }
+    } else {
+#ifdef USE_ZLIB
+        z_stream stream {};
+        // Negative window bits: raw deflate data without a zlib header.
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+            error = "Failed to start decompression";
+            return false;
+        }
+        struct Inflater {
+            z_stream& stream;
+            ~Inflater() {
+                inflateEnd(&stream);
+            }
+        } guard {stream};
+        int result = Z_OK;
+        while (result != Z_STREAM_END) {
+            if (progress.cancel) {
+                error = "Cancelled";
+                return false;
+            }
+            if (stream.avail_in == 0) {
+                if (remaining == 0) {
+                    error = "Truncated entry: " + entry.name;
+                    return false;
+                }
+                std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, input.size()));
+                if (!cursor.read(input.data(), chunk, error)) {
+                    return false;
+                }
+                remaining -= chunk;
+                stream.next_in = reinterpret_cast<Bytef*>(input.data());
+                stream.avail_in = static_cast<uInt>(chunk);
+            }
+            stream.next_out = reinterpret_cast<Bytef*>(output.data());
+            stream.avail_out = static_cast<uInt>(output.size());
+            result = inflate(&stream, Z_NO_FLUSH);
+            if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                error = "Corrupt data in " + entry.name;
+                return false;
+            }
+            std::size_t made = output.size() - stream.avail_out;
+            if (made > 0 && !emit(output.data(), made)) {
+                return false;
+            }
+        }
+        if (!cursor.skip(remaining, error)) {
+            return false;
+        }
+#else
+        (void)output;
+        error = "Deflate support not built";
+        return false;
+#endif
+    }
+    if (produced != entry.uncompressedSize) {
+        error = "Size mismatch in " + entry.name;
+        return false;
+    }
+    if (crc.value() != entry.crc32) {
+        error = "CRC mismatch in " + entry.name;
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+bool readZipDirectory(ByteSource& source, std::uint64_t size, ZipArchive& archive, std::string& error) {
+    std::uint64_t want = std::min(size, kTailRead);
+    // A second read is needed when the directory is larger than the first guess, a third
+    // when a zip64 record only then reveals where it starts.
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        std::vector<std::uint8_t> tail(static_cast<std::size_t>(want));
+        if (!source.open(size - want, error) ||
+            !readExact(source, reinterpret_cast<char*>(tail.data()), tail.size(), error)) {
+            return false;
+        }
+        std::uint64_t needed = 0;
+        if (archive.openTail(tail, size, needed, error)) {
+            return true;
+        }
+        if (needed <= want || needed > size) {
+            return false;
+        }
+        want = needed;
+    }
+    return false;
+}
+
+bool extractZipStream(ByteSource& source, const ZipArchive& archive, const fs::path& destDir,
+                      ExtractProgress& progress, std::string& error) {
+    // Later entries with the same name replace earlier ones, as with unzip -o.
+    std::map<std::string, StreamItem> files;
+    std::set<std::string> dirs;
+    for (const ZipEntry& entry : archive.entries()) {
+        StreamItem item;
+        if (!safeRelativePath(entry.name, item.relPath) || item.relPath.empty()) {
+            continue;
+        }
+        std::string parent = entry.isDir ? item.relPath : item.relPath.substr(0, item.relPath.rfind('/') + 1);
+        while (!parent.empty()) {
+            if (parent.back() == '/') {
+                parent.pop_back();
+            }
+            if (!dirs.insert(parent).second) {
+                break;
+            }
+            std::size_t slash = parent.rfind('/');
+            parent = slash == std::string::npos ? std::string() : parent.substr(0, slash);
+        }
+        if (!entry.isDir) {
+            item.entry = &entry;
+            item.link = (entry.unixMode() & kUnixTypeMask) == kUnixSymlink;
+            files[item.relPath] = item;
+        }
+    }
+    for (const std::string& dir : dirs) {
+        if (!makeExtractDirs(destDir, dir, error, progress.created)) {
+            return false;
+        }
+    }
+
+    std::vector<StreamItem> order;
+    for (auto& file : files) {
+        if (dirs.count(file.first) == 0) {
+            order.push_back(file.second);
+        }
+    }
+    std::sort(order.begin(), order.end(), [](const StreamItem& a, const StreamItem& b) {
+        return a.entry->localHeaderOffset < b.entry->localHeaderOffset;
+    });
+    {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        progress.active.assign(1, {});
+    }
+    auto setActivity = [&](const StreamItem* item, std::uint64_t done) {
+        std::lock_guard<std::mutex> lock(progress.mutex);
+        ExtractActivity& activity = progress.active[0];
+        activity = item ? ExtractActivity {item->relPath, item->entry->uncompressedSize, done} : ExtractActivity {};
+    };
+
+    PrefetchSource prefetch(source, kPrefetchBytes);
+    Cursor cursor(prefetch, progress);
+    std::vector<char> input(kChunk);
+    std::vector<char> output(kChunk);
+    std::vector<std::pair<const StreamItem*, std::string>> links;
+    for (const StreamItem& item : order) {
+        if (progress.cancel) {
+            error = "Cancelled";
+            return false;
+        }
+        const ZipEntry& entry = *item.entry;
+        unsigned char header[kLocalHeaderSize];
+        if (!cursor.seek(archive.prefix() + entry.localHeaderOffset, error) ||
+            !cursor.read(reinterpret_cast<char*>(header), sizeof(header), error)) {
+            return false;
+        }
+        if (read32(header) != kLocalHeaderSig) {
+            error = "Corrupt local header: " + entry.name;
+            return false;
+        }
+        // The local name and extra lengths may differ from the central copy.
+        if (!cursor.skip(static_cast<std::uint64_t>(read16(header + 26)) + read16(header + 28), error)) {
+            return false;
+        }
+        if (item.link) {
+            std::string link;
+            Sink collect = [&](const char* data, std::size_t size, std::string&) {
+                if (link.size() < 4096) {
+                    link.append(data, std::min<std::size_t>(size, 4096 - link.size()));
+                }
+                return true;
+            };
+            if (!decodeEntry(cursor, entry, input, output, collect, progress, error)) {
+                return false;
+            }
+            links.emplace_back(&item, link);
+            continue;
+        }
+        fs::path target = destDir / fs::u8path(item.relPath);
+        OutputFile file;
+        if (!file.open(target, entry.uncompressedSize, error, progress.created)) {
+            return false;
+        }
+        setActivity(&item, 0);
+        std::uint64_t offset = 0;
+        Sink write = [&](const char* data, std::size_t size, std::string& writeError) {
+            if (!file.write(data, size, offset, writeError)) {
+                return false;
+            }
+            offset += size;
+            progress.bytesDone += size;
+            setActivity(&item, offset);
+            return true;
+        };
+        bool ok = decodeEntry(cursor, entry, input, output, write, progress, error);
+        setActivity(nullptr, 0);
+        if (!ok || !file.close(error)) {
+            return false;
+        }
+        applyFileMetadata(target, entry.unixMode(), entry.modifiedTime());
+        ++progress.filesDone;
+    }
+
+    for (const auto& link : links) {
+        if (!writeSymlink(destDir, link.first->relPath, link.second, error, progress.created)) {
+            return false;
+        }
+        ++progress.filesDone;
+    }
+    return true;
+}
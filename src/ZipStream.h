@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "ByteSource.h"
+#include "ExtractOutput.h"
+#include "ZipArchive.h"
+
+// Loads the central directory of a ZIP that is read through source (size bytes long),
+// fetching only the end of the file with range reads.
+bool readZipDirectory(ByteSource& source, std::uint64_t size, ZipArchive& archive, std::string& error);
+
+// Extracts an archive opened with readZipDirectory below destDir, overwriting existing
+// files. Entries are taken in the order they are stored, so the archive is read once
+// from front to back with the transfer running ahead of the decompressor; only long
+// runs of unused data are skipped with a new range read. progress.sourceDone is the
+// archive offset reached. Every entry must pass ZipEntryReader::supports.
+bool extractZipStream(ByteSource& source, const ZipArchive& archive, const std::filesystem::path& destDir,
+                      ExtractProgress& progress, std::string& error);
@@ -2,17 +2,29 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <cctype>
+#include <cerrno>
 #include <cstdint>
 #include <cstdlib>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -21,7 +33,27 @@
 #include <curl/curl.h>
 #endif
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "ArchiveCreate.h"
+#include "Checksum.h"
+#include "DiskUsage.h"
+#include "Ftp.h"
+#include "GameScan.h"
+#include "Settings.h"
 #include "SteamHelper.h"
+#include "Vfs.h"
+#include "ZipArchive.h"
+#include "ZipExtract.h"
+#include "ZipStream.h"
+#ifdef USE_LIBARCHIVE
+#include "StreamExtract.h"
+#endif
 
 namespace fs = std::filesystem;
 
@@ -157,24 +189,19 @@ static const unsigned char kFont8x8Basic[128][8] = {
     {0x00,0x10,0x38,0x6C,0xC6,0xC6,0xFE,0x00}
 };
 
-struct Entry {
-    std::string name;
-    fs::path path;
-    bool isDir;
-    bool isParent;
-    std::uintmax_t sizeBytes = 0;
-    bool hasSize = false;
-};
-
 enum class PaneSource {
     Local,
-    Ftp
+    Ftp,
+    // Browsing inside a local archive; cwd stays on the folder holding it.
+    Archive
 };
 
 struct Pane {
     fs::path cwd;
     fs::path lastLocalCwd;
     std::string ftpPath;
+    fs::path archivePath;
+    std::string archiveDir = "/";
     PaneSource source = PaneSource::Local;
     std::vector<Entry> entries;
     int selected = 0;
@@ -193,7 +220,15 @@ enum class Mode {
     AppMenu,
     Settings,
     EditSetting,
-    ConfirmQuit
+    ConfirmQuit,
+    FtpSearch,
+    SearchResults,
+    SyncPlan,
+    Diagnostics,
+    ExtractSelect,
+    SteamScan,
+    SteamLibrary,
+    SteamMove
 };
 
 struct ActionContext {
@@ -207,28 +242,15 @@ struct StatusMessage {
 };
 
 static void setStatus(StatusMessage& status, const std::string& text);
-static bool copyEntry(const Entry& entry, const fs::path& targetDir, std::string& error);
-static bool moveEntry(const Entry& entry, const fs::path& targetDir, std::string& error);
-static bool deleteEntry(const Entry& entry, std::string& error);
-static bool renameEntry(const Entry& entry, const std::string& newName, std::string& error);
 static bool isWindowsExe(const Entry& entry, const Pane& pane);
 static bool isZipArchive(const Entry& entry, const Pane& pane);
 static bool isRarArchive(const Entry& entry, const Pane& pane);
 static std::string defaultSteamAppName(const Entry& entry);
-static std::vector<std::string> buildActionOptions(const Entry& entry, const Pane& pane);
+static std::vector<std::string> buildActionOptions(const Entry& entry, const Pane& pane, const Pane& other);
 static void resetPanePosition(Pane& pane);
-
-struct Settings {
-    std::string ftpHost;
-    int ftpPort = 21;
-    std::string ftpUser;
-    std::string ftpPass;
-    std::string steamLaunchOptions;
-    std::string steamCompatibilityToolVersion;
-    float uiScale = 1.0f;
-    bool showHidden = false;
-    fs::path panePath[2];
-};
+static std::string formatBytes(std::uintmax_t bytes);
+static std::string formatRate(double bytesPerSecond);
+static std::string formatDuration(double seconds);
 
 enum class SettingField {
     FtpHost,
@@ -269,6 +291,14 @@ struct TransferState {
     double progress = 0.0;
     int countCurrent = 0;
     int countTotal = 0;
+    // When a byte total is known it drives the bar; the count is then only a label.
+    std::uintmax_t bytesDone = 0;
+    std::uintmax_t bytesTotal = 0;
+    // Progress through the item being worked on, or negative when not tracked.
+    double itemProgress = -1.0;
+    // Set from the transfer screen; the running operation stops at its next check.
+    bool cancelRequested = false;
+    std::chrono::steady_clock::time_point started;
     std::chrono::steady_clock::time_point lastDraw;
 };
 
@@ -366,6 +396,8 @@ static std::string quoteArg(const std::string& text) {
 #endif
 }
 
+// ToolProcess starts tools itself on POSIX; the unrar listing still reads through a pipe.
+#if defined(_WIN32) || !defined(USE_LIBARCHIVE)
 static FILE* openPipe(const std::string& command, const char* mode) {
 #ifdef _WIN32
     return _popen(command.c_str(), mode);
@@ -381,6 +413,136 @@ static int closePipe(FILE* pipe) {
     return pclose(pipe);
 #endif
 }
+#endif
+
+// An external tool whose output is read line by line. Lines are read on a helper thread
+// so the caller can keep the transfer screen live and stop the tool without waiting for
+// it to print. On POSIX the tool runs in a process group of its own, so kill() ends it
+// together with anything it started; _popen gives no pid, so on Windows the tool runs
+// to the end.
+class ToolProcess {
+public:
+    ToolProcess() = default;
+    ToolProcess(const ToolProcess&) = delete;
+    ToolProcess& operator=(const ToolProcess&) = delete;
+    ~ToolProcess() {
+        close();
+    }
+
+    bool start(const std::string& command) {
+#ifdef _WIN32
+        pipe_ = openPipe(command, "r");
+#else
+        int fds[2];
+        if (::pipe(fds) != 0) {
+            return false;
+        }
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+        pid_ = fork();
+        if (pid_ == 0) {
+            // Only async-signal-safe calls between fork and exec.
+            setpgid(0, 0);
+            dup2(fds[1], STDOUT_FILENO);
+            execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char*>(nullptr));
+            _exit(127);
+        }
+        ::close(fds[1]);
+        if (pid_ < 0) {
+            ::close(fds[0]);
+            pid_ = 0;
+            return false;
+        }
+        // Also set here, so a kill() right after start() already finds the group.
+        setpgid(pid_, pid_);
+        pipe_ = fdopen(fds[0], "r");
+        if (!pipe_) {
+            ::close(fds[0]);
+            ::kill(-pid_, SIGKILL);
+            waitpid(pid_, nullptr, 0);
+            pid_ = 0;
+            return false;
+        }
+#endif
+        if (!pipe_) {
+            return false;
+        }
+        reader_ = std::thread(&ToolProcess::read, this);
+        return true;
+    }
+
+    // Waits up to timeout for the next line; false when none came, and then done()
+    // tells whether the tool has finished.
+    bool readLine(std::string& line, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait_for(lock, timeout, [&]() { return finished_ || !lines_.empty(); });
+        if (lines_.empty()) {
+            return false;
+        }
+        line = std::move(lines_.front());
+        lines_.pop_front();
+        return true;
+    }
+
+    bool done() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return finished_ && lines_.empty();
+    }
+
+    void kill() {
+#ifndef _WIN32
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pid_ > 0) {
+            ::kill(-pid_, SIGKILL);
+        }
+#endif
+    }
+
+    // Waits for the tool to exit and returns its status.
+    int close() {
+        if (!pipe_) {
+            return status_;
+        }
+        reader_.join();
+#ifdef _WIN32
+        status_ = closePipe(pipe_);
+#else
+        fclose(pipe_);
+        int status = 0;
+        while (waitpid(pid_, &status, 0) < 0 && errno == EINTR) {
+        }
+        status_ = status;
+        std::lock_guard<std::mutex> lock(mutex_);
+        pid_ = 0;
+#endif
+        pipe_ = nullptr;
+        return status_;
+    }
+
+private:
+    void read() {
+        char buffer[1024];
+        while (fgets(buffer, sizeof(buffer), pipe_)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            lines_.emplace_back(buffer);
+            changed_.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        changed_.notify_all();
+    }
+
+    FILE* pipe_ = nullptr;
+    std::thread reader_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<std::string> lines_;
+    bool finished_ = false;
+    int status_ = -1;
+#ifndef _WIN32
+    pid_t pid_ = 0;
+#endif
+};
 
 static std::string trimWhitespace(const std::string& text) {
     size_t start = 0;
@@ -651,13 +813,23 @@ static void drawTransferScreen(SDL_Renderer* renderer, SDL_Window* window, const
     drawText(renderer, modal.x + padding, modal.y + padding, fontScale, textColor, title);
 
     std::string itemLabel = transfer.item.empty() ? "(unknown)" : transfer.item;
-    drawText(renderer, modal.x + padding, modal.y + padding + static_cast<int>(std::round(40.0f * uiScale)),
-             smallScale, textColor, ellipsize(itemLabel, 48));
+    int itemY = modal.y + padding + static_cast<int>(std::round(40.0f * uiScale));
+    drawText(renderer, modal.x + padding, itemY, smallScale, textColor, ellipsize(itemLabel, 48));
 
     int barWidth = modal.w - padding * 2;
     int barHeight = static_cast<int>(std::round(20.0f * uiScale));
     int barX = modal.x + padding;
     int barY = modal.y + modal.h / 2;
+    if (transfer.itemProgress >= 0.0) {
+        int subY = itemY + 8 * smallScale + static_cast<int>(std::round(6.0f * uiScale));
+        int subHeight = std::max(2, static_cast<int>(std::round(4.0f * uiScale)));
+        SDL_Rect subRect {barX, subY, barWidth, subHeight};
+        SDL_SetRenderDrawColor(renderer, 25, 30, 35, 255);
+        SDL_RenderFillRect(renderer, &subRect);
+        subRect.w = static_cast<int>(std::round(barWidth * std::clamp(transfer.itemProgress, 0.0, 1.0)));
+        SDL_SetRenderDrawColor(renderer, 80, 220, 140, 255);
+        SDL_RenderFillRect(renderer, &subRect);
+    }
     SDL_Rect barRect {barX, barY, barWidth, barHeight};
     SDL_SetRenderDrawColor(renderer, 25, 30, 35, 255);
     SDL_RenderFillRect(renderer, &barRect);
@@ -672,6 +844,20 @@ static void drawTransferScreen(SDL_Renderer* renderer, SDL_Window* window, const
         SDL_RenderFillRect(renderer, &fillRect);
     }
 
+    if (transfer.bytesTotal > 0) {
+        std::string bytesLabel = formatBytes(transfer.bytesDone) + " of " + formatBytes(transfer.bytesTotal);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - transfer.started).count();
+        // The first second is mostly setup and would make the estimate jump around.
+        if (elapsed >= 1.0 && transfer.bytesDone > 0) {
+            double rate = static_cast<double>(transfer.bytesDone) / elapsed;
+            bytesLabel += "  " + formatRate(rate) + "  " +
+                          formatDuration(static_cast<double>(transfer.bytesTotal - std::min(transfer.bytesDone, transfer.bytesTotal)) / rate) +
+                          " left";
+        }
+        drawText(renderer, barX, barY + barHeight + static_cast<int>(std::round(10.0f * uiScale)), smallScale, textColor,
+                 bytesLabel);
+    }
+
     int percent = static_cast<int>(std::round(progress * 100.0));
     std::string percentLabel = std::to_string(percent) + "%";
     drawText(renderer, modal.x + padding, modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
@@ -683,6 +869,9 @@ static void drawTransferScreen(SDL_Renderer* renderer, SDL_Window* window, const
         drawText(renderer, labelX, modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
                  smallScale, textColor, countLabel);
     }
+    std::string hint = transfer.cancelRequested ? "Cancelling..." : "B: Cancel";
+    drawText(renderer, modal.x + (modal.w - textWidth(smallScale, hint)) / 2,
+             modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)), smallScale, textColor, hint);
 
     SDL_RenderPresent(renderer);
 }
@@ -695,6 +884,9 @@ static void pumpTransferUI(TransferContext& ctx) {
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT && ctx.running) {
             *ctx.running = false;
+        } else if ((event.type == SDL_CONTROLLERBUTTONDOWN && event.cbutton.button == SDL_CONTROLLER_BUTTON_B) ||
+                   (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE)) {
+            ctx.transfer->cancelRequested = true;
         }
     }
     if (ctx.running && !*ctx.running) {
@@ -703,27 +895,40 @@ static void pumpTransferUI(TransferContext& ctx) {
     drawTransferScreen(ctx.renderer, ctx.window, *ctx.settings, *ctx.transfer);
 }
 
+// True once the user asked to stop the running operation (or quit the app).
+static bool transferCancelled(const TransferContext* ctx) {
+    return ctx && ((ctx->running && !*ctx->running) || (ctx->transfer && ctx->transfer->cancelRequested));
+}
+
 static void startTransferItem(TransferContext* ctx, const std::string& title, const std::string& item, bool resetCount = true) {
     if (!ctx || !ctx->transfer) {
         return;
     }
+    // A cancel belongs to the operation it was pressed in, which may span several items.
+    if (!ctx->transfer->active) {
+        ctx->transfer->cancelRequested = false;
+    }
     ctx->transfer->active = true;
     ctx->transfer->title = title;
     ctx->transfer->item = item;
     ctx->transfer->progress = 0.0;
+    ctx->transfer->itemProgress = -1.0;
     if (resetCount) {
         ctx->transfer->countCurrent = 0;
         ctx->transfer->countTotal = 0;
+        ctx->transfer->bytesDone = 0;
+        ctx->transfer->bytesTotal = 0;
+        ctx->transfer->started = std::chrono::steady_clock::now();
     }
     ctx->transfer->lastDraw = std::chrono::steady_clock::now() - std::chrono::milliseconds(100);
     pumpTransferUI(*ctx);
 }
 
-static void updateTransferProgress(TransferContext* ctx, double progress) {
+// Redraws the transfer screen and takes its input, at most every 33 ms.
+static void refreshTransferScreen(TransferContext* ctx) {
     if (!ctx || !ctx->transfer) {
         return;
     }
-    ctx->transfer->progress = progress;
     auto now = std::chrono::steady_clock::now();
     if (now - ctx->transfer->lastDraw > std::chrono::milliseconds(33)) {
         ctx->transfer->lastDraw = now;
@@ -731,17 +936,32 @@ static void updateTransferProgress(TransferContext* ctx, double progress) {
     }
 }
 
+static void updateTransferProgress(TransferContext* ctx, double progress) {
+    if (!ctx || !ctx->transfer) {
+        return;
+    }
+    ctx->transfer->progress = progress;
+    refreshTransferScreen(ctx);
+}
+
 static void updateTransferCount(TransferContext* ctx, int current, int total) {
     if (!ctx || !ctx->transfer) {
         return;
     }
     ctx->transfer->countCurrent = std::max(0, current);
     ctx->transfer->countTotal = std::max(0, total);
-    auto now = std::chrono::steady_clock::now();
-    if (now - ctx->transfer->lastDraw > std::chrono::milliseconds(33)) {
-        ctx->transfer->lastDraw = now;
-        pumpTransferUI(*ctx);
+    refreshTransferScreen(ctx);
+}
+
+// Byte-weighted progress; itemProgress < 0 hides the per-item bar.
+static void updateTransferBytes(TransferContext* ctx, std::uintmax_t done, std::uintmax_t total, double itemProgress) {
+    if (!ctx || !ctx->transfer) {
+        return;
     }
+    ctx->transfer->bytesDone = done;
+    ctx->transfer->bytesTotal = total;
+    ctx->transfer->itemProgress = itemProgress;
+    updateTransferProgress(ctx, total > 0 ? static_cast<double>(done) / static_cast<double>(total) : 0.0);
 }
 
 static void finishTransfer(TransferContext* ctx) {
@@ -924,6 +1144,76 @@ static float clampUiScale(float scale) {
     return std::clamp(scale, 0.5f, 2.5f);
 }
 
+static int stepFtpCacheLimit(int currentMb, int direction) {
+    static const int kSteps[] = {0, 256, 512, 1024, 2048, 4096, 8192, 16384};
+    const int count = static_cast<int>(sizeof(kSteps) / sizeof(kSteps[0]));
+    int index = 0;
+    while (index + 1 < count && kSteps[index] < currentMb) {
+        ++index;
+    }
+    index = std::clamp(index + direction, 0, count - 1);
+    return kSteps[index];
+}
+
+static const char* ftpTlsConfigValue(FtpTlsMode mode) {
+    switch (mode) {
+    case FtpTlsMode::Tls:
+        return "tls";
+    case FtpTlsMode::TlsTrustAny:
+        return "tls-any";
+    default:
+        return "off";
+    }
+}
+
+static std::string formatFtpTls(FtpTlsMode mode) {
+    switch (mode) {
+    case FtpTlsMode::Tls:
+        return "TLS";
+    case FtpTlsMode::TlsTrustAny:
+        return "TLS (any cert)";
+    default:
+        return "Off";
+    }
+}
+
+static FtpTlsMode stepFtpTls(FtpTlsMode mode, int direction, bool wrap) {
+    int next = static_cast<int>(mode) + direction;
+    if (wrap) {
+        next = (next + 3) % 3;
+    }
+    return static_cast<FtpTlsMode>(std::clamp(next, 0, 2));
+}
+
+static std::string formatMillis(double ms) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(ms < 10.0 ? 1 : 0) << ms;
+    return out.str();
+}
+
+static std::string formatRate(double bytesPerSecond) {
+    return formatBytes(static_cast<std::uintmax_t>(std::max(0.0, bytesPerSecond))) + "/s";
+}
+
+static std::string formatDuration(double seconds) {
+    long long total = static_cast<long long>(std::ceil(std::max(0.0, seconds)));
+    std::ostringstream out;
+    if (total >= 3600) {
+        out << total / 3600 << ":" << std::setw(2) << std::setfill('0') << (total / 60) % 60;
+    } else {
+        out << total / 60;
+    }
+    out << ":" << std::setw(2) << std::setfill('0') << total % 60;
+    return out.str();
+}
+
+static std::string formatCacheLimit(int limitMb) {
+    if (limitMb <= 0) {
+        return "Off";
+    }
+    return formatBytes(static_cast<std::uintmax_t>(limitMb) * 1024 * 1024);
+}
+
 static bool loadConfig(Settings& settings, const std::string& path, const fs::path& homePath) {
     std::ifstream file(path);
     if (!file.is_open()) {
@@ -957,6 +1247,12 @@ static bool loadConfig(Settings& settings, const std::string& path, const fs::pa
     }
     settings.ftpUser = unescapeXml(readTag(xml, "ftpUser"));
     settings.ftpPass = unescapeXml(readTag(xml, "ftpPass"));
+    std::string ftpTlsValue = toLower(readTag(xml, "ftpTls"));
+    if (ftpTlsValue == "tls") {
+        settings.ftpTls = FtpTlsMode::Tls;
+    } else if (ftpTlsValue == "tls-any") {
+        settings.ftpTls = FtpTlsMode::TlsTrustAny;
+    }
     settings.steamLaunchOptions = unescapeXml(readTag(xml, "steamLaunchOptions"));
     settings.steamCompatibilityToolVersion = unescapeXml(readTag(xml, "steamCompatibilityToolVersion"));
     std::string showHiddenValue = readTag(xml, "showHidden");
@@ -968,6 +1264,24 @@ static bool loadConfig(Settings& settings, const std::string& path, const fs::pa
         }
         settings.showHidden = (lowered == "true" || lowered == "1" || lowered == "yes");
     }
+    std::string ftpSearchDepthValue = readTag(xml, "ftpSearchDepth");
+    if (!ftpSearchDepthValue.empty()) {
+        try {
+            settings.ftpSearchDepth = std::clamp(std::stoi(ftpSearchDepthValue), 1, 32);
+        } catch (const std::exception&) {
+        }
+    }
+    std::string ftpVerifyValue = toLower(readTag(xml, "ftpVerify"));
+    if (!ftpVerifyValue.empty()) {
+        settings.ftpVerify = (ftpVerifyValue == "true" || ftpVerifyValue == "1" || ftpVerifyValue == "yes");
+    }
+    std::string ftpCacheValue = readTag(xml, "ftpCacheLimitMb");
+    if (!ftpCacheValue.empty()) {
+        try {
+            settings.ftpCacheLimitMb = std::max(0, std::stoi(ftpCacheValue));
+        } catch (const std::exception&) {
+        }
+    }
 
     std::string pane0 = unescapeXml(readTag(xml, "pane0"));
     std::string pane1 = unescapeXml(readTag(xml, "pane1"));
@@ -999,161 +1313,105 @@ static bool saveConfig(const Settings& settings, const Pane panes[2], const std:
     file << "  <ftpPort>" << settings.ftpPort << "</ftpPort>\n";
     file << "  <ftpUser>" << escapeXml(settings.ftpUser) << "</ftpUser>\n";
     file << "  <ftpPass>" << escapeXml(settings.ftpPass) << "</ftpPass>\n";
+    file << "  <ftpTls>" << ftpTlsConfigValue(settings.ftpTls) << "</ftpTls>\n";
     file << "  <steamLaunchOptions>" << escapeXml(settings.steamLaunchOptions) << "</steamLaunchOptions>\n";
     file << "  <steamCompatibilityToolVersion>" << escapeXml(settings.steamCompatibilityToolVersion)
          << "</steamCompatibilityToolVersion>\n";
     file << "  <showHidden>" << (settings.showHidden ? "true" : "false") << "</showHidden>\n";
+    file << "  <ftpCacheLimitMb>" << settings.ftpCacheLimitMb << "</ftpCacheLimitMb>\n";
+    file << "  <ftpSearchDepth>" << settings.ftpSearchDepth << "</ftpSearchDepth>\n";
+    file << "  <ftpVerify>" << (settings.ftpVerify ? "true" : "false") << "</ftpVerify>\n";
     file << "  <pane0>" << escapeXml(panes[0].lastLocalCwd.string()) << "</pane0>\n";
     file << "  <pane1>" << escapeXml(panes[1].lastLocalCwd.string()) << "</pane1>\n";
     file << "</config>\n";
     return true;
 }
 
-static void sortEntries(std::vector<Entry>& entries) {
-    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
-        if (a.isDir != b.isDir) {
-            return a.isDir > b.isDir;
-        }
-        return toLower(a.name) < toLower(b.name);
-    });
-}
-
-static std::string normalizeFtpPath(const std::string& path) {
-    if (path.empty()) {
-        return "/";
-    }
-    std::string normalized = path;
-    if (normalized[0] != '/') {
-        normalized = "/" + normalized;
-    }
-    while (normalized.size() > 1 && normalized.back() == '/') {
-        normalized.pop_back();
-    }
-    return normalized;
-}
-
-static std::string ftpJoinPath(const std::string& base, const std::string& name) {
-    std::string cleanBase = normalizeFtpPath(base);
-    if (cleanBase == "/") {
-        return cleanBase + name;
-    }
-    return cleanBase + "/" + name;
-}
-
-static std::string ftpParentPath(const std::string& path) {
-    std::string clean = normalizeFtpPath(path);
-    if (clean == "/") {
-        return "/";
-    }
-    size_t pos = clean.find_last_of('/');
-    if (pos == std::string::npos || pos == 0) {
-        return "/";
+static std::string hashHex(const std::string& text) {
+    std::uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
     }
-    return clean.substr(0, pos);
+    std::ostringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return out.str();
 }
 
-#ifdef USE_CURL
-struct CurlBuffer {
-    std::string data;
+struct FtpSearchMatch {
+    std::string dirPath;
+    Entry entry;
 };
 
-static size_t curlWriteCallback(void* ptr, size_t size, size_t nmemb, void* userdata) {
-    size_t total = size * nmemb;
-    CurlBuffer* buffer = static_cast<CurlBuffer*>(userdata);
-    buffer->data.append(static_cast<char*>(ptr), total);
-    return total;
-}
-
-static bool parseFtpListLine(const std::string& line, Entry& entry);
-
-static std::string urlEncodePath(const std::string& path) {
-    std::ostringstream out;
-    for (unsigned char c : path) {
-        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/') {
-            out << static_cast<char>(c);
-        } else {
-            out << '%' << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
-                << static_cast<int>(c) << std::nouppercase << std::dec;
-        }
-    }
-    return out.str();
-}
+// Shared between the UI thread and the crawler workers. Workers append matches as
+// they find them; the results pane reads them every frame.
+struct FtpSearchState {
+    std::string rootPath;
+    std::string pattern;
+    int maxDepth = 0;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::pair<std::string, int>> queue;
+    int busyWorkers = 0;
+    std::vector<FtpSearchMatch> matches;
+    std::atomic<bool> cancel {false};
+    std::atomic<bool> done {false};
+    std::atomic<int> foldersScanned {0};
+    std::atomic<int> folderErrors {0};
+    std::vector<std::thread> workers;
+};
 
-static std::string buildFtpUrl(const Settings& settings, const std::string& path, bool isDir) {
-    std::string url = "ftp://" + settings.ftpHost;
-    if (settings.ftpPort > 0 && settings.ftpPort != 21) {
-        url += ":" + std::to_string(settings.ftpPort);
-    }
-    std::string remotePath = normalizeFtpPath(path);
-    if (isDir && remotePath.back() != '/') {
-        remotePath.push_back('/');
-    }
-    url += urlEncodePath(remotePath);
-    return url;
-}
+static const int kFtpSearchConnections = 4;
 
-static bool configureFtpHandle(CURL* curl, const Settings& settings, std::string& error) {
-    if (!curl) {
-        error = "Failed to initialize CURL";
-        return false;
-    }
-    if (settings.ftpHost.empty()) {
-        error = "FTP host not set";
-        return false;
+static void stopFtpSearch(std::unique_ptr<FtpSearchState>& search) {
+    if (!search) {
+        return;
     }
-    curl_easy_setopt(curl, CURLOPT_USERNAME, settings.ftpUser.empty() ? "anonymous" : settings.ftpUser.c_str());
-    curl_easy_setopt(curl, CURLOPT_PASSWORD, settings.ftpPass.c_str());
-    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
-    return true;
-}
-
-static bool fetchFtpList(const Settings& settings, const std::string& path, std::string& output, std::string& error) {
-    CURL* curl = curl_easy_init();
-    if (!configureFtpHandle(curl, settings, error)) {
-        if (curl) {
-            curl_easy_cleanup(curl);
+    search->cancel = true;
+    search->wake.notify_all();
+    for (auto& worker : search->workers) {
+        if (worker.joinable()) {
+            worker.join();
         }
-        return false;
     }
+    search->workers.clear();
+    search->done = true;
+}
 
-    std::string url = buildFtpUrl(settings, path, true);
-    CurlBuffer buffer;
+struct FtpSpeedTestResult {
+    bool hasResult = false;
+    // TCP connect time of a fresh control connection, roughly one round trip.
+    double rttMs = 0.0;
+    double uploadBytesPerSecond = 0.0;
+    double downloadBytesPerSecond = 0.0;
+};
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-    curl_easy_setopt(curl, CURLOPT_DIRLISTONLY, 0L);
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "MLSD");
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+struct SyncItem {
+    std::string relPath;
+    bool isDir = false;
+    std::uintmax_t sizeBytes = 0;
+    bool hasSize = false;
+    std::int64_t modifiedTime = 0;
+    bool hasModified = false;
+};
 
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        curl_easy_cleanup(curl);
-        curl = curl_easy_init();
-        if (!configureFtpHandle(curl, settings, error)) {
-            if (curl) {
-                curl_easy_cleanup(curl);
-            }
-            return false;
-        }
-        buffer.data.clear();
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &buffer);
-        curl_easy_setopt(curl, CURLOPT_DIRLISTONLY, 0L);
-        curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
-        res = curl_easy_perform(curl);
-        if (res != CURLE_OK) {
-            error = curl_easy_strerror(res);
-            curl_easy_cleanup(curl);
-            return false;
-        }
-    }
-    curl_easy_cleanup(curl);
-    output = buffer.data;
-    return true;
-}
+// Mirror plan between a local folder and an FTP folder. Transfers are ordered
+// parents first; extraneous holds only the top-most target-only entries.
+struct SyncPlan {
+    bool toFtp = true;
+    fs::path localRoot;
+    std::string ftpRoot;
+    std::vector<SyncItem> transfers;
+    std::vector<SyncItem> extraneous;
+    std::uintmax_t transferBytes = 0;
+    std::uintmax_t extraneousBytes = 0;
+    int transferFiles = 0;
+    int unchanged = 0;
+    int conflicts = 0;
+    bool deleteExtraneous = false;
+};
 
+#ifdef USE_CURL
 static size_t curlWriteFileCallback(void* ptr, size_t size, size_t nmemb, void* userdata) {
     FILE* file = static_cast<FILE*>(userdata);
     return std::fwrite(ptr, size, nmemb, file);
@@ -1184,7 +1442,7 @@ static int curlProgressCallback(void* clientp, curl_off_t dltotal, curl_off_t dl
     }
     double progress = total > 0.0 ? (now / total) : 0.0;
     updateTransferProgress(data->ctx, progress);
-    if (data->ctx->running && !*data->ctx->running) {
+    if (transferCancelled(data->ctx)) {
         return 1;
     }
     return 0;
@@ -1217,6 +1475,7 @@ static bool ftpDownloadFile(const Settings& settings, const std::string& remoteP
     curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &progressData);
 
     CURLcode res = curl_easy_perform(curl);
+    recordFtpTiming(settings, "Download", curl, res);
     std::fclose(file);
     if (res != CURLE_OK) {
         error = curl_easy_strerror(res);
@@ -1265,6 +1524,7 @@ static bool ftpUploadFile(const Settings& settings, const fs::path& localPath, c
     curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &progressData);
 
     CURLcode res = curl_easy_perform(curl);
+    recordFtpTiming(settings, "Upload", curl, res);
     std::fclose(file);
     if (res != CURLE_OK) {
         error = curl_easy_strerror(res);
@@ -1278,440 +1538,580 @@ static bool ftpUploadFile(const Settings& settings, const fs::path& localPath, c
     return true;
 }
 
-static bool ftpDeletePath(const Settings& settings, const std::string& remotePath, bool isDir, std::string& error) {
-    CURL* curl = curl_easy_init();
-    if (!configureFtpHandle(curl, settings, error)) {
-        if (curl) {
-            curl_easy_cleanup(curl);
+static bool globMatch(const char* pattern, const char* text) {
+    const char* starPattern = nullptr;
+    const char* starText = nullptr;
+    while (*text) {
+        if (*pattern == '?' || *pattern == *text) {
+            ++pattern;
+            ++text;
+        } else if (*pattern == '*') {
+            starPattern = pattern++;
+            starText = text;
+        } else if (starPattern) {
+            pattern = starPattern + 1;
+            text = ++starText;
+        } else {
+            return false;
         }
-        return false;
     }
+    while (*pattern == '*') {
+        ++pattern;
+    }
+    return *pattern == '\0';
+}
 
-    std::string url = buildFtpUrl(settings, "/", true);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
-
-    std::string command = std::string(isDir ? "RMD " : "DELE ") + normalizeFtpPath(remotePath);
-    struct curl_slist* quote = nullptr;
-    quote = curl_slist_append(quote, command.c_str());
-    curl_easy_setopt(curl, CURLOPT_QUOTE, quote);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(quote);
-    if (res != CURLE_OK) {
-        error = curl_easy_strerror(res);
-        curl_easy_cleanup(curl);
-        return false;
+// Patterns with * or ? are matched as globs against the whole name, anything else
+// as a substring. Both are case-insensitive.
+static bool searchPatternMatches(const std::string& loweredPattern, const std::string& name) {
+    std::string loweredName = toLower(name);
+    if (loweredPattern.find_first_of("*?") != std::string::npos) {
+        return globMatch(loweredPattern.c_str(), loweredName.c_str());
     }
-    curl_easy_cleanup(curl);
-    return true;
+    return loweredName.find(loweredPattern) != std::string::npos;
 }
 
-static bool ftpRenamePath(const Settings& settings, const std::string& fromPath, const std::string& toPath, std::string& error) {
+static void ftpSearchWorker(FtpSearchState* search, Settings settings) {
     CURL* curl = curl_easy_init();
-    if (!configureFtpHandle(curl, settings, error)) {
-        if (curl) {
-            curl_easy_cleanup(curl);
+    std::unique_lock<std::mutex> lock(search->mutex);
+    while (true) {
+        search->wake.wait(lock, [&]() {
+            return search->cancel.load() || !search->queue.empty() || search->busyWorkers == 0;
+        });
+        if (search->cancel.load() || (search->queue.empty() && search->busyWorkers == 0)) {
+            break;
         }
-        return false;
-    }
-
-    std::string url = buildFtpUrl(settings, "/", true);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+        std::pair<std::string, int> item = search->queue.front();
+        search->queue.pop_front();
+        ++search->busyWorkers;
+        lock.unlock();
 
-    std::string rnfr = "RNFR " + normalizeFtpPath(fromPath);
-    std::string rnto = "RNTO " + normalizeFtpPath(toPath);
-    struct curl_slist* quote = nullptr;
-    quote = curl_slist_append(quote, rnfr.c_str());
-    quote = curl_slist_append(quote, rnto.c_str());
-    curl_easy_setopt(curl, CURLOPT_QUOTE, quote);
+        std::string listing;
+        std::string error;
+        std::vector<Entry> entries;
+        bool ok = curl && fetchFtpListOn(curl, settings, item.first, listing, error, &search->cancel);
+        if (ok) {
+            parseFtpListing(listing, entries);
+            storeFtpListing(settings, item.first, entries, true);
+            ++search->foldersScanned;
+        } else if (!search->cancel.load()) {
+            ++search->folderErrors;
+        }
 
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(quote);
-    if (res != CURLE_OK) {
-        error = curl_easy_strerror(res);
+        lock.lock();
+        --search->busyWorkers;
+        for (const auto& entry : entries) {
+            if (!settings.showHidden && !entry.name.empty() && entry.name[0] == '.') {
+                continue;
+            }
+            if (searchPatternMatches(search->pattern, entry.name)) {
+                search->matches.push_back({item.first, entry});
+            }
+            if (entry.isDir && item.second < search->maxDepth) {
+                search->queue.emplace_back(ftpJoinPath(item.first, entry.name), item.second + 1);
+            }
+        }
+        search->wake.notify_all();
+    }
+    if (!search->cancel.load()) {
+        search->done = true;
+    }
+    search->wake.notify_all();
+    lock.unlock();
+    if (curl) {
         curl_easy_cleanup(curl);
-        return false;
     }
-    curl_easy_cleanup(curl);
-    return true;
 }
 
-static bool listFtpEntries(const Settings& settings, const std::string& path, std::vector<Entry>& entries,
-                           std::string& error, bool includeHidden) {
-    std::string listing;
-    if (!fetchFtpList(settings, path, listing, error)) {
+// Crawls breadth-first from rootPath: every worker owns one FTP connection and pulls
+// the shallowest pending folder from the shared queue.
+static std::unique_ptr<FtpSearchState> startFtpSearch(const Settings& settings, const std::string& rootPath,
+                                                      const std::string& pattern) {
+    auto search = std::make_unique<FtpSearchState>();
+    search->rootPath = normalizeFtpPath(rootPath);
+    search->pattern = toLower(pattern);
+    search->maxDepth = std::max(0, settings.ftpSearchDepth);
+    search->queue.emplace_back(search->rootPath, 0);
+    FtpSearchState* state = search.get();
+    for (int i = 0; i < kFtpSearchConnections; ++i) {
+        search->workers.emplace_back([state, settings]() {
+            ftpSearchWorker(state, settings);
+        });
+    }
+    return search;
+}
+
+// Seconds of slack when comparing timestamps; FAT volumes only keep 2s precision.
+static const std::int64_t kSyncTimeTolerance = 2;
+
+static std::int64_t fileTimeToUnix(fs::file_time_type time) {
+    auto system = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
+        time - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
+    return std::chrono::round<std::chrono::seconds>(system.time_since_epoch()).count();
+}
+
+static fs::file_time_type unixToFileTime(std::int64_t seconds) {
+    std::chrono::system_clock::time_point system {std::chrono::seconds(seconds)};
+    return std::chrono::time_point_cast<fs::file_time_type::duration>(
+        system - std::chrono::system_clock::now() + fs::file_time_type::clock::now());
+}
+
+static std::string syncJoinRel(const std::string& rel, const std::string& name) {
+    return rel.empty() ? name : rel + "/" + name;
+}
+
+static bool syncIsUnder(const std::string& rel, const std::string& dir) {
+    return rel.size() > dir.size() && rel.compare(0, dir.size(), dir) == 0 && rel[dir.size()] == '/';
+}
+
+static bool scanLocalSyncTree(const fs::path& root, const std::string& rel, bool includeHidden,
+                              std::map<std::string, SyncItem>& items, std::string& error) {
+    std::error_code ec;
+    fs::directory_iterator it(rel.empty() ? root : root / rel, ec);
+    if (ec) {
+        error = "Failed to read " + (rel.empty() ? root.string() : rel);
         return false;
     }
-    std::istringstream lines(listing);
-    std::string line;
-    while (std::getline(lines, line)) {
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
+    for (const auto& child : it) {
+        std::string name = child.path().filename().string();
+        if (!includeHidden && !name.empty() && name[0] == '.') {
+            continue;
         }
-        Entry entry;
-        if (parseFtpListLine(line, entry)) {
-            if (!includeHidden && !entry.name.empty() && entry.name[0] == '.') {
+        SyncItem item;
+        item.relPath = syncJoinRel(rel, name);
+        // Links are not followed into folders: Wine prefixes alone hold dosdevices/z: -> /,
+        // which would recurse without end. A link to a file syncs as that file.
+        item.isDir = fs::is_directory(child.symlink_status(ec));
+        if (!item.isDir) {
+            if (!child.is_regular_file(ec)) {
                 continue;
             }
-            entries.push_back(entry);
+            item.sizeBytes = child.file_size(ec);
+            item.hasSize = !ec;
+            fs::file_time_type time = child.last_write_time(ec);
+            if (!ec) {
+                item.modifiedTime = fileTimeToUnix(time);
+                item.hasModified = true;
+            }
+        }
+        items[item.relPath] = item;
+        if (item.isDir && !scanLocalSyncTree(root, item.relPath, includeHidden, items, error)) {
+            return false;
         }
     }
-    sortEntries(entries);
     return true;
 }
 
-static bool ftpCreateDir(const Settings& settings, const std::string& remotePath, std::string& error) {
-    CURL* curl = curl_easy_init();
-    if (!configureFtpHandle(curl, settings, error)) {
-        if (curl) {
-            curl_easy_cleanup(curl);
+static bool scanFtpSyncTree(const Settings& settings, const std::string& root, const std::string& rel, bool includeHidden,
+                            TransferContext* ctx, std::map<std::string, SyncItem>& items, std::string& error) {
+    if (ctx) {
+        startTransferItem(ctx, "Comparing folders", ftpJoinPath(root, rel));
+        if (transferCancelled(ctx)) {
+            error = "Cancelled";
+            return false;
         }
+    }
+    std::vector<Entry> entries;
+    if (!listFtpEntries(settings, rel.empty() ? root : ftpJoinPath(root, rel), entries, error, includeHidden)) {
         return false;
     }
+    for (const auto& entry : entries) {
+        SyncItem item;
+        item.relPath = syncJoinRel(rel, entry.name);
+        item.isDir = entry.isDir;
+        item.sizeBytes = entry.sizeBytes;
+        item.hasSize = entry.hasSize;
+        item.modifiedTime = entry.modifiedTime;
+        item.hasModified = entry.hasModified;
+        items[item.relPath] = item;
+        if (item.isDir && !scanFtpSyncTree(settings, root, item.relPath, includeHidden, ctx, items, error)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    std::string url = buildFtpUrl(settings, "/", true);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
-
-    std::string command = "MKD " + normalizeFtpPath(remotePath);
-    struct curl_slist* quote = nullptr;
-    quote = curl_slist_append(quote, command.c_str());
-    curl_easy_setopt(curl, CURLOPT_QUOTE, quote);
-
-    CURLcode res = curl_easy_perform(curl);
-    curl_slist_free_all(quote);
-    if (res != CURLE_OK) {
-        error = curl_easy_strerror(res);
-        curl_easy_cleanup(curl);
-        return false;
-    }
-    curl_easy_cleanup(curl);
-    return true;
-}
-
-static bool ftpEnsureDir(const Settings& settings, const std::string& remotePath, std::string& error) {
-    std::string clean = normalizeFtpPath(remotePath);
-    if (clean == "/") {
+// A file is sent when the target lacks it, the sizes differ, or the source is
+// newer. "Newer" rather than "different" keeps uploads stable: servers stamp
+// uploaded files with the upload time, not the local mtime.
+static bool syncItemChanged(const SyncItem& src, const SyncItem& dst) {
+    if (src.hasSize && dst.hasSize && src.sizeBytes != dst.sizeBytes) {
         return true;
     }
-    size_t pos = 1;
-    while (true) {
-        pos = clean.find('/', pos);
-        std::string segment = (pos == std::string::npos) ? clean : clean.substr(0, pos);
-        std::string cmdError;
-        ftpCreateDir(settings, segment, cmdError);
-        if (pos == std::string::npos) {
-            break;
-        }
-        ++pos;
-    }
-    return true;
+    return src.hasModified && dst.hasModified && src.modifiedTime > dst.modifiedTime + kSyncTimeTolerance;
 }
 
-static bool ftpEntryExists(const Settings& settings, const std::string& dirPath, const std::string& name, bool& isDir, std::string& error) {
-    error.clear();
-    std::vector<Entry> entries;
-    if (!listFtpEntries(settings, dirPath, entries, error, true)) {
-        return false;
-    }
-    for (const auto& entry : entries) {
-        if (entry.name == name) {
-            isDir = entry.isDir;
-            return true;
-        }
-    }
-    return false;
-}
+static bool buildSyncPlan(const Settings& settings, const fs::path& localRoot, const std::string& ftpRoot, bool toFtp,
+                          TransferContext* ctx, SyncPlan& plan, std::string& error) {
+    plan = SyncPlan{};
+    plan.toFtp = toFtp;
+    plan.localRoot = localRoot;
+    plan.ftpRoot = normalizeFtpPath(ftpRoot);
 
-static bool ftpDownloadDirectory(const Settings& settings, const std::string& remotePath, const fs::path& localPath,
-                                 TransferContext* ctx, const std::string& title, std::string& error) {
-    if (fs::exists(localPath)) {
-        error = "Target already exists";
-        return false;
+    std::map<std::string, SyncItem> localItems;
+    std::map<std::string, SyncItem> ftpItems;
+    if (ctx) {
+        startTransferItem(ctx, "Comparing folders", localRoot.string());
     }
-    {
-        std::error_code ec;
-        if (!fs::create_directories(localPath, ec)) {
-            error = "Failed to create local directory";
-            return false;
-        }
+    if (!scanLocalSyncTree(localRoot, "", settings.showHidden, localItems, error)) {
+        return false;
     }
-
-    std::vector<Entry> entries;
-    if (!listFtpEntries(settings, remotePath, entries, error, true)) {
+    invalidateFtpListings(settings, plan.ftpRoot);
+    if (!scanFtpSyncTree(settings, plan.ftpRoot, "", settings.showHidden, ctx, ftpItems, error)) {
         return false;
     }
-    for (const auto& entry : entries) {
-        std::string childRemote = ftpJoinPath(remotePath, entry.name);
-        fs::path childLocal = localPath / entry.name;
-        if (entry.isDir) {
-            if (!ftpDownloadDirectory(settings, childRemote, childLocal, ctx, title, error)) {
-                return false;
-            }
-        } else {
-            if (fs::exists(childLocal)) {
-                error = "Target already exists";
-                return false;
+
+    const auto& srcItems = toFtp ? localItems : ftpItems;
+    const auto& dstItems = toFtp ? ftpItems : localItems;
+    std::vector<std::string> conflictDirs;
+    auto underConflict = [&](const std::string& rel) {
+        for (const auto& dir : conflictDirs) {
+            if (syncIsUnder(rel, dir)) {
+                return true;
             }
-            if (ctx) {
-                startTransferItem(ctx, title, entry.name);
+        }
+        return false;
+    };
+
+    for (const auto& pair : srcItems) {
+        const SyncItem& src = pair.second;
+        if (underConflict(src.relPath)) {
+            continue;
+        }
+        auto found = dstItems.find(src.relPath);
+        if (found == dstItems.end()) {
+            plan.transfers.push_back(src);
+            if (!src.isDir) {
+                ++plan.transferFiles;
+                plan.transferBytes += src.sizeBytes;
             }
-            if (!ftpDownloadFile(settings, childRemote, childLocal, ctx, error)) {
-                return false;
+            continue;
+        }
+        const SyncItem& dst = found->second;
+        if (src.isDir != dst.isDir) {
+            ++plan.conflicts;
+            conflictDirs.push_back(src.relPath);
+        } else if (!src.isDir) {
+            if (syncItemChanged(src, dst)) {
+                plan.transfers.push_back(src);
+                ++plan.transferFiles;
+                plan.transferBytes += src.sizeBytes;
+            } else {
+                ++plan.unchanged;
             }
         }
     }
-    return true;
-}
 
-static bool ftpUploadDirectory(const Settings& settings, const fs::path& localPath, const std::string& remotePath,
-                               TransferContext* ctx, const std::string& title, std::string& error) {
-    if (!fs::is_directory(localPath)) {
-        error = "Source is not a directory";
-        return false;
-    }
-    if (!ftpEnsureDir(settings, remotePath, error)) {
-        return false;
+    std::string lastExtraneous;
+    for (const auto& pair : dstItems) {
+        const SyncItem& dst = pair.second;
+        if (srcItems.count(dst.relPath) || underConflict(dst.relPath)) {
+            continue;
+        }
+        if (!dst.isDir) {
+            plan.extraneousBytes += dst.sizeBytes;
+        }
+        if (!lastExtraneous.empty() && syncIsUnder(dst.relPath, lastExtraneous)) {
+            continue;
+        }
+        plan.extraneous.push_back(dst);
+        lastExtraneous = dst.relPath;
     }
+    return true;
+}
 
-    for (const auto& item : fs::directory_iterator(localPath)) {
-        const fs::path& childPath = item.path();
-        std::string childRemote = ftpJoinPath(remotePath, childPath.filename().string());
-        if (item.is_directory()) {
-            if (!ftpUploadDirectory(settings, childPath, childRemote, ctx, title, error)) {
-                return false;
+static bool executeSyncPlan(const Settings& settings, const SyncPlan& plan, TransferContext* ctx, int& filesDone,
+                            std::string& error) {
+    const std::string title = "Syncing";
+    filesDone = 0;
+    int total = plan.transferFiles + (plan.deleteExtraneous ? static_cast<int>(plan.extraneous.size()) : 0);
+    int step = 0;
+    bool ok = true;
+    for (const auto& item : plan.transfers) {
+        if (transferCancelled(ctx)) {
+            error = "Cancelled";
+            ok = false;
+            break;
+        }
+        fs::path localPath = plan.localRoot / fs::path(item.relPath);
+        std::string remotePath = ftpJoinPath(plan.ftpRoot, item.relPath);
+        if (item.isDir) {
+            std::error_code ec;
+            if (plan.toFtp) {
+                if (!ftpEnsureDir(settings, remotePath, error)) {
+                    ok = false;
+                    break;
+                }
+            } else if (!fs::create_directories(localPath, ec) && ec) {
+                error = "Failed to create " + item.relPath;
+                ok = false;
+                break;
             }
-        } else if (item.is_regular_file()) {
-            if (ctx) {
-                startTransferItem(ctx, title, childPath.filename().string());
+            continue;
+        }
+        if (ctx) {
+            startTransferItem(ctx, title, item.relPath, false);
+            updateTransferCount(ctx, ++step, total);
+        }
+        if (plan.toFtp) {
+            if (!ftpUploadFile(settings, localPath, remotePath, ctx, error)) {
+                ok = false;
+                break;
             }
-            if (!ftpUploadFile(settings, childPath, childRemote, ctx, error)) {
-                return false;
+        } else {
+            // Download beside the old copy so a failed transfer never clobbers it.
+            fs::path partPath = localPath;
+            partPath += ".part";
+            if (!ftpDownloadFile(settings, remotePath, partPath, ctx, error)) {
+                std::error_code ec;
+                fs::remove(partPath, ec);
+                ok = false;
+                break;
+            }
+            std::error_code ec;
+            fs::rename(partPath, localPath, ec);
+            if (ec) {
+                fs::remove(partPath, ec);
+                error = "Failed to replace " + item.relPath;
+                ok = false;
+                break;
+            }
+            if (item.hasModified) {
+                fs::last_write_time(localPath, unixToFileTime(item.modifiedTime), ec);
             }
         }
+        ++filesDone;
     }
-    return true;
-}
 
-static bool ftpDeleteRecursive(const Settings& settings, const std::string& remotePath, std::string& error) {
-    std::vector<Entry> entries;
-    if (!listFtpEntries(settings, remotePath, entries, error, true)) {
-        return false;
-    }
-    for (const auto& entry : entries) {
-        std::string childRemote = ftpJoinPath(remotePath, entry.name);
-        if (entry.isDir) {
-            if (!ftpDeleteRecursive(settings, childRemote, error)) {
-                return false;
+    if (ok && plan.deleteExtraneous) {
+        for (const auto& item : plan.extraneous) {
+            if (ctx) {
+                startTransferItem(ctx, "Removing extraneous", item.relPath, false);
+                updateTransferCount(ctx, ++step, total);
             }
-        } else {
-            if (!ftpDeletePath(settings, childRemote, false, error)) {
-                return false;
+            if (plan.toFtp) {
+                std::string remotePath = ftpJoinPath(plan.ftpRoot, item.relPath);
+                ok = item.isDir ? ftpDeleteRecursive(settings, remotePath, error)
+                                : ftpDeletePath(settings, remotePath, false, error);
+            } else {
+                std::error_code ec;
+                fs::remove_all(plan.localRoot / fs::path(item.relPath), ec);
+                if (ec) {
+                    error = "Failed to remove " + item.relPath;
+                    ok = false;
+                }
+            }
+            if (!ok) {
+                break;
             }
         }
     }
-    return ftpDeletePath(settings, remotePath, true, error);
-}
 
+    invalidateFtpListings(settings, plan.ftpRoot);
+    return ok;
+}
 #endif
 
-static bool copyLocalFileWithProgress(const fs::path& src, const fs::path& dst, TransferContext* ctx,
-                                      const std::string& title, const std::string& label, bool resetCount,
-                                      std::string& error) {
-    if (fs::exists(dst)) {
-        error = "Target already exists";
-        return false;
-    }
-    std::ifstream input(src, std::ios::binary);
-    if (!input.is_open()) {
-        error = "Failed to open source file";
+static bool parseUnzipOutputLine(const std::string& line, std::string& item) {
+    std::string trimmed = trimWhitespace(line);
+    if (trimmed.empty()) {
         return false;
     }
-    std::ofstream output(dst, std::ios::binary);
-    if (!output.is_open()) {
-        error = "Failed to open target file";
+    size_t colon = trimmed.find(':');
+    if (colon == std::string::npos) {
         return false;
     }
-
-    std::uintmax_t totalSize = 0;
-    try {
-        totalSize = fs::file_size(src);
-    } catch (const fs::filesystem_error&) {
+    std::string prefix = toLower(trimWhitespace(trimmed.substr(0, colon)));
+    if (prefix == "inflating" || prefix == "extracting" || prefix == "creating") {
+        item = trimWhitespace(trimmed.substr(colon + 1));
+        return !item.empty();
     }
+    return false;
+}
 
-    if (ctx) {
-        startTransferItem(ctx, title, label, resetCount);
-    }
+// What an update extraction wrote, and what it found already in place and left alone.
+struct ExtractSummary {
+    int filesWritten = 0;
+    int filesSkipped = 0;
+    std::uintmax_t bytesWritten = 0;
+    std::uintmax_t bytesSkipped = 0;
+};
 
-    const size_t bufferSize = 64 * 1024;
-    std::vector<char> buffer(bufferSize);
-    std::uintmax_t totalRead = 0;
-    while (input) {
-        input.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
-        std::streamsize bytes = input.gcount();
-        if (bytes <= 0) {
-            break;
-        }
-        output.write(buffer.data(), bytes);
-        if (!output) {
-            error = "Failed to write target file";
-            return false;
-        }
-        totalRead += static_cast<std::uintmax_t>(bytes);
-        if (ctx && totalSize > 0) {
-            updateTransferProgress(ctx, static_cast<double>(totalRead) / static_cast<double>(totalSize));
+// Takes back what a cancelled extraction wrote below destDir. The built-in extractors
+// report each path they create (see created()), and exactly those are removed. unzip
+// and unrar report nothing, so their entry names are added instead: for each, the
+// outermost part of its path that did not exist beforehand is removed, so new folders
+// go as a whole while files that were only overwritten stay.
+class ExtractCleanup {
+public:
+    explicit ExtractCleanup(const fs::path& destDir) : destDir_(destDir) {}
+
+    void add(const std::string& name) {
+        std::string relPath;
+        if (!safeRelativePath(name, relPath) || relPath.empty()) {
+            return;
         }
-        if (ctx && ctx->running && !*ctx->running) {
-            error = "Transfer cancelled";
-            return false;
+        std::string prefix;
+        for (size_t start = 0; start <= relPath.size();) {
+            size_t slash = relPath.find('/', start);
+            size_t end = slash == std::string::npos ? relPath.size() : slash;
+            prefix = relPath.substr(0, end);
+            if (fresh_.count(prefix) > 0) {
+                return;
+            }
+            if (existing_.count(prefix) == 0) {
+                std::error_code ec;
+                if (!fs::exists(fs::symlink_status(destDir_ / fs::u8path(prefix), ec))) {
+                    fresh_.insert(prefix);
+                    return;
+                }
+                existing_.insert(prefix);
+            }
+            start = end + 1;
         }
     }
-    if (ctx) {
-        updateTransferProgress(ctx, 1.0);
-    }
-    return true;
-}
 
-static bool copyLocalDirectoryWithProgress(const fs::path& srcDir, const fs::path& dstDir, TransferContext* ctx,
-                                           const std::string& title, std::string& error) {
-    if (fs::exists(dstDir)) {
-        error = "Target already exists";
-        return false;
+    CreatedPaths* created() {
+        return &created_;
     }
-    std::error_code ec;
-    if (!fs::create_directories(dstDir, ec)) {
-        error = "Failed to create target directory";
-        return false;
+
+    void undo() {
+        created_.undo();
+        std::error_code ec;
+        for (const std::string& relPath : fresh_) {
+            fs::remove_all(destDir_ / fs::u8path(relPath), ec);
+        }
+        fresh_.clear();
     }
-    int totalFiles = 0;
-    for (const auto& entry : fs::recursive_directory_iterator(srcDir, ec)) {
-        if (ec) {
-            break;
+
+private:
+    fs::path destDir_;
+    CreatedPaths created_;
+    std::set<std::string> fresh_;
+    std::unordered_set<std::string> existing_;
+};
+
+// Runs the native extractor on a worker pool while this (UI) thread keeps the progress
+// screen alive and turns a quit request into a cancel. With update, files that are
+// already on disk unchanged are skipped and counted there.
+static bool extractZipNative(const ZipArchive& archive, const fs::path& zipPath, const fs::path& destDir,
+                             const std::vector<bool>* include, TransferContext* ctx, std::string& error,
+                             ExtractSummary* update = nullptr, ExtractCleanup* cleanup = nullptr) {
+    ExtractProgress progress;
+    progress.created = cleanup ? cleanup->created() : nullptr;
+    auto summarize = [&](bool ok) {
+        if (update) {
+            update->filesSkipped = progress.filesSkipped;
+            update->bytesSkipped = progress.bytesSkipped;
+            update->filesWritten = progress.filesDone - progress.filesSkipped;
+            update->bytesWritten = progress.bytesDone - progress.bytesSkipped;
         }
-        if (entry.is_regular_file(ec)) {
+        return ok;
+    };
+    int totalFiles = 0;
+    std::uintmax_t totalBytes = 0;
+    const std::vector<ZipEntry>& entries = archive.entries();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (!entries[i].isDir && (!include || (*include)[i])) {
             ++totalFiles;
+            totalBytes += entries[i].uncompressedSize;
         }
     }
-    int copiedFiles = 0;
-    if (ctx && totalFiles > 0) {
-        updateTransferCount(ctx, 0, totalFiles);
+    if (!ctx) {
+        return summarize(extractZipArchive(archive, destDir, include, 0, progress, error, update != nullptr));
     }
-    ec.clear();
-    for (const auto& entry : fs::recursive_directory_iterator(srcDir, ec)) {
-        if (ec) {
-            break;
+    startTransferItem(ctx, update ? "Updating" : "Extracting", zipPath.filename().string());
+    updateTransferCount(ctx, 0, totalFiles);
+
+    std::atomic<bool> done {false};
+    bool ok = false;
+    std::thread runner([&]() {
+        ok = extractZipArchive(archive, destDir, include, 0, progress, error, update != nullptr);
+        done = true;
+    });
+    while (!done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+        if (transferCancelled(ctx)) {
+            progress.cancel = true;
         }
-        const fs::path& path = entry.path();
-        fs::path relative = fs::relative(path, srcDir, ec);
-        if (ec) {
-            relative = path.filename();
-        }
-        fs::path target = dstDir / relative;
-        if (entry.is_directory()) {
-            std::error_code dirEc;
-            fs::create_directories(target, dirEc);
-        } else if (entry.is_regular_file()) {
-            if (!copyLocalFileWithProgress(path, target, ctx, title, relative.string(), false, error)) {
-                return false;
-            }
-            ++copiedFiles;
-            if (ctx && totalFiles > 0) {
-                updateTransferCount(ctx, copiedFiles, totalFiles);
-            }
+        ExtractActivity current;
+        double itemProgress = -1.0;
+        if (ctx->transfer && progress.current(current)) {
+            ctx->transfer->item = current.name;
+            itemProgress = current.size > 0 ? static_cast<double>(current.done) / static_cast<double>(current.size) : 1.0;
         }
+        updateTransferCount(ctx, progress.filesDone, totalFiles);
+        updateTransferBytes(ctx, progress.bytesDone, totalBytes, itemProgress);
     }
-    return true;
-}
-
-static bool copyLocalPathWithProgress(const fs::path& src, const fs::path& dst, TransferContext* ctx,
-                                      const std::string& title, std::string& error) {
-    if (fs::is_directory(src)) {
-        return copyLocalDirectoryWithProgress(src, dst, ctx, title, error);
+    runner.join();
+    if (ok) {
+        updateTransferBytes(ctx, totalBytes, totalBytes, -1.0);
     }
-    return copyLocalFileWithProgress(src, dst, ctx, title, src.filename().string(), true, error);
+    return summarize(ok);
 }
 
-static int countZipEntries(const fs::path& zipPath, std::string& error) {
-#ifdef _WIN32
-    std::string command = "tar -tf " + quoteArg(zipPath.string()) + " 2>&1";
-    FILE* pipe = openPipe(command, "r");
-    if (!pipe) {
-        error = "Failed to run tar";
-        return -1;
-    }
-    int count = 0;
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        std::string line = trimWhitespace(buffer);
-        if (!line.empty() && line.rfind("tar:", 0) != 0 && line.rfind("bsdtar:", 0) != 0) {
-            ++count;
-        }
-    }
-    int status = closePipe(pipe);
-    if (status != 0) {
-        error = "tar failed";
-        return -1;
+// names limits the extraction to those entries (archive paths as listed); nullptr
+// extracts everything. update (see extractZipNative) needs the native extractor.
+// cleanup learns what the run writes.
+static bool extractZipWithProgress(const fs::path& zipPath, const fs::path& destDir,
+                                   const std::vector<std::string>* names, TransferContext* ctx, std::string& error,
+                                   ExtractSummary* update = nullptr, ExtractCleanup* cleanup = nullptr) {
+    if (!fs::exists(destDir)) {
+        error = "Target directory not found";
+        return false;
     }
-    return count;
-#else
-    std::string command = "unzip -Z -1 " + quoteArg(zipPath.string()) + " 2>&1";
-    FILE* pipe = openPipe(command, "r");
-    if (!pipe) {
-        error = "Failed to run unzip";
-        return -1;
+
+    // Archives using methods this build cannot inflate (or encryption) go to unzip/tar.
+    ZipArchive archive;
+    std::string openError;
+    bool listed = archive.open(zipPath, openError);
+    std::unordered_set<std::string> wanted;
+    if (names) {
+        wanted.insert(names->begin(), names->end());
     }
-    int count = 0;
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        std::string line = trimWhitespace(buffer);
-        if (!line.empty()) {
-            ++count;
+    std::vector<bool> include;
+    if (listed && names) {
+        for (const ZipEntry& entry : archive.entries()) {
+            include.push_back(wanted.count(entry.name) > 0);
         }
     }
-    int status = closePipe(pipe);
-    if (status != 0) {
-        error = "unzip failed";
-        return -1;
-    }
-    return count;
-#endif
-}
-
-static bool parseUnzipOutputLine(const std::string& line, std::string& item) {
-    std::string trimmed = trimWhitespace(line);
-    if (trimmed.empty()) {
-        return false;
+    if (listed && zipExtractSupported(archive)) {
+        return extractZipNative(archive, zipPath, destDir, names ? &include : nullptr, ctx, error, update, cleanup);
     }
-    size_t colon = trimmed.find(':');
-    if (colon == std::string::npos) {
+    if (update) {
+        error = listed ? "Archive needs unzip; use Extract" : openError;
         return false;
     }
-    std::string prefix = toLower(trimWhitespace(trimmed.substr(0, colon)));
-    if (prefix == "inflating" || prefix == "extracting" || prefix == "creating") {
-        item = trimWhitespace(trimmed.substr(colon + 1));
-        return !item.empty();
-    }
-    return false;
-}
-
-static bool extractZipWithProgress(const fs::path& zipPath, const fs::path& destDir, TransferContext* ctx,
-                                   std::string& error) {
-    if (!fs::exists(destDir)) {
-        error = "Target directory not found";
-        return false;
+    if (cleanup && names) {
+        for (const std::string& name : *names) {
+            cleanup->add(name);
+        }
+    } else if (cleanup && listed) {
+        for (const ZipEntry& entry : archive.entries()) {
+            cleanup->add(entry.name);
+        }
     }
 
+    // The tool only reports entry names, so progress is weighted by the sizes from the
+    // central directory: each reported entry completes the one before it.
     int totalEntries = 0;
-    std::string listError;
-    int count = countZipEntries(zipPath, listError);
-    if (count > 0) {
-        totalEntries = count;
+    std::uintmax_t totalBytes = 0;
+    std::unordered_map<std::string, std::uintmax_t> entrySizes;
+    if (listed) {
+        for (const ZipEntry& entry : archive.entries()) {
+            if (!names || wanted.count(entry.name) > 0) {
+                ++totalEntries;
+                totalBytes += entry.uncompressedSize;
+                entrySizes[entry.name] = entry.uncompressedSize;
+            }
+        }
     }
+    std::string destPrefix = destDir.generic_string();
+    if (!destPrefix.empty() && destPrefix.back() != '/') {
+        destPrefix += '/';
+    }
+    std::uintmax_t bytesDone = 0;
+    std::uintmax_t pendingBytes = 0;
 
     if (ctx) {
         startTransferItem(ctx, "Extracting", zipPath.filename().string());
@@ -1721,12 +2121,18 @@ static bool extractZipWithProgress(const fs::path& zipPath, const fs::path& dest
     }
 
 #ifdef _WIN32
-    std::string command = "tar -xf " + quoteArg(zipPath.string()) + " -C " + quoteArg(destDir.string()) + " -v 2>&1";
+    std::string command = "tar -xf " + quoteArg(zipPath.string()) + " -C " + quoteArg(destDir.string()) + " -v";
 #else
-    std::string command = "unzip -o " + quoteArg(zipPath.string()) + " -d " + quoteArg(destDir.string()) + " 2>&1";
+    std::string command = "unzip -o " + quoteArg(zipPath.string()) + " -d " + quoteArg(destDir.string());
 #endif
-    FILE* pipe = openPipe(command, "r");
-    if (!pipe) {
+    if (names) {
+        for (const std::string& name : *names) {
+            command += " " + quoteArg(name);
+        }
+    }
+    command += " 2>&1";
+    ToolProcess process;
+    if (!process.start(command)) {
 #ifdef _WIN32
         error = "Failed to run tar";
 #else
@@ -1737,9 +2143,21 @@ static bool extractZipWithProgress(const fs::path& zipPath, const fs::path& dest
 
     int extracted = 0;
     std::string lastLine;
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        std::string line = buffer;
+    std::string line;
+    bool cancelled = false;
+    while (true) {
+        if (transferCancelled(ctx)) {
+            process.kill();
+            cancelled = true;
+            break;
+        }
+        if (!process.readLine(line, std::chrono::milliseconds(15))) {
+            if (process.done()) {
+                break;
+            }
+            refreshTransferScreen(ctx);
+            continue;
+        }
         std::string trimmed = trimWhitespace(line);
         if (!trimmed.empty()) {
             lastLine = trimmed;
@@ -1757,8 +2175,18 @@ static bool extractZipWithProgress(const fs::path& zipPath, const fs::path& dest
 #endif
             ++extracted;
             if (ctx && ctx->transfer) {
-                ctx->transfer->item = item;
-                if (totalEntries > 0) {
+                std::string name = item;
+                if (name.compare(0, destPrefix.size(), destPrefix) == 0) {
+                    name = name.substr(destPrefix.size());
+                }
+                bytesDone += pendingBytes;
+                auto size = entrySizes.find(name);
+                pendingBytes = size != entrySizes.end() ? size->second : 0;
+                ctx->transfer->item = name;
+                if (totalBytes > 0) {
+                    updateTransferCount(ctx, extracted, totalEntries);
+                    updateTransferBytes(ctx, bytesDone, totalBytes, -1.0);
+                } else if (totalEntries > 0) {
                     updateTransferProgress(ctx, static_cast<double>(extracted) / static_cast<double>(totalEntries));
                     updateTransferCount(ctx, extracted, totalEntries);
                 } else {
@@ -1768,7 +2196,11 @@ static bool extractZipWithProgress(const fs::path& zipPath, const fs::path& dest
         }
     }
 
-    int status = closePipe(pipe);
+    int status = process.close();
+    if (cancelled) {
+        error = "Cancelled";
+        return false;
+    }
     if (status != 0) {
 #ifdef _WIN32
         error = lastLine.empty() ? "tar failed" : "tar failed: " + lastLine;
@@ -1778,61 +2210,44 @@ static bool extractZipWithProgress(const fs::path& zipPath, const fs::path& dest
         return false;
     }
     if (ctx) {
-        updateTransferProgress(ctx, 1.0);
+        if (totalBytes > 0) {
+            updateTransferBytes(ctx, totalBytes, totalBytes, -1.0);
+        } else {
+            updateTransferProgress(ctx, 1.0);
+        }
     }
     return true;
 }
 
-static int countRarEntries(const fs::path& rarPath, std::string& error) {
-#ifdef _WIN32
-    std::string command = "tar -tf " + quoteArg(rarPath.string()) + " 2>&1";
-    FILE* pipe = openPipe(command, "r");
-    if (!pipe) {
-        error = "Failed to run tar";
-        return -1;
-    }
-    int count = 0;
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        std::string line = trimWhitespace(buffer);
-        if (!line.empty() && line.rfind("tar:", 0) != 0 && line.rfind("bsdtar:", 0) != 0) {
-            ++count;
-        }
-    }
-    int status = closePipe(pipe);
-    if (status != 0) {
-        error = "tar failed";
-        return -1;
-    }
-    return count;
-#else
-    std::string command = "unrar lb " + quoteArg(rarPath.string()) + " 2>&1";
-    FILE* pipe = openPipe(command, "r");
-    if (!pipe) {
-        error = "Failed to run unrar";
-        return -1;
-    }
-    int count = 0;
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        std::string line = trimWhitespace(buffer);
-        if (!line.empty()) {
-            ++count;
-        }
-    }
-    int status = closePipe(pipe);
-    if (status != 0) {
-        error = "unrar failed";
-        return -1;
-    }
-    return count;
-#endif
-}
-
-static bool parseUnrarOutputLine(const std::string& line, std::string& item) {
-    std::string trimmed = trimWhitespace(line);
-    if (trimmed.empty()) {
-        return false;
+enum class ArchiveKind { Zip, Rar, Stream };
+
+static bool archiveKindOf(const Entry& entry, const Pane& pane, ArchiveKind& kind);
+static bool remoteArchiveKindOf(const Entry& entry, const Pane& pane, ArchiveKind& kind);
+
+struct ArchiveItem {
+    // Path inside the archive exactly as the extractor expects it.
+    std::string name;
+    std::uintmax_t size = 0;
+    bool isDir = false;
+};
+
+// Parsed listing of an archive, kept by loadArchiveIndex.
+struct ArchiveIndex {
+    std::vector<ArchiveItem> items;
+    int files = 0;
+    std::uintmax_t totalSize = 0;
+};
+
+static std::shared_ptr<const ArchiveIndex> loadArchiveIndex(const fs::path& path, ArchiveKind kind,
+                                                            std::string& error,
+                                                            const std::atomic<bool>* cancel = nullptr);
+
+#ifndef USE_LIBARCHIVE
+// Without libarchive, RAR archives are handed to unrar (bsdtar on Windows).
+static bool parseUnrarOutputLine(const std::string& line, std::string& item) {
+    std::string trimmed = trimWhitespace(line);
+    if (trimmed.empty()) {
+        return false;
     }
     std::string lowered = toLower(trimmed);
     if (lowered.rfind("extracting ", 0) == 0) {
@@ -1846,18 +2261,48 @@ static bool parseUnrarOutputLine(const std::string& line, std::string& item) {
     return false;
 }
 
-static bool extractRarWithProgress(const fs::path& rarPath, const fs::path& destDir, TransferContext* ctx,
-                                   std::string& error) {
+// names limits the extraction to those entries; they are handed to the tool in a list
+// file so large selections do not overflow the command line. cleanup is given the
+// names of the entries the tool will write.
+static bool extractRarWithProgress(const fs::path& rarPath, const fs::path& destDir,
+                                   const std::vector<std::string>* names, TransferContext* ctx, std::string& error,
+                                   ExtractCleanup* cleanup = nullptr) {
     if (!fs::exists(destDir)) {
         error = "Target directory not found";
         return false;
     }
 
     int totalEntries = 0;
-    std::string listError;
-    int count = countRarEntries(rarPath, listError);
-    if (count > 0) {
-        totalEntries = count;
+    if (names) {
+        totalEntries = static_cast<int>(names->size());
+        if (cleanup) {
+            for (const std::string& name : *names) {
+                cleanup->add(name);
+            }
+        }
+    } else {
+        std::string listError;
+        std::shared_ptr<const ArchiveIndex> index = loadArchiveIndex(rarPath, ArchiveKind::Rar, listError);
+        totalEntries = index ? static_cast<int>(index->items.size()) : 0;
+        if (cleanup && index) {
+            for (const ArchiveItem& item : index->items) {
+                cleanup->add(item.name);
+            }
+        }
+    }
+
+    fs::path listPath;
+    if (names) {
+        std::error_code ec;
+        listPath = fs::temp_directory_path(ec) / "gamepadcommander-extract.lst";
+        std::ofstream list(listPath, std::ios::binary | std::ios::trunc);
+        for (const std::string& name : *names) {
+            list << name << "\n";
+        }
+        if (!list) {
+            error = "Failed to write file list";
+            return false;
+        }
     }
 
     if (ctx) {
@@ -1868,12 +2313,25 @@ static bool extractRarWithProgress(const fs::path& rarPath, const fs::path& dest
     }
 
 #ifdef _WIN32
-    std::string command = "tar -xf " + quoteArg(rarPath.string()) + " -C " + quoteArg(destDir.string()) + " -v 2>&1";
+    std::string command = "tar -xf " + quoteArg(rarPath.string()) + " -C " + quoteArg(destDir.string()) + " -v";
+    if (names) {
+        command += " -T " + quoteArg(listPath.string());
+    }
+    command += " 2>&1";
 #else
-    std::string command = "unrar x -o+ -y " + quoteArg(rarPath.string()) + " " + quoteArg(destDir.string()) + " 2>&1";
+    std::string command = "unrar x -o+ -y " + quoteArg(rarPath.string());
+    if (names) {
+        command += " " + quoteArg("@" + listPath.string());
+    }
+    // A trailing separator marks the last argument as the destination, not another mask.
+    command += " " + quoteArg((destDir / "").string()) + " 2>&1";
 #endif
-    FILE* pipe = openPipe(command, "r");
-    if (!pipe) {
+    ToolProcess process;
+    if (!process.start(command)) {
+        if (!listPath.empty()) {
+            std::error_code ec;
+            fs::remove(listPath, ec);
+        }
 #ifdef _WIN32
         error = "Failed to run tar";
 #else
@@ -1884,9 +2342,21 @@ static bool extractRarWithProgress(const fs::path& rarPath, const fs::path& dest
 
     int extracted = 0;
     std::string lastLine;
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), pipe)) {
-        std::string line = buffer;
+    std::string line;
+    bool cancelled = false;
+    while (true) {
+        if (transferCancelled(ctx)) {
+            process.kill();
+            cancelled = true;
+            break;
+        }
+        if (!process.readLine(line, std::chrono::milliseconds(15))) {
+            if (process.done()) {
+                break;
+            }
+            refreshTransferScreen(ctx);
+            continue;
+        }
         std::string trimmed = trimWhitespace(line);
         if (!trimmed.empty()) {
             lastLine = trimmed;
@@ -1915,7 +2385,15 @@ static bool extractRarWithProgress(const fs::path& rarPath, const fs::path& dest
         }
     }
 
-    int status = closePipe(pipe);
+    int status = process.close();
+    if (!listPath.empty()) {
+        std::error_code ec;
+        fs::remove(listPath, ec);
+    }
+    if (cancelled) {
+        error = "Cancelled";
+        return false;
+    }
     if (status != 0) {
 #ifdef _WIN32
         error = lastLine.empty() ? "tar failed" : "tar failed: " + lastLine;
@@ -1929,7 +2407,88 @@ static bool extractRarWithProgress(const fs::path& rarPath, const fs::path& dest
     }
     return true;
 }
+#endif
+
+// Same shape as extractZipNative, but the overall bar follows the archive bytes read
+// (progress.sourceDone), since a stream has no index to total up the entries first.
+// With countOutput it follows progress.bytesDone instead, and sourceSize is the total
+// to be written.
+static bool runSourceExtraction(TransferContext* ctx, const std::string& title, const std::string& item,
+                                std::uintmax_t sourceSize, int fileCount,
+                                const std::function<bool(ExtractProgress&, std::string&)>& extract, std::string& error,
+                                bool countOutput = false) {
+    ExtractProgress progress;
+    if (!ctx) {
+        return extract(progress, error);
+    }
+    startTransferItem(ctx, title, item);
+
+    std::atomic<bool> done {false};
+    bool ok = false;
+    std::thread runner([&]() {
+        ok = extract(progress, error);
+        done = true;
+    });
+    while (!done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+        if (transferCancelled(ctx)) {
+            progress.cancel = true;
+        }
+        ExtractActivity current;
+        double itemProgress = -1.0;
+        if (ctx->transfer && progress.current(current)) {
+            ctx->transfer->item = current.name;
+            itemProgress = current.size > 0 ? static_cast<double>(current.done) / static_cast<double>(current.size) : 1.0;
+        }
+        if (fileCount > 0) {
+            updateTransferCount(ctx, progress.filesDone, fileCount);
+        }
+        std::uintmax_t done = countOutput ? progress.bytesDone : progress.sourceDone;
+        updateTransferBytes(ctx, std::min<std::uintmax_t>(done, sourceSize), sourceSize, itemProgress);
+    }
+    runner.join();
+    if (ok) {
+        updateTransferBytes(ctx, sourceSize, sourceSize, -1.0);
+    }
+    return ok;
+}
+
+#ifdef USE_LIBARCHIVE
+// Bytes on disk of an archive and the volumes that follow it.
+static std::uintmax_t archiveSetSize(const fs::path& archivePath) {
+    std::uintmax_t total = 0;
+    for (const fs::path& volume : archiveVolumes(archivePath)) {
+        std::error_code ec;
+        std::uintmax_t size = fs::file_size(volume, ec);
+        total += ec ? 0 : size;
+    }
+    return total;
+}
+
+static bool extractStreamWithProgress(const fs::path& archivePath, const fs::path& destDir,
+                                      const std::vector<std::string>* names, TransferContext* ctx, std::string& error,
+                                      ExtractCleanup* cleanup = nullptr) {
+    if (!fs::exists(destDir)) {
+        error = "Target directory not found";
+        return false;
+    }
+    std::unordered_set<std::string> wanted;
+    if (names) {
+        wanted.insert(names->begin(), names->end());
+    }
+    const std::unordered_set<std::string>* filter = names ? &wanted : nullptr;
+    std::uintmax_t archiveSize = archiveSetSize(archivePath);
+    return runSourceExtraction(
+        ctx, "Extracting", archivePath.filename().string(), archiveSize, names ? static_cast<int>(names->size()) : 0,
+        [&](ExtractProgress& progress, std::string& runError) {
+            progress.created = cleanup ? cleanup->created() : nullptr;
+            return extractStreamArchive(archivePath, destDir, filter, progress, runError);
+        },
+        error);
+}
+#endif
 
+#if !defined(_WIN32) && !defined(USE_LIBARCHIVE)
 static bool parseUnsignedValue(const std::string& token, std::uintmax_t& value) {
     if (token.empty()) {
         return false;
@@ -1945,351 +2504,1838 @@ static bool parseUnsignedValue(const std::string& token, std::uintmax_t& value)
     return true;
 }
 
-static bool parseFtpListLine(const std::string& line, Entry& entry) {
-    if (line.empty()) {
-        return false;
-    }
-    if (line.rfind("total ", 0) == 0) {
-        return false;
-    }
-    if (line.find("type=") != std::string::npos) {
-        bool isDir = (line.find("type=dir") != std::string::npos || line.find("type=cdir") != std::string::npos ||
-                      line.find("type=pdir") != std::string::npos);
-        if (!isDir) {
-            size_t sizePos = line.find("size=");
-            if (sizePos != std::string::npos) {
-                sizePos += std::string("size=").size();
-                size_t endPos = line.find(';', sizePos);
-                std::string sizeToken = line.substr(sizePos, endPos == std::string::npos ? std::string::npos : endPos - sizePos);
-                std::uintmax_t sizeValue = 0;
-                if (parseUnsignedValue(sizeToken, sizeValue)) {
-                    entry.sizeBytes = sizeValue;
-                    entry.hasSize = true;
-                }
-            }
+// Reads the technical listing of unrar, one "Key: value" block per entry.
+static bool parseUnrarTechnicalListing(FILE* pipe, std::vector<ArchiveItem>& items,
+                                       const std::atomic<bool>* cancel) {
+    char buffer[4096];
+    bool inItem = false;
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        if (cancel && *cancel) {
+            return false;
+        }
+        std::string line = trimWhitespace(buffer);
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key = toLower(trimWhitespace(line.substr(0, colon)));
+        std::string value = trimWhitespace(line.substr(colon + 1));
+        if (key == "name") {
+            items.push_back({value});
+            inItem = true;
+        } else if (inItem && key == "type") {
+            items.back().isDir = toLower(value) == "directory";
+        } else if (inItem && key == "size") {
+            parseUnsignedValue(value, items.back().size);
         }
-        size_t nameStart = line.find(' ');
-        if (nameStart == std::string::npos) {
+    }
+    return true;
+}
+#endif
+
+static bool listArchiveItems(const fs::path& path, ArchiveKind kind, std::vector<ArchiveItem>& items,
+                             std::string& error, const std::atomic<bool>* cancel = nullptr) {
+    items.clear();
+#ifdef USE_LIBARCHIVE
+    if (kind == ArchiveKind::Stream || kind == ArchiveKind::Rar) {
+        std::vector<StreamArchiveEntry> entries;
+        if (!listStreamArchive(path, entries, error, cancel)) {
             return false;
         }
-        while (nameStart < line.size() && line[nameStart] == ' ') {
-            ++nameStart;
+        for (const StreamArchiveEntry& entry : entries) {
+            items.push_back({entry.name, entry.size, entry.isDir});
         }
-        if (nameStart >= line.size()) {
+        return true;
+    }
+#else
+    if (kind == ArchiveKind::Stream) {
+        error = "Built without libarchive";
+        return false;
+    }
+#endif
+    if (kind == ArchiveKind::Zip) {
+        ZipArchive archive;
+        if (!archive.open(path, error)) {
             return false;
         }
-        std::string name = line.substr(nameStart);
-        if (name == "." || name == "..") {
+        for (const ZipEntry& entry : archive.entries()) {
+            items.push_back({entry.name, entry.uncompressedSize, entry.isDir});
+        }
+        return true;
+    }
+#ifndef USE_LIBARCHIVE
+#ifdef _WIN32
+    // bsdtar only lists names here, so sizes show as unknown.
+    std::string command = "tar -tf " + quoteArg(path.string()) + " 2>&1";
+    FILE* pipe = openPipe(command, "r");
+    if (!pipe) {
+        error = "Failed to run tar";
+        return false;
+    }
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), pipe)) {
+        if (cancel && *cancel) {
+            closePipe(pipe);
+            error = "Cancelled";
             return false;
         }
-        entry.name = name;
-        entry.isDir = isDir;
-        entry.isParent = false;
-        entry.path.clear();
-        return !entry.name.empty();
-    }
-    bool isDir = (line[0] == 'd');
-    int tokens = 0;
-    bool inToken = false;
-    size_t nameStart = std::string::npos;
-    size_t tokenStart = std::string::npos;
-    std::string sizeToken;
-    for (size_t i = 0; i < line.size(); ++i) {
-        if (!std::isspace(static_cast<unsigned char>(line[i]))) {
-            if (!inToken) {
-                inToken = true;
-                ++tokens;
-                tokenStart = i;
-                if (tokens == 9) {
-                    nameStart = i;
-                    break;
-                }
-            }
-        } else {
-            if (inToken && tokens == 5 && sizeToken.empty()) {
-                sizeToken = line.substr(tokenStart, i - tokenStart);
-            }
-            inToken = false;
+        std::string line = trimWhitespace(buffer);
+        if (!line.empty() && line.rfind("tar:", 0) != 0 && line.rfind("bsdtar:", 0) != 0) {
+            bool isDir = line.back() == '/';
+            items.push_back({line, 0, isDir});
         }
     }
-    if (nameStart == std::string::npos) {
-        entry.name = line;
-        entry.isDir = false;
-        entry.isParent = false;
-        entry.path.clear();
-        return !entry.name.empty();
+    if (closePipe(pipe) != 0) {
+        error = "tar failed";
+        return false;
     }
-    std::string name = line.substr(nameStart);
-    size_t arrow = name.find(" -> ");
-    if (arrow != std::string::npos) {
-        name = name.substr(0, arrow);
+#else
+    std::string command = "unrar lt " + quoteArg(path.string()) + " 2>&1";
+    FILE* pipe = openPipe(command, "r");
+    if (!pipe) {
+        error = "Failed to run unrar";
+        return false;
     }
-    if (!name.empty() && name.back() == '/') {
-        name.pop_back();
-        isDir = true;
+    if (!parseUnrarTechnicalListing(pipe, items, cancel)) {
+        closePipe(pipe);
+        error = "Cancelled";
+        return false;
     }
-    if (name == "." || name == "..") {
+    if (closePipe(pipe) != 0) {
+        error = "unrar failed";
         return false;
     }
-    entry.name = name;
-    entry.isDir = isDir;
-    entry.isParent = false;
-    entry.path.clear();
-    if (!entry.isDir && !sizeToken.empty()) {
-        std::uintmax_t sizeValue = 0;
-        if (parseUnsignedValue(sizeToken, sizeValue)) {
-            entry.sizeBytes = sizeValue;
-            entry.hasSize = true;
+#endif
+#endif
+    return true;
+}
+
+// Indexes of recently seen archives, checked against the file's size and modification
+// time before use. Listings are also written to a folder on disk (when one is set) so
+// they survive a restart; each file starts with the archive path, size and time.
+struct ArchiveIndexCache {
+    struct Slot {
+        std::string key;
+        std::uintmax_t size = 0;
+        fs::file_time_type modified;
+        std::shared_ptr<const ArchiveIndex> index;
+    };
+    std::mutex mutex;
+    std::deque<Slot> slots;
+    fs::path spillDir;
+};
+
+constexpr size_t kArchiveIndexSlots = 32;
+constexpr size_t kArchiveIndexSpillFiles = 256;
+constexpr char kArchiveIndexMagic[] = "GCINDEX 1";
+
+static ArchiveIndexCache& archiveIndexCache() {
+    static ArchiveIndexCache cache;
+    return cache;
+}
+
+static void setArchiveIndexSpillDir(const fs::path& dir) {
+    ArchiveIndexCache& cache = archiveIndexCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.spillDir = dir;
+}
+
+// A spill file that is damaged (rather than just stale) is deleted, so it is relisted
+// and rewritten instead of failing again on every start.
+static std::shared_ptr<const ArchiveIndex> readArchiveIndexSpill(const fs::path& file, const std::string& key,
+                                                                 std::uintmax_t size, fs::file_time_type modified) {
+    std::error_code ec;
+    std::uintmax_t fileSize = fs::file_size(file, ec);
+    if (ec) {
+        return nullptr;
+    }
+    std::ifstream in(file, std::ios::binary);
+    std::string magic;
+    std::string storedKey;
+    if (!std::getline(in, magic) || magic != kArchiveIndexMagic || !std::getline(in, storedKey) ||
+        storedKey != key) {
+        return nullptr;
+    }
+    auto corrupt = [&]() {
+        in.close();
+        fs::remove(file, ec);
+        return nullptr;
+    };
+    std::uintmax_t storedSize = 0;
+    long long storedTime = 0;
+    size_t count = 0;
+    if (!(in >> storedSize >> storedTime >> count)) {
+        return corrupt();
+    }
+    if (storedSize != size || storedTime != static_cast<long long>(modified.time_since_epoch().count())) {
+        return nullptr;
+    }
+    // Every item takes at least six bytes ("0 0 0\n" and a newline), and no name is
+    // longer than the file, which bounds both before anything is allocated.
+    if (count > fileSize / 6) {
+        return corrupt();
+    }
+    auto index = std::make_shared<ArchiveIndex>();
+    index->items.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        ArchiveItem item;
+        int isDir = 0;
+        size_t nameLength = 0;
+        if (!(in >> isDir >> item.size >> nameLength) || in.get() != '\n' || nameLength > fileSize) {
+            return corrupt();
         }
+        item.isDir = isDir != 0;
+        item.name.resize(nameLength);
+        if (!in.read(&item.name[0], static_cast<std::streamsize>(nameLength))) {
+            return corrupt();
+        }
+        index->files += item.isDir ? 0 : 1;
+        index->totalSize += item.size;
+        index->items.push_back(std::move(item));
     }
-    return !entry.name.empty();
+    // Counts as a use for the eviction below.
+    fs::last_write_time(file, fs::file_time_type::clock::now(), ec);
+    return index;
 }
 
-static void loadLocalEntries(Pane& pane, const Settings& settings) {
-    pane.entries.clear();
-    pane.lastLocalCwd = pane.cwd;
-    bool hasParent = pane.cwd.has_parent_path();
-    if (hasParent) {
-        pane.entries.push_back({"..", pane.cwd.parent_path(), true, true});
+static void writeArchiveIndexSpill(const fs::path& dir, const fs::path& file, const std::string& key,
+                                   std::uintmax_t size, fs::file_time_type modified, const ArchiveIndex& index) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    fs::path temp = file;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out << kArchiveIndexMagic << '\n'
+            << key << '\n'
+            << size << ' ' << static_cast<long long>(modified.time_since_epoch().count()) << ' '
+            << index.items.size() << '\n';
+        for (const ArchiveItem& item : index.items) {
+            out << (item.isDir ? 1 : 0) << ' ' << item.size << ' ' << item.name.size() << '\n' << item.name << '\n';
+        }
+        if (!out) {
+            out.close();
+            fs::remove(temp, ec);
+            return;
+        }
     }
+    fs::rename(temp, file, ec);
 
-    std::vector<Entry> collected;
-    try {
-        for (const auto& item : fs::directory_iterator(pane.cwd)) {
-            Entry entry;
-            entry.path = item.path();
-            entry.name = item.path().filename().string();
-            if (!settings.showHidden && !entry.name.empty() && entry.name[0] == '.') {
-                continue;
-            }
-            entry.isDir = item.is_directory();
-            entry.isParent = false;
-            if (!entry.isDir) {
-                std::error_code ec;
-                std::uintmax_t size = fs::file_size(entry.path, ec);
-                if (!ec) {
-                    entry.sizeBytes = size;
-                    entry.hasSize = true;
-                }
-            }
-            collected.push_back(entry);
+    std::vector<std::pair<fs::file_time_type, fs::path>> spilled;
+    for (const auto& item : fs::directory_iterator(dir, ec)) {
+        std::error_code itemEc;
+        spilled.emplace_back(item.last_write_time(itemEc), item.path());
+    }
+    if (spilled.size() > kArchiveIndexSpillFiles) {
+        std::sort(spilled.begin(), spilled.end());
+        for (size_t i = 0; i + kArchiveIndexSpillFiles < spilled.size(); ++i) {
+            fs::remove(spilled[i].second, ec);
         }
-    } catch (const fs::filesystem_error&) {
     }
-
-    sortEntries(collected);
-    pane.entries.insert(pane.entries.end(), collected.begin(), collected.end());
 }
 
-static void loadFtpEntries(Pane& pane, const Settings& settings, StatusMessage* status) {
-    pane.entries.clear();
-    pane.ftpPath = normalizeFtpPath(pane.ftpPath);
-    if (pane.ftpPath != "/") {
-        pane.entries.push_back({"..", {}, true, true});
+// Returns the cached index for path without reading the archive; nullptr when there
+// is none or the file has changed since.
+static std::shared_ptr<const ArchiveIndex> peekArchiveIndex(const fs::path& path) {
+    std::error_code ec;
+    std::uintmax_t size = fs::file_size(path, ec);
+    fs::file_time_type modified = fs::last_write_time(path, ec);
+    if (ec) {
+        return nullptr;
+    }
+    ArchiveIndexCache& cache = archiveIndexCache();
+    std::string key = path.string();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (const ArchiveIndexCache::Slot& slot : cache.slots) {
+        if (slot.key == key) {
+            return slot.size == size && slot.modified == modified ? slot.index : nullptr;
+        }
     }
+    return nullptr;
+}
 
-#ifdef USE_CURL
-    if (settings.ftpHost.empty()) {
-        if (status) {
-            setStatus(*status, "FTP host not set");
+// The listing of path, from memory, the spill folder, or by reading the archive.
+static std::shared_ptr<const ArchiveIndex> loadArchiveIndex(const fs::path& path, ArchiveKind kind,
+                                                            std::string& error, const std::atomic<bool>* cancel) {
+    std::error_code ec;
+    std::uintmax_t size = fs::file_size(path, ec);
+    fs::file_time_type modified = fs::last_write_time(path, ec);
+    if (ec) {
+        error = "Archive not found";
+        return nullptr;
+    }
+    ArchiveIndexCache& cache = archiveIndexCache();
+    std::string key = path.string();
+    fs::path spillDir;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (auto it = cache.slots.begin(); it != cache.slots.end(); ++it) {
+            if (it->key == key) {
+                ArchiveIndexCache::Slot slot = *it;
+                cache.slots.erase(it);
+                if (slot.size == size && slot.modified == modified) {
+                    cache.slots.push_front(slot);
+                    return slot.index;
+                }
+                break;
+            }
         }
-        return;
+        spillDir = cache.spillDir;
     }
-    std::string error;
-    std::vector<Entry> collected;
-    if (!listFtpEntries(settings, pane.ftpPath, collected, error, settings.showHidden)) {
-        if (status) {
-            setStatus(*status, "FTP error: " + error);
+
+    fs::path spillFile = spillDir.empty() ? fs::path() : spillDir / hashHex(key);
+    std::shared_ptr<const ArchiveIndex> index;
+    if (!spillFile.empty()) {
+        index = readArchiveIndexSpill(spillFile, key, size, modified);
+    }
+    if (!index) {
+        auto listed = std::make_shared<ArchiveIndex>();
+        if (!listArchiveItems(path, kind, listed->items, error, cancel)) {
+            return nullptr;
         }
-        return;
+        for (const ArchiveItem& item : listed->items) {
+            listed->files += item.isDir ? 0 : 1;
+            listed->totalSize += item.size;
+        }
+        if (!spillFile.empty()) {
+            writeArchiveIndexSpill(spillDir, spillFile, key, size, modified, *listed);
+        }
+        index = listed;
     }
 
-    pane.entries.insert(pane.entries.end(), collected.begin(), collected.end());
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.slots.push_front({key, size, modified, index});
+    if (cache.slots.size() > kArchiveIndexSlots) {
+        cache.slots.pop_back();
+    }
+    return index;
+}
+
+// names limits the run to those entries (as listed by listArchiveItems); nullptr extracts everything.
+// A cancelled run removes what it created. update skips files already on disk unchanged,
+// which needs the CRCs of a ZIP.
+static bool extractArchiveWithProgress(ArchiveKind kind, const fs::path& path, const fs::path& destDir,
+                                       const std::vector<std::string>* names, TransferContext* ctx,
+                                       std::string& error, ExtractSummary* update = nullptr) {
+    if (update && kind != ArchiveKind::Zip) {
+        error = "Only ZIP archives store checksums to compare";
+        return false;
+    }
+    ExtractCleanup cleanup(destDir);
+    bool ok = false;
+    switch (kind) {
+    case ArchiveKind::Zip:
+        ok = extractZipWithProgress(path, destDir, names, ctx, error, update, &cleanup);
+        break;
+#ifdef USE_LIBARCHIVE
+    // RAR goes through libarchive too: one pass over the volumes, no unrar processes.
+    case ArchiveKind::Rar:
+    case ArchiveKind::Stream:
+        ok = extractStreamWithProgress(path, destDir, names, ctx, error, &cleanup);
+        break;
 #else
-    if (status) {
-        setStatus(*status, "FTP support not built");
+    case ArchiveKind::Rar:
+        ok = extractRarWithProgress(path, destDir, names, ctx, error, &cleanup);
+        break;
+    case ArchiveKind::Stream:
+        error = "Unsupported archive";
+        return false;
+#endif
+    }
+    if (!ok && transferCancelled(ctx)) {
+        cleanup.undo();
+        error = "Cancelled";
     }
+    return ok;
+}
+
+struct ArchiveTestResult {
+    std::vector<std::string> corrupt;
+    int files = 0;
+    std::uintmax_t bytes = 0;
+};
+
+// Decompresses every entry without writing anything, checking each against its stored
+// checksum. Returns false when the test could not run to the end; entries that fail
+// their check are listed in result.corrupt.
+static bool testArchiveWithProgress(ArchiveKind kind, const fs::path& archivePath, TransferContext* ctx,
+                                    ArchiveTestResult& result, std::string& error) {
+    std::string item = archivePath.filename().string();
+    auto run = [&](std::uintmax_t total, int fileCount, bool countOutput,
+                   const std::function<bool(ExtractProgress&, std::string&)>& test) {
+        return runSourceExtraction(
+            ctx, "Testing", item, total, fileCount,
+            [&](ExtractProgress& progress, std::string& runError) {
+                bool ok = test(progress, runError);
+                result.files = progress.filesDone;
+                result.bytes = progress.bytesDone;
+                return ok;
+            },
+            error, countOutput);
+    };
+    if (kind == ArchiveKind::Zip) {
+        ZipArchive archive;
+        if (!archive.open(archivePath, error)) {
+            return false;
+        }
+        if (!zipExtractSupported(archive)) {
+            error = "Archive uses a method this build cannot check";
+            return false;
+        }
+        int totalFiles = 0;
+        for (const ZipEntry& entry : archive.entries()) {
+            totalFiles += entry.isDir ? 0 : 1;
+        }
+        return run(archive.totalUncompressedSize(), totalFiles, true,
+                   [&](ExtractProgress& progress, std::string& runError) {
+                       return testZipArchive(archive, 0, progress, result.corrupt, runError);
+                   });
+    }
+#ifdef USE_LIBARCHIVE
+    return run(archiveSetSize(archivePath), 0, false, [&](ExtractProgress& progress, std::string& runError) {
+        return testStreamArchive(archivePath, progress, result.corrupt, runError);
+    });
+#else
+    error = "Unsupported archive";
+    return false;
 #endif
 }
 
-static void loadEntries(Pane& pane, const Settings& settings, StatusMessage* status = nullptr) {
-    if (pane.source == PaneSource::Ftp) {
-        loadFtpEntries(pane, settings, status);
-    } else {
-        loadLocalEntries(pane, settings);
+// "<name>.zip" next to the source (files drop their extension), numbered when taken.
+static fs::path compressTargetPath(const fs::path& source, const std::string& extension) {
+    std::error_code ec;
+    std::string base = fs::is_directory(source, ec) ? source.filename().string() : source.stem().string();
+    fs::path target = source.parent_path() / (base + extension);
+    for (int n = 2; fs::exists(fs::symlink_status(target, ec)); ++n) {
+        target = source.parent_path() / (base + " (" + std::to_string(n) + ")" + extension);
     }
+    return target;
+}
 
-    if (pane.selected >= static_cast<int>(pane.entries.size())) {
-        pane.selected = static_cast<int>(pane.entries.size()) - 1;
+// Packs source (a file or folder) into a new .zip or .tar.zst beside it, keeping the
+// progress screen alive like the extractors do.
+static bool compressWithProgress(const fs::path& source, bool tarZst, TransferContext* ctx, fs::path& target,
+                                 std::string& error) {
+    std::vector<ArchiveSource> sources;
+    std::uint64_t totalBytes = 0;
+    if (!collectArchiveSources(source, sources, totalBytes, error)) {
+        return false;
     }
-    if (pane.selected < 0) {
-        pane.selected = 0;
+    target = compressTargetPath(source, tarZst ? ".tar.zst" : ".zip");
+    ExtractProgress progress;
+    auto run = [&]() {
+#ifdef USE_LIBARCHIVE
+        if (tarZst) {
+            return createTarZstArchive(sources, target, 0, progress, error);
+        }
+#endif
+        return createZipArchive(sources, target, 0, progress, error);
+    };
+    if (!ctx) {
+        return run();
     }
-    if (pane.scroll > pane.selected) {
-        pane.scroll = pane.selected;
+    int totalFiles = 0;
+    for (const ArchiveSource& item : sources) {
+        totalFiles += item.isDir ? 0 : 1;
     }
-}
+    startTransferItem(ctx, "Compressing", target.filename().string());
+    updateTransferCount(ctx, 0, totalFiles);
 
-static void resetPanePosition(Pane& pane) {
-    pane.selected = 0;
-    pane.scroll = 0;
+    std::atomic<bool> done {false};
+    bool ok = false;
+    std::thread runner([&]() {
+        ok = run();
+        done = true;
+    });
+    while (!done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+        if (transferCancelled(ctx)) {
+            progress.cancel = true;
+        }
+        ExtractActivity current;
+        double itemProgress = -1.0;
+        if (ctx->transfer && progress.current(current)) {
+            ctx->transfer->item = current.name;
+            itemProgress = current.size > 0 ? static_cast<double>(current.done) / static_cast<double>(current.size) : 1.0;
+        }
+        updateTransferCount(ctx, progress.filesDone, totalFiles);
+        updateTransferBytes(ctx, progress.bytesDone, totalBytes, itemProgress);
+    }
+    runner.join();
+    if (ok) {
+        updateTransferBytes(ctx, totalBytes, totalBytes, -1.0);
+    }
+    return ok;
 }
 
-static void connectToFtp(Pane& pane, const Settings& settings, StatusMessage& status) {
-    if (settings.ftpHost.empty()) {
-        setStatus(status, "FTP host not set");
-        return;
+// One file or folder of the Extract Selected tree. Files hold the selection; folders
+// keep running counts of what is selected below them.
+struct ArchivePickNode {
+    std::string label;
+    // Index into ArchivePicker::items, or -1 for folders only implied by file names.
+    int item = -1;
+    int parent = -1;
+    int depth = 0;
+    bool isDir = false;
+    bool expanded = false;
+    bool selected = false;
+    int files = 0;
+    int selectedFiles = 0;
+    std::uintmax_t bytes = 0;
+    std::uintmax_t selectedBytes = 0;
+    std::vector<int> children;
+};
+
+struct ArchivePicker {
+    fs::path archivePath;
+    fs::path destDir;
+    ArchiveKind kind = ArchiveKind::Zip;
+    std::vector<ArchiveItem> items;
+    // Node 0 is the archive root and is never shown.
+    std::vector<ArchivePickNode> nodes;
+    // Visible nodes in display order.
+    std::vector<int> rows;
+    int index = 0;
+    int scroll = 0;
+    std::uintmax_t freeBytes = 0;
+    bool hasFree = false;
+};
+
+static void refreshPickerRows(ArchivePicker& picker) {
+    picker.rows.clear();
+    std::vector<int> stack(picker.nodes[0].children.rbegin(), picker.nodes[0].children.rend());
+    while (!stack.empty()) {
+        int node = stack.back();
+        stack.pop_back();
+        picker.rows.push_back(node);
+        const ArchivePickNode& current = picker.nodes[static_cast<size_t>(node)];
+        if (current.isDir && current.expanded) {
+            stack.insert(stack.end(), current.children.rbegin(), current.children.rend());
+        }
     }
-    pane.source = PaneSource::Ftp;
-    pane.ftpPath = "/";
-    resetPanePosition(pane);
-    loadEntries(pane, settings, &status);
+    picker.index = std::clamp(picker.index, 0, std::max(0, static_cast<int>(picker.rows.size()) - 1));
 }
 
-static bool copyBetweenPanes(const Entry& entry, const Pane& src, const Pane& dst, const Settings& settings,
-                             TransferContext* ctx, const std::string& title, std::string& error) {
-    if (src.source == PaneSource::Local && dst.source == PaneSource::Local) {
-        fs::path target = dst.cwd / entry.name;
-        return copyLocalPathWithProgress(entry.path, target, ctx, title, error);
+static bool buildArchivePicker(ArchivePicker& picker, std::string& error) {
+    std::shared_ptr<const ArchiveIndex> index = loadArchiveIndex(picker.archivePath, picker.kind, error);
+    if (!index) {
+        return false;
     }
-#ifdef USE_CURL
-    if (src.source == PaneSource::Ftp && dst.source == PaneSource::Local) {
-        fs::path target = dst.cwd / entry.name;
-        if (fs::exists(target)) {
-            error = "Target already exists";
-            return false;
+    picker.items = index->items;
+    picker.nodes.assign(1, ArchivePickNode {});
+    picker.nodes[0].isDir = true;
+    picker.nodes[0].expanded = true;
+    std::map<std::string, int> dirs;
+    dirs[""] = 0;
+    auto childDir = [&](int parent, const std::string& path, const std::string& label) {
+        auto found = dirs.find(path);
+        if (found != dirs.end()) {
+            return found->second;
         }
-        std::string remotePath = ftpJoinPath(src.ftpPath, entry.name);
-        if (ctx) {
-            startTransferItem(ctx, title, entry.name);
+        int node = static_cast<int>(picker.nodes.size());
+        ArchivePickNode dir;
+        dir.label = label;
+        dir.parent = parent;
+        dir.depth = picker.nodes[static_cast<size_t>(parent)].depth + (parent == 0 ? 0 : 1);
+        dir.isDir = true;
+        picker.nodes.push_back(dir);
+        picker.nodes[static_cast<size_t>(parent)].children.push_back(node);
+        dirs[path] = node;
+        return node;
+    };
+    for (size_t i = 0; i < picker.items.size(); ++i) {
+        const ArchiveItem& item = picker.items[i];
+        std::vector<std::string> parts;
+        std::istringstream stream(item.name);
+        std::string part;
+        bool escapes = false;
+        while (std::getline(stream, part, '/')) {
+            escapes = escapes || part == "..";
+            if (!part.empty() && part != ".") {
+                parts.push_back(part);
+            }
         }
-        if (entry.isDir) {
-            return ftpDownloadDirectory(settings, remotePath, target, ctx, title, error);
+        // Entries reaching outside the target are never extracted, so they are not offered.
+        if (parts.empty() || escapes) {
+            continue;
         }
-        return ftpDownloadFile(settings, remotePath, target, ctx, error);
-    }
-    if (src.source == PaneSource::Local && dst.source == PaneSource::Ftp) {
-        bool isDir = false;
-        if (ftpEntryExists(settings, dst.ftpPath, entry.name, isDir, error)) {
-            error = "Target already exists";
+        int parent = 0;
+        std::string path;
+        size_t dirParts = item.isDir ? parts.size() : parts.size() - 1;
+        for (size_t p = 0; p < dirParts; ++p) {
+            path += parts[p] + "/";
+            parent = childDir(parent, path, parts[p]);
+        }
+        if (item.isDir) {
+            picker.nodes[static_cast<size_t>(parent)].item = static_cast<int>(i);
+            continue;
+        }
+        ArchivePickNode file;
+        file.label = parts.back();
+        file.item = static_cast<int>(i);
+        file.parent = parent;
+        file.depth = picker.nodes[static_cast<size_t>(parent)].depth + (parent == 0 ? 0 : 1);
+        file.files = 1;
+        file.bytes = item.size;
+        int node = static_cast<int>(picker.nodes.size());
+        picker.nodes.push_back(file);
+        picker.nodes[static_cast<size_t>(parent)].children.push_back(node);
+        for (int up = parent; up >= 0; up = picker.nodes[static_cast<size_t>(up)].parent) {
+            picker.nodes[static_cast<size_t>(up)].files += 1;
+            picker.nodes[static_cast<size_t>(up)].bytes += item.size;
+        }
+    }
+    for (auto& node : picker.nodes) {
+        std::stable_sort(node.children.begin(), node.children.end(), [&](int a, int b) {
+            const ArchivePickNode& left = picker.nodes[static_cast<size_t>(a)];
+            const ArchivePickNode& right = picker.nodes[static_cast<size_t>(b)];
+            if (left.isDir != right.isDir) {
+                return left.isDir;
+            }
+            return toLower(left.label) < toLower(right.label);
+        });
+    }
+    std::error_code ec;
+    fs::space_info space = fs::space(picker.destDir, ec);
+    picker.hasFree = !ec;
+    picker.freeBytes = ec ? 0 : space.available;
+    picker.index = 0;
+    picker.scroll = 0;
+    refreshPickerRows(picker);
+    return true;
+}
+
+// Selects or clears a file, or everything below a folder (a partly selected folder
+// becomes fully selected).
+static void togglePickNode(ArchivePicker& picker, int node) {
+    const ArchivePickNode& target = picker.nodes[static_cast<size_t>(node)];
+    bool select = target.isDir ? target.selectedFiles < target.files : !target.selected;
+    std::vector<int> stack {node};
+    while (!stack.empty()) {
+        ArchivePickNode& current = picker.nodes[static_cast<size_t>(stack.back())];
+        stack.pop_back();
+        if (current.isDir) {
+            stack.insert(stack.end(), current.children.begin(), current.children.end());
+            continue;
+        }
+        if (current.selected == select) {
+            continue;
+        }
+        current.selected = select;
+        std::uintmax_t size = current.bytes;
+        for (int up = current.parent; up >= 0; up = picker.nodes[static_cast<size_t>(up)].parent) {
+            ArchivePickNode& dir = picker.nodes[static_cast<size_t>(up)];
+            dir.selectedFiles += select ? 1 : -1;
+            dir.selectedBytes = select ? dir.selectedBytes + size : dir.selectedBytes - size;
+        }
+    }
+}
+
+static std::vector<std::string> pickedArchiveNames(const ArchivePicker& picker) {
+    std::vector<std::string> names;
+    for (const auto& node : picker.nodes) {
+        if (!node.isDir && node.selected) {
+            names.push_back(picker.items[static_cast<size_t>(node.item)].name);
+        }
+    }
+    return names;
+}
+
+
+// Returns nullptr when the pane points at a filesystem this build cannot reach.
+static std::shared_ptr<VfsBackend> paneBackend(const Pane& pane, const Settings& settings) {
+    if (pane.source == PaneSource::Archive) {
+        std::string error;
+        return archiveBackend(pane.archivePath, error);
+    }
+    if (pane.source == PaneSource::Ftp) {
+#ifdef USE_CURL
+        return ftpBackend(settings);
+#else
+        (void)settings;
+        return nullptr;
+#endif
+    }
+    return localBackend();
+}
+
+static std::string paneUnavailableReason(const Pane& pane) {
+    return pane.source == PaneSource::Archive ? "Archive could not be opened" : "FTP support not built";
+}
+
+static std::string paneDir(const Pane& pane) {
+    if (pane.source == PaneSource::Archive) {
+        return pane.archiveDir;
+    }
+    return pane.source == PaneSource::Ftp ? normalizeFtpPath(pane.ftpPath) : pane.cwd.string();
+}
+
+static void setPaneDir(Pane& pane, const std::string& dir) {
+    if (pane.source == PaneSource::Archive) {
+        pane.archiveDir = dir;
+    } else if (pane.source == PaneSource::Ftp) {
+        pane.ftpPath = dir;
+    } else {
+        pane.cwd = fs::path(dir);
+    }
+}
+
+static const size_t kVfsCopyChunk = 256 * 1024;
+static const int kVerifyAttempts = 3;
+
+// Digest of the bytes passing through a copy, so verification never rereads them.
+struct TransferDigest {
+    ChecksumKind kind = ChecksumKind::None;
+    Crc32 crc;
+    Md5 md5;
+
+    void update(const char* data, size_t size) {
+        if (kind == ChecksumKind::Crc32) {
+            crc.update(data, size);
+        } else if (kind == ChecksumKind::Md5) {
+            md5.update(data, size);
+        }
+    }
+    std::string hex() {
+        return kind == ChecksumKind::Crc32 ? toLower(crc.hex()) : md5.hex();
+    }
+};
+
+static bool vfsStreamFile(VfsBackend& src, const std::string& srcPath, VfsBackend& dst, const std::string& dstPath,
+                          std::uintmax_t sizeHint, TransferContext* ctx, TransferDigest& digest,
+                          std::uintmax_t& copied, std::string& error) {
+    std::unique_ptr<VfsReadStream> reader = src.openRead(srcPath, 0, error);
+    if (!reader) {
+        return false;
+    }
+    std::unique_ptr<VfsWriteStream> writer = dst.openWrite(dstPath, sizeHint, error);
+    if (!writer) {
+        return false;
+    }
+    std::vector<char> buffer(kVfsCopyChunk);
+    copied = 0;
+    while (true) {
+        long long bytes = reader->read(buffer.data(), buffer.size(), error);
+        if (bytes < 0) {
+            return false;
+        }
+        if (bytes == 0) {
+            break;
+        }
+        if (!writer->write(buffer.data(), static_cast<size_t>(bytes), error)) {
             return false;
         }
+        digest.update(buffer.data(), static_cast<size_t>(bytes));
+        copied += static_cast<std::uintmax_t>(bytes);
+        if (ctx && sizeHint > 0) {
+            updateTransferProgress(ctx, static_cast<double>(copied) / static_cast<double>(sizeHint));
+        }
+        if (transferCancelled(ctx)) {
+            error = "Transfer cancelled";
+            return false;
+        }
+    }
+    return writer->close(error);
+}
+
+// Checks a finished copy against whichever side can report a digest. Servers without
+// a checksum command fall back to comparing sizes with the bytes that went through.
+static bool vfsCopyMatches(VfsBackend& src, const std::string& srcPath, VfsBackend& dst, const std::string& dstPath,
+                           VfsBackend* checker, TransferDigest& digest, std::uintmax_t copied, std::string& error) {
+    if (checker) {
+        std::string expected;
+        if (!checker->checksum(checker == &dst ? dstPath : srcPath, digest.kind, expected, error)) {
+            return false;
+        }
+        return expected == digest.hex();
+    }
+    for (VfsBackend* side : {&src, &dst}) {
+        const std::string& path = (side == &src) ? srcPath : dstPath;
+        Entry entry;
+        side->invalidate(side->parent(path));
+        if (!side->stat(path, entry, error)) {
+            if (error.empty()) {
+                error = "File missing after transfer";
+            }
+            return false;
+        }
+        if (entry.hasSize && entry.sizeBytes != copied) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool vfsCopyFile(VfsBackend& src, const std::string& srcPath, VfsBackend& dst, const std::string& dstPath,
+                        std::uintmax_t sizeHint, TransferContext* ctx, bool verify, std::string& error) {
+    if (src.key() == dst.key() && src.capabilities().reflink && src.reflink(srcPath, dstPath, error)) {
+        updateTransferProgress(ctx, 1.0);
+        return true;
+    }
+    error.clear();
+    // Local disk copies are not worth checking; the kernel already does.
+    verify = verify && !(src.capabilities().localFiles && dst.capabilities().localFiles);
+    VfsBackend* checker = nullptr;
+    ChecksumKind kind = ChecksumKind::None;
+    if (verify) {
+        kind = dst.checksumKind();
+        checker = &dst;
+        if (kind == ChecksumKind::None) {
+            kind = src.checksumKind();
+            checker = (kind == ChecksumKind::None) ? nullptr : &src;
+        }
+    }
+    for (int attempt = 1;; ++attempt) {
+        TransferDigest digest;
+        digest.kind = kind;
+        std::uintmax_t copied = 0;
+        if (!vfsStreamFile(src, srcPath, dst, dstPath, sizeHint, ctx, digest, copied, error)) {
+            return false;
+        }
+        if (!verify || vfsCopyMatches(src, srcPath, dst, dstPath, checker, digest, copied, error)) {
+            break;
+        }
         if (!error.empty()) {
+            error = "Verify failed: " + error;
             return false;
         }
-        std::string remotePath = ftpJoinPath(dst.ftpPath, entry.name);
-        if (ctx) {
-            startTransferItem(ctx, title, entry.name);
+        if (attempt == kVerifyAttempts) {
+            std::string removeError;
+            dst.remove(dstPath, false, removeError);
+            error = "Checksum mismatch after " + std::to_string(kVerifyAttempts) + " attempts";
+            return false;
+        }
+        updateTransferProgress(ctx, 0.0);
+    }
+    updateTransferProgress(ctx, 1.0);
+    return true;
+}
+
+struct VfsCopyItem {
+    std::string srcPath;
+    std::string dstPath;
+    std::string label;
+    bool isDir = false;
+    std::uintmax_t sizeBytes = 0;
+};
+
+static bool collectVfsCopyItems(VfsBackend& src, const std::string& srcDir, VfsBackend& dst, const std::string& dstDir,
+                                const std::string& label, std::vector<VfsCopyItem>& items, std::string& error) {
+    std::vector<Entry> entries;
+    if (!src.list(srcDir, true, entries, error)) {
+        return false;
+    }
+    for (const auto& entry : entries) {
+        VfsCopyItem item;
+        item.srcPath = src.join(srcDir, entry.name);
+        item.dstPath = dst.join(dstDir, entry.name);
+        item.label = label.empty() ? entry.name : label + "/" + entry.name;
+        item.isDir = entry.isDir;
+        item.sizeBytes = entry.sizeBytes;
+        items.push_back(item);
+        if (entry.isDir && !collectVfsCopyItems(src, item.srcPath, dst, item.dstPath, item.label, items, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Copies a file or folder tree between any two backends.
+static bool vfsCopyPath(VfsBackend& src, const std::string& srcPath, const Entry& entry, VfsBackend& dst,
+                        const std::string& dstPath, TransferContext* ctx, const std::string& title, bool verify,
+                        std::string& error) {
+    Entry existing;
+    if (dst.stat(dstPath, existing, error)) {
+        error = "Target already exists";
+        return false;
+    }
+    if (!error.empty()) {
+        return false;
+    }
+    if (ctx) {
+        startTransferItem(ctx, title, entry.name);
+    }
+    bool ok = true;
+    if (!entry.isDir) {
+        ok = vfsCopyFile(src, srcPath, dst, dstPath, entry.sizeBytes, ctx, verify, error);
+    } else {
+        std::vector<VfsCopyItem> items;
+        ok = collectVfsCopyItems(src, srcPath, dst, dstPath, "", items, error) && dst.mkdir(dstPath, error);
+        int totalFiles = static_cast<int>(std::count_if(items.begin(), items.end(), [](const VfsCopyItem& item) {
+            return !item.isDir;
+        }));
+        int copiedFiles = 0;
+        if (ok && ctx && totalFiles > 0) {
+            updateTransferCount(ctx, 0, totalFiles);
+        }
+        for (size_t i = 0; ok && i < items.size(); ++i) {
+            const VfsCopyItem& item = items[i];
+            if (item.isDir) {
+                ok = dst.mkdir(item.dstPath, error);
+                continue;
+            }
+            if (ctx) {
+                startTransferItem(ctx, title, item.label, false);
+            }
+            ok = vfsCopyFile(src, item.srcPath, dst, item.dstPath, item.sizeBytes, ctx, verify, error);
+            if (ok && ctx && totalFiles > 0) {
+                updateTransferCount(ctx, ++copiedFiles, totalFiles);
+            }
+        }
+    }
+    // Listings taken while the copy was running may show partial files.
+    dst.invalidate(dst.parent(dstPath));
+    return ok;
+}
+
+#ifdef USE_CURL
+static const std::uintmax_t kSpeedTestBytes = 8 * 1024 * 1024;
+
+// Measures the link by writing a scratch file into dir and reading it back. Throughput
+// is wall time per direction, login included, as a user copying one file would see it.
+static bool runFtpSpeedTest(const Settings& settings, const std::string& dir, TransferContext* ctx,
+                            FtpSpeedTestResult& result, std::string& error) {
+    FtpTimingSample probe;
+    std::vector<std::string> replies;
+    if (!ftpQuoteCommands(settings, {"NOOP"}, replies, error, &probe)) {
+        return false;
+    }
+    std::shared_ptr<VfsBackend> ftp = ftpBackend(settings);
+    std::string path = ftp->join(dir, ".gamepadcommander-speedtest.tmp");
+    // Incompressible bytes, so link-level compression cannot flatter the result.
+    std::vector<char> chunk(kVfsCopyChunk);
+    std::uint32_t seed = 0x9E3779B9u;
+    for (char& byte : chunk) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        byte = static_cast<char>(seed & 0xFFu);
+    }
+
+    startTransferItem(ctx, "Speed Test", "Upload");
+    auto uploadStart = std::chrono::steady_clock::now();
+    {
+        std::unique_ptr<VfsWriteStream> writer = ftp->openWrite(path, kSpeedTestBytes, error);
+        if (!writer) {
+            return false;
+        }
+        for (std::uintmax_t sent = 0; sent < kSpeedTestBytes; sent += chunk.size()) {
+            if (!writer->write(chunk.data(), chunk.size(), error)) {
+                return false;
+            }
+            updateTransferProgress(ctx, static_cast<double>(sent + chunk.size()) / static_cast<double>(kSpeedTestBytes));
+            if (transferCancelled(ctx)) {
+                error = "Transfer cancelled";
+                return false;
+            }
+        }
+        if (!writer->close(error)) {
+            return false;
+        }
+    }
+    double uploadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - uploadStart).count();
+
+    startTransferItem(ctx, "Speed Test", "Download");
+    auto downloadStart = std::chrono::steady_clock::now();
+    std::uintmax_t received = 0;
+    bool ok = true;
+    std::unique_ptr<VfsReadStream> reader = ftp->openRead(path, 0, error);
+    ok = reader != nullptr;
+    while (ok) {
+        long long bytes = reader->read(chunk.data(), chunk.size(), error);
+        if (bytes <= 0) {
+            ok = bytes == 0;
+            break;
+        }
+        received += static_cast<std::uintmax_t>(bytes);
+        updateTransferProgress(ctx, static_cast<double>(received) / static_cast<double>(kSpeedTestBytes));
+        if (transferCancelled(ctx)) {
+            error = "Transfer cancelled";
+            ok = false;
+        }
+    }
+    reader.reset();
+    double downloadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - downloadStart).count();
+    std::string removeError;
+    ftp->remove(path, false, removeError);
+    if (!ok) {
+        return false;
+    }
+
+    result.hasResult = true;
+    result.rttMs = probe.connectMs;
+    result.uploadBytesPerSecond = static_cast<double>(kSpeedTestBytes) / std::max(uploadSeconds, 1e-6);
+    result.downloadBytesPerSecond = static_cast<double>(received) / std::max(downloadSeconds, 1e-6);
+    return true;
+}
+#endif
+
+static std::string fileCacheKey(const VfsBackend& backend, const std::string& path, const Entry& entry) {
+    std::ostringstream key;
+    key << backend.key() << '\n'
+        << path << '\n'
+        << (entry.hasSize ? std::to_string(entry.sizeBytes) : "?") << '\n'
+        << (entry.hasModified ? std::to_string(entry.modifiedTime) : "?");
+    return key.str();
+}
+
+// Each cached file lives in its own slot directory named after the key hash, so the
+// original filename (and extension) is kept for the system opener. A slot's last use
+// is the mtime of its file, which is bumped on every cache hit.
+static void evictFileCache(const fs::path& cacheDir, std::uintmax_t budget, const fs::path& keep) {
+    struct CachedSlot {
+        fs::path dir;
+        std::uintmax_t size = 0;
+        fs::file_time_type lastUsed = fs::file_time_type::min();
+    };
+    std::vector<CachedSlot> slots;
+    std::uintmax_t total = 0;
+    std::error_code ec;
+    for (const auto& item : fs::directory_iterator(cacheDir, ec)) {
+        if (!item.is_directory(ec)) {
+            continue;
+        }
+        CachedSlot slot;
+        slot.dir = item.path();
+        std::error_code fileEc;
+        for (const auto& file : fs::directory_iterator(slot.dir, fileEc)) {
+            if (!file.is_regular_file(fileEc)) {
+                continue;
+            }
+            std::uintmax_t size = file.file_size(fileEc);
+            if (!fileEc) {
+                slot.size += size;
+            }
+            fs::file_time_type used = file.last_write_time(fileEc);
+            if (!fileEc) {
+                slot.lastUsed = std::max(slot.lastUsed, used);
+            }
+        }
+        total += slot.size;
+        slots.push_back(slot);
+    }
+    std::sort(slots.begin(), slots.end(), [](const CachedSlot& a, const CachedSlot& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+    for (const auto& slot : slots) {
+        if (total <= budget) {
+            break;
+        }
+        if (slot.dir == keep) {
+            continue;
+        }
+        std::error_code removeEc;
+        fs::remove_all(slot.dir, removeEc);
+        if (!removeEc) {
+            total -= slot.size;
+        }
+    }
+}
+
+// Resolves a path to a file the system opener can use. Remote files are copied into
+// the local file cache, which keeps recently opened ones within the configured budget.
+static bool fetchLocalCopy(VfsBackend& backend, const std::string& path, const Entry& entry, const Settings& settings,
+                           TransferContext* ctx, fs::path& localPath, std::string& error) {
+    if (backend.capabilities().localFiles) {
+        localPath = fs::path(path);
+        return true;
+    }
+    if (settings.ftpCacheDir.empty()) {
+        error = "File cache unavailable";
+        return false;
+    }
+    fs::path slot = settings.ftpCacheDir / hashHex(fileCacheKey(backend, path, entry));
+    localPath = slot / entry.name;
+    // Without size or modify facts a stale copy cannot be detected, so always refetch.
+    bool cacheable = entry.hasSize || entry.hasModified;
+    std::error_code ec;
+    if (cacheable && fs::is_regular_file(localPath, ec)) {
+        std::uintmax_t cachedSize = fs::file_size(localPath, ec);
+        if (!ec && (!entry.hasSize || cachedSize == entry.sizeBytes)) {
+            fs::last_write_time(localPath, fs::file_time_type::clock::now(), ec);
+            return true;
+        }
+    }
+
+    ec.clear();
+    fs::create_directories(slot, ec);
+    if (ec) {
+        error = "Failed to create cache directory";
+        return false;
+    }
+    fs::path partial = localPath;
+    partial += ".part";
+    if (ctx) {
+        startTransferItem(ctx, "Downloading", entry.name);
+    }
+    if (!vfsCopyFile(backend, path, *localBackend(), partial.string(), entry.sizeBytes, ctx, settings.ftpVerify, error)) {
+        return false;
+    }
+    fs::rename(partial, localPath, ec);
+    if (ec) {
+        error = "Failed to store cached file";
+        return false;
+    }
+    std::uintmax_t budget = static_cast<std::uintmax_t>(std::max(0, settings.ftpCacheLimitMb)) * 1024 * 1024;
+    evictFileCache(settings.ftpCacheDir, budget, slot);
+    return true;
+}
+
+#ifdef USE_CURL
+// Lets the extractors read a remote file; every open starts a new transfer at the
+// given offset (a REST on FTP).
+class VfsByteSource : public ByteSource {
+public:
+    VfsByteSource(VfsBackend& backend, const std::string& path) : backend_(backend), path_(path) {}
+
+    bool open(std::uint64_t offset, std::string& error) override {
+        stream_.reset();
+        stream_ = backend_.openRead(path_, offset, error);
+        offset_ = offset;
+        received_ = false;
+        if (stream_) {
+            stream_->setCancel(cancel_);
+        }
+        return stream_ != nullptr;
+    }
+    // Applies to the open transfer and every later one.
+    void setCancel(const std::atomic<bool>* cancel) {
+        cancel_ = cancel;
+        if (stream_) {
+            stream_->setCancel(cancel);
+        }
+    }
+    long long read(char* buffer, size_t size, std::string& error) override {
+        long long bytes = stream_->read(buffer, size, error);
+        // A server without REST fails the first read of a transfer that starts mid-file.
+        if (bytes < 0 && offset_ > 0 && !received_) {
+            rangeFailed_ = true;
+        }
+        received_ = received_ || bytes > 0;
+        return bytes;
+    }
+    bool rangeFailed() const {
+        return rangeFailed_;
+    }
+
+private:
+    VfsBackend& backend_;
+    std::string path_;
+    std::unique_ptr<VfsReadStream> stream_;
+    const std::atomic<bool>* cancel_ = nullptr;
+    std::uint64_t offset_ = 0;
+    bool received_ = false;
+    bool rangeFailed_ = false;
+};
+
+// Extracts an archive on the server into a local folder while it downloads, so only
+// the extracted files are written. When the server cannot do range reads (needed for
+// the ZIP directory and for 7z), or the ZIP needs unzip, the archive goes through the
+// file cache and a local extract instead.
+static bool extractRemoteArchive(VfsBackend& backend, const std::string& path, const Entry& entry, ArchiveKind kind,
+                                 const fs::path& destDir, const Settings& settings, TransferContext* ctx,
+                                 std::string& error) {
+    if (!fs::is_directory(destDir)) {
+        error = "Target directory not found";
+        return false;
+    }
+    VfsByteSource source(backend, path);
+    ExtractCleanup cleanup(destDir);
+    auto finish = [&](bool ok) {
+        if (!ok && transferCancelled(ctx)) {
+            cleanup.undo();
+            error = "Cancelled";
+        }
+        return ok;
+    };
+    if (entry.hasSize && kind == ArchiveKind::Zip) {
+        ZipArchive archive;
+        std::string directoryError;
+        if (readZipDirectory(source, entry.sizeBytes, archive, directoryError) && zipExtractSupported(archive)) {
+            return finish(runSourceExtraction(
+                ctx, "Extracting", entry.name, entry.sizeBytes, 0,
+                [&](ExtractProgress& progress, std::string& runError) {
+                    progress.created = cleanup.created();
+                    source.setCancel(&progress.cancel);
+                    bool ok = extractZipStream(source, archive, destDir, progress, runError);
+                    source.setCancel(nullptr);
+                    return ok;
+                },
+                error));
+        }
+    }
+#ifdef USE_LIBARCHIVE
+    if (entry.hasSize && kind != ArchiveKind::Zip) {
+        bool ok = runSourceExtraction(
+            ctx, "Extracting", entry.name, entry.sizeBytes, 0,
+            [&](ExtractProgress& progress, std::string& runError) {
+                progress.created = cleanup.created();
+                source.setCancel(&progress.cancel);
+                bool extracted = extractStreamArchive(source, entry.sizeBytes, destDir, progress, runError);
+                source.setCancel(nullptr);
+                return extracted;
+            },
+            error);
+        if (ok || !source.rangeFailed() || transferCancelled(ctx)) {
+            return finish(ok);
+        }
+        // The server stopped serving ranges partway; what was written so far goes before
+        // the archive is extracted again from the cache.
+        cleanup.undo();
+    }
+#endif
+    fs::path localPath;
+    if (!fetchLocalCopy(backend, path, entry, settings, ctx, localPath, error)) {
+        return false;
+    }
+    return extractArchiveWithProgress(kind, localPath, destDir, nullptr, ctx, error);
+}
+
+static const size_t kUploadConnections = 4;
+// Decompressed data allowed to wait for the uploads before the extractor pauses.
+static const size_t kUploadQueueBytes = 32 * 1024 * 1024;
+
+// Uploads extracted files into a folder on a backend, over several connections at
+// once. The extractor's thread queues each file's data in memory as it comes out of
+// the decompressor; the workers take files in order and stream them to the server, so
+// small files go up side by side while a large one is still being inflated. Nothing is
+// written to local disk. Folders that end up empty are made at the end; the others
+// come with the uploads of their files.
+class VfsExtractSink : public ExtractSink {
+public:
+    VfsExtractSink(VfsBackend& backend, const std::string& root, ExtractProgress& progress, size_t connections)
+        : backend_(backend), root_(root), progress_(progress) {
+        {
+            std::lock_guard<std::mutex> lock(progress_.mutex);
+            progress_.active.assign(connections, {});
         }
-        if (entry.isDir) {
-            return ftpUploadDirectory(settings, entry.path, remotePath, ctx, title, error);
+        for (size_t slot = 0; slot < connections; ++slot) {
+            workers_.emplace_back(&VfsExtractSink::work, this, slot);
         }
-        return ftpUploadFile(settings, entry.path, remotePath, ctx, error);
     }
-#endif
-    error = "FTP copy not supported";
-    return false;
+    ~VfsExtractSink() override {
+        stop();
+    }
+    VfsExtractSink(const VfsExtractSink&) = delete;
+    VfsExtractSink& operator=(const VfsExtractSink&) = delete;
+
+    bool makeDir(const std::string& relPath, std::string& error) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirs_.insert(relPath);
+        return checkFailed(error);
+    }
+    bool openFile(const std::string& relPath, std::uint64_t size, std::string& error) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t slash = relPath.find('/'); slash != std::string::npos; slash = relPath.find('/', slash + 1)) {
+            filled_.insert(relPath.substr(0, slash));
+        }
+        current_ = std::make_shared<Upload>();
+        current_->relPath = relPath;
+        current_->size = size;
+        pending_.push_back(current_);
+        changed_.notify_all();
+        return checkFailed(error);
+    }
+    bool write(const char* data, size_t size, std::string& error) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&]() { return failed_ || buffered_ < kUploadQueueBytes; });
+        if (!checkFailed(error)) {
+            return false;
+        }
+        // Small writes are merged so each upload write moves a useful amount.
+        std::deque<std::vector<char>>& chunks = current_->chunks;
+        if (chunks.empty() || chunks.back().size() >= kVfsCopyChunk) {
+            chunks.emplace_back();
+            chunks.back().reserve(std::max(size, kVfsCopyChunk));
+        }
+        chunks.back().insert(chunks.back().end(), data, data + size);
+        buffered_ += size;
+        changed_.notify_all();
+        return true;
+    }
+    bool closeFile(std::string& error) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_->complete = true;
+        current_.reset();
+        changed_.notify_all();
+        return checkFailed(error);
+    }
+
+    // Waits for the queued uploads, then makes the empty folders.
+    bool finish(std::string& error) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [&]() { return failed_ || (pending_.empty() && busy_ == 0); });
+            if (!checkFailed(error)) {
+                return false;
+            }
+        }
+        stop();
+        // Parents sort before their children, so each mkdir has somewhere to go.
+        for (const std::string& dir : dirs_) {
+            if (filled_.count(dir) == 0) {
+                std::string ignored;
+                backend_.mkdir(backend_.join(root_, dir), ignored);
+            }
+        }
+        // Uploads only refresh the folder they land in; new subfolders show up in the
+        // listings above them too.
+        backend_.invalidate(root_);
+        for (const std::set<std::string>* set : {&dirs_, &filled_}) {
+            for (const std::string& dir : *set) {
+                backend_.invalidate(backend_.join(root_, dir));
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Upload {
+        std::string relPath;
+        std::uint64_t size = 0;
+        std::deque<std::vector<char>> chunks;
+        bool complete = false;
+    };
+
+    bool checkFailed(std::string& error) {
+        if (failed_) {
+            error = error_;
+            return false;
+        }
+        return true;
+    }
+    void setActivity(size_t slot, const Upload* upload, std::uint64_t done) {
+        std::lock_guard<std::mutex> lock(progress_.mutex);
+        progress_.active[slot] = upload ? ExtractActivity {upload->relPath, upload->size, done} : ExtractActivity {};
+    }
+    void work(size_t slot) {
+        while (true) {
+            std::shared_ptr<Upload> upload;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                changed_.wait(lock, [&]() { return stopping_ || failed_ || !pending_.empty(); });
+                if (stopping_ || failed_) {
+                    return;
+                }
+                upload = pending_.front();
+                pending_.pop_front();
+                ++busy_;
+            }
+            std::string error;
+            bool ok = send(*upload, slot, error);
+            setActivity(slot, nullptr, 0);
+            std::lock_guard<std::mutex> lock(mutex_);
+            --busy_;
+            if (!ok && !failed_) {
+                failed_ = true;
+                error_ = error;
+            }
+            changed_.notify_all();
+        }
+    }
+    // A writer dropped before close removes the partial file from the server.
+    bool send(Upload& upload, size_t slot, std::string& error) {
+        std::unique_ptr<VfsWriteStream> writer = backend_.openWrite(backend_.join(root_, upload.relPath), upload.size, error);
+        if (!writer) {
+            return false;
+        }
+        writer->setCancel(&progress_.cancel);
+        setActivity(slot, &upload, 0);
+        std::uint64_t sent = 0;
+        std::vector<char> chunk;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                changed_.wait(lock, [&]() { return stopping_ || failed_ || upload.complete || !upload.chunks.empty(); });
+                if (stopping_ || failed_) {
+                    error = "Cancelled";
+                    return false;
+                }
+                if (upload.chunks.empty()) {
+                    break;
+                }
+                chunk = std::move(upload.chunks.front());
+                upload.chunks.pop_front();
+                buffered_ -= chunk.size();
+                changed_.notify_all();
+            }
+            if (progress_.cancel) {
+                error = "Cancelled";
+                return false;
+            }
+            if (!writer->write(chunk.data(), chunk.size(), error)) {
+                return false;
+            }
+            sent += chunk.size();
+            progress_.bytesDone += chunk.size();
+            setActivity(slot, &upload, sent);
+        }
+        if (!writer->close(error)) {
+            return false;
+        }
+        ++progress_.filesDone;
+        return true;
+    }
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            changed_.notify_all();
+        }
+        for (auto& worker : workers_) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+    VfsBackend& backend_;
+    std::string root_;
+    ExtractProgress& progress_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<std::shared_ptr<Upload>> pending_;
+    std::shared_ptr<Upload> current_;
+    size_t buffered_ = 0;
+    int busy_ = 0;
+    bool stopping_ = false;
+    bool failed_ = false;
+    std::string error_;
+    // Folders listed in the archive, and the ones the uploads create on their own.
+    std::set<std::string> dirs_;
+    std::set<std::string> filled_;
+};
+
+// Extracts a local archive straight into a folder on the server; see VfsExtractSink.
+static bool extractToRemote(ArchiveKind kind, const fs::path& archivePath, VfsBackend& backend,
+                            const std::string& destDir, TransferContext* ctx, std::string& error) {
+    std::string item = archivePath.filename().string();
+    if (kind == ArchiveKind::Zip) {
+        ZipArchive archive;
+        if (!archive.open(archivePath, error)) {
+            return false;
+        }
+        if (!zipExtractSupported(archive)) {
+            error = "Archive needs unzip; extract it locally";
+            return false;
+        }
+        int totalFiles = 0;
+        for (const ZipEntry& entry : archive.entries()) {
+            totalFiles += entry.isDir ? 0 : 1;
+        }
+        return runSourceExtraction(
+            ctx, "Extracting", item, archive.totalUncompressedSize(), totalFiles,
+            [&](ExtractProgress& progress, std::string& runError) {
+                VfsExtractSink sink(backend, destDir, progress, kUploadConnections);
+                return extractZipArchive(archive, sink, progress, runError) && sink.finish(runError);
+            },
+            error, true);
+    }
+#ifdef USE_LIBARCHIVE
+    std::uintmax_t archiveSize = archiveSetSize(archivePath);
+    return runSourceExtraction(
+        ctx, "Extracting", item, archiveSize, 0,
+        [&](ExtractProgress& progress, std::string& runError) {
+            VfsExtractSink sink(backend, destDir, progress, kUploadConnections);
+            return extractStreamArchive(archivePath, sink, progress, runError) && sink.finish(runError);
+        },
+        error);
+#else
+    error = "Unsupported archive";
+    return false;
+#endif
+}
+#endif
+
+static std::future<VfsResult<std::vector<Entry>>> requestListing(const Pane& pane, const Settings& settings) {
+    std::shared_ptr<VfsBackend> backend = paneBackend(pane, settings);
+    if (!backend) {
+        return {};
+    }
+    return backend->listAsync(paneDir(pane), settings.showHidden, true);
+}
+
+static void applyListing(Pane& pane, const Settings& settings, std::future<VfsResult<std::vector<Entry>>> pending,
+                         StatusMessage* status) {
+    pane.entries.clear();
+    if (pane.source == PaneSource::Local) {
+        pane.lastLocalCwd = pane.cwd;
+    }
+    setPaneDir(pane, paneDir(pane));
+    std::shared_ptr<VfsBackend> backend = paneBackend(pane, settings);
+    if (!backend || !pending.valid()) {
+        if (status) {
+            setStatus(*status, paneUnavailableReason(pane));
+        }
+        return;
+    }
+    std::string dir = paneDir(pane);
+    std::string up = backend->parent(dir);
+    // An archive root leads back out to the folder holding the archive.
+    if (up != dir || pane.source == PaneSource::Archive) {
+        Entry parentEntry {"..", {}, true, true};
+        if (backend->capabilities().localFiles) {
+            parentEntry.path = fs::path(up);
+        }
+        pane.entries.push_back(parentEntry);
+    }
+
+    VfsResult<std::vector<Entry>> listing = pending.get();
+    if (listing.ok) {
+        pane.entries.insert(pane.entries.end(), listing.value.begin(), listing.value.end());
+    } else if (status) {
+        setStatus(*status, "List failed: " + listing.error);
+    }
+
+    if (pane.selected >= static_cast<int>(pane.entries.size())) {
+        pane.selected = static_cast<int>(pane.entries.size()) - 1;
+    }
+    if (pane.selected < 0) {
+        pane.selected = 0;
+    }
+    if (pane.scroll > pane.selected) {
+        pane.scroll = pane.selected;
+    }
+}
+
+static void loadEntries(Pane& pane, const Settings& settings, StatusMessage* status = nullptr) {
+    applyListing(pane, settings, requestListing(pane, settings), status);
+}
+
+// Lists both panes at once, so refreshing after a transfer waits for the slower side only.
+static void loadBothPanes(Pane panes[2], const Settings& settings, StatusMessage* status) {
+    auto first = requestListing(panes[0], settings);
+    auto second = requestListing(panes[1], settings);
+    applyListing(panes[0], settings, std::move(first), status);
+    applyListing(panes[1], settings, std::move(second), status);
+}
+
+static void resetPanePosition(Pane& pane) {
+    pane.selected = 0;
+    pane.scroll = 0;
+}
+
+static void connectToFtp(Pane& pane, const Settings& settings, StatusMessage& status) {
+    if (settings.ftpHost.empty()) {
+        setStatus(status, "FTP host not set");
+        return;
+    }
+    pane.source = PaneSource::Ftp;
+    pane.ftpPath = "/";
+    resetPanePosition(pane);
+    loadEntries(pane, settings, &status);
+}
+
+static bool copyBetweenPanes(const Entry& entry, const Pane& src, const Pane& dst, const Settings& settings,
+                             TransferContext* ctx, const std::string& title, std::string& error) {
+    std::shared_ptr<VfsBackend> srcFs = paneBackend(src, settings);
+    std::shared_ptr<VfsBackend> dstFs = paneBackend(dst, settings);
+    if (!srcFs || !dstFs) {
+        error = paneUnavailableReason(srcFs ? dst : src);
+        return false;
+    }
+    return vfsCopyPath(*srcFs, srcFs->join(paneDir(src), entry.name), entry,
+                       *dstFs, dstFs->join(paneDir(dst), entry.name), ctx, title, settings.ftpVerify, error);
 }
 
 static bool deleteFromPane(const Pane& pane, const Entry& entry, const Settings& settings, std::string& error) {
-    if (pane.source == PaneSource::Local) {
-        return deleteEntry(entry, error);
-    }
-#ifdef USE_CURL
-    std::string remotePath = ftpJoinPath(pane.ftpPath, entry.name);
-    if (entry.isDir) {
-        return ftpDeleteRecursive(settings, remotePath, error);
+    std::shared_ptr<VfsBackend> backend = paneBackend(pane, settings);
+    if (!backend) {
+        error = paneUnavailableReason(pane);
+        return false;
     }
-    return ftpDeletePath(settings, remotePath, false, error);
-#else
-    error = "FTP delete not supported";
-    return false;
-#endif
+    return backend->remove(backend->join(paneDir(pane), entry.name), entry.isDir, error);
 }
 
 static bool renameInPane(const Pane& pane, const Entry& entry, const Settings& settings, const std::string& newName, std::string& error) {
-    if (pane.source == PaneSource::Local) {
-        return renameEntry(entry, newName, error);
+    std::shared_ptr<VfsBackend> backend = paneBackend(pane, settings);
+    if (!backend) {
+        error = paneUnavailableReason(pane);
+        return false;
     }
-#ifdef USE_CURL
-    std::string fromPath = ftpJoinPath(pane.ftpPath, entry.name);
-    std::string toPath = ftpJoinPath(pane.ftpPath, newName);
-    return ftpRenamePath(settings, fromPath, toPath, error);
-#else
-    error = "FTP rename not supported";
-    return false;
-#endif
+    std::string target = backend->join(paneDir(pane), newName);
+    Entry existing;
+    if (backend->stat(target, existing, error)) {
+        error = "Target already exists";
+        return false;
+    }
+    if (!error.empty()) {
+        return false;
+    }
+    return backend->rename(backend->join(paneDir(pane), entry.name), target, error);
 }
 
 static bool createDirInPane(const Pane& pane, const Settings& settings, const std::string& name, std::string& error) {
-    if (pane.source == PaneSource::Local) {
-        if (name.empty()) {
-            error = "Folder name required";
-            return false;
-        }
-        fs::path target = pane.cwd / name;
-        if (fs::exists(target)) {
-            error = "Target already exists";
-            return false;
-        }
-        std::error_code ec;
-        if (!fs::create_directory(target, ec) || ec) {
-            error = ec ? ec.message() : "Failed to create folder";
-            return false;
-        }
-        return true;
-    }
-#ifdef USE_CURL
     if (name.empty()) {
         error = "Folder name required";
         return false;
     }
-    bool isDir = false;
-    if (ftpEntryExists(settings, pane.ftpPath, name, isDir, error)) {
+    std::shared_ptr<VfsBackend> backend = paneBackend(pane, settings);
+    if (!backend) {
+        error = paneUnavailableReason(pane);
+        return false;
+    }
+    std::string target = backend->join(paneDir(pane), name);
+    Entry existing;
+    if (backend->stat(target, existing, error)) {
         error = "Target already exists";
         return false;
     }
     if (!error.empty()) {
         return false;
     }
-    std::string remotePath = ftpJoinPath(pane.ftpPath, name);
-    return ftpCreateDir(settings, remotePath, error);
-#else
-    error = "FTP create not supported";
-    return false;
-#endif
+    return backend->mkdir(target, error);
 }
 
 static bool moveBetweenPanes(const Entry& entry, const Pane& src, const Pane& dst, const Settings& settings,
                              TransferContext* ctx, const std::string& title, std::string& error) {
-    if (src.source == PaneSource::Local && dst.source == PaneSource::Local) {
-        fs::path target = dst.cwd / entry.name;
-        if (!copyLocalPathWithProgress(entry.path, target, ctx, title, error)) {
+    std::shared_ptr<VfsBackend> srcFs = paneBackend(src, settings);
+    std::shared_ptr<VfsBackend> dstFs = paneBackend(dst, settings);
+    if (!srcFs || !dstFs) {
+        error = paneUnavailableReason(srcFs ? dst : src);
+        return false;
+    }
+    std::string fromPath = srcFs->join(paneDir(src), entry.name);
+    std::string toPath = dstFs->join(paneDir(dst), entry.name);
+    if (srcFs->key() == dstFs->key() && srcFs->capabilities().serverSideRename) {
+        Entry existing;
+        if (dstFs->stat(toPath, existing, error)) {
+            error = "Target already exists";
             return false;
         }
-        std::error_code ec;
-        if (entry.isDir) {
-            fs::remove_all(entry.path, ec);
-        } else {
-            fs::remove(entry.path, ec);
-        }
-        if (ec) {
-            error = "Move delete failed";
+        if (!error.empty()) {
             return false;
         }
-        return true;
+        if (srcFs->rename(fromPath, toPath, error)) {
+            return true;
+        }
+        // Renames fail across devices; fall back to copying.
+        error.clear();
     }
-    if (!copyBetweenPanes(entry, src, dst, settings, ctx, title, error)) {
+    if (!vfsCopyPath(*srcFs, fromPath, entry, *dstFs, toPath, ctx, title, settings.ftpVerify, error)) {
         return false;
     }
     std::string deleteError;
-    if (!deleteFromPane(src, entry, settings, deleteError)) {
+    if (!srcFs->remove(fromPath, entry.isDir, deleteError)) {
         error = "Move delete failed: " + deleteError;
         return false;
     }
     return true;
 }
 
+struct SteamScanItem {
+    fs::path exe;
+    std::string name;
+    bool selected = true;
+    // Steam already has a shortcut to this executable; offered unselected.
+    bool inSteam = false;
+};
+
+// Games found below a folder by "Add Games to Steam", waiting for the user to pick.
+struct SteamScan {
+    fs::path root;
+    int folders = 0;
+    std::vector<SteamScanItem> items;
+    int index = 0;
+    int scroll = 0;
+};
+
+// shortcuts.vdf keeps the Exe field quoted.
+static std::string shortcutExeKey(const std::string& exe) {
+    std::string path = exe;
+    if (path.size() >= 2 && path.front() == '"' && path.back() == '"') {
+        path = path.substr(1, path.size() - 2);
+    }
+    return fs::absolute(fs::path(path)).lexically_normal().string();
+}
+
+// Every subfolder of root is taken as one game; its folders are walked in parallel for
+// the executable that starts it (see findMainExecutable).
+static bool scanGamesWithProgress(const fs::path& root, TransferContext* ctx, SteamScan& scan, std::string& error) {
+    scan = SteamScan {};
+    scan.root = root;
+    GameScanProgress progress;
+    std::vector<GameCandidate> games;
+    startTransferItem(ctx, "Scanning for games", root.filename().string());
+    std::atomic<bool> done {false};
+    bool ok = false;
+    std::thread runner([&]() {
+        ok = scanGameFolders(root, 0, games, progress, error);
+        done = true;
+    });
+    while (!done) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+        if (transferCancelled(ctx)) {
+            progress.cancel = true;
+        }
+        int total = progress.folders;
+        updateTransferCount(ctx, progress.foldersDone, total);
+        updateTransferProgress(ctx, total > 0 ? static_cast<double>(progress.foldersDone) / total : 0.0);
+    }
+    runner.join();
+    if (!ok) {
+        return false;
+    }
+    scan.folders = progress.folders;
+
+    // Without a readable shortcuts.vdf every game is simply offered.
+    std::unordered_set<std::string> known;
+    SteamShortcuts shortcuts;
+    std::string steamError;
+    if (shortcuts.load(steamError)) {
+        for (const SteamShortcut& shortcut : shortcuts.list()) {
+            known.insert(shortcutExeKey(shortcut.exe));
+        }
+    }
+    for (const GameCandidate& game : games) {
+        SteamScanItem item;
+        item.exe = game.exe;
+        item.name = defaultSteamAppName(Entry {game.folder.filename().string(), game.folder, true, false});
+        item.inSteam = known.count(shortcutExeKey(game.exe.string())) > 0;
+        item.selected = !item.inSteam;
+        scan.items.push_back(item);
+    }
+    return true;
+}
+
+// Adds the selected games with a single write of shortcuts.vdf, and of config.vdf when
+// a compatibility tool is set. As with addExeToSteam, a failed compatibility mapping
+// still returns true, with error set.
+static bool addScannedGamesToSteam(const SteamScan& scan, const Settings& settings, int& added, std::string& error) {
+    added = 0;
+    SteamShortcuts shortcuts;
+    if (!shortcuts.load(error)) {
+        return false;
+    }
+    std::vector<std::uint32_t> appIds;
+    for (const SteamScanItem& item : scan.items) {
+        if (!item.selected) {
+            continue;
+        }
+        std::uint32_t appId = 0;
+        if (!shortcuts.add(item.exe, item.exe.parent_path(), item.name, settings.steamLaunchOptions, appId, error)) {
+            return false;
+        }
+        appIds.push_back(appId);
+    }
+    if (appIds.empty()) {
+        error = "Nothing selected";
+        return false;
+    }
+    if (!shortcuts.commit(error)) {
+        return false;
+    }
+    added = static_cast<int>(appIds.size());
+    std::string compatError;
+    if (!setSteamCompatToolMappings(appIds, settings.steamCompatibilityToolVersion, compatError)) {
+        error = compatError;
+    }
+    return true;
+}
+
+struct SteamLibraryRow {
+    SteamApp app;
+    std::uint64_t installBytes = 0;
+    std::uint64_t shaderBytes = 0;
+    std::uint64_t compatBytes = 0;
+
+    std::uint64_t total() const {
+        return installBytes + shaderBytes + compatBytes;
+    }
+};
+
+// A library the selected game can be moved to.
+struct SteamMoveTarget {
+    fs::path library;
+    bool hasFree = false;
+    std::uint64_t freeBytes = 0;
+};
+
+// Installed Steam games with what each takes on disk, largest first.
+struct SteamLibraryView {
+    std::vector<fs::path> libraries;
+    std::vector<SteamLibraryRow> rows;
+    std::uint64_t installBytes = 0;
+    std::uint64_t shaderBytes = 0;
+    std::uint64_t compatBytes = 0;
+    int index = 0;
+    int scroll = 0;
+    std::vector<SteamMoveTarget> moveTargets;
+    int moveIndex = 0;
+};
+
+// Reads the manifests of every library and measures each game's install folder, shader
+// cache and Proton prefix, all on a pool of workers. Folders are remembered in cache,
+// so reopening only checks directory times.
+static bool loadSteamLibraryWithProgress(DiskUsageCache& cache, TransferContext* ctx, SteamLibraryView& view,
+                                         std::string& error) {
+    view = SteamLibraryView {};
+    view.libraries = findSteamLibraries();
+    finishSteamAppMoves(view.libraries);
+    std::vector<SteamApp> apps;
+    if (!listSteamApps(view.libraries, apps, error)) {
+        return false;
+    }
+    std::vector<fs::path> paths;
+    for (const SteamApp& app : apps) {
+        paths.push_back(app.installPath());
+        paths.push_back(app.shaderCachePath());
+        paths.push_back(app.compatDataPath());
+    }
+    startTransferItem(ctx, "Measuring Steam games", std::to_string(apps.size()) + " games");
+    std::vector<std::uint64_t> bytes;
+    std::atomic<int> done {0};
+    std::atomic<bool> cancel {false};
+    std::atomic<bool> finished {false};
+    bool ok = false;
+    std::thread runner([&]() {
+        ok = measureDiskUsage(cache, paths, 0, bytes, done, cancel);
+        finished = true;
+    });
+    int total = static_cast<int>(paths.size());
+    while (!finished) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+        if (transferCancelled(ctx)) {
+            cancel = true;
+        }
+        updateTransferCount(ctx, done / 3, static_cast<int>(apps.size()));
+        updateTransferProgress(ctx, total > 0 ? static_cast<double>(done) / total : 0.0);
+    }
+    runner.join();
+    if (!ok) {
+        error = "Cancelled";
+        return false;
+    }
+    for (size_t i = 0; i < apps.size(); ++i) {
+        SteamLibraryRow row;
+        row.app = apps[i];
+        row.installBytes = bytes[i * 3];
+        row.shaderBytes = bytes[i * 3 + 1];
+        row.compatBytes = bytes[i * 3 + 2];
+        view.installBytes += row.installBytes;
+        view.shaderBytes += row.shaderBytes;
+        view.compatBytes += row.compatBytes;
+        view.rows.push_back(row);
+    }
+    std::sort(view.rows.begin(), view.rows.end(), [](const SteamLibraryRow& a, const SteamLibraryRow& b) {
+        return a.total() > b.total();
+    });
+    return true;
+}
+
+// Moves a game to another library; the bar follows the bytes copied, which stays empty
+// when the folders could simply be renamed.
+static bool moveSteamAppWithProgress(const SteamLibraryRow& row, const fs::path& toLibrary, TransferContext* ctx,
+                                     std::string& error) {
+    return runSourceExtraction(
+        ctx, "Moving", row.app.name, row.total(), 0,
+        [&](ExtractProgress& progress, std::string& runError) {
+            return moveSteamApp(row.app, toLibrary, progress, runError);
+        },
+        error, true);
+}
+
 static void handleActionSelection(int menuIndex,
                                   ActionContext& action,
                                   Pane panes[2],
@@ -2304,8 +4350,10 @@ static void handleActionSelection(int menuIndex,
                                   std::string& addToSteamName,
                                   size_t& addToSteamCursor,
                                   OskState& osk,
+                                  ArchivePicker& picker,
+                                  SteamScan& steamScan,
                                   TransferContext* transferCtx) {
-    auto options = buildActionOptions(action.entry, panes[action.paneIndex]);
+    auto options = buildActionOptions(action.entry, panes[action.paneIndex], panes[1 - action.paneIndex]);
     if (options.empty()) {
         mode = Mode::Browse;
         return;
@@ -2347,13 +4395,152 @@ static void handleActionSelection(int menuIndex,
         SDL_StartTextInput();
         return;
     }
+    if (option == "Add Games to Steam") {
+        std::string error;
+        bool ok = scanGamesWithProgress(action.entry.path, transferCtx, steamScan, error);
+        if (transferCtx) {
+            finishTransfer(transferCtx);
+        }
+        if (!ok) {
+            setStatus(status, "Scan failed: " + error);
+            mode = Mode::Browse;
+        } else if (steamScan.items.empty()) {
+            setStatus(status, "No games found in " + std::to_string(steamScan.folders) + " folders");
+            mode = Mode::Browse;
+        } else {
+            mode = Mode::SteamScan;
+        }
+        return;
+    }
+    if (option == "Extract Selected") {
+        picker = ArchivePicker {};
+        picker.archivePath = action.entry.path;
+        picker.destDir = panes[action.paneIndex].cwd;
+        archiveKindOf(action.entry, panes[action.paneIndex], picker.kind);
+        std::string error;
+        if (!buildArchivePicker(picker, error)) {
+            setStatus(status, "Open archive failed: " + error);
+            mode = Mode::Browse;
+            return;
+        }
+        mode = Mode::ExtractSelect;
+        return;
+    }
+    if (option == "Compress to ZIP" || option == "Compress to TAR.ZST") {
+        std::string error;
+        fs::path target;
+        bool ok = compressWithProgress(action.entry.path, option == "Compress to TAR.ZST", transferCtx, target, error);
+        setStatus(status, ok ? "Created " + target.filename().string() : ("Compress failed: " + error));
+        if (transferCtx) {
+            finishTransfer(transferCtx);
+        }
+        loadEntries(panes[action.paneIndex], settings, &status);
+        mode = Mode::Browse;
+        return;
+    }
+#ifdef USE_CURL
+    if (option == "Extract Here") {
+        Pane& src = panes[action.paneIndex];
+        Pane& dst = panes[1 - action.paneIndex];
+        std::shared_ptr<VfsBackend> backend = paneBackend(src, settings);
+        std::string error;
+        ArchiveKind kind = ArchiveKind::Zip;
+        bool ok = false;
+        if (dst.source != PaneSource::Local) {
+            error = "Open a local folder in the other pane";
+        } else if (!backend || !remoteArchiveKindOf(action.entry, src, kind)) {
+            error = "Unsupported archive";
+        } else {
+            ok = extractRemoteArchive(*backend, backend->join(paneDir(src), action.entry.name), action.entry, kind,
+                                      dst.cwd, settings, transferCtx, error);
+        }
+        setStatus(status, ok ? "Extracted" : ("Extract failed: " + error));
+        if (transferCtx) {
+            finishTransfer(transferCtx);
+        }
+        loadEntries(dst, settings, &status);
+        mode = Mode::Browse;
+        return;
+    }
+    if (option == "Extract to FTP") {
+        Pane& dst = panes[1 - action.paneIndex];
+        std::shared_ptr<VfsBackend> backend = paneBackend(dst, settings);
+        std::string error;
+        ArchiveKind kind = ArchiveKind::Zip;
+        bool ok = false;
+        if (!backend || !archiveKindOf(action.entry, panes[action.paneIndex], kind)) {
+            error = "Unsupported archive";
+        } else {
+            ok = extractToRemote(kind, action.entry.path, *backend, paneDir(dst), transferCtx, error);
+        }
+        setStatus(status, ok ? "Extracted" : ("Extract failed: " + error));
+        if (transferCtx) {
+            finishTransfer(transferCtx);
+        }
+        loadEntries(dst, settings, &status);
+        mode = Mode::Browse;
+        return;
+    }
+#endif
+    if (option == "Test Archive") {
+        std::string error;
+        ArchiveKind kind = ArchiveKind::Zip;
+        ArchiveTestResult result;
+        bool ok = false;
+        auto started = std::chrono::steady_clock::now();
+        if (archiveKindOf(action.entry, panes[action.paneIndex], kind)) {
+            ok = testArchiveWithProgress(kind, action.entry.path, transferCtx, result, error);
+        } else {
+            error = "Unsupported archive";
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        if (!result.corrupt.empty()) {
+            std::string names;
+            for (size_t i = 0; i < result.corrupt.size() && i < 3; ++i) {
+                names += (i > 0 ? ", " : "") + result.corrupt[i];
+            }
+            if (result.corrupt.size() > 3) {
+                names += ", ...";
+            }
+            setStatus(status, "Test failed: " + std::to_string(result.corrupt.size()) + " corrupt (" + names + ")");
+        } else if (!ok) {
+            setStatus(status, "Test failed: " + error);
+        } else {
+            setStatus(status, "Archive OK: " + std::to_string(result.files) + " files, " + formatBytes(result.bytes) +
+                                  " at " + formatRate(seconds > 0.0 ? result.bytes / seconds : 0.0));
+        }
+        if (transferCtx) {
+            finishTransfer(transferCtx);
+        }
+        mode = Mode::Browse;
+        return;
+    }
+    if (option == "Extract (Update)") {
+        std::string error;
+        ExtractSummary summary;
+        bool ok = extractArchiveWithProgress(ArchiveKind::Zip, action.entry.path, panes[action.paneIndex].cwd, nullptr,
+                                             transferCtx, error, &summary);
+        if (ok) {
+            setStatus(status, "Updated: " + std::to_string(summary.filesWritten) + " written (" +
+                                  formatBytes(summary.bytesWritten) + "), " + std::to_string(summary.filesSkipped) +
+                                  " unchanged (" + formatBytes(summary.bytesSkipped) + ")");
+        } else {
+            setStatus(status, "Update failed: " + error);
+        }
+        if (transferCtx) {
+            finishTransfer(transferCtx);
+        }
+        loadEntries(panes[action.paneIndex], settings, &status);
+        mode = Mode::Browse;
+        return;
+    }
     if (option == "Extract") {
         std::string error;
+        ArchiveKind kind = ArchiveKind::Zip;
         bool ok = false;
-        if (isZipArchive(action.entry, panes[action.paneIndex])) {
-            ok = extractZipWithProgress(action.entry.path, panes[action.paneIndex].cwd, transferCtx, error);
-        } else if (isRarArchive(action.entry, panes[action.paneIndex])) {
-            ok = extractRarWithProgress(action.entry.path, panes[action.paneIndex].cwd, transferCtx, error);
+        if (archiveKindOf(action.entry, panes[action.paneIndex], kind)) {
+            ok = extractArchiveWithProgress(kind, action.entry.path, panes[action.paneIndex].cwd, nullptr, transferCtx,
+                                            error);
         } else {
             error = "Unsupported archive";
         }
@@ -2474,7 +4661,60 @@ static bool isRarArchive(const Entry& entry, const Pane& pane) {
     return ext == ".rar";
 }
 
+static bool isStreamArchive(const Entry& entry, const Pane& pane) {
+#ifdef USE_LIBARCHIVE
+    if (pane.source != PaneSource::Local) {
+        return false;
+    }
+    if (entry.isDir || entry.isParent) {
+        return false;
+    }
+    return isStreamArchiveName(entry.path.filename().string());
+#else
+    (void)entry;
+    (void)pane;
+    return false;
+#endif
+}
+
+// Archives in an FTP pane, told apart by name. They can be extracted but not browsed.
+static bool remoteArchiveKindOf(const Entry& entry, const Pane& pane, ArchiveKind& kind) {
+    if (pane.source != PaneSource::Ftp || entry.isDir || entry.isParent) {
+        return false;
+    }
+    std::string ext = toLower(fs::u8path(entry.name).extension().string());
+    if (ext == ".zip") {
+        kind = ArchiveKind::Zip;
+    } else if (ext == ".rar") {
+        kind = ArchiveKind::Rar;
+#ifdef USE_LIBARCHIVE
+    } else if (isStreamArchiveName(entry.name)) {
+        kind = ArchiveKind::Stream;
+#endif
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool archiveKindOf(const Entry& entry, const Pane& pane, ArchiveKind& kind) {
+    if (isZipArchive(entry, pane)) {
+        kind = ArchiveKind::Zip;
+    } else if (isRarArchive(entry, pane)) {
+        kind = ArchiveKind::Rar;
+    } else if (isStreamArchive(entry, pane)) {
+        kind = ArchiveKind::Stream;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 static std::string defaultSteamAppName(const Entry& entry) {
+    // A game folder's name is the title as is; dots in it are not an extension.
+    if (entry.isDir) {
+        return entry.name;
+    }
     std::string name = entry.path.stem().string();
     if (name.empty()) {
         return entry.name;
@@ -2482,134 +4722,122 @@ static std::string defaultSteamAppName(const Entry& entry) {
     return name;
 }
 
-static std::vector<std::string> buildActionOptions(const Entry& entry, const Pane& pane) {
+static std::vector<std::string> buildActionOptions(const Entry& entry, const Pane& pane, const Pane& other) {
+    if (pane.source == PaneSource::Archive) {
+        return {"Copy"};
+    }
     std::vector<std::string> options = {"Copy", "Move", "Delete", "Rename", "Create New Folder"};
-    if (isZipArchive(entry, pane) || isRarArchive(entry, pane)) {
-        options.insert(options.begin() + 2, "Extract");
+    ArchiveKind kind;
+    if (archiveKindOf(entry, pane, kind)) {
+        options.insert(options.begin() + 2, {"Extract", "Extract Selected"});
+#ifdef USE_CURL
+        if (other.source == PaneSource::Ftp) {
+            options.insert(options.begin() + 4, "Extract to FTP");
+        }
+#else
+        (void)other;
+#endif
+        bool testable = kind == ArchiveKind::Zip;
+#ifdef USE_LIBARCHIVE
+        testable = true;
+#endif
+        if (testable) {
+            options.insert(std::find(options.begin(), options.end(), "Extract Selected") + 1, "Test Archive");
+        }
+        if (kind == ArchiveKind::Zip) {
+            options.insert(std::find(options.begin(), options.end(), "Extract Selected") + 1, "Extract (Update)");
+        }
+    } else if (remoteArchiveKindOf(entry, pane, kind)) {
+        options.insert(options.begin() + 2, "Extract Here");
+    }
+    if (pane.source == PaneSource::Local && !entry.isParent) {
+        options.push_back("Compress to ZIP");
+#ifdef USE_LIBARCHIVE
+        options.push_back("Compress to TAR.ZST");
+#endif
     }
     if (supportsAddToSteam() && (isWindowsExe(entry, pane) || isAppImage(entry, pane) || isShellScript(entry, pane))) {
         options.push_back("Add to Steam");
     }
+    if (supportsAddToSteam() && pane.source == PaneSource::Local && entry.isDir && !entry.isParent) {
+        options.push_back("Add Games to Steam");
+    }
     return options;
 }
 
-static bool statusActive(const StatusMessage& status) {
-    using namespace std::chrono;
-    return !status.text.empty() && (steady_clock::now() - status.started) < seconds(4);
-}
-
-static bool copyEntry(const Entry& entry, const fs::path& targetDir, std::string& error) {
-    fs::path target = targetDir / entry.name;
-    if (fs::exists(target)) {
-        error = "Target already exists";
-        return false;
-    }
-    try {
-        if (entry.isDir) {
-            fs::copy(entry.path, target, fs::copy_options::recursive);
-        } else {
-            fs::copy_file(entry.path, target);
+// Switches a local pane into the archive at its root; the pane keeps cwd so leaving
+// the archive lands back on the folder that holds it.
+static bool openArchivePane(Pane& pane, const Entry& entry, const Settings& settings, StatusMessage* status) {
+    std::string error;
+    if (!archiveBackend(entry.path, error)) {
+        if (status) {
+            setStatus(*status, "Open archive failed: " + error);
         }
-    } catch (const fs::filesystem_error& ex) {
-        error = ex.what();
-        return false;
-    }
-    return true;
-}
-
-static bool moveEntry(const Entry& entry, const fs::path& targetDir, std::string& error) {
-    fs::path target = targetDir / entry.name;
-    if (fs::exists(target)) {
-        error = "Target already exists";
         return false;
     }
-    try {
-        fs::rename(entry.path, target);
-        return true;
-    } catch (const fs::filesystem_error&) {
-        if (!copyEntry(entry, targetDir, error)) {
-            return false;
-        }
-        try {
-            if (entry.isDir) {
-                fs::remove_all(entry.path);
-            } else {
-                fs::remove(entry.path);
-            }
-        } catch (const fs::filesystem_error& ex) {
-            error = ex.what();
-            return false;
-        }
-    }
+    pane.source = PaneSource::Archive;
+    pane.archivePath = entry.path;
+    pane.archiveDir = "/";
+    resetPanePosition(pane);
+    loadEntries(pane, settings, status);
     return true;
 }
 
-static bool deleteEntry(const Entry& entry, std::string& error) {
-    try {
-        if (entry.isDir) {
-            fs::remove_all(entry.path);
-        } else {
-            fs::remove(entry.path);
+static void leaveArchivePane(Pane& pane, const Settings& settings, StatusMessage* status) {
+    std::string archiveName = pane.archivePath.filename().string();
+    pane.source = PaneSource::Local;
+    pane.archivePath.clear();
+    pane.archiveDir = "/";
+    resetPanePosition(pane);
+    loadEntries(pane, settings, status);
+    for (size_t i = 0; i < pane.entries.size(); ++i) {
+        if (!pane.entries[i].isParent && pane.entries[i].name == archiveName) {
+            pane.selected = static_cast<int>(i);
+            break;
         }
-    } catch (const fs::filesystem_error& ex) {
-        error = ex.what();
-        return false;
     }
-    return true;
 }
 
-static bool renameEntry(const Entry& entry, const std::string& newName, std::string& error) {
-    fs::path target = entry.path.parent_path() / newName;
-    if (fs::exists(target)) {
-        error = "Target already exists";
-        return false;
-    }
-    try {
-        fs::rename(entry.path, target);
-    } catch (const fs::filesystem_error& ex) {
-        error = ex.what();
-        return false;
-    }
-    return true;
+static bool statusActive(const StatusMessage& status) {
+    using namespace std::chrono;
+    return !status.text.empty() && (steady_clock::now() - status.started) < seconds(4);
 }
 
-static void enterSelected(Pane& pane, const Settings& settings, StatusMessage* status) {
+static void enterSelected(Pane& pane, const Settings& settings, StatusMessage* status, TransferContext* ctx = nullptr) {
     if (pane.entries.empty()) {
         return;
     }
     Entry entry = pane.entries[static_cast<size_t>(pane.selected)];
-    if (pane.source == PaneSource::Ftp) {
-        if (entry.isParent) {
-            pane.ftpPath = ftpParentPath(pane.ftpPath);
-            resetPanePosition(pane);
-            loadEntries(pane, settings, status);
-            return;
-        }
-        if (entry.isDir) {
-            pane.ftpPath = ftpJoinPath(pane.ftpPath, entry.name);
-            resetPanePosition(pane);
-            loadEntries(pane, settings, status);
-        } else if (status) {
-            setStatus(*status, "Open not supported on FTP");
+    std::shared_ptr<VfsBackend> backend = paneBackend(pane, settings);
+    if (!backend) {
+        if (status) {
+            setStatus(*status, paneUnavailableReason(pane));
         }
         return;
     }
-
-    if (entry.isParent) {
-        pane.cwd = entry.path;
-        resetPanePosition(pane);
-        loadEntries(pane, settings, status);
+    std::string dir = paneDir(pane);
+    if (entry.isParent && pane.source == PaneSource::Archive && backend->parent(dir) == dir) {
+        leaveArchivePane(pane, settings, status);
         return;
     }
-    if (entry.isDir) {
-        pane.cwd = entry.path;
+    if (isZipArchive(entry, pane)) {
+        openArchivePane(pane, entry, settings, status);
+        return;
+    }
+    if (entry.isParent || entry.isDir) {
+        setPaneDir(pane, entry.isParent ? backend->parent(dir) : backend->join(dir, entry.name));
         resetPanePosition(pane);
         loadEntries(pane, settings, status);
         return;
     }
     if (status) {
         std::string error;
-        if (openLocalFile(entry.path, error)) {
+        fs::path localPath;
+        bool ok = fetchLocalCopy(*backend, backend->join(dir, entry.name), entry, settings, ctx, localPath, error);
+        if (ctx) {
+            finishTransfer(ctx);
+        }
+        if (ok && openLocalFile(localPath, error)) {
             setStatus(*status, "Opened");
         } else {
             setStatus(*status, "Open failed: " + error);
@@ -2618,17 +4846,21 @@ static void enterSelected(Pane& pane, const Settings& settings, StatusMessage* s
 }
 
 static void goUp(Pane& pane, const Settings& settings, StatusMessage* status) {
-    if (pane.source == PaneSource::Ftp) {
-        pane.ftpPath = ftpParentPath(pane.ftpPath);
-        resetPanePosition(pane);
-        loadEntries(pane, settings, status);
+    std::shared_ptr<VfsBackend> backend = paneBackend(pane, settings);
+    if (!backend) {
         return;
     }
-    if (pane.cwd.has_parent_path()) {
-        pane.cwd = pane.cwd.parent_path();
-        resetPanePosition(pane);
-        loadEntries(pane, settings, status);
+    std::string dir = paneDir(pane);
+    std::string up = backend->parent(dir);
+    if (up == dir) {
+        if (pane.source == PaneSource::Archive) {
+            leaveArchivePane(pane, settings, status);
+        }
+        return;
     }
+    setPaneDir(pane, up);
+    resetPanePosition(pane);
+    loadEntries(pane, settings, status);
 }
 
 int main(int argc, char** argv) {
@@ -2664,6 +4896,8 @@ int main(int argc, char** argv) {
     if (!configPath.empty()) {
         fs::path configFile(configPath);
         favoritesPath = (configFile.parent_path() / "favorites.xml").string();
+        settings.ftpCacheDir = configFile.parent_path() / "ftp-cache";
+        setArchiveIndexSpillDir(configFile.parent_path() / "archive-index");
         loadConfig(settings, configPath, homePath);
     }
     settings.uiScale = clampUiScale(settings.uiScale);
@@ -2737,23 +4971,42 @@ int main(int argc, char** argv) {
     ActionContext action;
     StatusMessage status;
 
-    const std::array<std::string, 3> appMenuOptions = {"Settings", "Connect to FTP", "Quit"};
-    const std::array<std::string, 9> settingsOptions = {"FTP Host",
-                                                        "FTP Port",
-                                                        "FTP User",
-                                                        "FTP Password",
-                                                        "Steam Launch Options",
-                                                        "Steam Compatibility Tool",
-                                                        "UI Scale",
-                                                        "Show Hidden",
-                                                        "Back"};
+    const std::array<std::string, 7> appMenuOptions = {"Settings",      "Connect to FTP", "Search FTP", "Sync Panes",
+                                                       "Network Stats", "Steam Library",  "Quit"};
+    const std::array<std::string, 13> settingsOptions = {"FTP Host",
+                                                         "FTP Port",
+                                                         "FTP User",
+                                                         "FTP Password",
+                                                         "FTP Encryption",
+                                                         "FTP Cache Size",
+                                                         "FTP Search Depth",
+                                                         "Verify FTP Transfers",
+                                                         "Steam Launch Options",
+                                                         "Steam Compatibility Tool",
+                                                         "UI Scale",
+                                                         "Show Hidden",
+                                                         "Back"};
 
     std::string renameBuffer;
     std::string createFolderName;
     std::string addToSteamName;
+    std::string searchQuery;
     size_t renameCursor = 0;
     size_t createFolderCursor = 0;
     size_t addToSteamCursor = 0;
+    size_t searchCursor = 0;
+    std::unique_ptr<FtpSearchState> ftpSearch;
+    int searchPaneIndex = 0;
+    int searchResultIndex = 0;
+    int searchResultScroll = 0;
+    SyncPlan syncPlan;
+    int syncIndex = 0;
+    int syncScroll = 0;
+    FtpSpeedTestResult speedTest;
+    ArchivePicker picker;
+    SteamScan steamScan;
+    SteamLibraryView steamLibrary;
+    DiskUsageCache diskUsage;
     OskState osk;
     std::string editBuffer;
     size_t editCursor = 0;
@@ -2762,6 +5015,10 @@ int main(int argc, char** argv) {
     std::unordered_set<SDL_JoystickID> leftTriggerHeld;
     std::unordered_set<SDL_JoystickID> rightTriggerHeld;
 
+    std::atomic<bool> archiveIndexCancel {false};
+    std::future<void> archiveIndexJob;
+    fs::path archiveIndexPath;
+
     bool running = true;
     TransferContext transferCtx {window, renderer, &settings, &running, &transfer};
     while (running) {
@@ -2818,6 +5075,311 @@ int main(int argc, char** argv) {
             mode = Mode::Browse;
             SDL_StopTextInput();
         };
+        auto beginFtpSearch = [&]() {
+            if (panes[activePane].source != PaneSource::Ftp) {
+                setStatus(status, "Search needs an FTP pane");
+                mode = Mode::Browse;
+                return;
+            }
+            searchPaneIndex = activePane;
+            searchCursor = searchQuery.size();
+            osk = {};
+            mode = Mode::FtpSearch;
+            SDL_SetHint(SDL_HINT_ENABLE_SCREEN_KEYBOARD, "0");
+            SDL_StartTextInput();
+        };
+        auto commitFtpSearch = [&]() {
+            SDL_StopTextInput();
+            if (searchQuery.empty()) {
+                setStatus(status, "Search text required");
+                mode = Mode::Browse;
+                return;
+            }
+#ifdef USE_CURL
+            stopFtpSearch(ftpSearch);
+            ftpSearch = startFtpSearch(settings, panes[searchPaneIndex].ftpPath, searchQuery);
+            searchResultIndex = 0;
+            searchResultScroll = 0;
+            mode = Mode::SearchResults;
+#else
+            setStatus(status, "FTP support not built");
+            mode = Mode::Browse;
+#endif
+        };
+        auto cancelFtpSearch = [&]() {
+            mode = Mode::Browse;
+            SDL_StopTextInput();
+        };
+        auto closeSearchResults = [&]() {
+            stopFtpSearch(ftpSearch);
+            mode = Mode::Browse;
+        };
+        auto searchMatchCount = [&]() -> int {
+            if (!ftpSearch) {
+                return 0;
+            }
+            std::lock_guard<std::mutex> lock(ftpSearch->mutex);
+            return static_cast<int>(ftpSearch->matches.size());
+        };
+        auto openSearchResult = [&](int index) {
+            if (!ftpSearch) {
+                return;
+            }
+            FtpSearchMatch match;
+            {
+                std::lock_guard<std::mutex> lock(ftpSearch->mutex);
+                if (index < 0 || index >= static_cast<int>(ftpSearch->matches.size())) {
+                    return;
+                }
+                match = ftpSearch->matches[static_cast<size_t>(index)];
+            }
+            stopFtpSearch(ftpSearch);
+            Pane& pane = panes[searchPaneIndex];
+            if (pane.source != PaneSource::Ftp) {
+                setStatus(status, "FTP pane was closed");
+                mode = Mode::Browse;
+                return;
+            }
+            pane.ftpPath = match.dirPath;
+            resetPanePosition(pane);
+            loadEntries(pane, settings, &status);
+            for (size_t i = 0; i < pane.entries.size(); ++i) {
+                if (!pane.entries[i].isParent && pane.entries[i].name == match.entry.name) {
+                    pane.selected = static_cast<int>(i);
+                    break;
+                }
+            }
+            activePane = searchPaneIndex;
+            mode = Mode::Browse;
+        };
+        auto beginSync = [&]() {
+            const Pane& src = panes[activePane];
+            const Pane& dst = panes[1 - activePane];
+            mode = Mode::Browse;
+            if (src.source == dst.source || src.source == PaneSource::Archive || dst.source == PaneSource::Archive) {
+                setStatus(status, "Sync needs a local and an FTP pane");
+                return;
+            }
+#ifdef USE_CURL
+            bool toFtp = dst.source == PaneSource::Ftp;
+            const fs::path& localRoot = toFtp ? src.cwd : dst.cwd;
+            const std::string& ftpRoot = toFtp ? dst.ftpPath : src.ftpPath;
+            std::string error;
+            bool ok = buildSyncPlan(settings, localRoot, ftpRoot, toFtp, &transferCtx, syncPlan, error);
+            finishTransfer(&transferCtx);
+            if (!ok) {
+                setStatus(status, "Sync failed: " + error);
+                return;
+            }
+            syncIndex = 0;
+            syncScroll = 0;
+            mode = Mode::SyncPlan;
+#else
+            setStatus(status, "FTP support not built");
+#endif
+        };
+        auto runSpeedTest = [&]() {
+#ifdef USE_CURL
+            std::string dir = "/";
+            for (int i = 0; i < 2; ++i) {
+                if (panes[i].source == PaneSource::Ftp) {
+                    dir = paneDir(panes[i]);
+                    break;
+                }
+            }
+            std::string error;
+            FtpSpeedTestResult result;
+            bool ok = runFtpSpeedTest(settings, dir, &transferCtx, result, error);
+            finishTransfer(&transferCtx);
+            if (ok) {
+                speedTest = result;
+                setStatus(status, "Speed test finished");
+            } else {
+                setStatus(status, "Speed test failed: " + error);
+            }
+#else
+            setStatus(status, "FTP support not built");
+#endif
+        };
+        auto syncPlanRows = [&]() -> int {
+            return static_cast<int>(syncPlan.transfers.size()) +
+                   (syncPlan.deleteExtraneous ? static_cast<int>(syncPlan.extraneous.size()) : 0);
+        };
+        auto runSync = [&]() {
+            mode = Mode::Browse;
+#ifdef USE_CURL
+            int filesDone = 0;
+            std::string error;
+            bool ok = executeSyncPlan(settings, syncPlan, &transferCtx, filesDone, error);
+            finishTransfer(&transferCtx);
+            if (ok) {
+                setStatus(status, "Synced " + std::to_string(filesDone) + " files");
+            } else {
+                setStatus(status, "Sync failed: " + error);
+            }
+            loadBothPanes(panes, settings, &status);
+#endif
+        };
+        auto movePicker = [&](int delta) {
+            int totalItems = static_cast<int>(picker.rows.size());
+            if (totalItems > 0) {
+                picker.index = std::clamp(picker.index + delta, 0, totalItems - 1);
+            }
+        };
+        // Right opens a folder; left closes it, or jumps to the enclosing folder.
+        auto foldPicker = [&](bool open) {
+            if (picker.rows.empty()) {
+                return;
+            }
+            int node = picker.rows[static_cast<size_t>(picker.index)];
+            ArchivePickNode& current = picker.nodes[static_cast<size_t>(node)];
+            if (current.isDir && current.expanded != open) {
+                current.expanded = open;
+                refreshPickerRows(picker);
+                return;
+            }
+            if (!open && current.parent > 0) {
+                auto row = std::find(picker.rows.begin(), picker.rows.end(), current.parent);
+                picker.index = static_cast<int>(row - picker.rows.begin());
+            }
+        };
+        auto togglePicker = [&]() {
+            if (!picker.rows.empty()) {
+                togglePickNode(picker, picker.rows[static_cast<size_t>(picker.index)]);
+            }
+        };
+        auto runPickedExtract = [&]() {
+            std::vector<std::string> names = pickedArchiveNames(picker);
+            if (names.empty()) {
+                setStatus(status, "Nothing selected");
+                return;
+            }
+            if (picker.hasFree && picker.nodes[0].selectedBytes > picker.freeBytes) {
+                setStatus(status, "Not enough free space");
+                return;
+            }
+            mode = Mode::Browse;
+            std::string error;
+            bool ok = extractArchiveWithProgress(picker.kind, picker.archivePath, picker.destDir, &names, &transferCtx,
+                                                 error);
+            finishTransfer(&transferCtx);
+            setStatus(status, ok ? "Extracted " + std::to_string(names.size()) + " files" : "Extract failed: " + error);
+            loadBothPanes(panes, settings, &status);
+        };
+        auto moveSteamScan = [&](int delta) {
+            int totalItems = static_cast<int>(steamScan.items.size());
+            if (totalItems > 0) {
+                steamScan.index = std::clamp(steamScan.index + delta, 0, totalItems - 1);
+            }
+        };
+        auto toggleSteamScan = [&]() {
+            if (!steamScan.items.empty()) {
+                SteamScanItem& item = steamScan.items[static_cast<size_t>(steamScan.index)];
+                item.selected = !item.selected;
+            }
+        };
+        auto runSteamScanAdd = [&]() {
+            int added = 0;
+            std::string error;
+            if (!addScannedGamesToSteam(steamScan, settings, added, error)) {
+                setStatus(status, "Add to Steam failed: " + error);
+                if (error == "Nothing selected") {
+                    return;
+                }
+            } else if (!error.empty()) {
+                setStatus(status, "Added " + std::to_string(added) + " games to Steam, but: " + error);
+            } else {
+                setStatus(status, "Added " + std::to_string(added) + " games to Steam");
+            }
+            mode = Mode::Browse;
+        };
+        auto openSteamLibrary = [&]() {
+            std::string error;
+            bool ok = loadSteamLibraryWithProgress(diskUsage, &transferCtx, steamLibrary, error);
+            finishTransfer(&transferCtx);
+            if (!ok) {
+                setStatus(status, "Steam Library failed: " + error);
+                mode = Mode::Browse;
+                return;
+            }
+            mode = Mode::SteamLibrary;
+        };
+        auto moveSteamLibrary = [&](int delta) {
+            int totalItems = static_cast<int>(steamLibrary.rows.size());
+            if (totalItems > 0) {
+                steamLibrary.index = std::clamp(steamLibrary.index + delta, 0, totalItems - 1);
+            }
+        };
+        // Opens the selected game's install folder in the active pane.
+        auto openSteamLibraryRow = [&]() {
+            if (steamLibrary.rows.empty()) {
+                return;
+            }
+            fs::path target = steamLibrary.rows[static_cast<size_t>(steamLibrary.index)].app.installPath();
+            if (!fs::is_directory(target)) {
+                setStatus(status, "Install folder not found");
+                return;
+            }
+            Pane& pane = panes[activePane];
+            pane.source = PaneSource::Local;
+            pane.cwd = target;
+            pane.ftpPath = "/";
+            resetPanePosition(pane);
+            loadEntries(pane, settings, &status);
+            mode = Mode::Browse;
+        };
+        auto beginSteamMove = [&]() {
+            if (steamLibrary.rows.empty()) {
+                return;
+            }
+            const SteamLibraryRow& row = steamLibrary.rows[static_cast<size_t>(steamLibrary.index)];
+            steamLibrary.moveTargets.clear();
+            for (const fs::path& library : steamLibrary.libraries) {
+                std::error_code ec;
+                if (fs::equivalent(library, row.app.library, ec)) {
+                    continue;
+                }
+                SteamMoveTarget target;
+                target.library = library;
+                fs::space_info space = fs::space(library, ec);
+                target.hasFree = !ec;
+                target.freeBytes = ec ? 0 : space.available;
+                steamLibrary.moveTargets.push_back(target);
+            }
+            if (steamLibrary.moveTargets.empty()) {
+                setStatus(status, "Only one Steam library");
+                return;
+            }
+            steamLibrary.moveIndex = 0;
+            mode = Mode::SteamMove;
+        };
+        auto moveSteamMoveTarget = [&](int delta) {
+            int totalItems = static_cast<int>(steamLibrary.moveTargets.size());
+            if (totalItems > 0) {
+                steamLibrary.moveIndex = (steamLibrary.moveIndex + delta + totalItems) % totalItems;
+            }
+        };
+        auto runSteamMove = [&]() {
+            if (steamLibrary.moveTargets.empty() || steamLibrary.rows.empty()) {
+                return;
+            }
+            SteamLibraryRow row = steamLibrary.rows[static_cast<size_t>(steamLibrary.index)];
+            fs::path library = steamLibrary.moveTargets[static_cast<size_t>(steamLibrary.moveIndex)].library;
+            std::string error;
+            bool ok = moveSteamAppWithProgress(row, library, &transferCtx, error);
+            finishTransfer(&transferCtx);
+            std::string reloadError;
+            bool reloaded = loadSteamLibraryWithProgress(diskUsage, &transferCtx, steamLibrary, reloadError);
+            finishTransfer(&transferCtx);
+            mode = reloaded ? Mode::SteamLibrary : Mode::Browse;
+            if (!ok) {
+                setStatus(status, "Move failed: " + error);
+            } else if (!error.empty()) {
+                setStatus(status, "Moved " + row.app.name + ", but: " + error);
+            } else {
+                setStatus(status, "Moved " + row.app.name + " to " + library.string());
+            }
+        };
         auto commitEdit = [&]() {
             if (editField == SettingField::FtpHost) {
                 settings.ftpHost = editBuffer;
@@ -2951,7 +5513,8 @@ int main(int argc, char** argv) {
             }
 
             if (event.type == SDL_TEXTINPUT &&
-                (mode == Mode::Rename || mode == Mode::CreateFolder || mode == Mode::EditSetting || mode == Mode::AddToSteam)) {
+                (mode == Mode::Rename || mode == Mode::CreateFolder || mode == Mode::EditSetting || mode == Mode::AddToSteam ||
+                 mode == Mode::FtpSearch)) {
                 std::string input = event.text.text;
                 if (mode == Mode::Rename) {
                     insertFiltered(renameBuffer, renameCursor, input, false);
@@ -2959,6 +5522,8 @@ int main(int argc, char** argv) {
                     insertFiltered(createFolderName, createFolderCursor, input, false);
                 } else if (mode == Mode::AddToSteam) {
                     insertFiltered(addToSteamName, addToSteamCursor, input, false);
+                } else if (mode == Mode::FtpSearch) {
+                    insertFiltered(searchQuery, searchCursor, input, false);
                 } else {
                     bool digitsOnly = (editField == SettingField::FtpPort);
                     insertFiltered(editBuffer, editCursor, input, digitsOnly);
@@ -2975,12 +5540,20 @@ int main(int argc, char** argv) {
                         cancelEdit();
                     } else if (mode == Mode::AddToSteam) {
                         cancelAddToSteam();
+                    } else if (mode == Mode::FtpSearch) {
+                        cancelFtpSearch();
+                    } else if (mode == Mode::SearchResults) {
+                        closeSearchResults();
+                    } else if (mode == Mode::SyncPlan || mode == Mode::Diagnostics) {
+                        mode = Mode::Browse;
                     } else if (mode == Mode::CreateFolder) {
                         cancelCreateFolder();
                     } else if (mode == Mode::Rename) {
                         cancelRename();
                     } else if (mode == Mode::Settings) {
                         mode = Mode::AppMenu;
+                    } else if (mode == Mode::SteamMove) {
+                        mode = Mode::SteamLibrary;
                     } else {
                         mode = Mode::Browse;
                     }
@@ -2998,7 +5571,7 @@ int main(int argc, char** argv) {
                         panes[activePane].selected = std::min(static_cast<int>(panes[activePane].entries.size()) - 1,
                                                               panes[activePane].selected + 10);
                     } else if (key == SDLK_RETURN) {
-                        enterSelected(panes[activePane], settings, &status);
+                        enterSelected(panes[activePane], settings, &status, &transferCtx);
                     } else if (key == SDLK_BACKSPACE) {
                         goUp(panes[activePane], settings, &status);
                     } else if (key == SDLK_TAB) {
@@ -3016,7 +5589,7 @@ int main(int argc, char** argv) {
                         mode = Mode::Favorites;
                     }
                 } else if (mode == Mode::ActionMenu) {
-                    auto actionOptions = buildActionOptions(action.entry, panes[action.paneIndex]);
+                    auto actionOptions = buildActionOptions(action.entry, panes[action.paneIndex], panes[1 - action.paneIndex]);
                     if (actionOptions.empty()) {
                         mode = Mode::Browse;
                         break;
@@ -3033,7 +5606,7 @@ int main(int argc, char** argv) {
                                              confirmIndex, renameBuffer, renameCursor,
                                              createFolderName, createFolderCursor,
                                              addToSteamName, addToSteamCursor,
-                                             osk, &transferCtx);
+                                             osk, picker, steamScan, &transferCtx);
                     }
                 } else if (mode == Mode::Favorites) {
                     int totalItems = static_cast<int>(favorites.size()) + 1;
@@ -3125,6 +5698,99 @@ int main(int argc, char** argv) {
                     } else if (key == SDLK_RETURN) {
                         commitAddToSteam();
                     }
+                } else if (mode == Mode::FtpSearch) {
+                    if (key == SDLK_LEFT) {
+                        if (searchCursor > 0) {
+                            --searchCursor;
+                        }
+                    } else if (key == SDLK_RIGHT) {
+                        if (searchCursor < searchQuery.size()) {
+                            ++searchCursor;
+                        }
+                    } else if (key == SDLK_BACKSPACE) {
+                        backspaceAtCursor(searchQuery, searchCursor);
+                    } else if (key == SDLK_RETURN) {
+                        commitFtpSearch();
+                    }
+                } else if (mode == Mode::SearchResults) {
+                    int totalItems = searchMatchCount();
+                    if (key == SDLK_UP && totalItems > 0) {
+                        searchResultIndex = (searchResultIndex + totalItems - 1) % totalItems;
+                    } else if (key == SDLK_DOWN && totalItems > 0) {
+                        searchResultIndex = (searchResultIndex + 1) % totalItems;
+                    } else if (key == SDLK_RETURN) {
+                        openSearchResult(searchResultIndex);
+                    }
+                } else if (mode == Mode::SyncPlan) {
+                    int totalItems = syncPlanRows();
+                    if (key == SDLK_UP && totalItems > 0) {
+                        syncIndex = (syncIndex + totalItems - 1) % totalItems;
+                    } else if (key == SDLK_DOWN && totalItems > 0) {
+                        syncIndex = (syncIndex + 1) % totalItems;
+                    } else if (key == SDLK_x) {
+                        syncPlan.deleteExtraneous = !syncPlan.deleteExtraneous;
+                    } else if (key == SDLK_RETURN) {
+                        runSync();
+                    }
+                } else if (mode == Mode::ExtractSelect) {
+                    if (key == SDLK_UP) {
+                        movePicker(-1);
+                    } else if (key == SDLK_DOWN) {
+                        movePicker(1);
+                    } else if (key == SDLK_PAGEUP) {
+                        movePicker(-10);
+                    } else if (key == SDLK_PAGEDOWN) {
+                        movePicker(10);
+                    } else if (key == SDLK_LEFT || key == SDLK_RIGHT) {
+                        foldPicker(key == SDLK_RIGHT);
+                    } else if (key == SDLK_RETURN || key == SDLK_SPACE) {
+                        togglePicker();
+                    } else if (key == SDLK_x) {
+                        runPickedExtract();
+                    }
+                } else if (mode == Mode::SteamLibrary) {
+                    if (key == SDLK_UP) {
+                        moveSteamLibrary(-1);
+                    } else if (key == SDLK_DOWN) {
+                        moveSteamLibrary(1);
+                    } else if (key == SDLK_PAGEUP) {
+                        moveSteamLibrary(-10);
+                    } else if (key == SDLK_PAGEDOWN) {
+                        moveSteamLibrary(10);
+                    } else if (key == SDLK_RETURN) {
+                        openSteamLibraryRow();
+                    } else if (key == SDLK_x) {
+                        beginSteamMove();
+                    }
+                } else if (mode == Mode::SteamMove) {
+                    if (key == SDLK_UP) {
+                        moveSteamMoveTarget(-1);
+                    } else if (key == SDLK_DOWN) {
+                        moveSteamMoveTarget(1);
+                    } else if (key == SDLK_RETURN) {
+                        runSteamMove();
+                    }
+                } else if (mode == Mode::SteamScan) {
+                    if (key == SDLK_UP) {
+                        moveSteamScan(-1);
+                    } else if (key == SDLK_DOWN) {
+                        moveSteamScan(1);
+                    } else if (key == SDLK_PAGEUP) {
+                        moveSteamScan(-10);
+                    } else if (key == SDLK_PAGEDOWN) {
+                        moveSteamScan(10);
+                    } else if (key == SDLK_RETURN || key == SDLK_SPACE) {
+                        toggleSteamScan();
+                    } else if (key == SDLK_x) {
+                        runSteamScanAdd();
+                    }
+                } else if (mode == Mode::Diagnostics) {
+                    if (key == SDLK_RETURN) {
+                        runSpeedTest();
+                    } else if (key == SDLK_x) {
+                        clearFtpStats(ftpServerKey(settings));
+                        speedTest = FtpSpeedTestResult {};
+                    }
                 } else if (mode == Mode::AppMenu) {
                     if (key == SDLK_UP) {
                         appMenuIndex = (appMenuIndex + static_cast<int>(appMenuOptions.size()) - 1) % static_cast<int>(appMenuOptions.size());
@@ -3137,6 +5803,14 @@ int main(int argc, char** argv) {
                         } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Connect to FTP") {
                             connectToFtp(panes[activePane], settings, status);
                             mode = Mode::Browse;
+                        } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Search FTP") {
+                            beginFtpSearch();
+                        } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Sync Panes") {
+                            beginSync();
+                        } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Network Stats") {
+                            mode = Mode::Diagnostics;
+                        } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Steam Library") {
+                            openSteamLibrary();
                         } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Quit") {
                             quitConfirmIndex = 1;
                             mode = Mode::ConfirmQuit;
@@ -3153,8 +5827,15 @@ int main(int argc, char** argv) {
                             settings.uiScale = clampUiScale(settings.uiScale + delta);
                         } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "Show Hidden") {
                             settings.showHidden = (key == SDLK_RIGHT);
-                            loadEntries(panes[0], settings, &status);
-                            loadEntries(panes[1], settings, &status);
+                            loadBothPanes(panes, settings, &status);
+                        } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "FTP Cache Size") {
+                            settings.ftpCacheLimitMb = stepFtpCacheLimit(settings.ftpCacheLimitMb, (key == SDLK_RIGHT) ? 1 : -1);
+                        } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "FTP Search Depth") {
+                            settings.ftpSearchDepth = std::clamp(settings.ftpSearchDepth + ((key == SDLK_RIGHT) ? 1 : -1), 1, 32);
+                        } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "Verify FTP Transfers") {
+                            settings.ftpVerify = (key == SDLK_RIGHT);
+                        } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "FTP Encryption") {
+                            settings.ftpTls = stepFtpTls(settings.ftpTls, (key == SDLK_RIGHT) ? 1 : -1, false);
                         }
                     } else if (key == SDLK_RETURN) {
                         std::string option = settingsOptions[static_cast<size_t>(settingsIndex)];
@@ -3164,8 +5845,16 @@ int main(int argc, char** argv) {
                             settings.uiScale = clampUiScale(settings.uiScale + 0.1f);
                         } else if (option == "Show Hidden") {
                             settings.showHidden = !settings.showHidden;
-                            loadEntries(panes[0], settings, &status);
-                            loadEntries(panes[1], settings, &status);
+                            loadBothPanes(panes, settings, &status);
+                        } else if (option == "FTP Cache Size") {
+                            int next = stepFtpCacheLimit(settings.ftpCacheLimitMb, 1);
+                            settings.ftpCacheLimitMb = (next == settings.ftpCacheLimitMb) ? 0 : next;
+                        } else if (option == "FTP Search Depth") {
+                            settings.ftpSearchDepth = (settings.ftpSearchDepth >= 32) ? 1 : settings.ftpSearchDepth + 1;
+                        } else if (option == "Verify FTP Transfers") {
+                            settings.ftpVerify = !settings.ftpVerify;
+                        } else if (option == "FTP Encryption") {
+                            settings.ftpTls = stepFtpTls(settings.ftpTls, 1, true);
                         } else {
                         if (option == "FTP Host") {
                             editField = SettingField::FtpHost;
@@ -3228,7 +5917,7 @@ int main(int argc, char** argv) {
                     } else if (button == SDL_CONTROLLER_BUTTON_DPAD_DOWN && hasEntries) {
                         panes[activePane].selected = std::min(static_cast<int>(panes[activePane].entries.size()) - 1, panes[activePane].selected + 1);
                     } else if (button == SDL_CONTROLLER_BUTTON_A) {
-                        enterSelected(panes[activePane], settings, &status);
+                        enterSelected(panes[activePane], settings, &status, &transferCtx);
                     } else if (button == SDL_CONTROLLER_BUTTON_B) {
                         goUp(panes[activePane], settings, &status);
                     } else if (button == SDL_CONTROLLER_BUTTON_LEFTSHOULDER) {
@@ -3251,7 +5940,7 @@ int main(int argc, char** argv) {
                         mode = Mode::AppMenu;
                     }
                 } else if (mode == Mode::ActionMenu) {
-                    auto actionOptions = buildActionOptions(action.entry, panes[action.paneIndex]);
+                    auto actionOptions = buildActionOptions(action.entry, panes[action.paneIndex], panes[1 - action.paneIndex]);
                     if (actionOptions.empty()) {
                         mode = Mode::Browse;
                         break;
@@ -3270,7 +5959,7 @@ int main(int argc, char** argv) {
                                              confirmIndex, renameBuffer, renameCursor,
                                              createFolderName, createFolderCursor,
                                              addToSteamName, addToSteamCursor,
-                                             osk, &transferCtx);
+                                             osk, picker, steamScan, &transferCtx);
                     }
                 } else if (mode == Mode::Favorites) {
                     int totalItems = static_cast<int>(favorites.size()) + 1;
@@ -3450,17 +6139,79 @@ int main(int argc, char** argv) {
                     } else if (button == SDL_CONTROLLER_BUTTON_B) {
                         cancelCreateFolder();
                     }
-                } else if (mode == Mode::AddToSteam) {
+                } else if (mode == Mode::AddToSteam) {
+                    auto layout = buildOskLayout(osk.uppercase, osk.symbols, false);
+                    clampOskSelection(osk, layout);
+                    int rows = static_cast<int>(layout.size());
+                    if (button == SDL_CONTROLLER_BUTTON_LEFTSHOULDER) {
+                        if (addToSteamCursor > 0) {
+                            --addToSteamCursor;
+                        }
+                    } else if (button == SDL_CONTROLLER_BUTTON_RIGHTSHOULDER) {
+                        if (addToSteamCursor < addToSteamName.size()) {
+                            ++addToSteamCursor;
+                        }
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_UP && rows > 0) {
+                        osk.row = (osk.row + rows - 1) % rows;
+                        osk.col = std::min(osk.col, static_cast<int>(layout[osk.row].size()) - 1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_DOWN && rows > 0) {
+                        osk.row = (osk.row + 1) % rows;
+                        osk.col = std::min(osk.col, static_cast<int>(layout[osk.row].size()) - 1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_LEFT && rows > 0) {
+                        int cols = static_cast<int>(layout[osk.row].size());
+                        if (cols > 0) {
+                            osk.col = (osk.col + cols - 1) % cols;
+                        }
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT && rows > 0) {
+                        int cols = static_cast<int>(layout[osk.row].size());
+                        if (cols > 0) {
+                            osk.col = (osk.col + 1) % cols;
+                        }
+                    } else if (button == SDL_CONTROLLER_BUTTON_A) {
+                        if (!layout.empty() && !layout[osk.row].empty()) {
+                            const OskKey& key = layout[osk.row][osk.col];
+                            if (key.action == OskAction::None) {
+                                insertFiltered(addToSteamName, addToSteamCursor, key.value, false);
+                            } else if (key.action == OskAction::Backspace) {
+                                backspaceAtCursor(addToSteamName, addToSteamCursor);
+                            } else if (key.action == OskAction::Clear) {
+                                addToSteamName.clear();
+                                addToSteamCursor = 0;
+                            } else if (key.action == OskAction::Ok) {
+                                commitAddToSteam();
+                            } else if (key.action == OskAction::Cancel) {
+                                cancelAddToSteam();
+                            } else if (key.action == OskAction::ToggleShift) {
+                                osk.uppercase = !osk.uppercase;
+                                auto updated = buildOskLayout(osk.uppercase, osk.symbols, false);
+                                clampOskSelection(osk, updated);
+                            } else if (key.action == OskAction::ToggleSymbols) {
+                                osk.symbols = !osk.symbols;
+                                auto updated = buildOskLayout(osk.uppercase, osk.symbols, false);
+                                clampOskSelection(osk, updated);
+                            }
+                        }
+                    } else if (button == SDL_CONTROLLER_BUTTON_X) {
+                        backspaceAtCursor(addToSteamName, addToSteamCursor);
+                    } else if (button == SDL_CONTROLLER_BUTTON_Y) {
+                        addToSteamName.clear();
+                        addToSteamCursor = 0;
+                    } else if (button == SDL_CONTROLLER_BUTTON_START) {
+                        commitAddToSteam();
+                    } else if (button == SDL_CONTROLLER_BUTTON_B) {
+                        cancelAddToSteam();
+                    }
+                } else if (mode == Mode::FtpSearch) {
                     auto layout = buildOskLayout(osk.uppercase, osk.symbols, false);
                     clampOskSelection(osk, layout);
                     int rows = static_cast<int>(layout.size());
                     if (button == SDL_CONTROLLER_BUTTON_LEFTSHOULDER) {
-                        if (addToSteamCursor > 0) {
-                            --addToSteamCursor;
+                        if (searchCursor > 0) {
+                            --searchCursor;
                         }
                     } else if (button == SDL_CONTROLLER_BUTTON_RIGHTSHOULDER) {
-                        if (addToSteamCursor < addToSteamName.size()) {
-                            ++addToSteamCursor;
+                        if (searchCursor < searchQuery.size()) {
+                            ++searchCursor;
                         }
                     } else if (button == SDL_CONTROLLER_BUTTON_DPAD_UP && rows > 0) {
                         osk.row = (osk.row + rows - 1) % rows;
@@ -3482,16 +6233,16 @@ int main(int argc, char** argv) {
                         if (!layout.empty() && !layout[osk.row].empty()) {
                             const OskKey& key = layout[osk.row][osk.col];
                             if (key.action == OskAction::None) {
-                                insertFiltered(addToSteamName, addToSteamCursor, key.value, false);
+                                insertFiltered(searchQuery, searchCursor, key.value, false);
                             } else if (key.action == OskAction::Backspace) {
-                                backspaceAtCursor(addToSteamName, addToSteamCursor);
+                                backspaceAtCursor(searchQuery, searchCursor);
                             } else if (key.action == OskAction::Clear) {
-                                addToSteamName.clear();
-                                addToSteamCursor = 0;
+                                searchQuery.clear();
+                                searchCursor = 0;
                             } else if (key.action == OskAction::Ok) {
-                                commitAddToSteam();
+                                commitFtpSearch();
                             } else if (key.action == OskAction::Cancel) {
-                                cancelAddToSteam();
+                                cancelFtpSearch();
                             } else if (key.action == OskAction::ToggleShift) {
                                 osk.uppercase = !osk.uppercase;
                                 auto updated = buildOskLayout(osk.uppercase, osk.symbols, false);
@@ -3503,14 +6254,103 @@ int main(int argc, char** argv) {
                             }
                         }
                     } else if (button == SDL_CONTROLLER_BUTTON_X) {
-                        backspaceAtCursor(addToSteamName, addToSteamCursor);
+                        backspaceAtCursor(searchQuery, searchCursor);
                     } else if (button == SDL_CONTROLLER_BUTTON_Y) {
-                        addToSteamName.clear();
-                        addToSteamCursor = 0;
+                        searchQuery.clear();
+                        searchCursor = 0;
                     } else if (button == SDL_CONTROLLER_BUTTON_START) {
-                        commitAddToSteam();
+                        commitFtpSearch();
                     } else if (button == SDL_CONTROLLER_BUTTON_B) {
-                        cancelAddToSteam();
+                        cancelFtpSearch();
+                    }
+                } else if (mode == Mode::SearchResults) {
+                    int totalItems = searchMatchCount();
+                    if (button == SDL_CONTROLLER_BUTTON_DPAD_UP && totalItems > 0) {
+                        searchResultIndex = (searchResultIndex + totalItems - 1) % totalItems;
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_DOWN && totalItems > 0) {
+                        searchResultIndex = (searchResultIndex + 1) % totalItems;
+                    } else if (button == SDL_CONTROLLER_BUTTON_B) {
+                        closeSearchResults();
+                    } else if (button == SDL_CONTROLLER_BUTTON_A) {
+                        openSearchResult(searchResultIndex);
+                    }
+                } else if (mode == Mode::SyncPlan) {
+                    int totalItems = syncPlanRows();
+                    if (button == SDL_CONTROLLER_BUTTON_DPAD_UP && totalItems > 0) {
+                        syncIndex = (syncIndex + totalItems - 1) % totalItems;
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_DOWN && totalItems > 0) {
+                        syncIndex = (syncIndex + 1) % totalItems;
+                    } else if (button == SDL_CONTROLLER_BUTTON_X) {
+                        syncPlan.deleteExtraneous = !syncPlan.deleteExtraneous;
+                    } else if (button == SDL_CONTROLLER_BUTTON_B) {
+                        mode = Mode::Browse;
+                    } else if (button == SDL_CONTROLLER_BUTTON_A) {
+                        runSync();
+                    }
+                } else if (mode == Mode::ExtractSelect) {
+                    if (button == SDL_CONTROLLER_BUTTON_DPAD_UP) {
+                        movePicker(-1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_DOWN) {
+                        movePicker(1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_LEFT || button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT) {
+                        foldPicker(button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT);
+                    } else if (button == SDL_CONTROLLER_BUTTON_A) {
+                        togglePicker();
+                    } else if (button == SDL_CONTROLLER_BUTTON_X) {
+                        runPickedExtract();
+                    } else if (button == SDL_CONTROLLER_BUTTON_B) {
+                        mode = Mode::Browse;
+                    }
+                } else if (mode == Mode::SteamLibrary) {
+                    if (button == SDL_CONTROLLER_BUTTON_DPAD_UP) {
+                        moveSteamLibrary(-1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_DOWN) {
+                        moveSteamLibrary(1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_LEFT) {
+                        moveSteamLibrary(-10);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT) {
+                        moveSteamLibrary(10);
+                    } else if (button == SDL_CONTROLLER_BUTTON_A) {
+                        openSteamLibraryRow();
+                    } else if (button == SDL_CONTROLLER_BUTTON_X) {
+                        beginSteamMove();
+                    } else if (button == SDL_CONTROLLER_BUTTON_B) {
+                        mode = Mode::Browse;
+                    }
+                } else if (mode == Mode::SteamMove) {
+                    if (button == SDL_CONTROLLER_BUTTON_DPAD_UP) {
+                        moveSteamMoveTarget(-1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_DOWN) {
+                        moveSteamMoveTarget(1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_A) {
+                        runSteamMove();
+                    } else if (button == SDL_CONTROLLER_BUTTON_B) {
+                        mode = Mode::SteamLibrary;
+                    }
+                } else if (mode == Mode::SteamScan) {
+                    if (button == SDL_CONTROLLER_BUTTON_DPAD_UP) {
+                        moveSteamScan(-1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_DOWN) {
+                        moveSteamScan(1);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_LEFT) {
+                        moveSteamScan(-10);
+                    } else if (button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT) {
+                        moveSteamScan(10);
+                    } else if (button == SDL_CONTROLLER_BUTTON_A) {
+                        toggleSteamScan();
+                    } else if (button == SDL_CONTROLLER_BUTTON_X) {
+                        runSteamScanAdd();
+                    } else if (button == SDL_CONTROLLER_BUTTON_B) {
+                        mode = Mode::Browse;
+                    }
+                } else if (mode == Mode::Diagnostics) {
+                    if (button == SDL_CONTROLLER_BUTTON_A) {
+                        runSpeedTest();
+                    } else if (button == SDL_CONTROLLER_BUTTON_X) {
+                        clearFtpStats(ftpServerKey(settings));
+                        speedTest = FtpSpeedTestResult {};
+                    } else if (button == SDL_CONTROLLER_BUTTON_B) {
+                        mode = Mode::Browse;
                     }
                 } else if (mode == Mode::AppMenu) {
                     if (button == SDL_CONTROLLER_BUTTON_DPAD_UP) {
@@ -3526,6 +6366,14 @@ int main(int argc, char** argv) {
                         } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Connect to FTP") {
                             connectToFtp(panes[activePane], settings, status);
                             mode = Mode::Browse;
+                        } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Search FTP") {
+                            beginFtpSearch();
+                        } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Sync Panes") {
+                            beginSync();
+                        } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Network Stats") {
+                            mode = Mode::Diagnostics;
+                        } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Steam Library") {
+                            openSteamLibrary();
                         } else if (appMenuOptions[static_cast<size_t>(appMenuIndex)] == "Quit") {
                             quitConfirmIndex = 1;
                             mode = Mode::ConfirmQuit;
@@ -3542,8 +6390,15 @@ int main(int argc, char** argv) {
                             settings.uiScale = clampUiScale(settings.uiScale + delta);
                         } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "Show Hidden") {
                             settings.showHidden = (button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT);
-                            loadEntries(panes[0], settings, &status);
-                            loadEntries(panes[1], settings, &status);
+                            loadBothPanes(panes, settings, &status);
+                        } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "FTP Cache Size") {
+                            settings.ftpCacheLimitMb = stepFtpCacheLimit(settings.ftpCacheLimitMb, (button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT) ? 1 : -1);
+                        } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "FTP Search Depth") {
+                            settings.ftpSearchDepth = std::clamp(settings.ftpSearchDepth + ((button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT) ? 1 : -1), 1, 32);
+                        } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "Verify FTP Transfers") {
+                            settings.ftpVerify = (button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT);
+                        } else if (settingsOptions[static_cast<size_t>(settingsIndex)] == "FTP Encryption") {
+                            settings.ftpTls = stepFtpTls(settings.ftpTls, (button == SDL_CONTROLLER_BUTTON_DPAD_RIGHT) ? 1 : -1, false);
                         }
                     } else if (button == SDL_CONTROLLER_BUTTON_B) {
                         mode = Mode::AppMenu;
@@ -3555,8 +6410,16 @@ int main(int argc, char** argv) {
                             settings.uiScale = clampUiScale(settings.uiScale + 0.1f);
                         } else if (option == "Show Hidden") {
                             settings.showHidden = !settings.showHidden;
-                            loadEntries(panes[0], settings, &status);
-                            loadEntries(panes[1], settings, &status);
+                            loadBothPanes(panes, settings, &status);
+                        } else if (option == "FTP Cache Size") {
+                            int next = stepFtpCacheLimit(settings.ftpCacheLimitMb, 1);
+                            settings.ftpCacheLimitMb = (next == settings.ftpCacheLimitMb) ? 0 : next;
+                        } else if (option == "FTP Search Depth") {
+                            settings.ftpSearchDepth = (settings.ftpSearchDepth >= 32) ? 1 : settings.ftpSearchDepth + 1;
+                        } else if (option == "Verify FTP Transfers") {
+                            settings.ftpVerify = !settings.ftpVerify;
+                        } else if (option == "FTP Encryption") {
+                            settings.ftpTls = stepFtpTls(settings.ftpTls, 1, true);
                         } else {
                         if (option == "FTP Host") {
                             editField = SettingField::FtpHost;
@@ -3662,6 +6525,27 @@ int main(int argc, char** argv) {
             }
         }
 
+        // The archive under the cursor is indexed in the background so its pane footer can
+        // show what it holds; the index cache makes coming back to it instant. Only ZIP and
+        // RAR are listed from their headers: a compressed tar would have to be decompressed
+        // in full, so its footer waits until something else has listed it.
+        if (!archiveIndexJob.valid() ||
+            archiveIndexJob.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            const Pane& pane = panes[activePane];
+            ArchiveKind kind = ArchiveKind::Zip;
+            if (pane.selected >= 0 && pane.selected < static_cast<int>(pane.entries.size())) {
+                const Entry& entry = pane.entries[static_cast<size_t>(pane.selected)];
+                if (entry.path != archiveIndexPath && archiveKindOf(entry, pane, kind) &&
+                    kind != ArchiveKind::Stream && !peekArchiveIndex(entry.path)) {
+                    archiveIndexPath = entry.path;
+                    archiveIndexJob = std::async(std::launch::async, [path = entry.path, kind, &archiveIndexCancel]() {
+                        std::string error;
+                        loadArchiveIndex(path, kind, error, &archiveIndexCancel);
+                    });
+                }
+            }
+        }
+
         int width = 0;
         int height = 0;
         SDL_GetWindowSize(window, &width, &height);
@@ -3710,6 +6594,8 @@ int main(int argc, char** argv) {
             if (pane.source == PaneSource::Ftp) {
                 std::string hostLabel = settings.ftpHost.empty() ? "(unset)" : settings.ftpHost;
                 headerLabel = "FTP: " + hostLabel + pane.ftpPath;
+            } else if (pane.source == PaneSource::Archive) {
+                headerLabel = pane.archivePath.filename().string() + ":" + pane.archiveDir;
             } else {
                 headerLabel = pane.cwd.string();
             }
@@ -3784,6 +6670,19 @@ int main(int argc, char** argv) {
                 }
             }
             std::string countLabel = std::to_string(itemCount) + (itemCount == 1 ? " item" : " items");
+            ArchiveKind archiveKind = ArchiveKind::Zip;
+            if (pane.selected >= 0 && pane.selected < static_cast<int>(pane.entries.size()) &&
+                archiveKindOf(pane.entries[static_cast<size_t>(pane.selected)], pane, archiveKind)) {
+                std::shared_ptr<const ArchiveIndex> index =
+                    peekArchiveIndex(pane.entries[static_cast<size_t>(pane.selected)].path);
+                if (index) {
+                    countLabel += " | archive: " + std::to_string(index->files) +
+                                  (index->files == 1 ? " file" : " files");
+                    if (index->totalSize > 0) {
+                        countLabel += ", " + formatBytes(index->totalSize);
+                    }
+                }
+            }
             std::string freeLabel = "Free: N/A";
             if (pane.source == PaneSource::Local) {
                 std::error_code ec;
@@ -3829,18 +6728,28 @@ int main(int argc, char** argv) {
             int modalHeight = static_cast<int>(std::round(280.0f * uiScale));
             if (mode == Mode::Settings) {
                 modalWidth = static_cast<int>(std::round(780.0f * uiScale));
-                modalHeight = static_cast<int>(std::round(440.0f * uiScale));
+                modalHeight = static_cast<int>(std::round(620.0f * uiScale));
             } else if (mode == Mode::ActionMenu) {
-                modalHeight = static_cast<int>(std::round(330.0f * uiScale));
+                // Tall enough for every option: title, one 36px row each, help line.
+                size_t optionCount = buildActionOptions(action.entry, panes[action.paneIndex], panes[1 - action.paneIndex]).size();
+                modalHeight = static_cast<int>(std::round(std::max(280.0f, 120.0f + 36.0f * optionCount) * uiScale));
             } else if (mode == Mode::Favorites) {
                 modalWidth = static_cast<int>(std::round(820.0f * uiScale));
                 modalHeight = static_cast<int>(std::round(460.0f * uiScale));
-            } else if (mode == Mode::EditSetting || mode == Mode::Rename || mode == Mode::CreateFolder || mode == Mode::AddToSteam) {
+            } else if (mode == Mode::SearchResults) {
+                modalWidth = static_cast<int>(std::round(900.0f * uiScale));
+                modalHeight = static_cast<int>(std::round(500.0f * uiScale));
+            } else if (mode == Mode::SyncPlan || mode == Mode::Diagnostics || mode == Mode::ExtractSelect ||
+                       mode == Mode::SteamScan || mode == Mode::SteamLibrary || mode == Mode::SteamMove) {
+                modalWidth = static_cast<int>(std::round(900.0f * uiScale));
+                modalHeight = static_cast<int>(std::round(540.0f * uiScale));
+            } else if (mode == Mode::EditSetting || mode == Mode::Rename || mode == Mode::CreateFolder ||
+                       mode == Mode::AddToSteam || mode == Mode::FtpSearch) {
                 modalWidth = static_cast<int>(std::round(920.0f * uiScale));
                 modalHeight = static_cast<int>(std::round(420.0f * uiScale));
             } else if (mode == Mode::AppMenu) {
                 modalWidth = static_cast<int>(std::round(360.0f * uiScale));
-                modalHeight = static_cast<int>(std::round(240.0f * uiScale));
+                modalHeight = static_cast<int>(std::round(400.0f * uiScale));
             } else if (mode == Mode::ConfirmRemoveFavorite) {
                 modalWidth = static_cast<int>(std::round(520.0f * uiScale));
                 modalHeight = static_cast<int>(std::round(260.0f * uiScale));
@@ -3858,7 +6767,7 @@ int main(int argc, char** argv) {
             int helpLineHeight = 8 * smallScale + smallScale;
 
             if (mode == Mode::ActionMenu) {
-                auto actionOptions = buildActionOptions(action.entry, panes[action.paneIndex]);
+                auto actionOptions = buildActionOptions(action.entry, panes[action.paneIndex], panes[1 - action.paneIndex]);
                 if (actionOptions.empty()) {
                     actionOptions = {"Back"};
                 }
@@ -4063,6 +6972,449 @@ int main(int argc, char** argv) {
                          modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
                          smallScale, modalText,
                          "X: Backspace  Y: Clear  Start: Add  B: Cancel");
+            } else if (mode == Mode::FtpSearch) {
+                drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText, "Search FTP");
+                drawText(renderer, modal.x + padding, modal.y + padding + static_cast<int>(std::round(40.0f * uiScale)), smallScale, modalText,
+                         "Name or pattern (* and ? allowed).");
+
+                SDL_Rect fieldRect {modal.x + padding, modal.y + padding + static_cast<int>(std::round(70.0f * uiScale)),
+                                    modal.w - padding * 2, static_cast<int>(std::round(40.0f * uiScale))};
+                SDL_SetRenderDrawColor(renderer, 25, 30, 35, 255);
+                SDL_RenderFillRect(renderer, &fieldRect);
+                int fieldMaxChars = (fieldRect.w - static_cast<int>(std::round(20.0f * uiScale))) / (8 * fontScale + fontScale);
+                drawInputText(renderer,
+                              fieldRect.x + static_cast<int>(std::round(10.0f * uiScale)),
+                              fieldRect.y + static_cast<int>(std::round(12.0f * uiScale)),
+                              fontScale, modalText, searchQuery, searchCursor, fieldMaxChars);
+
+                int oskTop = fieldRect.y + fieldRect.h + static_cast<int>(std::round(16.0f * uiScale));
+                SDL_Rect oskArea {modal.x + padding, oskTop, modal.w - padding * 2, modal.h - oskTop - padding * 2};
+                auto layout = buildOskLayout(osk.uppercase, osk.symbols, false);
+                clampOskSelection(osk, layout);
+                drawOsk(renderer, oskArea, fontScale, uiScale, modalText, layout, osk);
+
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)) - helpLineHeight,
+                         smallScale, modalText,
+                         "D-Pad: Move  L1/R1: Cursor  A: Select");
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
+                         smallScale, modalText,
+                         "X: Backspace  Y: Clear  Start: Search  B: Cancel");
+            } else if (mode == Mode::SearchResults) {
+                std::vector<FtpSearchMatch> shown;
+                int totalItems = 0;
+                bool searchDone = true;
+                int foldersScanned = 0;
+                int folderErrors = 0;
+                int listStartY = modal.y + padding + static_cast<int>(std::round(80.0f * uiScale));
+                int listEndY = modal.y + modal.h - padding - helpLineHeight - static_cast<int>(std::round(12.0f * uiScale));
+                int listHeight = std::max(0, listEndY - listStartY);
+                int visibleRows = std::max(1, listHeight / optionHeight);
+                if (ftpSearch) {
+                    searchDone = ftpSearch->done.load();
+                    foldersScanned = ftpSearch->foldersScanned.load();
+                    folderErrors = ftpSearch->folderErrors.load();
+                    std::lock_guard<std::mutex> lock(ftpSearch->mutex);
+                    totalItems = static_cast<int>(ftpSearch->matches.size());
+                    if (searchResultIndex < 0 || searchResultIndex >= totalItems) {
+                        searchResultIndex = 0;
+                    }
+                    ensureMenuVisible(searchResultScroll, searchResultIndex, visibleRows, totalItems);
+                    int last = std::min(totalItems, searchResultScroll + visibleRows);
+                    shown.assign(ftpSearch->matches.begin() + searchResultScroll, ftpSearch->matches.begin() + last);
+                }
+                drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText, "Search: " + searchQuery);
+                std::string summary = std::string(searchDone ? "Done" : "Searching") + ", " +
+                                      std::to_string(foldersScanned) + " folders, " +
+                                      std::to_string(totalItems) + " matches";
+                if (folderErrors > 0) {
+                    summary += ", " + std::to_string(folderErrors) + " unreadable";
+                }
+                drawText(renderer, modal.x + padding, modal.y + padding + static_cast<int>(std::round(40.0f * uiScale)), smallScale, modalText,
+                         summary);
+                int sizeChars = 10;
+                int maxChars = (modal.w - padding * 2 - static_cast<int>(std::round(20.0f * uiScale))) / (8 * fontScale + fontScale) - sizeChars - 1;
+                for (size_t row = 0; row < shown.size(); ++row) {
+                    int index = searchResultScroll + static_cast<int>(row);
+                    SDL_Rect optionRect {
+                        modal.x + padding,
+                        listStartY + static_cast<int>(row) * optionHeight,
+                        modal.w - padding * 2,
+                        optionHeight
+                    };
+                    if (index == searchResultIndex) {
+                        SDL_SetRenderDrawColor(renderer, 40, 120, 160, 255);
+                        SDL_RenderFillRect(renderer, &optionRect);
+                    }
+                    const FtpSearchMatch& match = shown[row];
+                    std::string label = ftpJoinPath(match.dirPath, match.entry.name);
+                    if (match.entry.isDir) {
+                        label += "/";
+                    }
+                    drawText(renderer,
+                             optionRect.x + static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, ellipsize(label, maxChars));
+                    if (!match.entry.isDir && match.entry.hasSize) {
+                        std::string sizeText = formatBytes(match.entry.sizeBytes);
+                        int sizeWidth = static_cast<int>(sizeText.size()) * (8 * fontScale + fontScale);
+                        drawText(renderer,
+                                 optionRect.x + optionRect.w - sizeWidth - static_cast<int>(std::round(10.0f * uiScale)),
+                                 optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                                 fontScale, modalText, sizeText);
+                    }
+                }
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
+                         smallScale, modalText, "A: Go to  B: Stop/Back");
+            } else if (mode == Mode::SyncPlan) {
+                std::string localLabel = "Local " + syncPlan.localRoot.string();
+                std::string ftpLabel = "FTP " + syncPlan.ftpRoot;
+                int lineStep = static_cast<int>(std::round(28.0f * uiScale));
+                int infoY = modal.y + padding + static_cast<int>(std::round(40.0f * uiScale));
+                int maxChars = (modal.w - padding * 2 - static_cast<int>(std::round(20.0f * uiScale))) / (8 * fontScale + fontScale);
+                drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText,
+                         syncPlan.toFtp ? "Sync Local -> FTP" : "Sync FTP -> Local");
+                drawText(renderer, modal.x + padding, infoY, smallScale, modalText,
+                         ellipsize("From: " + (syncPlan.toFtp ? localLabel : ftpLabel), maxChars * 2));
+                drawText(renderer, modal.x + padding, infoY + lineStep, smallScale, modalText,
+                         ellipsize("To: " + (syncPlan.toFtp ? ftpLabel : localLabel), maxChars * 2));
+                std::string copySummary = "Copy " + std::to_string(syncPlan.transferFiles) + " files (" +
+                                          formatBytes(syncPlan.transferBytes) + "), " +
+                                          std::to_string(syncPlan.unchanged) + " unchanged";
+                if (syncPlan.conflicts > 0) {
+                    copySummary += ", " + std::to_string(syncPlan.conflicts) + " skipped (file/folder clash)";
+                }
+                drawText(renderer, modal.x + padding, infoY + lineStep * 2, smallScale, modalText, copySummary);
+                std::string deleteSummary = std::string("Delete extraneous: ") + (syncPlan.deleteExtraneous ? "On" : "Off") +
+                                            " (" + std::to_string(syncPlan.extraneous.size()) + " items, " +
+                                            formatBytes(syncPlan.extraneousBytes) + ")";
+                drawText(renderer, modal.x + padding, infoY + lineStep * 3, smallScale, modalText, deleteSummary);
+
+                int listStartY = infoY + lineStep * 4 + static_cast<int>(std::round(8.0f * uiScale));
+                int listEndY = modal.y + modal.h - padding - helpLineHeight - static_cast<int>(std::round(12.0f * uiScale));
+                int listHeight = std::max(0, listEndY - listStartY);
+                int visibleRows = std::max(1, listHeight / optionHeight);
+                int totalItems = syncPlanRows();
+                if (totalItems == 0) {
+                    drawText(renderer, modal.x + padding, listStartY, fontScale, modalText, "Already in sync");
+                }
+                if (syncIndex < 0 || syncIndex >= totalItems) {
+                    syncIndex = 0;
+                }
+                ensureMenuVisible(syncScroll, syncIndex, visibleRows, totalItems);
+                for (int row = 0; row < visibleRows; ++row) {
+                    int index = syncScroll + row;
+                    if (index >= totalItems) {
+                        break;
+                    }
+                    SDL_Rect optionRect {
+                        modal.x + padding,
+                        listStartY + row * optionHeight,
+                        modal.w - padding * 2,
+                        optionHeight
+                    };
+                    if (index == syncIndex) {
+                        SDL_SetRenderDrawColor(renderer, 40, 120, 160, 255);
+                        SDL_RenderFillRect(renderer, &optionRect);
+                    }
+                    bool isTransfer = index < static_cast<int>(syncPlan.transfers.size());
+                    const SyncItem& item = isTransfer ? syncPlan.transfers[static_cast<size_t>(index)]
+                                                      : syncPlan.extraneous[static_cast<size_t>(index) - syncPlan.transfers.size()];
+                    std::string label = (isTransfer ? "+ " : "- ") + item.relPath + (item.isDir ? "/" : "");
+                    drawText(renderer,
+                             optionRect.x + static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, ellipsize(label, maxChars - 11));
+                    if (!item.isDir && item.hasSize) {
+                        std::string sizeText = formatBytes(item.sizeBytes);
+                        drawText(renderer,
+                                 optionRect.x + optionRect.w - textWidth(fontScale, sizeText) - static_cast<int>(std::round(10.0f * uiScale)),
+                                 optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                                 fontScale, modalText, sizeText);
+                    }
+                }
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
+                         smallScale, modalText, "A: Run  X: Toggle Delete  B: Cancel");
+            } else if (mode == Mode::ExtractSelect) {
+                int lineStep = static_cast<int>(std::round(28.0f * uiScale));
+                int infoY = modal.y + padding + static_cast<int>(std::round(40.0f * uiScale));
+                int maxChars = (modal.w - padding * 2 - static_cast<int>(std::round(20.0f * uiScale))) / (8 * fontScale + fontScale);
+                drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText,
+                         ellipsize("Extract from " + picker.archivePath.filename().string(), maxChars));
+                drawText(renderer, modal.x + padding, infoY, smallScale, modalText,
+                         ellipsize("To: " + picker.destDir.string(), maxChars * 2));
+                ArchivePickNode noNodes;
+                const ArchivePickNode& root = picker.nodes.empty() ? noNodes : picker.nodes[0];
+                std::string selectedSummary = "Selected: " + std::to_string(root.selectedFiles) + " of " +
+                                              std::to_string(root.files) + " files, " + formatBytes(root.selectedBytes) +
+                                              "   Free: " + (picker.hasFree ? formatBytes(picker.freeBytes) : "N/A");
+                bool tooBig = picker.hasFree && root.selectedBytes > picker.freeBytes;
+                SDL_Color summaryColor = tooBig ? SDL_Color {240, 120, 110, 255} : modalText;
+                drawText(renderer, modal.x + padding, infoY + lineStep, smallScale, summaryColor, selectedSummary);
+
+                int listStartY = infoY + lineStep * 2 + static_cast<int>(std::round(8.0f * uiScale));
+                int listEndY = modal.y + modal.h - padding - helpLineHeight - static_cast<int>(std::round(12.0f * uiScale));
+                int listHeight = std::max(0, listEndY - listStartY);
+                int visibleRows = std::max(1, listHeight / optionHeight);
+                int totalItems = static_cast<int>(picker.rows.size());
+                if (totalItems == 0) {
+                    drawText(renderer, modal.x + padding, listStartY, fontScale, modalText, "Archive is empty");
+                }
+                ensureMenuVisible(picker.scroll, picker.index, visibleRows, totalItems);
+                for (int row = 0; row < visibleRows; ++row) {
+                    int index = picker.scroll + row;
+                    if (index >= totalItems) {
+                        break;
+                    }
+                    const ArchivePickNode& node = picker.nodes[static_cast<size_t>(picker.rows[static_cast<size_t>(index)])];
+                    SDL_Rect optionRect {
+                        modal.x + padding,
+                        listStartY + row * optionHeight,
+                        modal.w - padding * 2,
+                        optionHeight
+                    };
+                    if (index == picker.index) {
+                        SDL_SetRenderDrawColor(renderer, 40, 120, 160, 255);
+                        SDL_RenderFillRect(renderer, &optionRect);
+                    }
+                    bool all = node.isDir ? node.files > 0 && node.selectedFiles == node.files : node.selected;
+                    bool some = node.isDir && node.selectedFiles > 0;
+                    std::string label = std::string(all ? "[x] " : (some ? "[-] " : "[ ] ")) +
+                                        std::string(static_cast<size_t>(node.depth) * 2, ' ') +
+                                        (node.isDir ? (node.expanded ? "v " : "> ") : "  ") + node.label +
+                                        (node.isDir ? "/" : "");
+                    drawText(renderer,
+                             optionRect.x + static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, ellipsize(label, maxChars - 11));
+                    std::string sizeText = formatBytes(node.bytes);
+                    drawText(renderer,
+                             optionRect.x + optionRect.w - textWidth(fontScale, sizeText) - static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, sizeText);
+                }
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
+                         smallScale, modalText, "A: Select  Left/Right: Close/Open  X: Extract  B: Cancel");
+            } else if (mode == Mode::SteamLibrary) {
+                int lineStep = static_cast<int>(std::round(28.0f * uiScale));
+                int infoY = modal.y + padding + static_cast<int>(std::round(40.0f * uiScale));
+                int maxChars = (modal.w - padding * 2 - static_cast<int>(std::round(20.0f * uiScale))) / (8 * fontScale + fontScale);
+                drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText, "Steam Library");
+                std::uint64_t allBytes = steamLibrary.installBytes + steamLibrary.shaderBytes + steamLibrary.compatBytes;
+                drawText(renderer, modal.x + padding, infoY, smallScale, modalText,
+                         ellipsize(std::to_string(steamLibrary.rows.size()) + " games in " +
+                                       std::to_string(steamLibrary.libraries.size()) + " libraries: " +
+                                       formatBytes(allBytes) + " (games " + formatBytes(steamLibrary.installBytes) +
+                                       ", shader caches " + formatBytes(steamLibrary.shaderBytes) + ", Proton " +
+                                       formatBytes(steamLibrary.compatBytes) + ")",
+                                   maxChars * 2));
+                int totalItems = static_cast<int>(steamLibrary.rows.size());
+                if (totalItems > 0) {
+                    const SteamLibraryRow& current = steamLibrary.rows[static_cast<size_t>(steamLibrary.index)];
+                    drawText(renderer, modal.x + padding, infoY + lineStep, smallScale, modalText,
+                             ellipsize("Game " + formatBytes(current.installBytes) + ", shader cache " +
+                                           formatBytes(current.shaderBytes) + ", Proton " +
+                                           formatBytes(current.compatBytes) + "  in " + current.app.library.string(),
+                                       maxChars * 2));
+                }
+
+                int listStartY = infoY + lineStep * 2 + static_cast<int>(std::round(8.0f * uiScale));
+                int listEndY = modal.y + modal.h - padding - helpLineHeight - static_cast<int>(std::round(12.0f * uiScale));
+                int listHeight = std::max(0, listEndY - listStartY);
+                int visibleRows = std::max(1, listHeight / optionHeight);
+                if (totalItems == 0) {
+                    drawText(renderer, modal.x + padding, listStartY, fontScale, modalText, "No games installed");
+                }
+                ensureMenuVisible(steamLibrary.scroll, steamLibrary.index, visibleRows, totalItems);
+                for (int row = 0; row < visibleRows; ++row) {
+                    int index = steamLibrary.scroll + row;
+                    if (index >= totalItems) {
+                        break;
+                    }
+                    const SteamLibraryRow& item = steamLibrary.rows[static_cast<size_t>(index)];
+                    SDL_Rect optionRect {
+                        modal.x + padding,
+                        listStartY + row * optionHeight,
+                        modal.w - padding * 2,
+                        optionHeight
+                    };
+                    if (index == steamLibrary.index) {
+                        SDL_SetRenderDrawColor(renderer, 40, 120, 160, 255);
+                        SDL_RenderFillRect(renderer, &optionRect);
+                    }
+                    drawText(renderer,
+                             optionRect.x + static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, ellipsize(item.app.name, maxChars - 11));
+                    std::string sizeText = formatBytes(item.total());
+                    drawText(renderer,
+                             optionRect.x + optionRect.w - textWidth(fontScale, sizeText) - static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, sizeText);
+                }
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
+                         smallScale, modalText, "A: Open Folder  X: Move to Library  B: Back");
+            } else if (mode == Mode::SteamMove) {
+                int lineStep = static_cast<int>(std::round(28.0f * uiScale));
+                int infoY = modal.y + padding + static_cast<int>(std::round(40.0f * uiScale));
+                int maxChars = (modal.w - padding * 2 - static_cast<int>(std::round(20.0f * uiScale))) / (8 * fontScale + fontScale);
+                const SteamLibraryRow& current = steamLibrary.rows[static_cast<size_t>(steamLibrary.index)];
+                drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText,
+                         ellipsize("Move " + current.app.name, maxChars));
+                drawText(renderer, modal.x + padding, infoY, smallScale, modalText,
+                         ellipsize(formatBytes(current.total()) + " from " + current.app.library.string(), maxChars * 2));
+                drawText(renderer, modal.x + padding, infoY + lineStep, smallScale, modalText,
+                         "Close Steam first. A cancelled move resumes when started again.");
+
+                int listStartY = infoY + lineStep * 2 + static_cast<int>(std::round(8.0f * uiScale));
+                int totalItems = static_cast<int>(steamLibrary.moveTargets.size());
+                for (int index = 0; index < totalItems; ++index) {
+                    const SteamMoveTarget& target = steamLibrary.moveTargets[static_cast<size_t>(index)];
+                    SDL_Rect optionRect {
+                        modal.x + padding,
+                        listStartY + index * optionHeight,
+                        modal.w - padding * 2,
+                        optionHeight
+                    };
+                    if (index == steamLibrary.moveIndex) {
+                        SDL_SetRenderDrawColor(renderer, 40, 120, 160, 255);
+                        SDL_RenderFillRect(renderer, &optionRect);
+                    }
+                    drawText(renderer,
+                             optionRect.x + static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, ellipsize(target.library.string(), maxChars - 16));
+                    std::string freeText = target.hasFree ? formatBytes(target.freeBytes) + " free" : "";
+                    drawText(renderer,
+                             optionRect.x + optionRect.w - textWidth(fontScale, freeText) - static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, freeText);
+                }
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
+                         smallScale, modalText, "A: Move  B: Back");
+            } else if (mode == Mode::SteamScan) {
+                int lineStep = static_cast<int>(std::round(28.0f * uiScale));
+                int infoY = modal.y + padding + static_cast<int>(std::round(40.0f * uiScale));
+                int maxChars = (modal.w - padding * 2 - static_cast<int>(std::round(20.0f * uiScale))) / (8 * fontScale + fontScale);
+                drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText,
+                         ellipsize("Add games in " + steamScan.root.filename().string(), maxChars));
+                int selectedCount = static_cast<int>(std::count_if(steamScan.items.begin(), steamScan.items.end(),
+                                                                   [](const SteamScanItem& item) { return item.selected; }));
+                drawText(renderer, modal.x + padding, infoY, smallScale, modalText,
+                         "Found " + std::to_string(steamScan.items.size()) + " games in " +
+                             std::to_string(steamScan.folders) + " folders, " + std::to_string(selectedCount) +
+                             " selected");
+
+                int listStartY = infoY + lineStep + static_cast<int>(std::round(8.0f * uiScale));
+                int listEndY = modal.y + modal.h - padding - helpLineHeight - static_cast<int>(std::round(12.0f * uiScale));
+                int listHeight = std::max(0, listEndY - listStartY);
+                int visibleRows = std::max(1, listHeight / optionHeight);
+                int totalItems = static_cast<int>(steamScan.items.size());
+                ensureMenuVisible(steamScan.scroll, steamScan.index, visibleRows, totalItems);
+                for (int row = 0; row < visibleRows; ++row) {
+                    int index = steamScan.scroll + row;
+                    if (index >= totalItems) {
+                        break;
+                    }
+                    const SteamScanItem& item = steamScan.items[static_cast<size_t>(index)];
+                    SDL_Rect optionRect {
+                        modal.x + padding,
+                        listStartY + row * optionHeight,
+                        modal.w - padding * 2,
+                        optionHeight
+                    };
+                    if (index == steamScan.index) {
+                        SDL_SetRenderDrawColor(renderer, 40, 120, 160, 255);
+                        SDL_RenderFillRect(renderer, &optionRect);
+                    }
+                    std::string exeText = item.exe.lexically_relative(steamScan.root).generic_string();
+                    std::string label = std::string(item.selected ? "[x] " : "[ ] ") + item.name +
+                                        (item.inSteam ? " (in Steam)" : "");
+                    int labelChars = std::max(8, maxChars - 4 - std::min(static_cast<int>(exeText.size()), maxChars / 2));
+                    drawText(renderer,
+                             optionRect.x + static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, ellipsize(label, labelChars));
+                    exeText = ellipsize(exeText, maxChars / 2);
+                    drawText(renderer,
+                             optionRect.x + optionRect.w - textWidth(fontScale, exeText) - static_cast<int>(std::round(10.0f * uiScale)),
+                             optionRect.y + static_cast<int>(std::round(6.0f * uiScale)),
+                             fontScale, modalText, exeText);
+                }
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
+                         smallScale, modalText, "A: Select  X: Add to Steam  B: Cancel");
+            } else if (mode == Mode::Diagnostics) {
+                int lineStep = static_cast<int>(std::round(28.0f * uiScale));
+                int infoY = modal.y + padding + static_cast<int>(std::round(40.0f * uiScale));
+                drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText, "Network Stats");
+                std::string serverLabel = settings.ftpHost.empty() ? "Server: (unset)" : "Server: " + ftpServerKey(settings);
+                drawText(renderer, modal.x + padding, infoY, smallScale, modalText, serverLabel);
+                std::string speedLabel = "Speed test: not run";
+                if (speedTest.hasResult) {
+                    speedLabel = "Speed test: up " + formatRate(speedTest.uploadBytesPerSecond) + ", down " +
+                                 formatRate(speedTest.downloadBytesPerSecond) + ", RTT " + formatMillis(speedTest.rttMs) + " ms";
+                }
+                drawText(renderer, modal.x + padding, infoY + lineStep, smallScale, modalText, speedLabel);
+                drawText(renderer, modal.x + padding, infoY + lineStep * 2, smallScale, modalText,
+                         "Times in ms from request start, median / 90th percentile of the last " +
+                             std::to_string(kFtpStatsWindow) + " requests");
+
+                // Column offsets in characters of the small font.
+                const int columns[] = {0, 15, 24, 38, 52, 66, 80};
+                const char* headers[] = {"Operation", "Count", "Connect", "Ready", "First byte", "Total", "Speed"};
+                int charWidth = 8 * smallScale + smallScale;
+                int tableY = infoY + lineStep * 3 + static_cast<int>(std::round(8.0f * uiScale));
+                SDL_Color headerText {150, 200, 170, 255};
+                for (size_t c = 0; c < 7; ++c) {
+                    drawText(renderer, modal.x + padding + columns[c] * charWidth, tableY, smallScale, headerText, headers[c]);
+                }
+                std::vector<FtpOperationSummary> summaries = summarizeFtpStats(ftpServerKey(settings));
+                if (summaries.empty()) {
+                    drawText(renderer, modal.x + padding, tableY + lineStep, fontScale, modalText, "No FTP activity yet");
+                }
+                int rowY = tableY + lineStep;
+                int rowEndY = modal.y + modal.h - padding - helpLineHeight - static_cast<int>(std::round(12.0f * uiScale));
+                for (const auto& summary : summaries) {
+                    if (rowY + lineStep > rowEndY) {
+                        break;
+                    }
+                    auto pair = [](double median, double p90) {
+                        return formatMillis(median) + " / " + formatMillis(p90);
+                    };
+                    bool localOnly = summary.operation == kFtpParseOperation;
+                    std::string cells[] = {
+                        summary.operation,
+                        std::to_string(summary.count) + (summary.failures > 0 ? " (" + std::to_string(summary.failures) + " err)" : ""),
+                        localOnly ? "-" : pair(summary.median.connectMs, summary.p90.connectMs),
+                        localOnly ? "-" : pair(summary.median.readyMs, summary.p90.readyMs),
+                        localOnly ? "-" : pair(summary.median.firstByteMs, summary.p90.firstByteMs),
+                        pair(summary.median.totalMs, summary.p90.totalMs),
+                        localOnly ? "-" : formatRate(summary.median.bytesPerSecond),
+                    };
+                    for (size_t c = 0; c < 7; ++c) {
+                        drawText(renderer, modal.x + padding + columns[c] * charWidth, rowY, smallScale, modalText, cells[c]);
+                    }
+                    rowY += lineStep;
+                }
+                drawText(renderer,
+                         modal.x + padding,
+                         modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
+                         smallScale, modalText, "A: Speed Test  X: Clear  B: Close");
             } else if (mode == Mode::AppMenu) {
                 drawText(renderer, modal.x + padding, modal.y + padding, fontScale, modalText, "Menu");
                 for (size_t i = 0; i < appMenuOptions.size(); ++i) {
@@ -4108,6 +7460,12 @@ int main(int argc, char** argv) {
                         label += ": " + (settings.ftpUser.empty() ? "(unset)" : settings.ftpUser);
                     } else if (settingsOptions[i] == "FTP Password") {
                         label += ": " + (settings.ftpPass.empty() ? "(unset)" : maskPassword(settings.ftpPass));
+                    } else if (settingsOptions[i] == "FTP Encryption") {
+                        label += ": " + formatFtpTls(settings.ftpTls);
+                    } else if (settingsOptions[i] == "FTP Cache Size") {
+                        label += ": " + formatCacheLimit(settings.ftpCacheLimitMb);
+                    } else if (settingsOptions[i] == "FTP Search Depth") {
+                        label += ": " + std::to_string(settings.ftpSearchDepth);
                     } else if (settingsOptions[i] == "Steam Launch Options") {
                         label += ": " + (settings.steamLaunchOptions.empty() ? "(unset)" : settings.steamLaunchOptions);
                     } else if (settingsOptions[i] == "Steam Compatibility Tool") {
@@ -4116,6 +7474,8 @@ int main(int argc, char** argv) {
                         label += ": " + formatScale(settings.uiScale);
                     } else if (settingsOptions[i] == "Show Hidden") {
                         label += ": " + std::string(settings.showHidden ? "Yes" : "No");
+                    } else if (settingsOptions[i] == "Verify FTP Transfers") {
+                        label += ": " + std::string(settings.ftpVerify ? "Yes" : "No");
                     }
                     drawText(renderer,
                              optionRect.x + static_cast<int>(std::round(10.0f * uiScale)),
@@ -4125,7 +7485,7 @@ int main(int argc, char** argv) {
                 drawText(renderer,
                          modal.x + padding,
                          modal.y + modal.h - padding - static_cast<int>(std::round(10.0f * uiScale)),
-                         smallScale, modalText, "A: Edit  B: Back  Left/Right: Scale/Hidden");
+                         smallScale, modalText, "A: Edit  B: Back  Left/Right: Adjust");
             } else if (mode == Mode::EditSetting) {
                 std::string editTitle = "Edit ";
                 if (editField == SettingField::FtpHost) {
@@ -4239,7 +7599,14 @@ int main(int argc, char** argv) {
         saveFavorites(favorites, favoritesPath);
     }
 
+    stopFtpSearch(ftpSearch);
+    archiveIndexCancel = true;
+    if (archiveIndexJob.valid()) {
+        archiveIndexJob.wait();
+    }
 #ifdef USE_CURL
+    drainFtpHandlePool();
+    releaseCurlShare();
     curl_global_cleanup();
 #endif
 